@@ -0,0 +1,66 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Compare the memory planned for the intermediate tensors of networks,
+with and without reordering the calls for memory.
+see README.md for the usage and results of this script.
+"""
+import argparse
+
+from tvm import relay
+from tvm.relay import testing
+
+
+def get_network(name, batch_size):
+    if name == "mobilenet":
+        return testing.mobilenet.get_workload(batch_size=batch_size)
+    if name == "inception_v3":
+        return testing.inception_v3.get_workload(batch_size=batch_size)
+    if "resnet" in name:
+        n_layer = int(name.split('-')[1])
+        return testing.resnet.get_workload(num_layers=n_layer, batch_size=batch_size)
+    raise ValueError("Unsupported network: " + name)
+
+
+def plan(mod, params, required_pass):
+    with relay.build_config(opt_level=3, required_pass=required_pass):
+        mod, _ = relay.optimize(mod, target="llvm", params=params)
+    planned, token, peak = [
+        v.value for v in relay.backend._backend.GraphPlanMemoryStats(mod["main"])]
+    return token, planned, peak
+
+
+def benchmark(network, batch_size):
+    mod, params = get_network(network, batch_size)
+    for order, required_pass in [("original", []), ("scheduled", ["ScheduleForMemory"])]:
+        res = plan(mod, params, required_pass)
+        print("%-14s %-10s %-12s %-12s %-12s" % (
+            network, order, *["%.2f" % (v / 2.0 ** 20) for v in res]))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--network", type=str, nargs="+",
+                        default=["mobilenet", "inception_v3"])
+    parser.add_argument("--batch-size", type=int, default=1)
+    args = parser.parse_args()
+
+    print("--------------------------------------------------------------------")
+    print("%-14s %-10s %-12s %-12s %-12s" % ("Network", "Order", "Token (MB)",
+                                             "Offset (MB)", "Peak (MB)"))
+    print("--------------------------------------------------------------------")
+    for net in args.network:
+        benchmark(net, args.batch_size)
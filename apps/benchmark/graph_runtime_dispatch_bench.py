@@ -0,0 +1,88 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark the per-op dispatch overhead of the graph runtime,
+comparing the default executors with the call table.
+see README.md for the usage and results of this script.
+"""
+import argparse
+import json
+
+import numpy as np
+
+import tvm
+from tvm import te
+from tvm.contrib import graph_runtime
+
+
+def build_chain(num_ops, size):
+    """Build a graph of num_ops chained tiny element-wise ops."""
+    A = te.placeholder((size,), name='A')
+    B = te.compute(A.shape, lambda *i: A(*i) + 1.0, name='B')
+    s = te.create_schedule(B.op)
+    mlib = tvm.build(s, [A, B], "llvm", name="myadd")
+
+    nodes = [{"op": "null", "name": "x", "inputs": []}]
+    for i in range(num_ops):
+        nodes.append({"op": "tvm_op", "name": "add%d" % i,
+                      "inputs": [[i, 0, 0]],
+                      "attrs": {"func_name": "myadd",
+                                "flatten_data": "0",
+                                "num_inputs": "1",
+                                "num_outputs": "1"}})
+    shape = (size,)
+    graph = json.dumps({
+        "nodes": nodes,
+        "arg_nodes": [0],
+        "node_row_ptr": list(range(num_ops + 2)),
+        "heads": [[num_ops, 0, 0]],
+        "attrs": {
+            "shape": ["list_shape", [shape] * (num_ops + 1)],
+            "dltype": ["list_str", ["float32"] * (num_ops + 1)],
+            "storage_id": ["list_int", [0] + [1 + i % 2 for i in range(num_ops)]],
+        }})
+    return graph, mlib
+
+
+def benchmark(num_ops, size):
+    graph, mlib = build_chain(num_ops, size)
+    ctx = tvm.cpu(0)
+    mod = graph_runtime.create(graph, mlib, ctx)
+    mod.set_input("x", np.zeros(size, dtype="float32"))
+    for mode, enable in [("executors", False), ("call-table", True)]:
+        mod.use_call_table(enable)
+        ftimer = mod.module.time_evaluator("run", ctx, number=args.number, repeat=args.repeat)
+        res = np.array(ftimer().results) * 1e9 / num_ops  # nanoseconds per op
+        print("%-8d %-8d %-12s %-12s %-12s" % (
+            num_ops, size, mode, "%.1f" % np.median(res), "%.1f" % np.min(res)))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--num-ops", type=int, nargs="+", default=[100, 500],
+                        help="The number of ops in the chain")
+    parser.add_argument("--size", type=int, default=1,
+                        help="The number of elements processed by each op")
+    parser.add_argument("--number", type=int, default=100)
+    parser.add_argument("--repeat", type=int, default=10)
+    args = parser.parse_args()
+
+    print("--------------------------------------------------------------")
+    print("%-8s %-8s %-12s %-12s %-12s" % ("Ops", "Size", "Mode",
+                                           "median (ns)", "min (ns)"))
+    print("--------------------------------------------------------------")
+    for n in args.num_ops:
+        benchmark(n, args.size)
@@ -0,0 +1,104 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Measure the wall time of relay.build for networks with a number of build threads.
+see README.md for the usage and results of this script.
+"""
+import argparse
+import os
+import time
+
+import numpy as np
+from tvm import relay
+from tvm.relay import testing
+
+
+def bert(num_layers=12, seq_len=128, hidden=768, num_heads=12, batch_size=1):
+    """A BERT encoder, with a different weight for every layer."""
+    head = hidden // num_heads
+    x = relay.var("data", shape=(batch_size * seq_len, hidden))
+
+    def weight(name, shape):
+        return relay.var(name, shape=shape)
+
+    def dense(data, name, units, in_units):
+        y = relay.nn.dense(data, weight(name + "_weight", (units, in_units)))
+        return relay.nn.bias_add(y, weight(name + "_bias", (units,)))
+
+    def layer_norm(data, name):
+        return relay.nn.layer_norm(data, weight(name + "_gamma", (hidden,)),
+                                   weight(name + "_beta", (hidden,)))
+
+    def heads(data):
+        data = relay.reshape(data, (batch_size, seq_len, num_heads, head))
+        data = relay.transpose(data, (0, 2, 1, 3))
+        return relay.reshape(data, (batch_size * num_heads, seq_len, head))
+
+    for i in range(num_layers):
+        name = "layer%d" % i
+        q = heads(dense(x, name + "_query", hidden, hidden))
+        k = heads(dense(x, name + "_key", hidden, hidden))
+        v = heads(dense(x, name + "_value", hidden, hidden))
+        score = relay.nn.batch_matmul(q, k) * relay.const(1.0 / np.sqrt(head))
+        prob = relay.nn.softmax(score)
+        ctx = relay.nn.batch_matmul(prob, relay.transpose(v, (0, 2, 1)))
+        ctx = relay.reshape(ctx, (batch_size, num_heads, seq_len, head))
+        ctx = relay.reshape(relay.transpose(ctx, (0, 2, 1, 3)), (batch_size * seq_len, hidden))
+        x = layer_norm(x + dense(ctx, name + "_output", hidden, hidden), name + "_ln1")
+        ffn = relay.nn.relu(dense(x, name + "_ffn1", 4 * hidden, hidden))
+        x = layer_norm(x + dense(ffn, name + "_ffn2", hidden, 4 * hidden), name + "_ln2")
+    func = relay.Function(relay.analysis.free_vars(x), x)
+    return testing.create_workload(func)
+
+
+def get_network(name, batch_size):
+    if name == "bert":
+        return bert(batch_size=batch_size)
+    if "resnet" in name:
+        n_layer = int(name.split('-')[1])
+        return testing.resnet.get_workload(num_layers=n_layer, batch_size=batch_size)
+    raise ValueError("Unsupported network: " + name)
+
+
+def benchmark(network, batch_size, num_threads, repeat):
+    mod, params = get_network(network, batch_size)
+    for threads in num_threads:
+        os.environ["TVM_BUILD_NUM_THREADS"] = str(threads)
+        costs = []
+        for _ in range(repeat):
+            # Lower every function again, rather than from the compile engine cache.
+            relay.backend.compile_engine.get().clear()
+            start = time.time()
+            with relay.build_config(opt_level=3):
+                relay.build(mod, target="llvm", params=params)
+            costs.append(time.time() - start)
+        print("%-14s %-10d %-12.2f" % (network, threads, min(costs)))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--network", type=str, nargs="+", default=["resnet-50", "bert"])
+    parser.add_argument("--batch-size", type=int, default=1)
+    parser.add_argument("--num-threads", type=int, nargs="+",
+                        default=[1, os.cpu_count() or 1])
+    parser.add_argument("--repeat", type=int, default=3)
+    args = parser.parse_args()
+
+    print("--------------------------------------------------")
+    print("%-14s %-10s %-12s" % ("Network", "Threads", "Build (s)"))
+    print("--------------------------------------------------")
+    for net in args.network:
+        benchmark(net, args.batch_size, args.num_threads, args.repeat)
@@ -0,0 +1,72 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Measure the time of the Relay passes on the very deep graph of an unrolled RNN.
+see README.md for the usage and results of this script.
+"""
+import argparse
+import time
+
+import tvm
+from tvm import relay
+from tvm.relay import transform
+
+
+def unrolled_rnn(num_nodes, hidden=16):
+    """An RNN cell unrolled into a chain of num_nodes operators."""
+    x = relay.var("x", shape=(1, hidden))
+    w = relay.var("w", shape=(hidden, hidden))
+    bias = relay.const(0.5)
+    h = x
+    for _ in range(num_nodes // 4):
+        # Each step goes through a tuple, so that every kind of dataflow node is deep.
+        gates = relay.Tuple([relay.nn.dense(h, w), x])
+        h = relay.tanh(relay.add(relay.TupleGetItem(gates, 0), bias))
+    return relay.Function([x, w], h)
+
+
+PASSES = [
+    ("InferType", transform.InferType),
+    ("FoldConstant", transform.FoldConstant),
+    ("FuseOps", transform.FuseOps),
+    ("ToANormalForm", transform.ToANormalForm),
+]
+
+
+def benchmark(num_nodes, repeat):
+    func = unrolled_rnn(num_nodes)
+    for name, create_pass in PASSES:
+        costs = []
+        for _ in range(repeat):
+            mod = tvm.IRModule.from_expr(func)
+            start = time.time()
+            create_pass()(mod)
+            costs.append(time.time() - start)
+        print("%-16s %-10d %-12.3f" % (name, num_nodes, min(costs)))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--num-nodes", type=int, nargs="+", default=[10000, 50000])
+    parser.add_argument("--repeat", type=int, default=3)
+    args = parser.parse_args()
+
+    print("--------------------------------------------------")
+    print("%-16s %-10s %-12s" % ("Pass", "Nodes", "Time (s)"))
+    print("--------------------------------------------------")
+
+    for n in args.num_nodes:
+        benchmark(n, args.repeat)
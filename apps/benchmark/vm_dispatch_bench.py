@@ -0,0 +1,102 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark the per-instruction dispatch overhead of the Relay VM
+on control-flow heavy programs with tiny tensors.
+see README.md for the usage and results of this script.
+"""
+import argparse
+import time
+
+import numpy as np
+
+import tvm
+from tvm import relay
+from tvm.runtime import vm as vm_rt
+from tvm.relay.scope_builder import ScopeBuilder
+
+
+def build_countdown():
+    """A recursive countdown, mostly If, Invoke and scalar ops."""
+    mod = tvm.IRModule({})
+    count = relay.GlobalVar('count')
+    i = relay.var('i', shape=[], dtype='int32')
+    accum = relay.var('accum', shape=[], dtype='int32')
+    sb = ScopeBuilder()
+    with sb.if_scope(relay.equal(i, relay.const(0, 'int32'))):
+        sb.ret(accum)
+    with sb.else_scope():
+        sb.ret(count(relay.subtract(i, relay.const(1, 'int32')),
+                     relay.add(accum, relay.const(1, 'int32'))))
+    mod[count] = relay.Function([i, accum], sb.get())
+    n = relay.var('n', shape=[], dtype='int32')
+    mod["main"] = relay.Function([n], count(n, relay.const(0, 'int32')))
+    return mod
+
+
+def build_tuple_loop():
+    """A recursive loop carrying its state in a tuple, adding AllocADT and GetField."""
+    mod = tvm.IRModule({})
+    loop = relay.GlobalVar('loop')
+    ty = relay.TensorType([], 'int32')
+    state = relay.var('state', relay.TupleType([ty, ty]))
+    i = relay.TupleGetItem(state, 0)
+    accum = relay.TupleGetItem(state, 1)
+    sb = ScopeBuilder()
+    with sb.if_scope(relay.equal(i, relay.const(0, 'int32'))):
+        sb.ret(accum)
+    with sb.else_scope():
+        sb.ret(loop(relay.Tuple([relay.subtract(i, relay.const(1, 'int32')),
+                                 relay.add(accum, i)])))
+    mod[loop] = relay.Function([state], sb.get())
+    n = relay.var('n', shape=[], dtype='int32')
+    mod["main"] = relay.Function([n], loop(relay.Tuple([n, relay.const(0, 'int32')])))
+    return mod
+
+
+def benchmark(name, mod, n):
+    exe = relay.vm.compile(mod, "llvm")
+    vm = vm_rt.VirtualMachine(exe)
+    vm.init(tvm.cpu())
+    arg = np.array(n, dtype='int32')
+    vm.invoke("main", arg)
+    costs = []
+    for _ in range(args.repeat):
+        executed = vm.get_num_executed()
+        start = time.perf_counter()
+        vm.invoke("main", arg)
+        elapsed = time.perf_counter() - start
+        costs.append((elapsed, vm.get_num_executed() - executed))
+    elapsed, num_instr = min(costs)
+    print("%-12s %-8d %-12d %-12s %-12s" % (
+        name, n, num_instr, "%.2f" % (num_instr / elapsed / 1e6),
+        "%.1f" % (elapsed * 1e9 / num_instr)))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--n", type=int, nargs="+", default=[1000, 10000],
+                        help="The number of iterations of each loop")
+    parser.add_argument("--repeat", type=int, default=10)
+    args = parser.parse_args()
+
+    print("--------------------------------------------------------------")
+    print("%-12s %-8s %-12s %-12s %-12s" % ("Workload", "N", "Instrs",
+                                           "M instr/s", "ns/instr"))
+    print("--------------------------------------------------------------")
+    for n in args.n:
+        benchmark("countdown", build_countdown(), n)
+        benchmark("tuple-loop", build_tuple_loop(), n)
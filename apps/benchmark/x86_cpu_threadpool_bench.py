@@ -0,0 +1,110 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark the tail latency of x86 conv2d schedules under background load,
+comparing the static and the work-stealing schedule of the thread pool.
+see README.md for the usage and results of this script.
+"""
+import argparse
+import multiprocessing
+
+import numpy as np
+
+import tvm
+from tvm import te
+import topi
+
+# (batch, in_channel, height, width, out_channel, kernel, stride, padding)
+WORKLOADS = {
+    'resnet-conv2': (1, 64, 56, 56, 64, 3, 1, 1),
+    'resnet-conv7': (1, 128, 28, 28, 128, 3, 1, 1),
+    'resnet-conv10': (1, 256, 14, 14, 256, 3, 1, 1),
+}
+
+SCHEDULES = {'static': 0, 'work-stealing': 1}
+
+
+def _background_load():
+    """Spin forever to steal a core from the thread pool."""
+    x = 0
+    while True:
+        x += 1
+
+
+def build_conv2d(workload, target):
+    batch, in_channel, size, _, out_channel, kernel, stride, padding = workload
+    data = te.placeholder((batch, in_channel, size, size), name='data')
+    weight = te.placeholder((out_channel, in_channel, kernel, kernel), name='weight')
+    with tvm.target.create(target):
+        conv = topi.x86.conv2d_nchw(data, weight, (stride, stride), (padding, padding),
+                                    (1, 1), 'float32')
+        s = topi.x86.schedule_conv2d_nchw([conv])
+    func = tvm.build(s, [data, weight, conv], target)
+    ctx = tvm.cpu(0)
+    tensors = [tvm.nd.array(np.random.uniform(size=[x.value for x in t.shape])
+                            .astype('float32'), ctx)
+               for t in [data, weight, conv]]
+    return func, tensors
+
+
+def benchmark(name, workload, target):
+    func, tensors = build_conv2d(workload, target)
+    ctx = tvm.cpu(0)
+    config_threadpool = tvm.get_global_func('runtime.config_threadpool')
+    for sched_name, sched in SCHEDULES.items():
+        # big cores, all threads, chosen schedule
+        config_threadpool(1, 0, sched, args.chunks)
+        ftimer = func.time_evaluator(func.entry_name, ctx, number=1, repeat=args.repeat)
+        res = np.array(ftimer(*tensors).results) * 1000  # multiply 1000 for converting to millisecond
+        print("%-16s %-14s %-10s %-10s %-10s" % (
+            name, sched_name, "%.3f" % np.percentile(res, 50),
+            "%.3f" % np.percentile(res, 99), "%.3f" % np.max(res)))
+    config_threadpool(1, 0, SCHEDULES['static'])
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--workload", type=str, choices=list(WORKLOADS.keys()),
+                        help='The conv2d workload, all of them if not given')
+    parser.add_argument("--target", type=str, default='llvm -mcpu=core-avx2',
+                        help="The tvm compilation target")
+    parser.add_argument("--repeat", type=int, default=1000)
+    parser.add_argument("--chunks", type=int, default=4,
+                        help="The number of tasks per worker of the work-stealing schedule")
+    parser.add_argument("--background", type=int, default=1,
+                        help="The number of busy processes competing with the thread pool")
+    args = parser.parse_args()
+
+    if args.workload is None:
+        workloads = list(WORKLOADS.keys())
+    else:
+        workloads = [args.workload]
+
+    loads = [multiprocessing.Process(target=_background_load, daemon=True)
+             for _ in range(args.background)]
+    for p in loads:
+        p.start()
+
+    print("--------------------------------------------------------------")
+    print("%-16s %-14s %-10s %-10s %-10s" % ("Workload", "Schedule", "p50 (ms)",
+                                             "p99 (ms)", "max (ms)"))
+    print("--------------------------------------------------------------")
+    try:
+        for wkl in workloads:
+            benchmark(wkl, WORKLOADS[wkl], args.target)
+    finally:
+        for p in loads:
+            p.terminate()
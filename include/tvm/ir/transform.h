@@ -76,6 +76,51 @@ using TraceFunc =
                                 const PassInfo& ctx,
                                 bool is_before)>;
 
+/*!
+ * \brief The measurements of a pass invocation, recorded when the pass
+ *  context profiles the passes.
+ * \sa PassProfile
+ */
+class PassProfileNode : public Object {
+ public:
+  /*! \brief The name of the pass. */
+  std::string name;
+  /*! \brief The wall time of the pass, including the passes it ran, in microseconds. */
+  int64_t duration_us{0};
+  /*! \brief The number of distinct IR nodes reachable from the input module. */
+  int64_t num_nodes_before{0};
+  /*! \brief The number of distinct IR nodes reachable from the output module. */
+  int64_t num_nodes_after{0};
+  /*!
+   * \brief The number of IR nodes reachable from the output module and not from
+   *  the input module, i.e. the nodes the pass created and kept.
+   */
+  int64_t num_new_nodes{0};
+  /*! \brief The PassProfile of the passes run by the pass, in order. */
+  Array<ObjectRef> children;
+
+  void VisitAttrs(AttrVisitor* v) {
+    v->Visit("name", &name);
+    v->Visit("duration_us", &duration_us);
+    v->Visit("num_nodes_before", &num_nodes_before);
+    v->Visit("num_nodes_after", &num_nodes_after);
+    v->Visit("num_new_nodes", &num_new_nodes);
+    v->Visit("children", &children);
+  }
+
+  static constexpr const char* _type_key = "transform.PassProfile";
+  TVM_DECLARE_FINAL_OBJECT_INFO(PassProfileNode, Object);
+};
+
+/*!
+ * \brief Managed reference class for PassProfileNode
+ * \sa PassProfileNode
+ */
+class PassProfile : public ObjectRef {
+ public:
+  TVM_DEFINE_MUTABLE_OBJECT_REF_METHODS(PassProfile, ObjectRef, PassProfileNode);
+};
+
 /*!
  * \brief PassContextNode contains the information that a pass can rely on,
  * such as analysis results.
@@ -101,6 +146,16 @@ class PassContextNode : public Object {
 
   TraceFunc trace_func;
 
+  /*! \brief Whether to record a PassProfile of every pass invocation. */
+  bool profile_passes{false};
+  /*! \brief The profiles of the outermost passes run in the context. */
+  Array<PassProfile> pass_profiles;
+
+  /*! \brief Whether the graph runtime plans its tensors at offsets in a single arena. */
+  bool plan_memory_offset{false};
+  /*! \brief Whether the VM compiler fuses recurring instruction sequences, from opt_level 1. */
+  bool fuse_bytecode{true};
+
   PassContextNode() = default;
 
   void VisitAttrs(AttrVisitor* v) {
@@ -108,6 +163,9 @@ class PassContextNode : public Object {
     v->Visit("fallback_device", &fallback_device);
     v->Visit("required_pass", &required_pass);
     v->Visit("disabled_pass", &disabled_pass);
+    v->Visit("profile_passes", &profile_passes);
+    v->Visit("plan_memory_offset", &plan_memory_offset);
+    v->Visit("fuse_bytecode", &fuse_bytecode);
   }
 
   static constexpr const char* _type_key = "transform.PassContext";
@@ -278,25 +336,18 @@ class Pass : public ObjectRef {
    *
    * \return The transformed module.
    */
-  IRModule operator()(const IRModule& mod) const {
-    const PassNode* node = operator->();
-    CHECK(node != nullptr);
-    return node->operator()(mod);
-  }
+  TVM_DLL IRModule operator()(const IRModule& mod) const;
   /*!
-   * \brief Transform mod using a functor under a given pass context.
+   * \brief Transform mod using a functor under a given pass context, and
+   *  record its profile when the context profiles the passes.
    *
    * \param mod The module that an optimization pass runs on.
    * \param pass_ctx The pass context that can provide information for the optimization.
    *
    * \return The transformed module.
    */
-  IRModule operator()(const IRModule& mod,
-                      const PassContext& pass_ctx) const {
-    const PassNode* node = operator->();
-    CHECK(node != nullptr);
-    return node->operator()(mod, pass_ctx);
-  }
+  TVM_DLL IRModule operator()(const IRModule& mod,
+                              const PassContext& pass_ctx) const;
 
   TVM_DEFINE_OBJECT_REF_METHODS(Pass, ObjectRef, PassNode);
 };
@@ -38,6 +38,7 @@ struct AllocTensorAttrs : public tvm::AttrsNode<AllocTensorAttrs> {
   Constant const_shape;
   Array<IndexExpr> assert_shape;
   DataType dtype;
+  int64_t offset;
 
   TVM_DECLARE_ATTRS(AllocTensorAttrs, "relay.attrs.AllocTensorAttrs") {
     TVM_ATTR_FIELD(dtype)
@@ -51,6 +52,10 @@ struct AllocTensorAttrs : public tvm::AttrsNode<AllocTensorAttrs> {
       .describe(
          "The shape to cast the return type of the allocation to, "\
          "used to specify the shape obtained via further analysis.");
+    TVM_ATTR_FIELD(offset)
+      .describe(
+         "The byte offset of the tensor in its storage.")
+      .set_default(0);
   }
 };
 
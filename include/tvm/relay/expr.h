@@ -99,6 +99,9 @@ class TupleNode : public ExprNode {
 
   TVM_DLL static Tuple make(tvm::Array<relay::Expr> fields);
 
+  /*! \brief Destroy the node, releasing deep chains of operands without recursion. */
+  TVM_DLL ~TupleNode();
+
   static constexpr const char* _type_key = "relay.Tuple";
   TVM_DECLARE_FINAL_OBJECT_INFO(TupleNode, ExprNode);
 };
@@ -220,6 +223,9 @@ class CallNode : public ExprNode {
                            Attrs attrs = Attrs(),
                            Array<Type> type_args = Array<Type>());
 
+  /*! \brief Destroy the node, releasing deep chains of operands without recursion. */
+  TVM_DLL ~CallNode();
+
   static constexpr const char* _type_key = "relay.Call";
   TVM_DECLARE_FINAL_OBJECT_INFO(CallNode, ExprNode);
 };
@@ -261,6 +267,9 @@ class LetNode : public ExprNode {
 
   TVM_DLL static Let make(Var var, Expr value, Expr body);
 
+  /*! \brief Destroy the node, releasing deep chains of operands without recursion. */
+  TVM_DLL ~LetNode();
+
   static constexpr const char* _type_key = "relay.Let";
   TVM_DECLARE_FINAL_OBJECT_INFO(LetNode, ExprNode);
 };
@@ -329,6 +338,9 @@ class TupleGetItemNode : public ExprNode {
 
   TVM_DLL static TupleGetItem make(Expr tuple, int index);
 
+  /*! \brief Destroy the node, releasing deep chains of operands without recursion. */
+  TVM_DLL ~TupleGetItemNode();
+
   static constexpr const char* _type_key = "relay.TupleGetItem";
   TVM_DECLARE_FINAL_OBJECT_INFO(TupleGetItemNode, ExprNode);
 };
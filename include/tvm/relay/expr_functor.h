@@ -32,9 +32,11 @@
 #include <tvm/relay/adt.h>
 #include <tvm/relay/op.h>
 
+#include <cstdint>
 #include <string>
 #include <utility>
 #include <unordered_map>
+#include <vector>
 
 namespace tvm {
 namespace relay {
@@ -232,6 +234,244 @@ class ExprMutator
   std::unordered_map<Expr, Expr, ObjectHash, ObjectEqual> memo_;
 };
 
+/*!
+ * \brief A memo table from expressions to values.
+ *
+ *  The values are stored densely in insertion order, and found through an
+ *  open addressing index on the address of the expressions, rather than
+ *  through a node allocated per entry and a hash of the expression as in
+ *  std::unordered_map. The table keeps its keys alive, so that their
+ *  addresses are not reused while it is.
+ *
+ * \tparam T The type of the values, which cannot be bool.
+ */
+template <typename T>
+class DenseExprMemo {
+ public:
+  /*!
+   * \brief Find the value of an expression.
+   * \param expr The expression.
+   * \return The value, or nullptr when there is none. The pointer is
+   *  invalidated by the next Insert.
+   */
+  T* Find(const Object* expr) {
+    return const_cast<T*>(static_cast<const DenseExprMemo*>(this)->Find(expr));
+  }
+
+  /*!
+   * \brief Find the value of an expression.
+   * \param expr The expression.
+   * \return The value, or nullptr when there is none.
+   */
+  const T* Find(const Object* expr) const {
+    if (slots_.empty()) return nullptr;
+    size_t mask = slots_.size() - 1;
+    for (size_t i = Hash(expr); ; i = (i + 1) & mask) {
+      size_t slot = slots_[i];
+      if (slot == 0) return nullptr;
+      if (keys_[slot - 1].get() == expr) return &values_[slot - 1];
+    }
+  }
+
+  /*!
+   * \brief Get the value of an expression, inserting a default one when
+   *  there is none, as std::unordered_map::operator[] does.
+   * \param expr The expression.
+   * \return The value, invalidated by the next Insert.
+   */
+  T& operator[](const Expr& expr) {
+    if (T* value = Find(expr.get())) return *value;
+    Insert(expr, T());
+    return values_.back();
+  }
+
+  /*!
+   * \brief Set the value of an expression, replacing any previous one.
+   * \param expr The expression.
+   * \param value The value.
+   */
+  void Insert(const Expr& expr, T value) {
+    if (T* old = Find(expr.get())) {
+      *old = std::move(value);
+      return;
+    }
+    // Keep the index at most half full.
+    if ((keys_.size() + 1) * 2 > slots_.size()) {
+      Rehash(slots_.empty() ? 16 : slots_.size() * 2);
+    }
+    keys_.push_back(expr);
+    values_.push_back(std::move(value));
+    Place(expr.get(), keys_.size());
+  }
+
+  /*! \return The number of expressions in the table. */
+  size_t size() const { return keys_.size(); }
+
+  /*! \brief Remove all the expressions. */
+  void Clear() {
+    keys_.clear();
+    values_.clear();
+    slots_.clear();
+  }
+
+ private:
+  /*! \brief The first slot to probe for an expression. */
+  size_t Hash(const Object* expr) const {
+    // Fibonacci hashing, taking the high bits of the product.
+    uint64_t h = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(expr)) *
+        0x9E3779B97F4A7C15ULL;
+    return static_cast<size_t>(h >> shift_);
+  }
+
+  /*! \brief Point the first free slot of an expression at an entry. */
+  void Place(const Object* expr, size_t slot) {
+    size_t mask = slots_.size() - 1;
+    size_t i = Hash(expr);
+    while (slots_[i] != 0) i = (i + 1) & mask;
+    slots_[i] = slot;
+  }
+
+  /*! \brief Rebuild the index with a number of slots, a power of two. */
+  void Rehash(size_t num_slots) {
+    slots_.assign(num_slots, 0);
+    shift_ = 64;
+    for (size_t n = num_slots; n > 1; n >>= 1) --shift_;
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      Place(keys_[i].get(), i + 1);
+    }
+  }
+
+  /*! \brief The expressions, in insertion order. */
+  std::vector<Expr> keys_;
+  /*! \brief The values of the expressions. */
+  std::vector<T> values_;
+  /*! \brief The index: one plus the position of an entry, or zero for a free slot. */
+  std::vector<size_t> slots_;
+  /*! \brief The shift of the hash to the number of slots. */
+  int shift_{64};
+};
+
+/*!
+ * \brief Visit the dataflow operands of an expression before the expression,
+ *  with an explicit stack rather than recursion.
+ *
+ *  The arguments of calls, the fields of tuples and the tuples of
+ *  TupleGetItem are expanded, so that chains of them of any length are
+ *  visited in a constant stack depth. Every other expression, including the
+ *  operators of calls to primitive ops, is a leaf which fvisit_leaf may
+ *  recurse into.
+ *
+ * \param expr The expression.
+ * \param fcheck_visited Whether an expression was visited.
+ * \param fvisit_leaf Visit an expression, after its operands.
+ * \param op_first Whether the operator of a call is visited before its
+ *  arguments, as in ExprVisitor, or after them, in evaluation order.
+ */
+template <typename FCheckVisited, typename FVisitLeaf>
+void ExpandDataflow(const Expr& expr,
+                    FCheckVisited fcheck_visited,
+                    FVisitLeaf fvisit_leaf,
+                    bool op_first = true) {
+  // The expressions to visit, and whether their operands were pushed.
+  std::vector<std::pair<Expr, bool> > stack;
+  auto fpush = [&stack, &fcheck_visited](const Expr& e) {
+    if (!fcheck_visited(e)) stack.emplace_back(e, false);
+  };
+  fpush(expr);
+  while (!stack.empty()) {
+    Expr node = stack.back().first;
+    if (fcheck_visited(node)) {
+      stack.pop_back();
+    } else if (stack.back().second) {
+      stack.pop_back();
+      fvisit_leaf(node);
+    } else {
+      stack.back().second = true;
+      // Push the operands in reverse, so that they are visited in order.
+      if (const CallNode* call = node.as<CallNode>()) {
+        bool expand_op = call->op.as<OpNode>() == nullptr;
+        if (expand_op && !op_first) fpush(call->op);
+        for (size_t i = call->args.size(); i != 0; --i) {
+          fpush(call->args[i - 1]);
+        }
+        if (expand_op && op_first) fpush(call->op);
+      } else if (const TupleNode* tuple = node.as<TupleNode>()) {
+        for (size_t i = tuple->fields.size(); i != 0; --i) {
+          fpush(tuple->fields[i - 1]);
+        }
+      } else if (const TupleGetItemNode* get = node.as<TupleGetItemNode>()) {
+        fpush(get->tuple);
+      }
+    }
+  }
+}
+
+/*!
+ * \brief Visit a chain of lets, each the body of the previous one, with a
+ *  loop rather than recursion.
+ *
+ * \param op The first let of the chain.
+ * \param fpre_visit Visit a let before the lets of its body, from the first.
+ * \param fpost_visit Visit a let after the lets of its body, from the last.
+ */
+template <typename FPreVisit, typename FPostVisit>
+void ExpandANormalForm(const LetNode* op, FPreVisit fpre_visit, FPostVisit fpost_visit) {
+  std::vector<const LetNode*> lets;
+  for (const LetNode* let = op; let != nullptr; let = let->body.as<LetNode>()) {
+    fpre_visit(let);
+    lets.push_back(let);
+  }
+  for (auto it = lets.rbegin(); it != lets.rend(); ++it) {
+    fpost_visit(*it);
+  }
+}
+
+/*!
+ * \brief An ExprVisitor which visits the dataflow operands of an expression
+ *  iteratively, see ExpandDataflow, so that very deep graphs do not overflow
+ *  the stack.
+ *
+ *  The operands of a call, a tuple or a TupleGetItem are visited before the
+ *  VisitExpr_ of the expression, where visiting them again is a memo hit;
+ *  the VisitExpr_ overrides of subclasses must not rely on being called
+ *  before those of the operands. The visited expressions are kept in a
+ *  DenseExprMemo instead of visit_counter_.
+ *
+ *  The lets of a chain of lets are visited with ExpandANormalForm, the
+ *  subclasses which override the VisitExpr_ of LetNode should use it too.
+ */
+class MixedModeVisitor : public ExprVisitor {
+ public:
+  void VisitExpr(const Expr& expr) override;
+  void VisitExpr_(const LetNode* op) override;
+
+ protected:
+  /*! \brief The number of times VisitExpr reached each visited expression. */
+  DenseExprMemo<size_t> dense_visit_counter_;
+};
+
+/*!
+ * \brief An ExprMutator which mutates the dataflow operands of an expression
+ *  iteratively, see ExpandDataflow, so that very deep graphs do not overflow
+ *  the stack.
+ *
+ *  The operands of a call, a tuple or a TupleGetItem are mutated before the
+ *  VisitExpr_ of the expression, where mutating them again is a memo hit.
+ *  The results are memoized in dense_memo_ instead of memo_.
+ *
+ *  The lets of a chain of lets are mutated with ExpandANormalForm, the
+ *  subclasses which override the VisitExpr_ of LetNode should use it too.
+ */
+class MixedModeMutator : public ExprMutator {
+ public:
+  Expr VisitExpr(const Expr& expr) override;
+  Expr VisitExpr_(const LetNode* op) override;
+
+ protected:
+  /*! \brief Internal map used for memoization. */
+  DenseExprMemo<Expr> dense_memo_;
+};
+
 /*!
  * \brief recursively visit the ir in post DFS order node, apply fvisit
  * Each node is guaranteed to be visited only once.
@@ -171,6 +171,14 @@ TVM_DLL Pass SimplifyInference();
  */
 TVM_DLL Pass FastMath();
 
+/*!
+ * \brief Reorder the calls of a function in graph normal form to reduce the
+ *  peak memory of the graph runtime, binding them to lets in the new order.
+ *
+ * \return The Pass.
+ */
+TVM_DLL Pass ScheduleForMemory();
+
 /*!
  * \brief Infer the type of an expression.
  *
@@ -24,6 +24,7 @@
 #ifndef TVM_RUNTIME_THREADING_BACKEND_H_
 #define TVM_RUNTIME_THREADING_BACKEND_H_
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <vector>
@@ -65,6 +66,11 @@ class ThreadGroup {
   enum AffinityMode : int {
     kBig = 1,
     kLittle = -1,
+    /*!
+     * \brief Spread the workers evenly over the NUMA nodes and bind each of
+     *  them to a core of its node, so that a launch can use a per-node team.
+     */
+    kNumaNode = 2,
   };
 
   /*!
@@ -81,6 +87,14 @@ class ThreadGroup {
    */
   int Configure(AffinityMode mode, int nthreads, bool exclude_worker0);
 
+  /*!
+   * \brief Get the NUMA node of each worker under the current configuration.
+   *
+   * \return The node id indexed by worker id, -1 for the workers that are
+   *         not bound to the cores of a single node.
+   */
+  std::vector<int> WorkerNumaNodes() const;
+
  private:
   Impl* impl_;
 };
@@ -95,6 +109,61 @@ void Yield();
  */
 int MaxConcurrency();
 
+/*!
+ * \brief Get the logical CPUs of each NUMA node, discovered from sysfs.
+ *
+ * \return The CPU ids indexed by node id. A single node holding every CPU
+ *         when the topology is unknown.
+ */
+const std::vector<std::vector<unsigned int> >& NumaNodeCpus();
+
+/*!
+ * \brief Get the NUMA node the calling thread is confined to.
+ *
+ * \return The node id if the CPU affinity of the thread only covers CPUs of
+ *         one node and the system has several nodes, -1 otherwise.
+ */
+int CurrentNumaNode();
+
+/*!
+ * \brief Bind the calling thread to the CPUs of one NUMA node.
+ *
+ *  Parallel launches from the thread then use the workers of that node when
+ *  the thread pool is configured with kNumaNode, and the CPU allocations made
+ *  by the thread are placed on the node.
+ *
+ * \param node The node id.
+ */
+void BindToNumaNode(int node);
+
+/*!
+ * \brief Limit the team of the parallel launches made by the calling thread.
+ *
+ *  Threads running independent work concurrently use it to partition the
+ *  thread pool instead of letting the first launch claim every idle worker.
+ *
+ * \param size The maximum number of threads of a launch, including the
+ *        calling thread, 0 for no limit.
+ * \return The previous limit.
+ */
+int SetMaxTeamSize(int size);
+
+/*!
+ * \brief Start or stop accounting the time the thread pool spends running tasks.
+ * \param enable Whether to account it.
+ */
+void SetTaskProfiling(bool enable);
+
+/*!
+ * \brief The time spent running the tasks of parallel launches while task
+ *  profiling was enabled.
+ *
+ *  Only launches on the TVM thread pool are accounted, not OpenMP ones.
+ *
+ * \return The nanoseconds of each thread pool worker, followed by those of
+ *  the threads making the launches.
+ */
+std::vector<int64_t> TaskBusyTime();
 
 }  // namespace threading
 }  // namespace runtime
@@ -29,6 +29,7 @@
 #include <tvm/runtime/packed_func.h>
 #include <tvm/runtime/registry.h>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -38,6 +39,8 @@ namespace tvm {
 namespace runtime {
 namespace vm {
 
+class Allocator;
+
 /*!
  * \brief An object representing a closure. This object is used by both the
  * Relay VM and interpreter.
@@ -113,6 +116,10 @@ enum class Opcode {
   LoadConsti = 14U,
   Fatal = 15U,
   AllocStorage = 16U,
+  InvokeShapeFunc = 17U,
+  // Superinstructions, which only the bytecode fusion of the compiler emits.
+  AllocStorageTensor = 18U,
+  InvokePackedConst = 19U,
 };
 
 /*! \brief A single virtual machine instruction.
@@ -135,6 +142,8 @@ struct Instruction {
     struct /* AllocTensor Operands */ {
       /*! \brief The storage to allocate from. */
       RegName storage;
+      /*! \brief The byte offset of the tensor in the storage. */
+      Index offset;
       /*! \brief The number of dimensions. */
       uint32_t ndim;
       /*! \brief The shape of tensor. */
@@ -166,7 +175,7 @@ struct Instruction {
       /*! \brief The source register for a move operation. */
       RegName from;
     };
-    struct /* InvokePacked Operands */ {
+    struct /* InvokePacked, InvokeShapeFunc and InvokePackedConst Operands */ {
       /*! \brief The index into the packed function table. */
       Index packed_index;
       /*! \brief The arity of the packed function. */
@@ -240,6 +249,20 @@ struct Instruction {
       /*! \brief The hint of the dtype. */
       DLDataType dtype_hint;
     } alloc_storage;
+    struct /* AllocStorageTensor Operands */ {
+      /*! \brief The size of the storage. */
+      Index allocation_size;
+      /*! \brief The alignment of the storage. */
+      Index alignment;
+      /*! \brief The hint of the dtype. */
+      DLDataType dtype_hint;
+      /*! \brief The number of dimensions. */
+      uint32_t ndim;
+      /*! \brief The shape of tensor. */
+      int64_t* shape;
+      /*! \brief The datatype of tensor to be allocated. */
+      DLDataType dtype;
+    } alloc_storage_tensor;
   };
 
   /*!
@@ -263,15 +286,28 @@ struct Instruction {
    */
   static Instruction InvokePacked(Index packed_index, Index arity, Index output_size,
                                   const std::vector<RegName>& args);
+  /*!
+   * \brief Construct an invoke shape function instruction, which invokes a
+   *  packed function computing the output shapes of an operator. The outputs
+   *  are reused when the inputs are the same as in an earlier call.
+   * \param packed_index The index of the packed function.
+   * \param arity The arity of the function.
+   * \param output_size The number of outputs of the packed function.
+   * \param args The argument registers.
+   * \return The invoke shape function instruction.
+   */
+  static Instruction InvokeShapeFunc(Index packed_index, Index arity, Index output_size,
+                                     const std::vector<RegName>& args);
   /*!
    * \brief Construct an allocate tensor instruction with constant shape.
    * \param storage The storage to allocate out of.
+   * \param offset The byte offset of the tensor in the storage.
    * \param shape The shape of the tensor.
    * \param dtype The dtype of the tensor.
    * \param dst The destination register.
    * \return The allocate tensor instruction.
    */
-  static Instruction AllocTensor(RegName storage,
+  static Instruction AllocTensor(RegName storage, Index offset,
                                  const std::vector<int64_t>& shape, DLDataType dtype, RegName dst);
   /*!
    * \brief Construct an allocate tensor instruction with register.
@@ -382,6 +418,36 @@ struct Instruction {
   static Instruction AllocStorage(RegName size, RegName alignment,
                                   DLDataType dtype_hint, RegName dst);
 
+  /*!
+   * \brief Construct an instruction allocating a storage of constant size
+   *  which holds a single tensor of constant shape, fusing an AllocStorage
+   *  and an AllocTensor.
+   * \param size The size of the storage.
+   * \param alignment The alignment of the storage.
+   * \param dtype_hint The data type hint for the allocator.
+   * \param shape The shape of the tensor.
+   * \param dtype The dtype of the tensor.
+   * \param dst The destination register of the tensor.
+   * \return The alloc storage tensor instruction.
+   */
+  static Instruction AllocStorageTensor(Index size, Index alignment, DLDataType dtype_hint,
+                                        const std::vector<int64_t>& shape, DLDataType dtype,
+                                        RegName dst);
+
+  /*!
+   * \brief Construct an invoke packed instruction which reads some of its
+   *  arguments straight from the constant pool, fusing the LoadConst
+   *  instructions of those arguments into an InvokePacked. The argument
+   *  `-1 - i` stands for the constant i rather than a register.
+   * \param packed_index The index of the packed function.
+   * \param arity The arity of the function.
+   * \param output_size The number of outputs of the packed function.
+   * \param args The argument registers and constants.
+   * \return The invoke packed const instruction.
+   */
+  static Instruction InvokePackedConst(Index packed_index, Index arity, Index output_size,
+                                       const std::vector<RegName>& args);
+
   Instruction();
   Instruction(const Instruction& instr);
   Instruction& operator=(const Instruction& instr);
@@ -436,18 +502,22 @@ struct VMFrame {
   /*! \brief A pointer into the caller function's instructions. */
   const Instruction* code;
 
-  /*! \brief Statically allocated space for objects */
-  std::vector<ObjectRef> register_file;
+  /*! \brief The offset of the frame's registers in the register stack. */
+  Index register_base;
+  /*! \brief The number of registers of the frame. */
+  Index register_file_size;
 
   /*! \brief Register in caller's frame to put return value */
   RegName caller_return_register;
 
-  VMFrame(Index pc, Index func_index, Index args, const Instruction* code, Index register_file_size)
+  VMFrame(Index pc, Index func_index, Index args, const Instruction* code,
+          Index register_base, Index register_file_size)
       : pc(pc),
         func_index(func_index),
         args(args),
         code(code),
-        register_file(register_file_size),
+        register_base(register_base),
+        register_file_size(register_file_size),
         caller_return_register(0) {}
 };
 
@@ -494,6 +564,26 @@ class Executable : public ModuleNode {
    */
   static runtime::Module Load(const std::string& code, const runtime::Module lib);
 
+  /*!
+   * \brief Load the saved VM executable from a file. The file is mapped in
+   *  memory where supported, and the constants are bound to it without copying.
+   *
+   * \param path The path to a file holding the bytes returned by Save.
+   * \param lib The compiled runtime library.
+   *
+   * \return exe The constructed executable.
+   */
+  static runtime::Module LoadFile(const std::string& path, const runtime::Module lib);
+
+  /*!
+   * \brief Get a VM function, deserializing its bytecode on first use.
+   *
+   * \param index The index of the function.
+   *
+   * \return The VM function.
+   */
+  const VMFunction& GetVMFunction(Index index) const;
+
   /*!
    * \brief Get the serialized form of the `functions`. This is
    * essentially bytecode serialization.
@@ -574,10 +664,38 @@ class Executable : public ModuleNode {
    * corresponds to the position of the `packed_funcs` list in a `VirtualMachine` object.
    */
   std::unordered_map<std::string, Index> primitive_map;
-  /*! \brief The virtual machine's function table. */
+  /*! \brief The virtual machine's function table. The instructions of a
+   * loaded function are only filled in by GetVMFunction. */
   std::vector<VMFunction> functions;
 
  private:
+  /*! \brief The serialized instructions of a loaded function. */
+  struct LazyBytecode {
+    /*! \brief The serialized instructions. */
+    const char* data;
+    /*! \brief The size of the serialized instructions in bytes. */
+    size_t size;
+    /*! \brief The number of instructions. */
+    size_t num_instructions;
+    /*! \brief Whether the instructions have been deserialized. */
+    std::once_flag loaded;
+  };
+
+  /*!
+   * \brief Load the saved VM executable from a buffer.
+   *
+   * \param data The saved bytes, aligned to kAllocAlignment.
+   * \param size The number of saved bytes.
+   * \param buffer The buffer holding the saved bytes, kept alive by the
+   *  executable and the constants bound to it.
+   * \param lib The compiled runtime library.
+   *
+   * \return exe The constructed executable.
+   */
+  static runtime::Module LoadBuffer(const char* data, size_t size,
+                                    std::shared_ptr<void> buffer,
+                                    const runtime::Module lib);
+
   /*!
    * \brief Save the globals.
    *
@@ -586,11 +704,12 @@ class Executable : public ModuleNode {
   void SaveGlobalSection(dmlc::Stream* strm);
 
   /*!
-   * \brief Save the constant pool.
+   * \brief Save the metadata of the constant pool.
    *
    * \param strm The input stream.
+   * \param offsets The offset of each constant in the data section.
    */
-  void SaveConstantSection(dmlc::Stream* strm);
+  void SaveConstantSection(dmlc::Stream* strm, const std::vector<uint64_t>& offsets);
 
   /*!
    * \brief Save primitive op names.
@@ -600,11 +719,14 @@ class Executable : public ModuleNode {
   void SavePrimitiveOpNames(dmlc::Stream* strm);
 
   /*!
-   * \brief Save the vm functions.
+   * \brief Save the metadata of the vm functions.
    *
    * \param strm The input stream.
+   * \param offsets The offset of the bytecode of each function in the data section.
+   * \param bytecode The serialized instructions of each function.
    */
-  void SaveCodeSection(dmlc::Stream* strm);
+  void SaveCodeSection(dmlc::Stream* strm, const std::vector<uint64_t>& offsets,
+                       const std::vector<std::string>& bytecode);
 
   /*!
    * \brief Load the globals.
@@ -614,7 +736,7 @@ class Executable : public ModuleNode {
   void LoadGlobalSection(dmlc::Stream* strm);
 
   /*!
-   * \brief Load the constant pool.
+   * \brief Load the constant pool, binding the constants to the data section.
    *
    * \param strm The input stream.
    */
@@ -628,7 +750,7 @@ class Executable : public ModuleNode {
   void LoadPrimitiveOpNames(dmlc::Stream* strm);
 
   /*!
-   * \brief Load the vm functions.
+   * \brief Load the vm functions, leaving their bytecode in the data section.
    *
    * \param strm The input stream.
    */
@@ -636,6 +758,29 @@ class Executable : public ModuleNode {
 
   /*! \brief The serialized bytecode. */
   std::string code_;
+  /*! \brief The buffer the executable was loaded from. */
+  std::shared_ptr<void> buffer_;
+  /*! \brief The data section of the buffer, holding the constants and the bytecode. */
+  const char* data_section_{nullptr};
+  /*! \brief The size of the data section in bytes. */
+  size_t data_section_size_{0};
+  /*! \brief The bytecode of the loaded functions, by function index. */
+  std::vector<std::unique_ptr<LazyBytecode> > lazy_bytecode_;
+};
+
+/*!
+ * \brief The state loaded from an executable which does not change while
+ *  running it. It is shared by the virtual machines running the executable
+ *  concurrently, each of which only holds the state of its own execution.
+ */
+struct LoadedExecutable {
+  /*! \brief The packed functions of the executable, by packed index. */
+  std::vector<PackedFunc> packed_funcs;
+  /*!
+   * \brief The constants copied to the device, loaded on first use. They are
+   *  all loaded before the state is shared, so that it is only read after.
+   */
+  std::vector<ObjectRef> const_pool;
 };
 
 /*!
@@ -685,11 +830,48 @@ class VirtualMachine : public runtime::ModuleNode {
    */
   virtual void LoadExecutable(const Executable* exec);
 
+  /*!
+   * \brief Create a virtual machine running the same executable on the same
+   *  contexts, sharing the packed functions and the constants on the device
+   *  with this one. Each of them can then run on its own thread.
+   *
+   *  This virtual machine must be initialized and not running.
+   * \return The new virtual machine.
+   */
+  runtime::Module Share();
+
  protected:
-  /*! \brief The virtual machine's packed function table. */
-  std::vector<PackedFunc> packed_funcs_;
+  /*! \brief The state loaded from the executable, shared with Share. */
+  std::shared_ptr<LoadedExecutable> loaded_;
   /*! \brief The current stack of call frames. */
   std::vector<VMFrame> frames_;
+  /*! \brief The registers of all the frames, each frame using a contiguous range. */
+  std::vector<ObjectRef> register_stack_;
+  /*! \brief The registers of the current frame, pointing into register_stack_. */
+  ObjectRef* registers_{nullptr};
+  /*! \brief Scratch space for the arguments of an instruction, reused across instructions. */
+  std::vector<ObjectRef> arg_scratch_;
+  /*! \brief Scratch space for the packed arguments of InvokePacked. */
+  std::vector<TVMValue> packed_values_;
+  std::vector<int> packed_codes_;
+  /*! \brief The number of instructions executed. */
+  uint64_t num_executed_{0};
+  /*! \brief The number of frames pushed on the call stack. */
+  uint64_t num_frames_pushed_{0};
+  /*! \brief The number of frames popped off the call stack. */
+  uint64_t num_frames_popped_{0};
+  /*! \brief Whether RunLoop reports each instruction to ProfileInstruction. */
+  bool profile_instructions_{false};
+  /*!
+   * \brief The outputs of the shape functions, for each packed function
+   *  keyed by the content of its inputs.
+   */
+  std::unordered_map<Index, std::unordered_map<std::string, std::vector<NDArray>>>
+      shape_func_cache_;
+  /*! \brief The number of shape function calls served from the cache. */
+  uint64_t shape_func_cache_hits_{0};
+  /*! \brief The number of shape function calls running the function. */
+  uint64_t shape_func_cache_misses_{0};
   /*! \brief The fuction table index of the current function. */
   Index func_index_;
   /*! \brief The current pointer to the code section. */
@@ -704,13 +886,20 @@ class VirtualMachine : public runtime::ModuleNode {
   std::unordered_map<std::string, std::vector<ObjectRef>> inputs_;
   /*! \brief The set of TVM contexts the VM is currently executing on. */
   std::vector<TVMContext> ctxs_;
+  /*! \brief The allocator of each context. */
+  std::vector<Allocator*> allocators_;
 
-  /*! \brief Push a call frame on to the call stack. */
+  /*!
+   * \brief Push a call frame on to the call stack.
+   *
+   *  The frame's registers are taken from the top of the register stack, which
+   *  may move it: pointers into the caller's registers are invalidated.
+   */
   void PushFrame(Index arg_count, Index ret_pc, const VMFunction& vm_func);
 
   /*!
-   * \brief Pop a frame off the call stack.
-   * \return The number of frames left.
+   * \brief Pop a frame off the call stack, releasing the objects in its registers.
+   * \return The number of frames before popping.
    */
   Index PopFrame();
 
@@ -726,7 +915,14 @@ class VirtualMachine : public runtime::ModuleNode {
    * \param reg The register to read from.
    * \return The read object.
    */
-  inline ObjectRef ReadRegister(RegName reg) const;
+  inline const ObjectRef& ReadRegister(RegName reg) const;
+
+  /*!
+   * \brief Get a constant, copying it to the device on first use.
+   * \param const_index The index of the constant.
+   * \return The constant on the device.
+   */
+  inline const ObjectRef& LoadConstant(Index const_index);
 
   /*!
    * \brief Read a VM register and cast it to int32_t
@@ -769,15 +965,47 @@ class VirtualMachine : public runtime::ModuleNode {
                             Index output_size,
                             const std::vector<ObjectRef>& args);
 
+  /*!
+   * \brief Invoke a shape function, copying its outputs from an earlier call
+   *  with the same inputs when possible.
+   *
+   * \param packed_index The offset of the PackedFunction in all functions.
+   * \param func The shape function to be invoked.
+   * \param arg_count The number of arguments to the PackedFunction.
+   * \param output_size The number of outputs of the PackedFunction.
+   * \param args Arguments to the PackedFunction.
+   */
+  void InvokeShapeFunc(Index packed_index,
+                       const PackedFunc& func,
+                       Index arg_count,
+                       Index output_size,
+                       const std::vector<ObjectRef>& args);
+
   /*!
    * \brief Initialize the virtual machine for a set of contexts.
    * \param contexts The set of TVM contexts.
+   * \param allocators The allocator of each context.
    */
-  void Init(const std::vector<TVMContext>& contexts);
+  void Init(const std::vector<TVMContext>& contexts, const std::vector<Allocator*>& allocators);
 
   /*! \brief Run VM dispatch loop. */
   void RunLoop();
 
+  /*!
+   * \brief The VM dispatch loop.
+   * \tparam kProfile Whether to report each instruction to ProfileInstruction.
+   */
+  template <bool kProfile>
+  void RunLoopImpl();
+
+  /*!
+   * \brief Report an executed instruction when profile_instructions_ is set.
+   *
+   * \param instr The instruction, called once it completes.
+   * \param duration The time from its dispatch to its completion in microseconds.
+   */
+  virtual void ProfileInstruction(const Instruction& instr, double duration) {}
+
   /*! \brief Get device context for params. */
   TVMContext GetParamsContext() const;
 
@@ -788,12 +1016,6 @@ class VirtualMachine : public runtime::ModuleNode {
    * This does not begin execution of the VM.
    */
   void InvokeGlobal(const VMFunction& func, const std::vector<ObjectRef>& args);
-
-  /*!
-   * \brief The constant pool for runtime. It caches the device dependent
-   * object to avoid rellocation of constants during inference.
-   */
-  std::vector<ObjectRef> const_pool_;
 };
 
 }  // namespace vm
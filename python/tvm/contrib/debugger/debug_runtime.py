@@ -28,6 +28,7 @@ from . import debug_result
 
 _DUMP_ROOT_PREFIX = "tvmdbg_"
 _DUMP_PATH_PREFIX = "_tvmdbg_"
+TIMELINE_TRACE_FILE_NAME = "_tvmdbg_timeline_trace.json"
 
 
 def create(graph_json_str, libmod, ctx, dump_root=None):
@@ -104,6 +105,7 @@ class GraphModuleDebug(graph_runtime.GraphModule):
         self._dump_path = None
         self._get_output_by_layer = module["get_output_by_layer"]
         self._run_individual = module["run_individual"]
+        self._profile_timeline = module["profile_timeline"]
         graph_runtime.GraphModule.__init__(self, module)
         self._create_debug_env(graph_json_str, ctx)
 
@@ -244,6 +246,38 @@ class GraphModuleDebug(graph_runtime.GraphModule):
         ret = self._run_individual(number, repeat, min_repeat_ms)
         return ret.strip(",").split(",") if ret else []
 
+    def profile_timeline(self, repeat=1, hardware_counters=False, path=None):
+        """Run every op of the graph and write the timeline of the runs as
+        a Chrome trace, which can be loaded in chrome://tracing.
+
+        Each op records its input and output bytes, the bandwidth they imply
+        and the utilization of the thread pool workers.
+
+        Parameters
+        ----------
+        repeat : int
+            The number of times to run the graph, after a warmup run.
+
+        hardware_counters : bool
+            Whether to also record the cycles and the last level cache misses
+            of each op. They need perf_event_open on Linux, and are skipped
+            with a warning when it is not permitted.
+
+        path : str
+            The file to write, the trace file of the dump folder by default.
+
+        Returns
+        -------
+        path : str
+            The written file.
+        """
+        trace = self._profile_timeline(repeat, hardware_counters)
+        if path is None:
+            path = os.path.join(self._dump_path, TIMELINE_TRACE_FILE_NAME)
+        with open(path, "w") as trace_f:
+            trace_f.write(trace)
+        return path
+
     def exit(self):
         """Exits the dump folder and all its contents"""
         self._remove_dump_root()
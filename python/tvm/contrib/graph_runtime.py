@@ -15,6 +15,8 @@
 # specific language governing permissions and limitations
 # under the License.
 """Minimum graph runtime that executes graph containing TVM PackedFunc."""
+import contextlib
+
 import numpy as np
 import tvm._ffi
 
@@ -63,6 +65,96 @@ def create(graph_json_str, libmod, ctx):
     return GraphModule(fcreate(graph_json_str, libmod, *device_type_id))
 
 
+def create_session(graph_json_str, libmod, ctx, max_arenas=0):
+    """Create a session serving concurrent requests of a graph.
+
+    The parameters loaded into the session are shared by all the requests,
+    each of which runs on its own arena holding the activations.
+
+    Parameters
+    ----------
+    graph_json_str : str or graph class
+        The graph to be deployed in json format output by json graph.
+
+    libmod : tvm.runtime.Module
+        The module of the corresponding function
+
+    ctx : TVMContext or list of TVMContext
+        The context to deploy the module, see :py:func:`create`.
+
+    max_arenas : int
+        The maximum number of requests in flight, further requests wait for
+        one to finish. Zero for no limit.
+
+    Returns
+    -------
+    session : GraphRuntimeSession
+        The session.
+    """
+    if not isinstance(graph_json_str, string_types):
+        try:
+            graph_json_str = graph_json_str._tvm_graph_json()
+        except AttributeError:
+            raise ValueError("Type %s is not supported" % type(graph_json_str))
+
+    ctx, num_rpc_ctx, device_type_id = get_device_ctx(libmod, ctx)
+
+    if num_rpc_ctx == len(ctx):
+        fcreate = ctx[0]._rpc_sess.get_function("tvm.graph_runtime.create_session")
+    else:
+        fcreate = tvm._ffi.get_global_func("tvm.graph_runtime.create_session")
+
+    return GraphRuntimeSession(fcreate(graph_json_str, libmod, max_arenas, *device_type_id))
+
+
+def create_pipeline(graph_json_str, libmod, ctx, max_in_flight=0, stage_begins=None):
+    """Create a pipelined executor of a graph.
+
+    The graph is split into stages, each run by its own thread, so that
+    consecutive requests overlap on different stages.
+
+    Parameters
+    ----------
+    graph_json_str : str or graph class
+        The graph to be deployed in json format output by json graph.
+
+    libmod : tvm.runtime.Module
+        The module of the corresponding function
+
+    ctx : TVMContext or list of TVMContext
+        The context to deploy the module, see :py:func:`create`.
+
+    max_in_flight : int
+        The maximum number of requests in flight, each of which holds its
+        own activations. Zero for twice the number of stages.
+
+    stage_begins : list of int, optional
+        The first node id of every stage but the first one. By default the
+        graph is split where consecutive operators run on different devices.
+
+    Returns
+    -------
+    pipeline : GraphRuntimePipeline
+        The pipelined executor.
+    """
+    if not isinstance(graph_json_str, string_types):
+        try:
+            graph_json_str = graph_json_str._tvm_graph_json()
+        except AttributeError:
+            raise ValueError("Type %s is not supported" % type(graph_json_str))
+
+    ctx, num_rpc_ctx, device_type_id = get_device_ctx(libmod, ctx)
+
+    if num_rpc_ctx == len(ctx):
+        fcreate = ctx[0]._rpc_sess.get_function("tvm.graph_runtime.create_pipeline")
+    else:
+        fcreate = tvm._ffi.get_global_func("tvm.graph_runtime.create_pipeline")
+
+    stages = ",".join(str(nid) for nid in stage_begins) if stage_begins else ""
+    return GraphRuntimePipeline(
+        fcreate(graph_json_str, libmod, max_in_flight, stages, *device_type_id))
+
+
 def get_device_ctx(libmod, ctx):
     """Parse and validate all the device context(s).
 
@@ -175,6 +267,35 @@ class GraphModule(object):
             self.set_input(**input_dict)
         self._run()
 
+    def set_inter_op_threads(self, num_threads):
+        """Run independent operators of the graph concurrently.
+
+        Each operator runs once the operators it depends on are done, on one
+        of num_threads threads, with an equal share of the thread pool for
+        its own parallel loops.
+
+        Parameters
+        ----------
+        num_threads : int
+            The number of threads including the caller of run, 1 to run the
+            operators one by one.
+        """
+        self.module["set_inter_op_threads"](num_threads)
+
+    def use_call_table(self, enable=True):
+        """Enable or disable the call table execution mode.
+
+        In this mode run calls the compiled function of each op directly
+        through arguments packed once at creation, which cuts the per-op
+        dispatch overhead of graphs with many small ops.
+
+        Parameters
+        ----------
+        enable : bool
+            Whether to use the call table.
+        """
+        self.module["use_call_table"](enable)
+
     def get_num_outputs(self):
         """Get the number of outputs from the graph
 
@@ -243,6 +364,21 @@ class GraphModule(object):
         """
         self._load_params(bytearray(params_bytes))
 
+    def load_params_mmap(self, path):
+        """Load parameters by memory-mapping a file of serialized parameter dict.
+
+        When the file is saved with aligned payloads, see the alignment
+        argument of :py:func:`tvm.relay.save_param_dict`, the parameters on
+        CPU use the mapped pages in place, which are shared by all the
+        processes mapping the same file. Other parameters are copied.
+
+        Parameters
+        ----------
+        path : str
+            The path of the parameter file on the machine running the module.
+        """
+        self.module["load_params_mmap"](path)
+
     def share_params(self, other, params_bytes):
         """Share parameters from pre-existing GraphRuntime instance.
 
@@ -265,3 +401,167 @@ class GraphModule(object):
             The key to the module.
         """
         return self.module[key]
+
+
+class GraphRuntimeSession(object):
+    """Wrapper of a session serving concurrent requests of a graph.
+
+    Parameters
+    ----------
+    module : tvm.runtime.Module
+        The internal tvm module that holds the session.
+
+    Examples
+    --------
+    .. code-block:: python
+
+       sess = graph_runtime.create_session(graph, lib, tvm.cpu(0), max_arenas=4)
+       sess.load_params(relay.save_param_dict(params))
+       # in each serving thread
+       with sess.request() as mod:
+           mod.run(data=data)
+           out = mod.get_output(0).asnumpy()
+    """
+
+    def __init__(self, module):
+        self.module = module
+        self._load_params = module["load_params"]
+        self._acquire = module["acquire"]
+        self._release = module["release"]
+        self._get_num_arenas = module["get_num_arenas"]
+
+    def load_params(self, params_bytes):
+        """Load parameters shared by all the requests.
+
+        No request may be in flight.
+
+        Parameters
+        ----------
+        params_bytes : bytearray
+            The serialized parameter dict.
+        """
+        self._load_params(bytearray(params_bytes))
+
+    def acquire(self):
+        """Acquire an arena for a request, waiting if max_arenas are in use.
+
+        The arena must be used by one thread at a time and given back with
+        :py:meth:`release`. The shared parameters cannot be set through it.
+
+        Returns
+        -------
+        graph_module : GraphModule
+            The arena.
+        """
+        return GraphModule(self._acquire())
+
+    def release(self, graph_module):
+        """Release an arena, its outputs may be overwritten by other requests.
+
+        Parameters
+        ----------
+        graph_module : GraphModule
+            The arena returned by :py:meth:`acquire`.
+        """
+        self._release(graph_module.module)
+
+    @contextlib.contextmanager
+    def request(self):
+        """Acquire an arena for the duration of a with block."""
+        graph_module = self.acquire()
+        try:
+            yield graph_module
+        finally:
+            self.release(graph_module)
+
+    def get_num_arenas(self):
+        """Get the number of arenas created by the session.
+
+        Returns
+        -------
+        count : int
+            The number of arenas.
+        """
+        return self._get_num_arenas()
+
+
+class GraphRuntimePipeline(object):
+    """Wrapper of a pipelined executor of a graph.
+
+    Requests complete in the order they are submitted.
+
+    Parameters
+    ----------
+    module : tvm.runtime.Module
+        The internal tvm module that holds the pipeline.
+
+    Examples
+    --------
+    .. code-block:: python
+
+       pipe = graph_runtime.create_pipeline(graph, lib, [tvm.cpu(0), tvm.gpu(0)])
+       pipe.load_params(relay.save_param_dict(params))
+       pipe.submit(data=batch0)
+       pipe.submit(data=batch1)
+       out0 = pipe.collect(tvm.nd.empty(oshape))[0]
+       out1 = pipe.collect(tvm.nd.empty(oshape))[0]
+    """
+
+    def __init__(self, module):
+        self.module = module
+        self._load_params = module["load_params"]
+        self._submit = module["submit"]
+        self._collect = module["collect"]
+        self._get_num_stages = module["get_num_stages"]
+
+    def load_params(self, params_bytes):
+        """Load parameters shared by all the requests.
+
+        No request may be in flight.
+
+        Parameters
+        ----------
+        params_bytes : bytearray
+            The serialized parameter dict.
+        """
+        self._load_params(bytearray(params_bytes))
+
+    def submit(self, **inputs):
+        """Submit a request, waiting while max_in_flight requests are in flight.
+
+        Parameters
+        ----------
+        inputs: dict of str to NDArray
+            The inputs of the request.
+        """
+        args = []
+        for k, v in inputs.items():
+            args.append(k)
+            args.append(v if isinstance(v, tvm.nd.NDArray) else tvm.nd.array(v))
+        self._submit(*args)
+
+    def collect(self, *outs):
+        """Wait for the oldest request and copy its outputs.
+
+        Parameters
+        ----------
+        outs : list of NDArray
+            The arrays receiving the first len(outs) outputs.
+
+        Returns
+        -------
+        outs : list of NDArray
+            The given arrays.
+        """
+        self._collect(*outs)
+        return list(outs)
+
+    def get_num_stages(self):
+        """Get the number of stages.
+
+        Returns
+        -------
+        count : int
+            The number of stages.
+        """
+        return self._get_num_stages()
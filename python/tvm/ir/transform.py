@@ -51,6 +51,34 @@ class PassInfo(Object):
             _ffi_transform_api.PassInfo, opt_level, name, required)
 
 
+@tvm._ffi.register_object("transform.PassProfile")
+class PassProfile(Object):
+    """The measurements of a pass invocation, recorded when the pass context
+    profiles the passes.
+
+    Attributes
+    ----------
+    name : str
+        The name of the pass.
+
+    duration_us : int
+        The wall time of the pass, including the passes it ran, in microseconds.
+
+    num_nodes_before : int
+        The number of distinct IR nodes reachable from the input module.
+
+    num_nodes_after : int
+        The number of distinct IR nodes reachable from the output module.
+
+    num_new_nodes : int
+        The number of IR nodes reachable from the output module and not from
+        the input module, i.e. the nodes the pass created and kept.
+
+    children : List[PassProfile]
+        The profiles of the passes run by the pass, in order.
+    """
+
+
 @tvm._ffi.register_object("transform.PassContext")
 class PassContext(Object):
     """The basis where a Relay optimization/analysis runs on.
@@ -70,13 +98,31 @@ class PassContext(Object):
 
     disabled_pass : Optional[Union[List[str], Set[str], Tuple[str]]]
         The list of passes that are disabled.
+
+    trace : Optional[Callable[[IRModule, PassInfo, bool], None]]
+        A tracing function called before and after every pass.
+
+    profile : bool
+        Whether to record the time and the IR nodes of every pass run in
+        the context, see :py:func:`render_profiles`.
+
+    plan_memory_offset : bool
+        Whether the graph runtime codegen places the intermediate tensors at
+        offsets in a single arena per device instead of sharing whole buffers.
+
+    fuse_bytecode : bool
+        Whether the VM compiler fuses recurring instruction sequences into
+        superinstructions, from opt_level 1.
     """
     def __init__(self,
                  opt_level=2,
                  fallback_device=_nd.cpu(),
                  required_pass=None,
                  disabled_pass=None,
-                 trace=None):
+                 trace=None,
+                 profile=False,
+                 plan_memory_offset=False,
+                 fuse_bytecode=True):
         if isinstance(fallback_device, str):
             fallback_device = _nd.context(fallback_device).device_type
         elif isinstance(fallback_device, TVMContext):
@@ -97,7 +143,8 @@ class PassContext(Object):
 
         self.__init_handle_by_constructor__(_ffi_transform_api.PassContext, opt_level,
                                             fallback_device, required,
-                                            disabled, trace)
+                                            disabled, trace, profile, plan_memory_offset,
+                                            fuse_bytecode)
 
     def __enter__(self):
         _ffi_transform_api.EnterPassContext(self)
@@ -111,6 +158,25 @@ class PassContext(Object):
         """Return the current pass context."""
         return _ffi_transform_api.GetCurrentPassContext()
 
+    def profiles(self):
+        """Return the profiles of the outermost passes run in the context.
+
+        Returns
+        -------
+        profiles : List[PassProfile]
+            The profiles, with the passes run by each pass as its children.
+        """
+        return list(_ffi_transform_api.GetPassProfiles(self))
+
+    def render_profiles(self):
+        """Return the profiles of the passes run in the context as a table,
+        the passes run by a pass indented under it."""
+        return _ffi_transform_api.RenderPassProfiles(self)
+
+    def clear_profiles(self):
+        """Drop the profiles recorded so far."""
+        _ffi_transform_api.ClearPassProfiles(self)
+
 
 @tvm._ffi.register_object("transform.Pass")
 class Pass(Object):
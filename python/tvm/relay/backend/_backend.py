@@ -20,9 +20,12 @@ import tvm.driver
 from tvm.ir import container as _container
 
 
-@tvm._ffi.register_func("relay.backend.lower")
+@tvm._ffi.register_func("relay.backend.python_lower")
 def lower(sch, inputs, func_name, source_func):
-    """Backend function for lowering.
+    """Backend function for lowering with tvm.driver.lower, used when the
+    build config adds lowering passes, dumps the IR, or the target is CUDA.
+    Other functions are lowered natively. Register relay.backend.lower to
+    override the lowering of every function.
 
     Parameters
     ----------
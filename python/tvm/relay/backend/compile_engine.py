@@ -324,6 +324,51 @@ class CompileEngine(Object):
         """clear the existing cached functions"""
         _backend._CompileEngineClear(self)
 
+    def set_disk_cache(self, path):
+        """Set the directory of the disk compile cache, shared by the builds
+        of every process using it. relay.build then compiles each fused
+        function for a host LLVM target into its own module, and loads it
+        from the cache when an identical function was built for the same
+        target before. The cache can also be set with the
+        TVM_COMPILE_CACHE_DIR environment variable.
+
+        The tuning configurations applied are not part of the cache key, so
+        builds using different tuning logs should use different directories.
+
+        Parameters
+        ----------
+        path : Optional[str]
+            The directory, created when missing. None disables the disk cache.
+        """
+        _backend._CompileEngineSetDiskCache(self, path or "")
+
+    def disk_cache_stats(self):
+        """Get the number of functions served by the disk compile cache since
+        it was set, and the number of functions built into it.
+
+        Returns
+        -------
+        hits : int
+            The number of functions loaded from the disk cache.
+
+        misses : int
+            The number of functions built and saved to the disk cache.
+        """
+        hits, misses = _backend._CompileEngineDiskCacheStats(self)
+        return hits.value, misses.value
+
+    def num_lowered_in_parallel(self):
+        """Get the number of functions lowered on the build threads since the
+        last clear. Functions whose lowering needs Python are lowered on the
+        calling thread and not counted.
+
+        Returns
+        -------
+        num : int
+            The number of functions lowered in parallel.
+        """
+        return _backend._CompileEngineNumLoweredInParallel(self)
+
     def items(self):
         """List items in the cache.
 
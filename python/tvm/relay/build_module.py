@@ -75,7 +75,7 @@ class BuildModule(object):
         self._set_params_func = self.mod["set_params"]
         self._get_params_func = self.mod["get_params"]
 
-    def build(self, mod, target=None, target_host=None, params=None):
+    def build(self, mod, target=None, target_host=None, params=None, incremental=False):
         """
         Parameters
         ----------
@@ -100,6 +100,11 @@ class BuildModule(object):
             Input parameters to the graph that do not change
             during inference time. Used for constant folding.
 
+        incremental : bool
+            Whether to keep the params as inputs of the graph instead of
+            folding them, and reuse the previous build of the same module
+            in the process.
+
         Returns
         -------
         graph_json : str
@@ -117,7 +122,7 @@ class BuildModule(object):
         if params:
             self._set_params(params)
         # Build the IR module
-        self._build(mod, target, target_host)
+        self._build(mod, target, target_host, incremental)
         # Get artifacts
         graph_json = self.get_json()
         mod = self.get_module()
@@ -181,10 +186,27 @@ class BuildModule(object):
         return ret
 
 
-def build(mod, target=None, target_host=None, params=None):
+def build(mod, target=None, target_host=None, params=None, incremental=False):
     """Helper function that builds a Relay function to run on TVM graph
     runtime.
 
+    An incremental build keeps the params as inputs of the graph, so that
+    the graph and the module only depend on the types of the params. When
+    the same module is built again in the process with the same targets
+    and configuration, only with new params, the previous graph and module
+    are reused and only the params are new. The optimized module and the
+    lowered functions of the previous builds are also matched, to reuse
+    the builds of equivalent modules. Constant folding does not reach the
+    params in this mode, and the tuning logs in use are not matched, see
+    :py:func:`clear_incremental_builds`. The builds with lowering passes
+    added, or a relay.backend.lower hook registered, are not reused.
+
+    The fused functions are lowered, and the LLVM module of a host target is
+    compiled in chunks, on the number of threads set by the
+    TVM_BUILD_NUM_THREADS environment variable, by default the number of
+    hardware threads. Functions whose lowering needs Python, as with
+    add_lower_pass, are lowered serially.
+
     Parameters
     ----------
     mod : :py:class:`~tvm.IRModule`
@@ -208,6 +230,10 @@ def build(mod, target=None, target_host=None, params=None):
         Input parameters to the graph that do not change
         during inference time. Used for constant folding.
 
+    incremental : bool
+        Whether to keep the params as inputs of the graph and reuse the
+        previous builds of the same module.
+
     Returns
     -------
     graph_json : str
@@ -248,10 +274,16 @@ def build(mod, target=None, target_host=None, params=None):
 
     with tophub_context:
         bld_mod = BuildModule()
-        graph_json, mod, params = bld_mod.build(mod, target, target_host, params)
+        graph_json, mod, params = bld_mod.build(mod, target, target_host, params, incremental)
     return graph_json, mod, params
 
 
+def clear_incremental_builds():
+    """Drop the builds kept for the incremental builds, for instance after
+    changing the tuning logs."""
+    _build_module._ClearIncrementalBuilds()
+
+
 def optimize(mod, target=None, params=None):
     """Helper function that optimizes a Relay module.
 
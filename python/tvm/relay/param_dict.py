@@ -21,9 +21,10 @@ import tvm._ffi
 
 
 _save_param_dict = tvm._ffi.get_global_func("tvm.relay._save_param_dict")
+_save_param_dict_aligned = tvm._ffi.get_global_func("tvm.relay._save_param_dict_aligned")
 _load_param_dict = tvm._ffi.get_global_func("tvm.relay._load_param_dict")
 
-def save_param_dict(params):
+def save_param_dict(params, alignment=None):
     """Save parameter dictionary to binary bytes.
 
     The result binary bytes can be loaded by the
@@ -34,6 +35,12 @@ def save_param_dict(params):
     params : dict of str to NDArray
         The parameter dictionary.
 
+    alignment : int, optional
+        If given, every tensor payload starts at a multiple of alignment
+        bytes, e.g. 4096 for a page. Written to a file, the result can be
+        memory-mapped by the GraphModule with API "load_params_mmap",
+        which then uses the weights in place instead of copying them.
+
     Returns
     -------
     param_bytes: bytearray
@@ -56,6 +63,8 @@ def save_param_dict(params):
     for k, v in params.items():
         args.append(k)
         args.append(tvm.nd.array(v))
+    if alignment is not None:
+        return _save_param_dict_aligned(alignment, *args)
     return _save_param_dict(*args)
 
 
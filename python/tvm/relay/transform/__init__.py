@@ -20,3 +20,4 @@
 from .transform import *
 
 from . import memory_alloc
+from . import memory_plan
@@ -0,0 +1,219 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+# pylint: disable=invalid-name
+"""
+A pass for planning the static allocations manifested by ManifestAlloc
+into a shared storage.
+"""
+from ..expr_functor import ExprMutator
+from . import transform
+from .. import op, expr, analysis
+from ... import register_func
+
+
+def _align_up(value, alignment):
+    return (value + alignment - 1) // alignment * alignment
+
+
+def plan_offsets(sizes, alignments, intervals):
+    """Place tensors in a storage so that tensors alive at the same time
+    do not overlap.
+
+    Parameters
+    ----------
+    sizes : List[int]
+        The size in bytes of each tensor.
+
+    alignments : List[int]
+        The alignment in bytes of each tensor.
+
+    intervals : List[Tuple[int, int]]
+        The first and last binding where each tensor is alive.
+
+    Returns
+    -------
+    offsets : List[int]
+        The byte offset of each tensor.
+
+    total : int
+        The size of the storage.
+    """
+    num = len(sizes)
+    # Place the large tensors first, each in the smallest gap left between
+    # the tensors placed before it and alive at the same time.
+    order = sorted(range(num), key=lambda i: (-sizes[i], intervals[i][0]))
+    offsets = [0] * num
+    placed = []
+    total = 0
+    for i in order:
+        begin, end = intervals[i]
+        conflicts = sorted((offsets[j], offsets[j] + sizes[j]) for j in placed
+                           if intervals[j][0] <= end and begin <= intervals[j][1])
+        best, best_gap = None, None
+        offset = 0
+        for lo, hi in conflicts:
+            if offset + sizes[i] <= lo and (best_gap is None or lo - offset < best_gap):
+                best, best_gap = offset, lo - offset
+            offset = max(offset, _align_up(hi, alignments[i]))
+        offsets[i] = offset if best is None else best
+        placed.append(i)
+        total = max(total, offsets[i] + sizes[i])
+    return offsets, total
+
+
+class StorageCoalesce(ExprMutator):
+    """Coalesce the storages of the tensors with a static shape allocated
+    in a let block into a single storage, at offsets planned from their
+    liveness. Tensors with a dynamic shape, and tensors which may outlive
+    the block, keep their own storage.
+    """
+
+    def __init__(self):
+        self.alloc_storage = op.get("memory.alloc_storage")
+        self.alloc_tensor = op.get("memory.alloc_tensor")
+        self.invoke_tvm = op.get("memory.invoke_tvm_op")
+        self.shape_func = op.get("memory.shape_func")
+        super().__init__()
+
+    def visit_let(self, let):
+        bindings = []
+        while isinstance(let, expr.Let):
+            bindings.append((let.var, self.visit(let.value)))
+            let = let.body
+        body = self.visit(let)
+        for var, value in reversed(self.plan_block(bindings, body)):
+            body = expr.Let(var, value, body)
+        return body
+
+    def is_call(self, value, callee):
+        return isinstance(value, expr.Call) and value.op == callee
+
+    def operands(self, value):
+        """The variables read by an operator without retaining them, or None
+        when the value may retain its free variables."""
+        if self.is_call(value, self.invoke_tvm) or self.is_call(value, self.shape_func):
+            fields = []
+            for arg in value.args[1:]:
+                if not isinstance(arg, expr.Tuple):
+                    return None
+                fields.extend(arg.fields)
+        elif self.is_call(value, self.alloc_tensor):
+            fields = value.args
+        else:
+            return None
+        if not all(isinstance(f, (expr.Var, expr.Constant)) for f in fields):
+            return None
+        return [f for f in fields if isinstance(f, expr.Var)]
+
+    def plan_block(self, bindings, body):
+        """Return the bindings of a let block with its static storages coalesced."""
+        # The storages of a constant size and alignment.
+        storages = {}
+        for i, (var, value) in enumerate(bindings):
+            if self.is_call(value, self.alloc_storage) and \
+               all(isinstance(arg, expr.Constant) for arg in value.args):
+                storages[var] = i
+        if len(storages) < 2:
+            return bindings
+
+        # The tensors with a constant shape which are the only users of their storage.
+        num_uses = {}
+        for _, value in bindings:
+            for v in analysis.free_vars(value):
+                num_uses[v] = num_uses.get(v, 0) + 1
+        for v in analysis.free_vars(body):
+            num_uses[v] = num_uses.get(v, 0) + 1
+        tensors = {}
+        for i, (var, value) in enumerate(bindings):
+            if self.is_call(value, self.alloc_tensor) and \
+               isinstance(value.args[1], expr.Constant) and \
+               value.args[0] in storages and num_uses.get(value.args[0], 0) == 1:
+                tensors[var] = i
+
+        # Follow the tensors through the variables which may refer to them,
+        # extending their live range to their last read. A tensor reaching
+        # anything else may outlive the block and is left alone.
+        refs = {}
+        last_use = {}
+        escaped = set()
+        for i, (var, value) in enumerate(bindings):
+            if var in tensors:
+                refs[var] = {var}
+                continue
+            if isinstance(value, expr.Var):
+                refs[var] = set(refs.get(value, ()))
+                continue
+            if isinstance(value, expr.TupleGetItem) and isinstance(value.tuple_value, expr.Var):
+                refs[var] = set(refs.get(value.tuple_value, ()))
+                continue
+            if isinstance(value, expr.Tuple) and \
+               all(isinstance(f, (expr.Var, expr.Constant)) for f in value.fields):
+                refs[var] = set()
+                for f in value.fields:
+                    refs[var] |= refs.get(f, set())
+                continue
+            operands = self.operands(value)
+            if operands is None:
+                for v in analysis.free_vars(value):
+                    escaped |= refs.get(v, set())
+                continue
+            for v in operands:
+                for t in refs.get(v, ()):
+                    last_use[t] = i
+        for v in analysis.free_vars(body):
+            escaped |= refs.get(v, set())
+
+        planned = [t for t in tensors if t not in escaped]
+        if len(planned) < 2:
+            return bindings
+        sizes, alignments, intervals = [], [], []
+        for t in planned:
+            size, alignment = bindings[storages[bindings[tensors[t]][1].args[0]]][1].args
+            sizes.append(int(size.data.asnumpy()))
+            alignments.append(int(alignment.data.asnumpy()))
+            intervals.append((tensors[t], last_use.get(t, tensors[t])))
+        offsets, total = plan_offsets(sizes, alignments, intervals)
+
+        arena = expr.var("storage_planned")
+        alloc = op.memory.alloc_storage(expr.const(total, dtype="int64"),
+                                        expr.const(max(alignments), dtype="int64"),
+                                        "uint8")
+        removed = set(storages[bindings[tensors[t]][1].args[0]] for t in planned)
+        new_allocs = {}
+        for t, offset in zip(planned, offsets):
+            value = bindings[tensors[t]][1]
+            new_allocs[tensors[t]] = op.memory.alloc_tensor(
+                arena, value.args[1], value.attrs.dtype, value.attrs.assert_shape, offset)
+        new_bindings = []
+        for i, (var, value) in enumerate(bindings):
+            if i in removed:
+                if i == min(removed):
+                    new_bindings.append((arena, alloc))
+                continue
+            new_bindings.append((var, new_allocs.get(i, value)))
+        return new_bindings
+
+
+@transform.function_pass(opt_level=0)
+class MemoryPlan:
+    """The explicit pass wrapper around StorageCoalesce."""
+
+    def transform_function(self, func, mod, _):
+        return StorageCoalesce().visit(func)
+
+
+register_func("relay.transform.MemoryPlan", MemoryPlan)
@@ -35,7 +35,10 @@ def build_config(opt_level=2,
                  fallback_device=_nd.cpu(),
                  required_pass=None,
                  disabled_pass=None,
-                 trace=None):
+                 trace=None,
+                 profile=False,
+                 plan_memory_offset=False,
+                 fuse_bytecode=True):
     """Configure the build behavior by setting config variables.
 
     Parameters
@@ -57,7 +60,8 @@ def build_config(opt_level=2,
                 "EliminateCommonSubexpr": 3,
                 "CombineParallelConv2D": 4,
                 "CombineParallelDense": 4,
-                "FastMath": 4
+                "FastMath": 4,
+                "ScheduleForMemory": 4
             }
 
     fallback_device : int, str, or tvmContext, optional
@@ -73,13 +77,25 @@ def build_config(opt_level=2,
     trace: Callable[[IRModule, PassInfo, bool], None]
         A tracing function for debugging or introspection.
 
+    profile: bool
+        Whether to record the time and the IR nodes of every pass.
+
+    plan_memory_offset: bool
+        Whether the graph runtime codegen places the intermediate tensors at
+        offsets in a single arena per device.
+
+    fuse_bytecode: bool
+        Whether the VM compiler fuses recurring instruction sequences into
+        superinstructions, from opt_level 1.
+
     Returns
     -------
     pass_context: PassContext
         The pass context for optimizations.
     """
     return PassContext(opt_level, fallback_device, required_pass,
-                       disabled_pass, trace)
+                       disabled_pass, trace, profile, plan_memory_offset,
+                       fuse_bytecode)
 
 
 @tvm._ffi.register_object("relay.FunctionPass")
@@ -191,6 +207,19 @@ def FastMath():
     return _ffi_api.FastMath()
 
 
+def ScheduleForMemory():
+    """Reorder the calls of a function in graph normal form to reduce the peak
+    memory of the graph runtime. The calls are bound to lets in the new order,
+    which the graph runtime codegen emits them in.
+
+    Returns
+    -------
+    ret: tvm.relay.Pass
+        The registered pass that reorders the calls.
+    """
+    return _ffi_api.ScheduleForMemory()
+
+
 def CanonicalizeOps():
     """Canonicalize special operators to basic operators.
     This can simplify followed analysis, e.g. expanding bias_add to
@@ -38,6 +38,7 @@ class VirtualMachineProfiler(vm.VirtualMachine):
         self._get_stat = self.mod["get_stat"]
         self._set_input = self.mod["set_input"]
         self._reset = self.mod["reset"]
+        self._get_chrome_trace = self.mod["get_chrome_trace"]
 
     def get_stat(self, sort_by_time=True):
         """Get the statistics of executed ops.
@@ -55,5 +56,15 @@ class VirtualMachineProfiler(vm.VirtualMachine):
         """
         return self._get_stat(sort_by_time)
 
+    def get_chrome_trace(self):
+        """Get the executed instructions and the kernels they ran as a
+        timeline, which can be loaded in chrome://tracing.
+
+        Returns
+        -------
+            The trace events in the Chrome trace event JSON format.
+        """
+        return self._get_chrome_trace()
+
     def reset(self):
         self._reset()
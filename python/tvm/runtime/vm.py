@@ -96,8 +96,13 @@ class Executable(object):
          the list of primitive operator names that will be invoked by the
          virtual machine.
 
-         - Code section. The VM functions, including bytecode, are sitting in
-         this section.
+         - Code section. The VM functions are listed in this section, with the
+         location of their bytecode in the data section.
+
+         - Data section. This page-aligned section holds the constants, each
+         aligned so that it can be used in place, followed by the bytecode of
+         each function, which is only deserialized when the function is first
+         invoked.
 
         Examples
         --------
@@ -165,6 +170,31 @@ from tvm import te
 
         return Executable(_ffi_api.Load_Executable(bytecode, lib))
 
+    @staticmethod
+    def load_exec_file(path, lib):
+        """Construct an executable from a file holding the code returned by
+        :py:meth:`save`. The file is mapped in memory where supported, and the
+        constants are used in place instead of being copied.
+
+        Parameters
+        ----------
+        path : str
+            The path to the saved code.
+
+        lib : :py:class:`~tvm.runtime.Module`
+            The runtime module that contains the generated code.
+
+        Returns
+        -------
+        exec: Executable
+            An executable constructed using the provided artifacts.
+        """
+        if lib is not None and not isinstance(lib, tvm.runtime.Module):
+            raise TypeError("lib is expected to be the type of tvm.runtime.Module" +
+                            ", but received {}".format(type(lib)))
+
+        return Executable(_ffi_api.Load_ExecutableFile(path, lib))
+
     @property
     def lib(self):
         """Get the library that contains hardware dependent code.
@@ -277,21 +307,40 @@ class VirtualMachine(object):
             raise TypeError("mod is expected to be the type of Executable or " +
                             "tvm.runtime.Module, but received {}".format(type(mod)))
         m = mod.module if isinstance(mod, Executable) else mod
-        self.mod = _ffi_api._VirtualMachine(m)
-        self._exec = mod
+        self._setup(_ffi_api._VirtualMachine(m), mod)
+
+    def _setup(self, vm_mod, exe):
+        self.mod = vm_mod
+        self._exec = exe
         self._init = self.mod["init"]
         self._invoke = self.mod["invoke"]
         self._set_input = self.mod["set_input"]
 
-    def init(self, ctx):
+    NAIVE_ALLOCATOR = 1
+    POOLED_ALLOCATOR = 2
+    BUCKETED_ALLOCATOR = 3
+
+    def init(self, ctx, alloc_type=None):
         """Initialize the context in the VM.
 
         Parameters
         ----------
         ctx : :py:class:`TVMContext`
             The runtime context to run the code on.
+
+        alloc_type : str, optional
+            The allocator of the context, one of "naive", "pooled" and "bucketed".
+            Defaults to "naive". The allocators are shared by the virtual
+            machines using the same type on the same context.
         """
         args = [ctx.device_type, ctx.device_id]
+        if alloc_type is not None:
+            alloc_types = {"naive": VirtualMachine.NAIVE_ALLOCATOR,
+                           "pooled": VirtualMachine.POOLED_ALLOCATOR,
+                           "bucketed": VirtualMachine.BUCKETED_ALLOCATOR}
+            if alloc_type not in alloc_types:
+                raise ValueError("Unknown allocator type: {}".format(alloc_type))
+            args.append(alloc_types[alloc_type])
         self._init(*args)
 
     def set_input(self, func_name, *args, **kwargs):
@@ -347,6 +396,68 @@ class VirtualMachine(object):
             self.set_input(func_name, *args, **kwargs)
         return self._invoke(func_name)
 
+    def share(self):
+        """Create a virtual machine running the same executable on the same
+        contexts, sharing the packed functions and the constants loaded on
+        the device with this one.
+
+        Each virtual machine holds the state of one execution, so the virtual
+        machines sharing an executable can run concurrently, one per thread.
+        This virtual machine must be initialized and not running.
+
+        Returns
+        -------
+        vm : VirtualMachine
+            The new virtual machine, already initialized.
+        """
+        vm = VirtualMachine.__new__(VirtualMachine)
+        vm._setup(self.mod["share"](), self._exec)
+        return vm
+
+    def get_num_executed(self):
+        """Get the number of instructions executed by the VM.
+
+        Returns
+        -------
+        count : int
+            The number of instructions executed since the VM was created.
+        """
+        return self.mod["get_num_executed"]()
+
+    def get_allocator_stats(self):
+        """Get the statistics of the allocator of the first context.
+
+        Returns
+        -------
+        used : int
+            The bytes allocated from the device and not yet freed to it.
+
+        cached : int
+            The bytes of the freed buffers held for reuse.
+
+        reused : int
+            The number of allocations served from freed buffers.
+        """
+        return (self.mod["get_used_memory"](),
+                self.mod["get_cached_memory"](),
+                self.mod["get_num_reused"]())
+
+    def get_shape_func_cache_stats(self):
+        """Get the number of shape function calls served from the cache of
+        their earlier outputs, and the number of calls running the function.
+
+        Returns
+        -------
+        hits : int
+            The number of calls reusing the outputs of an earlier call with
+            the same inputs.
+
+        misses : int
+            The number of calls running the shape function.
+        """
+        return (self.mod["get_shape_func_cache_hits"](),
+                self.mod["get_shape_func_cache_misses"]())
+
     def run(self, *args, **kwargs):
         """Run the main function.
 
@@ -24,14 +24,21 @@
 #include <dmlc/thread_local.h>
 #include <tvm/runtime/registry.h>
 #include <tvm/runtime/device_api.h>
+#include <tvm/node/container.h>
+#include <tvm/node/reflection.h>
 #include <tvm/node/repr_printer.h>
 #include <tvm/ir/transform.h>
 
 // TODO(tqchen): Update to use String container after it is merged.
 #include <tvm/tir/expr.h>
 
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
 #include <stack>
 #include <unordered_set>
+#include <vector>
 
 namespace tvm {
 namespace transform {
@@ -91,6 +98,165 @@ void PassContext::Trace(const IRModule& module, const PassInfo& info, bool is_be
     }
 }
 
+/*! \brief Count the distinct objects reachable from an object. */
+class NodeCounter : public AttrVisitor {
+ public:
+  /*!
+   * \param keep_alive Whether to hold the counted objects, so that a pass
+   *  freeing them cannot make new objects reuse their addresses.
+   */
+  explicit NodeCounter(bool keep_alive = false) : keep_alive_(keep_alive) {}
+
+  int64_t Count(const ObjectRef& root) {
+    // An explicit stack, as the chains of Relay expressions can be deep.
+    Push(root.get());
+    while (!stack_.empty()) {
+      Object* node = stack_.back();
+      stack_.pop_back();
+      if (node->IsInstance<ArrayNode>()) {
+        for (const auto& elem : static_cast<ArrayNode*>(node)->data) {
+          Push(elem.get());
+        }
+      } else if (node->IsInstance<MapNode>()) {
+        for (const auto& kv : static_cast<MapNode*>(node)->data) {
+          Push(kv.first.get());
+          Push(kv.second.get());
+        }
+      } else if (node->IsInstance<StrMapNode>()) {
+        for (const auto& kv : static_cast<StrMapNode*>(node)->data) {
+          Push(kv.second.get());
+        }
+      } else {
+        reflection_->VisitAttrs(node, this);
+      }
+    }
+    return static_cast<int64_t>(visited_.size());
+  }
+
+  /*! \return The number of objects counted here and not by other. */
+  int64_t CountNotIn(const NodeCounter& other) const {
+    int64_t count = 0;
+    for (const Object* node : visited_) {
+      count += other.visited_.count(node) == 0;
+    }
+    return count;
+  }
+
+  void Visit(const char* key, double* value) final {}
+  void Visit(const char* key, int64_t* value) final {}
+  void Visit(const char* key, uint64_t* value) final {}
+  void Visit(const char* key, int* value) final {}
+  void Visit(const char* key, bool* value) final {}
+  void Visit(const char* key, std::string* value) final {}
+  void Visit(const char* key, void** value) final {}
+  void Visit(const char* key, DataType* value) final {}
+  void Visit(const char* key, runtime::NDArray* value) final {}
+  void Visit(const char* key, ObjectRef* value) final {
+    Push(value->get());
+  }
+
+ private:
+  void Push(const Object* node) {
+    if (node != nullptr && visited_.insert(node).second) {
+      stack_.push_back(const_cast<Object*>(node));
+      if (keep_alive_) {
+        alive_.push_back(ObjectRef(runtime::GetObjectPtr<Object>(const_cast<Object*>(node))));
+      }
+    }
+  }
+
+  bool keep_alive_;
+  std::vector<ObjectRef> alive_;
+  std::unordered_set<const Object*> visited_;
+  std::vector<Object*> stack_;
+  ReflectionVTable* reflection_ = ReflectionVTable::Global();
+};
+
+/*! \brief The profiles of the passes running on the current thread, innermost last. */
+static std::vector<PassProfile>* RunningPassProfiles() {
+  static thread_local std::vector<PassProfile> profiles;
+  return &profiles;
+}
+
+/*! \brief The time spent profiling on the current thread, left out of the durations. */
+static std::chrono::high_resolution_clock::duration* PassProfilingTime() {
+  static thread_local std::chrono::high_resolution_clock::duration time{0};
+  return &time;
+}
+
+/*! \brief The lock of the profiles recorded in the pass contexts. */
+static std::mutex pass_profiles_mutex;
+
+IRModule Pass::operator()(const IRModule& mod) const {
+  return this->operator()(mod, PassContext::Current());
+}
+
+IRModule Pass::operator()(const IRModule& mod, const PassContext& pass_ctx) const {
+  const PassNode* node = operator->();
+  CHECK(node != nullptr);
+  if (!pass_ctx->profile_passes) {
+    return node->operator()(mod, pass_ctx);
+  }
+  using Clock = std::chrono::high_resolution_clock;
+  Clock::time_point counting = Clock::now();
+  auto profile = make_object<PassProfileNode>();
+  profile->name = node->Info()->name;
+  // The input nodes are held until the output is counted, to tell the new nodes.
+  NodeCounter before(true);
+  profile->num_nodes_before = before.Count(mod);
+  std::vector<PassProfile>* running = RunningPassProfiles();
+  running->push_back(PassProfile(profile));
+  Clock::duration* profiling_time = PassProfilingTime();
+  Clock::time_point start = Clock::now();
+  *profiling_time += start - counting;
+  // The profiling of the passes run by this one is left out.
+  Clock::duration nested_profiling_time = *profiling_time;
+  IRModule updated_mod;
+  try {
+    updated_mod = node->operator()(mod, pass_ctx);
+  } catch (...) {
+    running->pop_back();
+    throw;
+  }
+  Clock::time_point end = Clock::now();
+  nested_profiling_time = *profiling_time - nested_profiling_time;
+  profile->duration_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      end - start - nested_profiling_time).count();
+  NodeCounter after;
+  profile->num_nodes_after = after.Count(updated_mod);
+  profile->num_new_nodes = after.CountNotIn(before);
+  running->pop_back();
+  if (!running->empty()) {
+    running->back()->children.push_back(PassProfile(profile));
+  } else {
+    PassContext ctx = pass_ctx;
+    std::lock_guard<std::mutex> lock(pass_profiles_mutex);
+    ctx->pass_profiles.push_back(PassProfile(profile));
+  }
+  *profiling_time += Clock::now() - end;
+  return updated_mod;
+}
+
+/*!
+ * \brief Print the profiles of passes as a table, the passes run by a pass
+ *  indented under it.
+ */
+static void PrintPassProfiles(const Array<ObjectRef>& profiles, int depth,
+                              std::ostream& os) {
+  for (const ObjectRef& ref : profiles) {
+    const auto* profile = ref.as<PassProfileNode>();
+    CHECK(profile != nullptr);
+    std::string name = std::string(2 * depth, ' ') + profile->name;
+    os << std::left << std::setw(48) << name << std::right
+       << std::setw(12) << std::fixed << std::setprecision(3)
+       << profile->duration_us / 1000.0
+       << std::setw(12) << profile->num_nodes_before
+       << std::setw(12) << profile->num_nodes_after
+       << std::setw(12) << profile->num_new_nodes << "\n";
+    PrintPassProfiles(profile->children, depth + 1, os);
+  }
+}
+
 class ModulePass;
 
 /*!
@@ -429,6 +595,9 @@ TVM_REGISTER_GLOBAL("transform.PassContext")
   tvm::Array<tvm::PrimExpr> required = args[2];
   tvm::Array<tvm::PrimExpr> disabled = args[3];
   TraceFunc trace_func = args[4];
+  pctx->profile_passes = args.num_args > 5 && static_cast<bool>(args[5]);
+  pctx->plan_memory_offset = args.num_args > 6 && static_cast<bool>(args[6]);
+  pctx->fuse_bytecode = args.num_args <= 7 || static_cast<bool>(args[7]);
   pctx->opt_level = opt_level;
   pctx->fallback_device = fallback_device;
   pctx->required_pass = std::move(required);
@@ -459,6 +628,47 @@ TVM_STATIC_IR_FUNCTOR(ReprPrinter, vtable)
   p->stream << "]";
 });
 
+TVM_REGISTER_NODE_TYPE(PassProfileNode);
+
+TVM_REGISTER_GLOBAL("transform.GetPassProfiles")
+.set_body_typed([](PassContext pass_ctx) {
+  std::lock_guard<std::mutex> lock(pass_profiles_mutex);
+  return pass_ctx->pass_profiles;
+});
+
+TVM_REGISTER_GLOBAL("transform.ClearPassProfiles")
+.set_body_typed([](PassContext pass_ctx) {
+  std::lock_guard<std::mutex> lock(pass_profiles_mutex);
+  pass_ctx->pass_profiles = Array<PassProfile>();
+});
+
+TVM_REGISTER_GLOBAL("transform.RenderPassProfiles")
+.set_body_typed([](PassContext pass_ctx) {
+  Array<ObjectRef> profiles;
+  {
+    std::lock_guard<std::mutex> lock(pass_profiles_mutex);
+    for (const PassProfile& profile : pass_ctx->pass_profiles) {
+      profiles.push_back(profile);
+    }
+  }
+  std::ostringstream os;
+  os << std::left << std::setw(48) << "Pass" << std::right
+     << std::setw(12) << "Time(ms)"
+     << std::setw(12) << "Nodes In"
+     << std::setw(12) << "Nodes Out"
+     << std::setw(12) << "New Nodes" << "\n";
+  PrintPassProfiles(profiles, 0, os);
+  return os.str();
+});
+
+TVM_STATIC_IR_FUNCTOR(ReprPrinter, vtable)
+.set_dispatch<PassProfileNode>([](const ObjectRef& ref, ReprPrinter* p) {
+  auto* node = static_cast<const PassProfileNode*>(ref.get());
+  p->stream << "PassProfile(" << node->name << ", " << node->duration_us << "us, "
+            << node->num_nodes_before << " -> " << node->num_nodes_after << " nodes, "
+            << node->num_new_nodes << " new)";
+});
+
 class PassContext::Internal {
  public:
   static void EnterScope(PassContext pass_ctx) {
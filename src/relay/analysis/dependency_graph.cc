@@ -74,12 +74,21 @@ class DependencyGraph::Creator : private ExprFunctor<void(const Expr& e)> {
 
   void VisitExpr(const Expr& e) final {
     if (visited_.count(e) == 0) {
-      if (graph_.expr_node.count(e) == 0) {
-        graph_.expr_node[e] = NewNode(false);
-      }
-      visited_.insert(e);
-      ExprFunctor<void(const Expr&)>::VisitExpr(e);
-      graph_.post_dfs_order.push_back(graph_.expr_node[e]);
+      // Visit the dataflow operands first, so that long chains of calls do
+      // not recurse.
+      ExpandDataflow(
+          e,
+          [this](const Expr& n) {
+            return visited_.count(n) != 0;
+          },
+          [this](const Expr& n) {
+            if (graph_.expr_node.count(n) == 0) {
+              graph_.expr_node[n] = NewNode(false);
+            }
+            visited_.insert(n);
+            ExprFunctor<void(const Expr&)>::VisitExpr(n);
+            graph_.post_dfs_order.push_back(graph_.expr_node[n]);
+          });
     }
   }
 
@@ -31,7 +31,7 @@ namespace relay {
 
 
 //! brief make sure each Var is bound at most once in a scope.
-class WellFormedChecker : private ExprVisitor, PatternVisitor {
+class WellFormedChecker : private MixedModeVisitor, PatternVisitor {
   bool well_formed = true;
 
   std::vector<std::unordered_set<Var, ObjectHash, ObjectEqual>> scope;
@@ -39,18 +39,26 @@ class WellFormedChecker : private ExprVisitor, PatternVisitor {
   std::unordered_set<Var, ObjectHash, ObjectEqual> total_bound;
   std::unordered_set<Var, ObjectHash, ObjectEqual> free;
 
+  void PushScope() {
+    scope.push_back({{}});
+  }
+
+  void PopScope() {
+    CHECK_GE(scope.size(), 0);
+    for (const Var& v : scope.back()) {
+      CHECK_GE(current_bound.count(v), 0);
+      current_bound.erase(v);
+    }
+    scope.pop_back();
+  }
+
   struct Scope {
     WellFormedChecker* wfc;
     explicit Scope(WellFormedChecker* wfc) : wfc(wfc) {
-      wfc->scope.push_back({{}});
+      wfc->PushScope();
     }
     ~Scope() {
-      CHECK_GE(wfc->scope.size(), 0);
-      for (const Var& v : wfc->scope.back()) {
-        CHECK_GE(wfc->current_bound.count(v), 0);
-        wfc->current_bound.erase(v);
-      }
-      wfc->scope.pop_back();
+      wfc->PopScope();
     }
   };
 
@@ -76,12 +84,20 @@ class WellFormedChecker : private ExprVisitor, PatternVisitor {
   }
 
   void VisitExpr_(const LetNode* l) final {
-    Scope s(this);
-    // we do letrec only for FunctionNode,
-    // but shadowing let in let binding is likely programming error, and we should forbidden it.
-    Bound(l->var);
-    CheckWellFormed(l->value);
-    CheckWellFormed(l->body);
+    // The scope of each let of the chain ends after the lets of its body.
+    ExpandANormalForm(
+        l,
+        [this](const LetNode* let) {
+          PushScope();
+          // we do letrec only for FunctionNode, but shadowing let in let
+          // binding is likely programming error, and we should forbidden it.
+          Bound(let->var);
+          CheckWellFormed(let->value);
+        },
+        [this](const LetNode* let) {
+          if (let->body.as<LetNode>() == nullptr) CheckWellFormed(let->body);
+          PopScope();
+        });
   }
 
   void VisitExpr_(const FunctionNode* f) final {
@@ -110,7 +126,7 @@ class WellFormedChecker : private ExprVisitor, PatternVisitor {
     if (auto v = e.as<VarNode>()) {
       VisitExpr_(v);
     } else {
-      ExprVisitor::VisitExpr(e);
+      MixedModeVisitor::VisitExpr(e);
     }
   }
 
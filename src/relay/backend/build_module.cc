@@ -29,7 +29,13 @@
 #include <tvm/relay/transform.h>
 #include <tvm/relay/qnn/transform.h>
 #include <tvm/tir/ir_pass.h>
+#include <algorithm>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
 
 #include "../../target/source/codegen_source_base.h"
 #include "utils.h"
@@ -65,8 +71,8 @@ struct GraphCodegen {
   }
   ~GraphCodegen() {}
 
-  void Init(runtime::Module* m, TargetsMap targets) {
-    CallFunc("init", m, targets);
+  void Init(runtime::Module* m, TargetsMap targets, Target target_host) {
+    CallFunc("init", m, targets, target_host);
   }
 
   void Codegen(const Function& func) {
@@ -110,6 +116,162 @@ struct GraphCodegen {
   }
 };
 
+/*!
+ * \brief A build kept for the incremental builds.
+ */
+struct IncrementalBuild {
+  /*! \brief The targets, the build configuration and the pass context. */
+  std::string context;
+  /*! \brief The functions of the input module, by name. */
+  std::unordered_map<std::string, Function> input_funcs;
+  /*! \brief The hash of the input module. */
+  size_t input_hash;
+  /*! \brief The optimized main function. */
+  Function optimized_func;
+  /*! \brief The hash of the optimized main function. */
+  size_t optimized_hash;
+  /*! \brief The lowered functions printed, or empty when the module is not reusable alone. */
+  std::string lowered_funcs;
+  /*! \brief The output, with the constants lifted by the codegen as params. */
+  BuildOutput output;
+};
+
+/*!
+ * \brief The builds reused by the incremental builds of the process.
+ *
+ *  A build is found from the module it was built from, then from its
+ *  optimized main function, then from its lowered functions, from which
+ *  the runtime module alone is reused. The hashes of Relay are only stable
+ *  within a process, so the builds are not kept across processes.
+ */
+class IncrementalBuildCache {
+ public:
+  /*! \brief The number of builds kept, the least recently used ones are dropped. */
+  static constexpr size_t kMaxBuilds = 8;
+
+  static IncrementalBuildCache* Global() {
+    static IncrementalBuildCache* inst = new IncrementalBuildCache();
+    return inst;
+  }
+
+  /*! \brief The functions of a module by name. */
+  static std::unordered_map<std::string, Function> Functions(const IRModule& mod) {
+    std::unordered_map<std::string, Function> funcs;
+    for (const auto& kv : mod->functions) {
+      if (const auto* func = kv.second.as<FunctionNode>()) {
+        funcs[kv.first->name_hint] = GetRef<Function>(func);
+      }
+    }
+    return funcs;
+  }
+
+  /*! \brief The hash of the functions of a module, independent of their order. */
+  static size_t Hash(const std::unordered_map<std::string, Function>& funcs) {
+    size_t hash = 0;
+    for (const auto& kv : funcs) {
+      hash += std::hash<std::string>()(kv.first) ^ StructuralHash()(kv.second);
+    }
+    return hash;
+  }
+
+  /*!
+   * \brief Find the build of a module.
+   * \param context The context of the build.
+   * \param funcs The functions of the module.
+   * \param hash Their hash.
+   * \param build The build found.
+   * \return Whether a build was found.
+   */
+  bool FindInput(const std::string& context, const std::unordered_map<std::string, Function>& funcs,
+                 size_t hash, IncrementalBuild* build) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = builds_.begin(); it != builds_.end(); ++it) {
+      if (it->context != context || it->input_hash != hash ||
+          it->input_funcs.size() != funcs.size()) {
+        continue;
+      }
+      bool equal = true;
+      for (const auto& kv : funcs) {
+        auto f = it->input_funcs.find(kv.first);
+        if (f == it->input_funcs.end() || !AlphaEqual(f->second, kv.second)) {
+          equal = false;
+          break;
+        }
+      }
+      if (equal) return Use(it, build);
+    }
+    return false;
+  }
+
+  /*!
+   * \brief Find the build of an optimized main function.
+   * \param context The context of the build.
+   * \param func The optimized function.
+   * \param hash Its hash.
+   * \param build The build found.
+   * \return Whether a build was found.
+   */
+  bool FindOptimized(const std::string& context, const Function& func, size_t hash,
+                     IncrementalBuild* build) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = builds_.begin(); it != builds_.end(); ++it) {
+      if (it->context == context && it->optimized_hash == hash &&
+          AlphaEqual(it->optimized_func, func)) {
+        return Use(it, build);
+      }
+    }
+    return false;
+  }
+
+  /*!
+   * \brief Find the runtime module built from lowered functions.
+   * \param context The context of the build.
+   * \param lowered_funcs The lowered functions printed.
+   * \return The module, undefined when none was found.
+   */
+  runtime::Module FindLowered(const std::string& context, const std::string& lowered_funcs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& build : builds_) {
+      if (build.context == context && !build.lowered_funcs.empty() &&
+          build.lowered_funcs == lowered_funcs) {
+        return build.output.mod;
+      }
+    }
+    return runtime::Module();
+  }
+
+  /*! \brief Keep a build, replacing the one of the same optimized function. */
+  void Add(const IncrementalBuild& build) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = builds_.begin(); it != builds_.end(); ++it) {
+      if (it->context == build.context && it->optimized_hash == build.optimized_hash &&
+          AlphaEqual(it->optimized_func, build.optimized_func)) {
+        builds_.erase(it);
+        break;
+      }
+    }
+    builds_.push_front(build);
+    if (builds_.size() > kMaxBuilds) builds_.pop_back();
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    builds_.clear();
+  }
+
+ private:
+  /*! \brief Copy a build out and mark it as the most recently used. */
+  bool Use(std::list<IncrementalBuild>::iterator it, IncrementalBuild* build) {
+    builds_.splice(builds_.begin(), builds_, it);
+    *build = builds_.front();
+    return true;
+  }
+
+  /*! \brief The builds, the most recently used first. */
+  std::list<IncrementalBuild> builds_;
+  std::mutex mutex_;
+};
+
 /*!
  * \brief Relay build module
  *
@@ -134,8 +296,9 @@ class RelayBuildModule : public runtime::ModuleNode {
       });
     } else if (name == "build") {
       return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
-        CHECK_EQ(args.num_args, 3);
-        this->Build(args[0], args[1], args[2]);
+        CHECK(args.num_args == 3 || args.num_args == 4);
+        bool incremental = args.num_args == 4 && static_cast<bool>(args[3]);
+        this->Build(args[0], args[1], args[2], incremental);
       });
     } else if (name == "list_params") {
       return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
@@ -154,10 +317,12 @@ class RelayBuildModule : public runtime::ModuleNode {
       });
     } else if (name == "get_lowered_funcs") {
       return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+          CHECK(this->graph_codegen_ != nullptr) << "The build was reused without codegen";
           *rv = this->graph_codegen_->GetLoweredFunc();
       });
     } else if (name == "get_external_modules") {
       return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+          CHECK(this->graph_codegen_ != nullptr) << "The build was reused without codegen";
           *rv = this->graph_codegen_->GetExternalModules();
       });
     } else if (name == "optimize") {
@@ -240,13 +405,20 @@ class RelayBuildModule : public runtime::ModuleNode {
    * \param mod Relay IRModule
    * \param target Target device
    * \param target_host Host target device
+   * \param incremental Whether to keep the params as inputs and reuse the
+   *  previous builds of the same module
    */
   void Build(IRModule mod,
              const TargetsMap& targets,
-             const tvm::Target& target_host) {
+             const tvm::Target& target_host,
+             bool incremental = false) {
     targets_ = targets;
     target_host_ = target_host;
-    BuildRelay(mod, params_);
+    if (incremental) {
+      BuildIncremental(mod, params_);
+    } else {
+      BuildRelay(mod, params_);
+    }
   }
 
  protected:
@@ -343,6 +515,13 @@ class RelayBuildModule : public runtime::ModuleNode {
     // inline functions. However, this should be very unlikely for accelerators
     // and vendor-provided libraries. So we don't handle for now.
     relay_module = transform::Inline()(relay_module);
+    // Reorder the fused calls to reduce the peak memory, only when required.
+    BaseFunc main = relay_module->Lookup("main");
+    relay_module = transform::Sequential({transform::ScheduleForMemory()})(relay_module);
+    // Only a reordered function lacks the types of its new let bindings.
+    if (!relay_module->Lookup("main").same_as(main)) {
+      relay_module = transform::InferType()(relay_module);
+    }
     CHECK(relay_module.defined());
 
     return relay_module;
@@ -443,16 +622,106 @@ class RelayBuildModule : public runtime::ModuleNode {
     relay_module = Optimize(relay_module, targets_, params);
     // Get the updated function.
     auto func = Downcast<Function>(relay_module->Lookup("main"));
+    Codegen(func);
+    BuildModule(graph_codegen_->GetLoweredFunc());
+  }
 
+  /*!
+   * \brief Build a module whose params stay inputs of the graph, reusing
+   *  the previous builds of the process when only the params changed.
+   *
+   *  The params are neither bound nor folded, so that the build does not
+   *  depend on their values, and are returned along the constants lifted
+   *  by the codegen.
+   *
+   * \param relay_module The Relay IRModule.
+   * \param params The params, whose types must match the parameters of main.
+   */
+  void BuildIncremental(
+      IRModule relay_module,
+      const std::unordered_map<std::string, tvm::runtime::NDArray>& params) {
+    CHECK(relay_module->ContainGlobalVar("main"))
+      << "Missing the main entry function";
+    auto main_func = Downcast<Function>(relay_module->Lookup("main"));
+    std::unordered_map<std::string, runtime::NDArray> inputs;
+    for (const Var& param : main_func->params) {
+      auto it = params.find(param->name_hint());
+      if (it == params.end()) continue;
+      CHECK(param->type_annotation.defined() &&
+            AlphaEqual(param->type_annotation, ConstantNode::make(it->second)->tensor_type()))
+        << "The incremental build needs the type of the param " << param->name_hint()
+        << " annotated with the shape and dtype of its value";
+      inputs[it->first] = it->second;
+    }
+
+    IncrementalBuildCache* cache = IncrementalBuildCache::Global();
+    // The lowering passes and the lowering hook are functions whose output is
+    // not part of the context, the builds using them are not reused.
+    bool reuse = BuildConfig::Current()->add_lower_pass.empty() &&
+                 runtime::Registry::Get("relay.backend.lower") == nullptr;
+    IncrementalBuild build;
+    build.context = BuildContext();
+    build.input_funcs = IncrementalBuildCache::Functions(relay_module);
+    build.input_hash = IncrementalBuildCache::Hash(build.input_funcs);
+    IncrementalBuild prev;
+    if (reuse && cache->FindInput(build.context, build.input_funcs, build.input_hash, &prev)) {
+      graph_codegen_.reset();
+      ret_ = prev.output;
+    } else {
+      relay_module = Optimize(relay_module, targets_, {});
+      build.optimized_func = Downcast<Function>(relay_module->Lookup("main"));
+      build.optimized_hash = StructuralHash()(build.optimized_func);
+      if (reuse && cache->FindOptimized(build.context, build.optimized_func,
+                                        build.optimized_hash, &prev)) {
+        graph_codegen_.reset();
+        build.lowered_funcs = prev.lowered_funcs;
+        ret_ = prev.output;
+      } else {
+        Codegen(build.optimized_func);
+        auto lowered_funcs = graph_codegen_->GetLoweredFunc();
+        // The modules of the external functions and of the disk compile
+        // cache are not part of the lowered functions.
+        if (graph_codegen_->GetExternalModules().empty()) {
+          build.lowered_funcs = PrintLoweredFuncs(lowered_funcs);
+        }
+        runtime::Module mod;
+        if (reuse && !build.lowered_funcs.empty()) {
+          mod = cache->FindLowered(build.context, build.lowered_funcs);
+        }
+        if (mod.defined()) {
+          ret_.mod = mod;
+        } else {
+          BuildModule(lowered_funcs);
+        }
+      }
+      build.output = ret_;
+      if (reuse) cache->Add(build);
+    }
+    for (const auto& kv : inputs) {
+      ret_.params[kv.first] = kv.second;
+    }
+  }
+
+ private:
+  /*!
+   * \brief Generate the graph of a function, and its lifted params.
+   * \param func The optimized function.
+   */
+  void Codegen(const Function& func) {
     // Generate code for the updated function.
     graph_codegen_ = std::unique_ptr<GraphCodegen>(new GraphCodegen());
-    graph_codegen_->Init(nullptr, targets_);
+    graph_codegen_->Init(nullptr, targets_, target_host_);
     graph_codegen_->Codegen(func);
 
     ret_.graph_json = graph_codegen_->GetJSON();
     ret_.params = graph_codegen_->GetParams();
+  }
 
-    auto lowered_funcs = graph_codegen_->GetLoweredFunc();
+  /*!
+   * \brief Build the runtime module of the generated graph.
+   * \param lowered_funcs The lowered functions of each target.
+   */
+  void BuildModule(const Map<std::string, Array<LoweredFunc>>& lowered_funcs) {
 
     // When there is no lowered_funcs due to reasons such as optimization.
     if (lowered_funcs.size() == 0) {
@@ -474,10 +743,7 @@ class RelayBuildModule : public runtime::ModuleNode {
         ret_.mod = tvm::codegen::CSourceModuleCreate(";", "");
       }
     } else {
-      ret_.mod = tvm::build(
-        lowered_funcs,
-        target_host_,
-        BuildConfig::Current());
+      ret_.mod = BuildLoweredFuncs(lowered_funcs);
     }
 
     Array<tvm::runtime::Module> ext_mods = graph_codegen_->GetExternalModules();
@@ -486,7 +752,103 @@ class RelayBuildModule : public runtime::ModuleNode {
       ret_.mod.Import(it);
   }
 
- private:
+  /*!
+   * \brief The context of a build that its output depends on, other than
+   *  the module: the targets, the build configuration and the pass context.
+   */
+  std::string BuildContext() {
+    std::ostringstream os;
+    std::map<int64_t, std::string> targets;
+    for (const auto& kv : targets_) {
+      targets[kv.first->value] = kv.second->str();
+    }
+    for (const auto& kv : targets) {
+      os << "target " << kv.first << " " << kv.second << "\n";
+    }
+    if (target_host_.defined()) {
+      os << "target_host " << target_host_->str() << "\n";
+    }
+    transform::PassContext pass_ctx = PassContext::Current();
+    os << BuildConfig::Current() << "\n"
+       << "opt_level " << pass_ctx->opt_level << "\n"
+       << "fallback_device " << pass_ctx->fallback_device << "\n"
+       << "required_pass " << pass_ctx->required_pass << "\n"
+       << "disabled_pass " << pass_ctx->disabled_pass << "\n"
+       << "plan_memory_offset " << pass_ctx->plan_memory_offset << "\n";
+    return os.str();
+  }
+
+  /*! \brief The lowered functions printed in the order of their targets and names. */
+  static std::string PrintLoweredFuncs(const Map<std::string, Array<LoweredFunc>>& lowered_funcs) {
+    std::map<std::string, std::map<std::string, LoweredFunc>> sorted;
+    for (const auto& kv : lowered_funcs) {
+      for (const LoweredFunc& f : kv.second) {
+        sorted[kv.first][f->name] = f;
+      }
+    }
+    std::ostringstream os;
+    for (const auto& target : sorted) {
+      os << "target " << target.first << "\n";
+      for (const auto& kv : target.second) {
+        const LoweredFunc& f = kv.second;
+        os << "func " << f->name << " " << f->args << " " << f->func_type << "\n"
+           << f->body << "\n";
+      }
+    }
+    return os.str();
+  }
+
+  /*!
+   * \brief Build the lowered functions into a module.
+   *
+   *  The functions of a single LLVM target compiled for the host are split
+   *  into chunks compiled on several threads into separate modules. The
+   *  other chunks are imported into the first one, and linked together when
+   *  exporting the library.
+   *
+   * \param lowered_funcs The lowered functions of each target.
+   * \return The built module.
+   */
+  runtime::Module BuildLoweredFuncs(const Map<std::string, Array<LoweredFunc>>& lowered_funcs) {
+    // The number of functions below which a chunk is not worth a module.
+    const int kMinFuncsPerChunk = 16;
+    BuildConfig config = BuildConfig::Current();
+    if (lowered_funcs.size() != 1) {
+      return tvm::build(lowered_funcs, target_host_, config);
+    }
+    std::string target_str = (*lowered_funcs.begin()).first;
+    Target target = Target::Create(target_str);
+    Array<LoweredFunc> funcs = (*lowered_funcs.begin()).second;
+    int num_chunks = std::min(GetNumBuildThreads(),
+                              static_cast<int>(funcs.size()) / kMinFuncsPerChunk);
+    if (num_chunks <= 1 || target->target_name != "llvm" ||
+        target_str.find("-system-lib") != std::string::npos ||
+        (target_host_.defined() && target_host_->str() != target_str)) {
+      return tvm::build(lowered_funcs, target_host_, config);
+    }
+    // Sort the functions by name, so that the chunks only depend on them.
+    std::vector<LoweredFunc> sorted(funcs.begin(), funcs.end());
+    std::sort(sorted.begin(), sorted.end(), [](const LoweredFunc& a, const LoweredFunc& b) {
+      return a->name < b->name;
+    });
+    std::vector<runtime::Module> modules(num_chunks);
+    transform::PassContext pass_ctx = transform::PassContext::Current();
+    ParallelFor(num_chunks, num_chunks, [&](int i) {
+      size_t begin = sorted.size() * i / num_chunks;
+      size_t end = sorted.size() * (i + 1) / num_chunks;
+      Map<std::string, Array<LoweredFunc>> chunk;
+      chunk.Set(target_str, Array<LoweredFunc>(sorted.begin() + begin, sorted.begin() + end));
+      // The build contexts are thread local.
+      With<BuildConfig> config_scope(config);
+      With<transform::PassContext> pass_scope(pass_ctx);
+      modules[i] = tvm::build(chunk, target_host_, config);
+    });
+    for (int i = 1; i < num_chunks; ++i) {
+      modules[0].Import(modules[i]);
+    }
+    return modules[0];
+  }
+
   Target GetTargetHost() {
     Target target_host = target_host_;
     if (!target_host_.defined()) {
@@ -522,6 +884,11 @@ TVM_REGISTER_GLOBAL("relay.build_module._BuildModule")
   *rv = RelayBuildCreate();
 });
 
+TVM_REGISTER_GLOBAL("relay.build_module._ClearIncrementalBuilds")
+.set_body_typed([]() {
+  IncrementalBuildCache::Global()->Clear();
+});
+
 TVM_REGISTER_GLOBAL("relay.build_module.BindParamsByName")
 .set_body([](TVMArgs args, TVMRetValue* rv) {
   Map<std::string, Constant> params = args[1];
@@ -0,0 +1,152 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file relay/backend/compile_cache.cc
+ * \brief The on-disk cache of the modules compiled from primitive functions.
+ */
+#include <tvm/ir/module.h>
+#include <tvm/runtime/c_runtime_api.h>
+#include <tvm/runtime/registry.h>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <utility>
+
+#include "compile_cache.h"
+
+namespace tvm {
+namespace relay {
+
+/*! \brief The 64-bit FNV-1a digest of a string, in hexadecimal. */
+static std::string Digest(const std::string& str) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char c : str) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  std::ostringstream os;
+  os << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return os.str();
+}
+
+/*! \brief A name next to a path for writing it before renaming it over the path. */
+static std::string TempPath(const std::string& path) {
+  static std::random_device rd;
+  std::ostringstream os;
+  os << path << ".tmp" << std::hex << rd() << rd();
+  return os.str();
+}
+
+/*! \brief Rename a written file over its final path. */
+static void Commit(const std::string& temp, const std::string& path) {
+#ifdef _WIN32
+  // rename does not replace an existing file on Windows.
+  std::remove(path.c_str());
+#endif
+  if (std::rename(temp.c_str(), path.c_str()) != 0) {
+    std::remove(temp.c_str());
+    LOG(WARNING) << "Cannot write the compile cache entry " << path;
+  }
+}
+
+DiskCompileCache::DiskCompileCache(std::string root) : root_(std::move(root)) {
+  CHECK(!root_.empty()) << "The compile cache needs a directory";
+#ifdef _WIN32
+  int ret = _mkdir(root_.c_str());
+#else
+  int ret = mkdir(root_.c_str(), 0777);
+#endif
+  struct stat st;
+  CHECK((ret == 0 || errno == EEXIST) && stat(root_.c_str(), &st) == 0 &&
+        (st.st_mode & S_IFDIR))
+      << "Cannot use " << root_ << " as the compile cache directory";
+}
+
+bool DiskCompileCache::Supports(const CCacheKey& key, const BuildConfig& config) {
+  return key->target->target_name == "llvm" &&
+      key->target->str().find("-system-lib") == std::string::npos &&
+      !key->source_func->GetAttr<tir::StringImm>(attr::kCompiler).defined() &&
+      config->add_lower_pass.empty() &&
+      runtime::Registry::Get("runtime.module.loadfile_ll") != nullptr;
+}
+
+std::string DiskCompileCache::EntryKey(const CCacheKey& key, const BuildConfig& config) {
+  std::ostringstream os;
+  os << "tvm " << TVM_VERSION << "\n"
+     << "target " << key->target->str() << "\n"
+     << config << "\n"
+     // with the meta data, so that the values of the constants are included
+     << AsText(key->source_func, true);
+  return os.str();
+}
+
+std::string DiskCompileCache::EntryPath(const std::string& key) const {
+  return root_ + "/" + Digest(key);
+}
+
+bool DiskCompileCache::Load(const std::string& key, std::string* func_name,
+                            runtime::Module* module) const {
+  std::string path = EntryPath(key);
+  std::ifstream fs(path + ".key", std::ios::binary);
+  if (!fs) return false;
+  std::getline(fs, *func_name);
+  std::stringstream entry_key;
+  entry_key << fs.rdbuf();
+  // Different keys with the same digest are misses.
+  if (func_name->empty() || entry_key.str() != key) return false;
+  std::string bitcode = path + "-" + *func_name + ".bc";
+  if (!std::ifstream(bitcode)) return false;
+  *module = (*runtime::Registry::Get("runtime.module.loadfile_ll"))(bitcode);
+  return true;
+}
+
+void DiskCompileCache::Save(const std::string& key, const std::string& func_name,
+                            const runtime::Module& module) const {
+  std::string path = EntryPath(key);
+  std::string bitcode = path + "-" + func_name + ".bc";
+  std::string temp = TempPath(bitcode);
+  runtime::Module mod = module;
+  mod->SaveToFile(temp, "bc");
+  Commit(temp, bitcode);
+
+  temp = TempPath(path + ".key");
+  {
+    std::ofstream fs(temp, std::ios::binary);
+    fs << func_name << "\n" << key;
+    if (!fs) {
+      std::remove(temp.c_str());
+      LOG(WARNING) << "Cannot write the compile cache entry " << path;
+      return;
+    }
+  }
+  Commit(temp, path + ".key");
+}
+
+}  // namespace relay
+}  // namespace tvm
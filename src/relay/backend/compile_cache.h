@@ -0,0 +1,110 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file relay/backend/compile_cache.h
+ * \brief The on-disk cache of the modules compiled from primitive functions,
+ *  shared by the builds of every process using the same directory.
+ */
+#ifndef TVM_RELAY_BACKEND_COMPILE_CACHE_H_
+#define TVM_RELAY_BACKEND_COMPILE_CACHE_H_
+
+#include <tvm/runtime/module.h>
+#include <tvm/target/target.h>
+
+#include <string>
+
+#include "compile_engine.h"
+
+namespace tvm {
+namespace relay {
+
+/*!
+ * \brief A content-addressed cache of the LLVM modules compiled from
+ *  primitive functions.
+ *
+ *  Relay's StructuralHash hashes operators by address, so it differs between
+ *  processes. Entries are instead keyed on the printed function, the target,
+ *  the build configuration and the TVM version, and named after a digest of
+ *  that key. An entry is the key with the name of the compiled function, and
+ *  the optimized LLVM bitcode of the function. A hit only needs the bitcode
+ *  loaded, skipping scheduling, lowering and LLVM optimization.
+ *
+ *  Files are written under a temporary name then renamed, and the bitcode is
+ *  written before the key refers to it, so concurrent builds never read a
+ *  partial entry.
+ *
+ *  The tuning configurations applied during lowering are not part of the
+ *  key: builds with different tuning logs should use different directories.
+ */
+class DiskCompileCache {
+ public:
+  /*!
+   * \brief Open a cache directory, creating it when missing.
+   * \param root The directory.
+   */
+  explicit DiskCompileCache(std::string root);
+
+  /*!
+   * \brief Whether the functions of a key can be cached: host LLVM targets
+   *  only, outside of system libraries and custom lowering passes.
+   * \param key The key to the cached function.
+   * \param config The build configuration.
+   */
+  static bool Supports(const CCacheKey& key, const BuildConfig& config);
+
+  /*!
+   * \brief The key of the entry of a function.
+   * \param key The key to the cached function.
+   * \param config The build configuration.
+   */
+  static std::string EntryKey(const CCacheKey& key, const BuildConfig& config);
+
+  /*!
+   * \brief Load an entry.
+   * \param key The key of the entry.
+   * \param func_name The name of the compiled function.
+   * \param module The compiled module.
+   * \return Whether the entry was found.
+   */
+  bool Load(const std::string& key, std::string* func_name, runtime::Module* module) const;
+
+  /*!
+   * \brief Save an entry, replacing any previous one.
+   * \param key The key of the entry.
+   * \param func_name The name of the compiled function.
+   * \param module The LLVM module compiled from the function.
+   */
+  void Save(const std::string& key, const std::string& func_name,
+            const runtime::Module& module) const;
+
+  /*! \return The directory of the cache. */
+  const std::string& root() const { return root_; }
+
+ private:
+  /*! \brief The path of the files of an entry, without their extension. */
+  std::string EntryPath(const std::string& key) const;
+
+  /*! \brief The cache directory. */
+  std::string root_;
+};
+
+}  // namespace relay
+}  // namespace tvm
+#endif  // TVM_RELAY_BACKEND_COMPILE_CACHE_H_
@@ -36,13 +36,19 @@
 
 #include <topi/tags.h>
 #include <utility>
+#include <atomic>
+#include <cstdlib>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <functional>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 
+#include "compile_cache.h"
 #include "compile_engine.h"
+#include "utils.h"
 
 namespace tvm {
 namespace relay {
@@ -606,6 +612,120 @@ class CompileEngineImpl : public CompileEngineNode {
     return value->packed_func;
   }
 
+  CachedFunc LowerWithDiskCache(const CCacheKey& key) final {
+    std::shared_ptr<DiskCompileCache> disk_cache;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      disk_cache = disk_cache_;
+      auto it = disk_cache_funcs_.find(key);
+      if (it != disk_cache_funcs_.end()) return it->second;
+    }
+    BuildConfig config = BuildConfig::Current();
+    if (disk_cache == nullptr || !DiskCompileCache::Supports(key, config)) {
+      return Lower(key);
+    }
+    std::string entry_key = DiskCompileCache::EntryKey(key, config);
+    CachedFunc cfunc = LoadFromDiskCache(*disk_cache, key, entry_key);
+    if (cfunc.defined()) return cfunc;
+    cfunc = Lower(key);
+    if (cfunc->funcs.empty()) return cfunc;
+    return BuildToDiskCache(*disk_cache, key, entry_key, cfunc, config, false);
+  }
+
+  void LowerParallel(const Array<CCacheKey>& keys, bool use_disk_cache) final {
+    BuildConfig config = BuildConfig::Current();
+    std::shared_ptr<DiskCompileCache> disk_cache;
+    if (use_disk_cache) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      disk_cache = disk_cache_;
+    }
+    transform::PassContext pass_ctx = transform::PassContext::Current();
+    struct Task {
+      CCacheKey key;
+      // the function, lowered when its funcs are set
+      ObjectPtr<CachedFuncNode> node;
+      // the key of its disk cache entry, empty when it is not built
+      std::string entry_key;
+    };
+    std::vector<Task> tasks;
+    std::unordered_set<CCacheKey> seen;
+    // Schedule and name the functions in order: the schedules come from
+    // Python strategies, and the names must not depend on the threads.
+    for (const CCacheKey& key : keys) {
+      if (!seen.insert(key).second || !IsLoweredInParallel(key)) continue;
+      // The lowering hook and the Python lowering cannot be called from
+      // other threads while the caller holds the GIL, the function is
+      // lowered here like Lower does.
+      if (!LowersNatively(key, config)) {
+        if (use_disk_cache) {
+          LowerWithDiskCache(key);
+        } else {
+          Lower(key);
+        }
+        continue;
+      }
+      Task task;
+      task.key = key;
+      if (disk_cache != nullptr && DiskCompileCache::Supports(key, config)) {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (disk_cache_funcs_.count(key)) continue;
+        }
+        task.entry_key = DiskCompileCache::EntryKey(key, config);
+        if (LoadFromDiskCache(*disk_cache, key, task.entry_key).defined()) continue;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cache_.find(key);
+        if (it != cache_.end() && it->second->cached_func.defined()) {
+          if (task.entry_key.empty()) continue;
+          task.node = make_object<CachedFuncNode>(*(it->second->cached_func.operator->()));
+        }
+      }
+      if (task.node == nullptr) {
+        With<Target> target_scope(key->target);
+        task.node = make_object<CachedFuncNode>(
+            *(CreateSchedule(key->source_func, key->target).operator->()));
+        std::lock_guard<std::mutex> lock(mutex_);
+        task.node->func_name = GetUniqueName(task.node->func_name);
+      }
+      tasks.push_back(task);
+    }
+
+    // No Python hook is involved, the workers lower and build natively.
+    std::atomic<size_t> num_lowered{0};
+    backend::ParallelFor(static_cast<int>(tasks.size()), backend::GetNumBuildThreads(),
+                         [&](int i) {
+      Task& task = tasks[i];
+      // The build contexts are thread local.
+      With<BuildConfig> config_scope(config);
+      With<transform::PassContext> pass_scope(pass_ctx);
+      With<Target> target_scope(task.key->target);
+      if (task.node->funcs.empty()) {
+        LowerSchedule(task.key, task.node.get(), config);
+        num_lowered.fetch_add(1);
+      }
+      if (!task.entry_key.empty()) {
+        BuildToDiskCache(*disk_cache, task.key, task.entry_key, CachedFunc(task.node),
+                         config, true);
+      }
+    });
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_lowered_in_parallel_ += num_lowered.load();
+    for (const Task& task : tasks) {
+      auto it = cache_.find(task.key);
+      if (it == cache_.end()) {
+        CCacheValue value(make_object<CCacheValueNode>());
+        value->use_count = 0;
+        value->cached_func = CachedFunc(task.node);
+        cache_[task.key] = value;
+      } else if (!it->second->cached_func.defined()) {
+        it->second->cached_func = CachedFunc(task.node);
+      }
+    }
+  }
+
   CachedFunc LowerShapeFunc(const CCacheKey& key) final {
     return LowerShapeFuncInternal(key)->cached_func;
   }
@@ -651,6 +771,31 @@ class CompileEngineImpl : public CompileEngineNode {
 
   void Clear() final {
     cache_.clear();
+    disk_cache_funcs_.clear();
+    num_lowered_in_parallel_ = 0;
+  }
+
+  void SetDiskCache(const std::string& path) final {
+    std::shared_ptr<DiskCompileCache> disk_cache;
+    if (!path.empty()) {
+      disk_cache = std::make_shared<DiskCompileCache>(path);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    disk_cache_ = disk_cache;
+    disk_cache_funcs_.clear();
+    disk_cache_hits_ = 0;
+    disk_cache_misses_ = 0;
+  }
+  // The number of functions loaded from and built into the disk cache.
+  Array<Integer> DiskCacheStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {Integer(static_cast<int>(disk_cache_hits_)),
+            Integer(static_cast<int>(disk_cache_misses_))};
+  }
+  // The number of functions lowered on the build threads since the last clear.
+  int NumLoweredInParallel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(num_lowered_in_parallel_);
   }
   // List all items in the cache.
   Array<ObjectRef> ListItems() {
@@ -719,23 +864,64 @@ class CompileEngineImpl : public CompileEngineNode {
     }
 
     cache_node->func_name = GetUniqueName(cache_node->func_name);
+    LowerSchedule(key, cache_node.get(), BuildConfig::Current());
+    value->cached_func = CachedFunc(cache_node);
+    return value;
+  }
+  /*!
+   * \brief Whether LowerParallel lowers a function ahead of the codegen.
+   *  Device copies and external functions are left to Lower.
+   * \param key The key to the function.
+   */
+  static bool IsLoweredInParallel(const CCacheKey& key) {
+    const auto* call = key->source_func->body.as<CallNode>();
+    return !(call != nullptr && call->attrs.as<DeviceCopyAttrs>()) &&
+           !key->source_func->GetAttr<tir::StringImm>(attr::kCompiler).defined();
+  }
+  /*!
+   * \brief Whether a function is lowered by tvm::lower, which runs the passes
+   *  of the Python tvm.driver.lower but the Python lowering passes, the IR
+   *  dumps and the tensor core rewrite of CUDA.
+   * \param key The key to the function.
+   * \param config The configuration to lower with.
+   */
+  static bool LowersNatively(const CCacheKey& key, const BuildConfig& config) {
+    return runtime::Registry::Get("relay.backend.lower") == nullptr &&
+           (runtime::Registry::Get("relay.backend.python_lower") == nullptr ||
+            (config->add_lower_pass.empty() && !config->dump_pass_ir &&
+             key->target->target_name != "cuda"));
+  }
+  /*!
+   * \brief Lower the schedule of a function into its funcs, through the
+   *  lowering hook when one is registered, and natively when it can be.
+   * \param key The key to the function.
+   * \param cache_node The scheduled function.
+   * \param config The configuration to lower with.
+   */
+  static void LowerSchedule(const CCacheKey& key, CachedFuncNode* cache_node,
+                            const BuildConfig& config) {
     // NOTE: array will copy on write.
     Array<te::Tensor> all_args = cache_node->inputs;
     for (te::Tensor arg : cache_node->outputs) {
       all_args.push_back(arg);
     }
-    // lower the function
-    if (const auto* f = runtime::Registry::Get("relay.backend.lower")) {
+    if (!LowersNatively(key, config)) {
+      const auto* f = runtime::Registry::Get("relay.backend.lower");
+      if (f == nullptr) f = runtime::Registry::Get("relay.backend.python_lower");
       cache_node->funcs = (*f)(
-          cfunc->schedule, all_args, cache_node->func_name, key->source_func);
-    } else {
-      tvm::BuildConfig bcfg = BuildConfig::Create();
-      std::unordered_map<te::Tensor, tir::Buffer> binds;
-      cache_node->funcs = tvm::lower(cfunc->schedule, all_args, cache_node->func_name,
-                                     binds, bcfg);
+          cache_node->schedule, all_args, cache_node->func_name, key->source_func);
+      return;
+    }
+    std::unordered_map<te::Tensor, tir::Buffer> binds;
+    try {
+      cache_node->funcs = tvm::lower(cache_node->schedule, all_args, cache_node->func_name,
+                                     binds, config);
+    } catch (const dmlc::Error& e) {
+      LOG(FATAL) << e.what() << "\n"
+                 << "Error during compile function\n"
+                 << "-----------------------------\n"
+                 << AsText(key->source_func, false);
     }
-    value->cached_func = CachedFunc(cache_node);
-    return value;
   }
   // implement lowered shape func
   CCacheValue LowerShapeFuncInternal(const CCacheKey& key) {
@@ -771,6 +957,88 @@ class CompileEngineImpl : public CompileEngineNode {
     value->cached_func = CachedFunc(cache_node);
     return value;
   }
+  /*!
+   * \brief Load a function from the disk cache.
+   * \param disk_cache The disk cache.
+   * \param key The key to the function.
+   * \param entry_key The key of its disk cache entry.
+   * \return The function with its module, or undefined on a miss.
+   */
+  CachedFunc LoadFromDiskCache(const DiskCompileCache& disk_cache, const CCacheKey& key,
+                               const std::string& entry_key) {
+    std::string func_name;
+    runtime::Module module;
+    // A hit is only used when its function name is still free in this
+    // process, or taken by the same entry.
+    if (!disk_cache.Load(entry_key, &func_name, &module) ||
+        !ReserveName(func_name, entry_key)) {
+      return CachedFunc();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++disk_cache_hits_;
+    }
+    auto cache_node = make_object<CachedFuncNode>();
+    cache_node->target = key->target;
+    cache_node->func_name = func_name;
+    cache_node->module = module;
+    return AddDiskCacheFunc(key, CachedFunc(cache_node));
+  }
+  /*!
+   * \brief Build a lowered function and save its module to the disk cache.
+   * \param disk_cache The disk cache.
+   * \param key The key to the function.
+   * \param entry_key The key of its disk cache entry.
+   * \param cfunc The lowered function.
+   * \param config The build configuration.
+   * \param native Whether to build natively rather than through the build hook.
+   * \return The function with its module.
+   */
+  CachedFunc BuildToDiskCache(const DiskCompileCache& disk_cache, const CCacheKey& key,
+                              const std::string& entry_key, const CachedFunc& cfunc,
+                              const BuildConfig& config, bool native) {
+    runtime::Module module;
+    const auto* f = runtime::Registry::Get("relay.backend.build");
+    if (!native && f != nullptr) {
+      module = (*f)(cfunc->funcs, key->target);
+    } else {
+      module = build(cfunc->funcs, key->target, Target(nullptr), config);
+    }
+    disk_cache.Save(entry_key, cfunc->func_name, module);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      disk_cache_names_[cfunc->func_name] = entry_key;
+      ++disk_cache_misses_;
+    }
+    auto cache_node = make_object<CachedFuncNode>(*(cfunc.operator->()));
+    cache_node->funcs = Array<tir::LoweredFunc>();
+    cache_node->module = module;
+    return AddDiskCacheFunc(key, CachedFunc(cache_node));
+  }
+  // Remember a function compiled through the disk cache.
+  CachedFunc AddDiskCacheFunc(const CCacheKey& key, CachedFunc cfunc) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = disk_cache_funcs_.find(key);
+    if (it != disk_cache_funcs_.end()) return it->second;
+    disk_cache_funcs_[key] = cfunc;
+    return cfunc;
+  }
+  /*!
+   * \brief Claim a name for a function loaded from the disk cache.
+   * \param name The name of the function.
+   * \param entry_key The key of its disk cache entry.
+   * \return Whether the name was not used by another function.
+   */
+  bool ReserveName(const std::string& name, const std::string& entry_key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (name_map_.count(name)) {
+      auto it = disk_cache_names_.find(name);
+      return it != disk_cache_names_.end() && it->second == entry_key;
+    }
+    name_map_[name] = 1;
+    disk_cache_names_[name] = entry_key;
+    return true;
+  }
   /*!
    * \brief Get unique name from name.
    * \param name The orginal name.
@@ -802,14 +1070,31 @@ class CompileEngineImpl : public CompileEngineNode {
   std::unordered_map<CCacheKey, CCacheValue> cache_;
   /*! \brief internal compiler cache for shape funcs */
   std::unordered_map<CCacheKey, CCacheValue> shape_func_cache_;
+  /*! \brief the disk compile cache, if any */
+  std::shared_ptr<DiskCompileCache> disk_cache_;
+  /*! \brief the functions compiled through the disk cache */
+  std::unordered_map<CCacheKey, CachedFunc> disk_cache_funcs_;
+  /*! \brief the disk cache entry of the names of functions compiled through it */
+  std::unordered_map<std::string, std::string> disk_cache_names_;
+  /*! \brief the number of functions loaded from the disk cache */
+  size_t disk_cache_hits_{0};
+  /*! \brief the number of functions built into the disk cache */
+  size_t disk_cache_misses_{0};
+  /*! \brief the number of functions lowered on the build threads */
+  size_t num_lowered_in_parallel_{0};
 };
 
 /*! \brief The global compile engine */
 const CompileEngine& CompileEngine::Global() {
   // intentionally allocate raw pointer to avoid
   // free during destructuion.
-  static CompileEngine* inst = new CompileEngine(
-      make_object<CompileEngineImpl>());
+  static CompileEngine* inst = [] {
+    auto* engine = new CompileEngine(make_object<CompileEngineImpl>());
+    if (const char* path = getenv("TVM_COMPILE_CACHE_DIR")) {
+      (*engine)->SetDiskCache(path);
+    }
+    return engine;
+  }();
   return *inst;
 }
 
@@ -837,6 +1122,30 @@ TVM_REGISTER_GLOBAL("relay.backend._CompileEngineLower")
   return self->Lower(key);
 });
 
+TVM_REGISTER_GLOBAL("relay.backend._CompileEngineLowerWithDiskCache")
+.set_body_typed(
+    [](CompileEngine self, CCacheKey key) {
+  return self->LowerWithDiskCache(key);
+});
+
+TVM_REGISTER_GLOBAL("relay.backend._CompileEngineSetDiskCache")
+.set_body_typed(
+    [](CompileEngine self, std::string path) {
+  self->SetDiskCache(path);
+});
+
+TVM_REGISTER_GLOBAL("relay.backend._CompileEngineDiskCacheStats")
+.set_body_typed(
+    [](CompileEngine self) {
+  return static_cast<CompileEngineImpl*>(self.operator->())->DiskCacheStats();
+});
+
+TVM_REGISTER_GLOBAL("relay.backend._CompileEngineNumLoweredInParallel")
+.set_body_typed(
+    [](CompileEngine self) {
+  return static_cast<CompileEngineImpl*>(self.operator->())->NumLoweredInParallel();
+});
+
 TVM_REGISTER_GLOBAL("relay.backend._CompileEngineLowerShapeFunc")
 .set_body_typed(
     [](CompileEngine self, CCacheKey key) {
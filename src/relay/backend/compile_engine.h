@@ -83,6 +83,11 @@ struct CachedFuncNode : public Object {
   tvm::Array<tir::LoweredFunc> funcs;
   /*! \brief Parameter usage states in the shape function. */
   tvm::Array<Integer> shape_func_param_states;
+  /*!
+   * \brief The module compiled from the function on its own, through the disk
+   *  compile cache. The funcs are then empty.
+   */
+  runtime::Module module;
 
   void VisitAttrs(tvm::AttrVisitor* v) {
     v->Visit("target", &target);
@@ -205,6 +210,26 @@ class CompileEngineNode : public Object {
    * \return The result.
    */
   virtual CachedFunc Lower(const CCacheKey& key) = 0;
+  /*!
+   * \brief Get the function compiled into its own module through the disk
+   *  compile cache, when one is set and supports the key. Otherwise the
+   *  result of Lower.
+   * \param key The key to the cached function.
+   * \return The result, with the module defined when it went through the cache.
+   */
+  virtual CachedFunc LowerWithDiskCache(const CCacheKey& key) = 0;
+  /*!
+   * \brief Lower functions ahead of their Lower or LowerWithDiskCache calls,
+   *  running the lowering and the building of different functions on
+   *  TVM_BUILD_NUM_THREADS threads, by default the number of hardware threads.
+   *  The functions are scheduled and named in order, so the result does not
+   *  depend on the threads. They are lowered serially when the
+   *  relay.backend.lower hook is registered, and when the lowering needs
+   *  Python: lowering passes are added, the IR is dumped or the target is CUDA.
+   * \param keys The keys to the functions.
+   * \param use_disk_cache Whether they will be compiled through the disk cache.
+   */
+  virtual void LowerParallel(const Array<CCacheKey>& keys, bool use_disk_cache) = 0;
   /*!
    * \brief Just in time compile to get a PackedFunc.
    * \param key The key to the cached function.
@@ -225,6 +250,11 @@ class CompileEngineNode : public Object {
 
   /*! \brief clear the cache. */
   virtual void Clear() = 0;
+  /*!
+   * \brief Set the directory of the disk compile cache.
+   * \param path The directory, or empty to disable the disk cache.
+   */
+  virtual void SetDiskCache(const std::string& path) = 0;
 
   // VisitAttrs
   void VisitAttrs(AttrVisitor*) {}
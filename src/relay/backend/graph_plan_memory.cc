@@ -26,6 +26,12 @@
 #include <tvm/relay/expr.h>
 #include <tvm/relay/expr_functor.h>
 #include <tvm/relay/analysis.h>
+#include <tvm/relay/transform.h>
+
+#include <algorithm>
+#include <limits>
+#include <unordered_set>
+
 #include "../../support/arena.h"
 
 namespace tvm {
@@ -127,6 +133,36 @@ class StorageAllocaBaseVisitor : public ExprVisitor {
    * \param can_realloc Whether we can re-allocate the memory.
    */
   virtual void CreateToken(const ExprNode* op, bool can_realloc) = 0;
+  /*!
+   * \brief ceil(size/word_size) to get number of words.
+   * \param size The original size.
+   * \param word_size The element size.
+   */
+  static size_t DivRoundUp(size_t size, size_t word_size) {
+    return (size + word_size - 1) / word_size;
+  }
+  /*!
+   * \brief Get the memory requirement.
+   * \param prototype The prototype token.
+   * \return The required memory size.
+   */
+  static size_t GetMemorySize(StorageToken* prototype) {
+    const TensorTypeNode* ttype = prototype->ttype;
+    CHECK(ttype != nullptr);
+    size_t size = 1;
+    for (IndexExpr dim : ttype->shape) {
+      const int64_t* pval = tir::as_const_int(dim);
+      CHECK(pval != nullptr)
+          << "Cannot allocate memory symbolic tensor shape "
+          << ttype->shape;
+      CHECK_GE(*pval, 0)
+          << "Cannot allocate memory for tensor with negative shape"
+          << *pval;
+      size *= static_cast<size_t>(pval[0]);
+    }
+    size *= DivRoundUp(ttype->dtype.bits() * ttype->dtype.lanes(), 8);
+    return size;
+  }
 };
 
 class StorageAllocaInit : protected StorageAllocaBaseVisitor {
@@ -200,6 +236,18 @@ class StorageAllocator : public StorageAllocaBaseVisitor {
     }
     return total;
   }
+  /*!
+   * \param alignment The alignment each storage is rounded up to.
+   * \return number of bytes allocated for the intermediate tensors
+   */
+  size_t IntermediateBytes(size_t alignment) const {
+    size_t total = 0;
+    for (const auto* p : data_) {
+      if (fixed_ids_.count(p->storage_id)) continue;
+      total += DivRoundUp(p->max_bytes, alignment) * alignment;
+    }
+    return total;
+  }
 
   // Run storage allocation for a function.
   Map<Expr, Array<IntegerArray> > Plan(const Function& func) {
@@ -249,6 +297,7 @@ class StorageAllocator : public StorageAllocaBaseVisitor {
       } else {
         // Allocate a new token,
         StorageToken* allocated_tok = Alloc(tok, GetMemorySize(tok));
+        fixed_ids_.insert(allocated_tok->storage_id);
         allocated_tok->device_type = tok->device_type;
         // ensure it never get de-allocated.
         allocated_tok->ref_counter += 1;
@@ -277,36 +326,6 @@ class StorageAllocator : public StorageAllocaBaseVisitor {
       CheckForRelease(tok);
     }
   }
-  /*!
-   * \brief ceil(size/word_size) to get number of words.
-   * \param size The original size.
-   * \param word_size The element size.
-   */
-  static size_t DivRoundUp(size_t size, size_t word_size) {
-    return (size + word_size - 1) / word_size;
-  }
-  /*!
-   * \brief Get the memory requirement.
-   * \param prototype The prototype token.
-   * \return The required memory size.
-   */
-  size_t GetMemorySize(StorageToken* prototype) {
-    const TensorTypeNode* ttype = prototype->ttype;
-    CHECK(ttype != nullptr);
-    size_t size = 1;
-    for (IndexExpr dim : ttype->shape) {
-      const int64_t* pval = tir::as_const_int(dim);
-      CHECK(pval != nullptr)
-          << "Cannot allocate memory symbolic tensor shape "
-          << ttype->shape;
-      CHECK_GE(*pval, 0)
-          << "Cannot allocate memory for tensor with negative shape"
-          << *pval;
-      size *= static_cast<size_t>(pval[0]);
-    }
-    size *= DivRoundUp(ttype->dtype.bits() * ttype->dtype.lanes(), 8);
-    return size;
-  }
   /*!
    * \brief Request a storage token for a given prototype.
    * \param prototype. The prototype storage token.
@@ -382,16 +401,247 @@ class StorageAllocator : public StorageAllocaBaseVisitor {
   std::multimap<size_t, StorageToken*> free_;
   // all the storage resources available
   std::vector<StorageToken*> data_;
+  // storage ids of the parameters and constants
+  std::unordered_set<int64_t> fixed_ids_;
+  /*! \brief internal prototype token map */
+  std::unordered_map<const ExprNode*, std::vector<StorageToken*> > prototype_;
+};
+
+/*!
+ * \brief Plan the intermediate tensors of each device into a single arena,
+ *  assigning each one an offset from its liveness interval.
+ *
+ *  Tensors are placed greedily by decreasing size, each one in the smallest
+ *  gap left by the tensors already placed whose intervals overlap its own.
+ *  Parameters and constants keep a storage of their own.
+ */
+class OffsetStorageAllocator : public StorageAllocaBaseVisitor {
+ public:
+  /*! \brief The alignment of the tensors in an arena. */
+  static constexpr size_t kAlignment = 64;
+  /*! \brief The liveness interval and placement of a tensor. */
+  struct Interval {
+    /*! \brief The token of the tensor. */
+    StorageToken* tok;
+    /*! \brief The number of bytes, rounded up to the alignment. */
+    size_t size;
+    /*! \brief The first and last call during which the tensor is alive. */
+    int start, end;
+    /*! \brief The offset of the tensor in its arena. */
+    size_t offset;
+  };
+
+  // Run storage allocation for a function.
+  Map<Expr, Array<IntegerArray> > Plan(const Function& func) {
+    prototype_ = StorageAllocaInit(&arena_).GetInitTokenMap(func);
+    this->Run(func);
+    // the outputs of the function stay alive until the end.
+    for (Interval& iv : intervals_) {
+      if (iv.end < 0) iv.end = std::max(time_ - 1, iv.start);
+    }
+    this->Place();
+
+    // The value of smap contains three integer arrays holding the storage ids,
+    // the device types and the offsets in the storage.
+    Map<Expr, Array<IntegerArray> > smap;
+    int num_annotated_nodes = 0;
+    int num_nodes = 0;
+    for (const auto& kv : token_map_) {
+      std::vector<Integer> storage_ids;
+      std::vector<Integer> device_types;
+      std::vector<Integer> offsets;
+      for (StorageToken* tok : kv.second) {
+        if (tok->device_type) {
+          num_annotated_nodes++;
+        }
+        num_nodes++;
+        storage_ids.push_back(tok->storage_id);
+        device_types.push_back(tok->device_type);
+        auto it = interval_index_.find(tok);
+        offsets.push_back(IntImm(DataType::Int(64),
+            it != interval_index_.end() ? intervals_[it->second].offset : 0));
+      }
+      smap.Set(GetRef<Expr>(kv.first),
+               Array<IntegerArray>({storage_ids, device_types, offsets}));
+    }
+    // Either all or none of the nodes should be annotated.
+    if (num_annotated_nodes != 0 && num_annotated_nodes != num_nodes) {
+      LOG(FATAL)
+          << num_annotated_nodes << " out of " << num_nodes
+          << "expressions are assigned with virtual device types. Either all "
+             "or none of the expressions are expected to be annotated.";
+    }
+    return smap;
+  }
+
+  /*! \return The total number of bytes of the arenas. */
+  size_t ArenaBytes() const {
+    size_t total = 0;
+    for (const auto& kv : arena_bytes_) {
+      total += kv.second;
+    }
+    return total;
+  }
+
+  /*!
+   * \return The sum over the devices of the largest number of bytes alive at
+   *  the same time, the lower bound of ArenaBytes.
+   */
+  size_t PeakBytes() const {
+    std::unordered_map<int, std::vector<size_t> > live;
+    for (const Interval& iv : intervals_) {
+      std::vector<size_t>& bytes = live[iv.tok->device_type];
+      bytes.resize(std::max(time_, 1), 0);
+      for (int t = iv.start; t <= iv.end; ++t) {
+        bytes[t] += iv.size;
+      }
+    }
+    size_t total = 0;
+    for (const auto& kv : live) {
+      total += *std::max_element(kv.second.begin(), kv.second.end());
+    }
+    return total;
+  }
+
+ protected:
+  using StorageAllocaBaseVisitor::VisitExpr_;
+
+  void CreateToken(const ExprNode* op, bool can_realloc) final {
+    CHECK(!token_map_.count(op));
+    auto it = prototype_.find(op);
+    CHECK(it != prototype_.end());
+    for (StorageToken* tok : it->second) {
+      if (can_realloc) {
+        interval_index_[tok] = intervals_.size();
+        intervals_.push_back(
+            {tok, DivRoundUp(GetMemorySize(tok), kAlignment) * kAlignment, time_, -1, 0});
+      } else {
+        tok->max_bytes = GetMemorySize(tok);
+        tok->storage_id = num_storage_++;
+        // ensure it never get de-allocated.
+        tok->ref_counter += 1;
+      }
+    }
+    token_map_[op] = it->second;
+  }
+
+  void VisitExpr_(const CallNode* op) final {
+    std::vector<StorageToken*> args;
+    for (Expr arg : op->args) {
+      for (StorageToken* tok : GetToken(arg)) {
+        args.push_back(tok);
+      }
+    }
+    CreateToken(op, true);
+    // orphaned outputs only live during the call.
+    for (StorageToken* tok : token_map_.at(op)) {
+      CheckForRelease(tok);
+    }
+    for (StorageToken* tok : args) {
+      tok->ref_counter -= 1;
+      CheckForRelease(tok);
+    }
+    ++time_;
+  }
+
+  /*!
+   * \brief End the interval of a token if it is no longer used.
+   * \param tok The token.
+   */
+  void CheckForRelease(StorageToken* tok) {
+    CHECK_GE(tok->ref_counter, 0);
+    auto it = interval_index_.find(tok);
+    if (tok->ref_counter == 0 && it != interval_index_.end()) {
+      intervals_[it->second].end = time_;
+    }
+  }
+
+  /*! \brief Assign the offsets and the storage id of each device arena. */
+  void Place() {
+    std::vector<Interval*> order;
+    for (Interval& iv : intervals_) {
+      order.push_back(&iv);
+    }
+    std::stable_sort(order.begin(), order.end(), [](const Interval* a, const Interval* b) {
+        return a->size > b->size;
+      });
+    std::unordered_map<int, std::vector<Interval*> > placed;
+    std::unordered_map<int, int64_t> arena_id;
+    for (Interval* iv : order) {
+      int device_type = iv->tok->device_type;
+      std::vector<Interval*> overlap;
+      for (Interval* other : placed[device_type]) {
+        if (other->start <= iv->end && iv->start <= other->end) {
+          overlap.push_back(other);
+        }
+      }
+      std::sort(overlap.begin(), overlap.end(), [](const Interval* a, const Interval* b) {
+          return a->offset < b->offset;
+        });
+      // best fit among the gaps between overlapping tensors, else at the top.
+      size_t top = 0;
+      size_t best_offset = 0, best_gap = std::numeric_limits<size_t>::max();
+      for (Interval* other : overlap) {
+        if (other->offset >= top + iv->size && other->offset - top < best_gap) {
+          best_gap = other->offset - top;
+          best_offset = top;
+        }
+        top = std::max(top, other->offset + other->size);
+      }
+      iv->offset = best_gap != std::numeric_limits<size_t>::max() ? best_offset : top;
+      placed[device_type].push_back(iv);
+      arena_bytes_[device_type] = std::max(arena_bytes_[device_type], iv->offset + iv->size);
+      if (!arena_id.count(device_type)) {
+        arena_id[device_type] = num_storage_++;
+      }
+      iv->tok->storage_id = arena_id[device_type];
+    }
+  }
+
+ private:
+  // allocator
+  support::Arena arena_;
+  /*! \brief The index of the current call. */
+  int time_{0};
+  /*! \brief The number of storage ids assigned. */
+  int64_t num_storage_{0};
+  /*! \brief The intervals of the intermediate tensors. */
+  std::vector<Interval> intervals_;
+  std::unordered_map<const StorageToken*, size_t> interval_index_;
+  /*! \brief The size of the arena of each device type. */
+  std::unordered_map<int, size_t> arena_bytes_;
   /*! \brief internal prototype token map */
   std::unordered_map<const ExprNode*, std::vector<StorageToken*> > prototype_;
 };
 
 Map<Expr, Array<IntegerArray> > GraphPlanMemory(const Function& func) {
+  if (transform::PassContext::Current()->plan_memory_offset) {
+    return OffsetStorageAllocator().Plan(func);
+  }
   return StorageAllocator().Plan(func);
 }
 
+/*!
+ * \brief Compare the memory planners on a function.
+ * \return The bytes of the intermediate tensors planned by the offset planner,
+ *  by the storage token planner, and the peak bytes alive at the same time.
+ */
+Array<Integer> GraphPlanMemoryStats(const Function& func) {
+  OffsetStorageAllocator offset_alloc;
+  offset_alloc.Plan(func);
+  StorageAllocator token_alloc;
+  token_alloc.Plan(func);
+  auto as_int = [](size_t v) { return Integer(IntImm(DataType::Int(64), v)); };
+  return {as_int(offset_alloc.ArenaBytes()),
+          as_int(token_alloc.IntermediateBytes(OffsetStorageAllocator::kAlignment)),
+          as_int(offset_alloc.PeakBytes())};
+}
+
 TVM_REGISTER_GLOBAL("relay.backend.GraphPlanMemory")
 .set_body_typed(GraphPlanMemory);
 
+TVM_REGISTER_GLOBAL("relay.backend.GraphPlanMemoryStats")
+.set_body_typed(GraphPlanMemoryStats);
+
 }  // namespace relay
 }  // namespace tvm
@@ -31,6 +31,7 @@
 
 #include <list>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "utils.h"
@@ -189,12 +190,38 @@ class GraphOpNode : public GraphNode {
   const std::string op_type_name_{"tvm_op"};
 };
 
+/*!
+ * \brief Collect the calls to primitive functions in the order the codegen
+ *  lowers them: each call before its arguments.
+ */
+class PrimitiveCallCollector : public ExprVisitor {
+ public:
+  void VisitExpr_(const CallNode* op) final {
+    const auto* callee = op->op.as<FunctionNode>();
+    if (callee == nullptr) {
+      ExprVisitor::VisitExpr_(op);
+      return;
+    }
+    if (callee->HasNonzeroAttr(attr::kPrimitive) &&
+        !callee->GetAttr<tir::StringImm>(attr::kCompiler).defined()) {
+      calls.push_back(GetRef<Call>(op));
+    }
+    for (const Expr& arg : op->args) {
+      VisitExpr(arg);
+    }
+  }
+
+  /*! \brief The calls. */
+  std::vector<Call> calls;
+};
+
 /*! \brief Code generator for graph runtime */
 class GraphRuntimeCodegen
     : public ::tvm::relay::ExprFunctor<std::vector<GraphNodeRef>(const Expr&)> {
  public:
-  GraphRuntimeCodegen(runtime::Module* mod, const TargetsMap& targets)
-      : mod_(mod) {
+  GraphRuntimeCodegen(runtime::Module* mod, const TargetsMap& targets,
+                      const Target& target_host = Target())
+      : mod_(mod), target_host_(target_host) {
     compile_engine_ = CompileEngine::Global();
     targets_ = targets;
   }
@@ -202,6 +229,7 @@ class GraphRuntimeCodegen
   LoweredOutput Codegen(relay::Function func) {
     auto pf = GetPackedFunc("relay.backend.GraphPlanMemory");
     storage_device_map_ = (*pf)(func);
+    LowerAhead(func);
     // First we convert all the parameters into input nodes.
     for (auto param : func->params) {
       auto node_ptr = GraphInputNode::make_node_ptr(param->name_hint(), GraphAttrs());
@@ -229,6 +257,9 @@ class GraphRuntimeCodegen
       ret.lowered_funcs.Set(kv.first, tmp);
     }
     ret.external_mods = compile_engine_->LowerExternalFunctions();
+    for (const auto& m : disk_cache_mods_) {
+      ret.external_mods.push_back(m);
+    }
     return ret;
   }
 
@@ -260,13 +291,21 @@ class GraphRuntimeCodegen
     size_t count = storage_device_map_.count(expr);
     CHECK_GT(count, 0) << "Expr is not existing in storage plan";
     auto storage_device_info = storage_device_map_[expr];
-    CHECK_EQ(storage_device_info.size(), 2);
+    CHECK(storage_device_info.size() == 2 || storage_device_info.size() == 3);
     // storage
     std::vector<int64_t> storage_info;
     for (auto& v : storage_device_info[0]) {
       storage_info.push_back(v->value);
     }
     node->attrs_["storage_id"] = std::move(storage_info);
+    // offset in the storage, only planned by the offset planner
+    if (storage_device_info.size() == 3) {
+      std::vector<int64_t> storage_offset;
+      for (auto& v : storage_device_info[2]) {
+        storage_offset.push_back(v->value);
+      }
+      node->attrs_["storage_offset"] = std::move(storage_offset);
+    }
     // type
     std::vector<int64_t> device_types;
     for (auto& v : storage_device_info[1]) {
@@ -402,6 +441,66 @@ class GraphRuntimeCodegen
     return AddNode(node, GetRef<Expr>(op));
   }
 
+  /*!
+   * \brief Get the target of a call to a primitive function.
+   * \param expr The call.
+   * \return The target of the device it runs on.
+   */
+  Target GetTarget(const Expr& expr) {
+    if (targets_.size() == 1) {
+       // homogeneous execution.
+      const auto& it = targets_.begin();
+      return (*it).second;
+    }
+    // heterogeneous execution.
+    CHECK_GE(storage_device_map_.count(expr), 0);
+    auto &device_type = storage_device_map_[expr][1];
+    auto call_dev_type = device_type[0]->value;
+    std::string call_dev_name;
+    if (call_dev_type == 0) {
+      call_dev_name = "llvm";
+    } else {
+      call_dev_name = runtime::DeviceName(call_dev_type);
+    }
+    if (targets_.count(call_dev_type) == 0) {
+      LOG(FATAL) << "No target is provided for device "
+                 << call_dev_name;
+    }
+    return targets_[call_dev_type];
+  }
+
+  /*!
+   * \brief Whether the functions of a target go through the disk cache. The
+   *  functions compiled on their own are built with their target, so only
+   *  when it is also the host target.
+   */
+  bool UseDiskCache(const Target& target) const {
+    return !target_host_.defined() || target_host_->str() == target->str();
+  }
+
+  /*!
+   * \brief Lower the primitive functions called by a function ahead of the
+   *  visit, on several threads.
+   * \param func The function.
+   */
+  void LowerAhead(const Function& func) {
+    PrimitiveCallCollector collector;
+    collector.VisitExpr(func->body);
+    Array<CCacheKey> keys;
+    Array<CCacheKey> disk_cache_keys;
+    for (const Call& call : collector.calls) {
+      Target target = GetTarget(call);
+      CCacheKey key = CCacheKeyNode::make(Downcast<Function>(call->op), target);
+      if (UseDiskCache(target)) {
+        disk_cache_keys.push_back(key);
+      } else {
+        keys.push_back(key);
+      }
+    }
+    compile_engine_->LowerParallel(keys, false);
+    compile_engine_->LowerParallel(disk_cache_keys, true);
+  }
+
   std::vector<GraphNodeRef> VisitExpr_(const CallNode* op) override {
     Expr expr = GetRef<Expr>(op);
     Function func;
@@ -432,33 +531,21 @@ class GraphRuntimeCodegen
       return GraphAddCallNode(op, ext_func->func_name, ext_func->func_name);
     }
 
-    CHECK_GE(storage_device_map_.count(expr), 0);
-    auto &device_type = storage_device_map_[expr][1];
-    auto call_dev_type = device_type[0]->value;
     // Normal Relay Function
-    if (targets_.size() == 1) {
-       // homogeneous execution.
-      const auto& it = targets_.begin();
-      target = (*it).second;
+    target = GetTarget(expr);
+    CCacheKey key = (*pf0)(func, target);
+    CachedFunc lowered_func;
+    if (UseDiskCache(target)) {
+      auto pf2 = GetPackedFunc("relay.backend._CompileEngineLowerWithDiskCache");
+      lowered_func = (*pf2)(compile_engine_, key);
     } else {
-      // heterogeneous execution.
-      std::string call_dev_name;
-      if (call_dev_type == 0) {
-        call_dev_name = "llvm";
-      } else {
-        call_dev_name = runtime::DeviceName(call_dev_type);
-      }
-      if (targets_.count(call_dev_type) == 0) {
-        LOG(FATAL) << "No target is provided for device "
-                   << call_dev_name;
-      }
-      target = targets_[call_dev_type];
+      lowered_func = (*pf1)(compile_engine_, key);
     }
-    CCacheKey key = (*pf0)(func, target);
-    CachedFunc lowered_func = (*pf1)(compile_engine_, key);
-    if (!lowered_funcs_.count(target->str())) {
-      lowered_funcs_[target->str()] = {};
+    if (lowered_func->module.defined() &&
+        disk_cache_mod_names_.insert(lowered_func->func_name).second) {
+      disk_cache_mods_.push_back(lowered_func->module);
     }
+    // no entry for a target left without functions, which has nothing to build
     for (auto f : lowered_func->funcs) {
       lowered_funcs_[target->str()].insert(f);
     }
@@ -530,6 +617,7 @@ class GraphRuntimeCodegen
     size_t num_entry = 0;
     ShapeVector shapes;
     std::vector<size_t> storage_ids;
+    std::vector<size_t> storage_offsets;
     std::vector<size_t> device_types;
     std::vector<std::string> dltypes;
     std::vector<size_t> node_row_ptr{0};
@@ -544,6 +632,10 @@ class GraphRuntimeCodegen
       shapes.insert(shapes.end(), shape_vec.begin(), shape_vec.end());
       dltypes.insert(dltypes.end(), dtype_vec.begin(), dtype_vec.end());
       storage_ids.insert(storage_ids.end(), storage_id.begin(), storage_id.end());
+      if (node->attrs_.count("storage_offset")) {
+        const auto& offset = dmlc::get<std::vector<int64_t>>(node->attrs_["storage_offset"]);
+        storage_offsets.insert(storage_offsets.end(), offset.begin(), offset.end());
+      }
       if (node->attrs_.count("device_index")) {
         const auto& dev_types = dmlc::get<std::vector<int64_t>>(node->attrs_["device_index"]);
         device_types.insert(device_types.end(), dev_types.begin(), dev_types.end());
@@ -559,6 +651,10 @@ class GraphRuntimeCodegen
     attrs["shape"].emplace_back(shapes);
     attrs["storage_id"].emplace_back(std::string("list_int"));
     attrs["storage_id"].emplace_back(storage_ids);
+    if (storage_offsets.size()) {
+      attrs["storage_offset"].emplace_back(std::string("list_int"));
+      attrs["storage_offset"].emplace_back(storage_offsets);
+    }
     if (device_types.size()) {
       attrs["device_index"].emplace_back(std::string("list_int"));
       attrs["device_index"].emplace_back(device_types);
@@ -608,6 +704,12 @@ class GraphRuntimeCodegen
   std::unordered_map<std::string, size_t> name_map_;
   /*! \brief compile engine */
   CompileEngine compile_engine_;
+  /*! \brief target host */
+  Target target_host_;
+  /*! \brief the modules of the functions compiled through the disk cache */
+  std::vector<runtime::Module> disk_cache_mods_;
+  /*! \brief the names of the functions of disk_cache_mods_ */
+  std::unordered_set<std::string> disk_cache_mod_names_;
 };
 
 class GraphRuntimeCodegenModule : public runtime::ModuleNode {
@@ -617,9 +719,9 @@ class GraphRuntimeCodegenModule : public runtime::ModuleNode {
                                  const ObjectPtr<Object>& sptr_to_self) {
      if (name == "init") {
        return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
-         CHECK_EQ(args.num_args, 2)
+         CHECK(args.num_args == 2 || args.num_args == 3)
              << "The expected of arguments are: "
-             << "runtime::Module mod and Map<int, Target> targets";
+             << "runtime::Module mod, Map<int, Target> targets and optionally Target target_host";
          void* mod = args[0];
          Map<Integer, tvm::Target> tmp = args[1];
          TargetsMap targets;
@@ -628,8 +730,12 @@ class GraphRuntimeCodegenModule : public runtime::ModuleNode {
            CHECK(dev_type);
            targets[dev_type->value] = it.second;
          }
+         Target target_host;
+         if (args.num_args == 3) {
+           target_host = args[2];
+         }
          codegen_ = std::make_shared<GraphRuntimeCodegen>(
-             reinterpret_cast<runtime::Module*>(mod), targets);
+             reinterpret_cast<runtime::Module*>(mod), targets, target_host);
        });
     } else if (name == "codegen") {
       return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
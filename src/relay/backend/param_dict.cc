@@ -22,9 +22,11 @@
  * \brief Implementation and registration of parameter dictionary
  * serializing/deserializing functions.
  */
+#include <tvm/runtime/device_api.h>
 #include <tvm/runtime/registry.h>
 #include <dmlc/memory_io.h>
 
+#include <cstring>
 #include <string>
 #include <vector>
 #include <utility>
@@ -71,6 +73,97 @@ TVM_REGISTER_GLOBAL("tvm.relay._save_param_dict")
     *rv = arr;
   });
 
+/*!
+ * \brief Write the header of an aligned parameter blob.
+ * \param fo The output stream.
+ * \param alignment The alignment of the payloads.
+ * \param names The names of the parameters.
+ * \param arrays The parameters.
+ * \param offsets The file offset of each payload.
+ */
+static void WriteAlignedParamHeader(dmlc::Stream* fo, uint64_t alignment,
+                                    const std::vector<std::string>& names,
+                                    const std::vector<DLTensor*>& arrays,
+                                    const std::vector<uint64_t>& offsets) {
+  uint64_t header = kTVMAlignedNDArrayListMagic;
+  fo->Write(header);
+  fo->Write(alignment);
+  fo->Write(names);
+  uint64_t sz = static_cast<uint64_t>(arrays.size());
+  fo->Write(sz);
+  // Always save data as CPU context, as SaveDLTensor does.
+  DLContext cpu_ctx;
+  cpu_ctx.device_type = kDLCPU;
+  cpu_ctx.device_id = 0;
+  for (size_t i = 0; i < arrays.size(); ++i) {
+    fo->Write(cpu_ctx);
+    fo->Write(arrays[i]->ndim);
+    fo->Write(arrays[i]->dtype);
+    fo->WriteArray(arrays[i]->shape, arrays[i]->ndim);
+    uint64_t nbytes = GetDataSize(*arrays[i]);
+    fo->Write(offsets[i]);
+    fo->Write(nbytes);
+  }
+}
+
+TVM_REGISTER_GLOBAL("tvm.relay._save_param_dict_aligned")
+.set_body([](TVMArgs args, TVMRetValue *rv) {
+    // `args` is in the form "alignment, key, value, key, value, ..."
+    CHECK_EQ(args.size() % 2, 1);
+    int64_t alignment = args[0];
+    CHECK(alignment > 0 && (alignment & (alignment - 1)) == 0 &&
+          alignment % kAllocAlignment == 0)
+        << "The alignment must be a power of two multiple of " << kAllocAlignment;
+    size_t num_params = args.size() / 2;
+    std::vector<std::string> names;
+    names.reserve(num_params);
+    std::vector<DLTensor*> arrays;
+    arrays.reserve(num_params);
+    for (size_t i = 1; i < num_params * 2 + 1; i += 2) {
+      names.emplace_back(args[i].operator std::string());
+      arrays.emplace_back(args[i + 1].operator DLTensor*());
+    }
+    uint64_t align = static_cast<uint64_t>(alignment);
+    auto align_up = [align](uint64_t x) {
+      return (x + align - 1) / align * align;
+    };
+    // The header size does not depend on the offset values, measure it first.
+    std::vector<uint64_t> offsets(num_params, 0);
+    std::string bytes;
+    {
+      dmlc::MemoryStringStream strm(&bytes);
+      WriteAlignedParamHeader(&strm, align, names, arrays, offsets);
+    }
+    uint64_t offset = bytes.size();
+    for (size_t i = 0; i < num_params; ++i) {
+      offset = align_up(offset);
+      offsets[i] = offset;
+      offset += GetDataSize(*arrays[i]);
+    }
+    bytes.clear();
+    bytes.reserve(offset);
+    {
+      dmlc::MemoryStringStream strm(&bytes);
+      WriteAlignedParamHeader(&strm, align, names, arrays, offsets);
+    }
+    for (size_t i = 0; i < num_params; ++i) {
+      const DLTensor* tensor = arrays[i];
+      size_t nbytes = GetDataSize(*tensor);
+      bytes.resize(offsets[i] + nbytes, '\0');
+      void* dst = &bytes[offsets[i]];
+      CHECK_EQ(TVMArrayCopyToBytes(const_cast<DLTensor*>(tensor), dst, nbytes), 0)
+          << TVMGetLastError();
+      if (!DMLC_IO_NO_ENDIAN_SWAP) {
+        int elem_bytes = (tensor->dtype.bits + 7) / 8;
+        dmlc::ByteSwap(dst, elem_bytes, nbytes / elem_bytes);
+      }
+    }
+    TVMByteArray arr;
+    arr.data = bytes.c_str();
+    arr.size = bytes.length();
+    *rv = arr;
+  });
+
 TVM_REGISTER_GLOBAL("tvm.relay._load_param_dict")
 .set_body([](TVMArgs args, TVMRetValue *rv) {
     std::string bytes = args[0];
@@ -80,7 +173,7 @@ TVM_REGISTER_GLOBAL("tvm.relay._load_param_dict")
     uint64_t header, reserved;
     CHECK(strm->Read(&header))
         << "Invalid parameters file format";
-    CHECK(header == kTVMNDArrayListMagic)
+    CHECK(header == kTVMNDArrayListMagic || header == kTVMAlignedNDArrayListMagic)
         << "Invalid parameters file format";
     CHECK(strm->Read(&reserved))
         << "Invalid parameters file format";
@@ -91,10 +184,44 @@ TVM_REGISTER_GLOBAL("tvm.relay._load_param_dict")
     size_t size = static_cast<size_t>(sz);
     CHECK(size == names.size())
         << "Invalid parameters file format";
+    std::vector<tvm::runtime::NDArray> arrays(size);
+    if (header == kTVMAlignedNDArrayListMagic) {
+      // The header lists the metadata of all the payloads, which follow it.
+      std::vector<std::pair<uint64_t, uint64_t> > extents(size);
+      for (size_t i = 0; i < size; ++i) {
+        DLContext ctx;
+        int ndim;
+        DLDataType dtype;
+        CHECK(strm->Read(&ctx) && strm->Read(&ndim) && strm->Read(&dtype))
+            << "Invalid parameters file format";
+        std::vector<int64_t> shape(ndim);
+        if (ndim != 0) {
+          CHECK(strm->ReadArray(&shape[0], ndim))
+              << "Invalid parameters file format";
+        }
+        CHECK(strm->Read(&extents[i].first) && strm->Read(&extents[i].second))
+            << "Invalid parameters file format";
+        arrays[i] = tvm::runtime::NDArray::Empty(shape, dtype, ctx);
+      }
+      for (size_t i = 0; i < size; ++i) {
+        uint64_t offset = extents[i].first, nbytes = extents[i].second;
+        CHECK(offset <= bytes.size() && nbytes <= bytes.size() - offset &&
+              nbytes == GetDataSize(*arrays[i].operator->()))
+            << "Invalid parameters file format";
+        std::memcpy(arrays[i]->data, bytes.data() + offset, nbytes);
+        if (!DMLC_IO_NO_ENDIAN_SWAP) {
+          int elem_bytes = (arrays[i]->dtype.bits + 7) / 8;
+          dmlc::ByteSwap(arrays[i]->data, elem_bytes, nbytes / elem_bytes);
+        }
+      }
+    } else {
+      for (size_t i = 0; i < size; ++i) {
+        arrays[i].Load(strm);
+      }
+    }
     tvm::Array<NamedNDArray> ret;
     for (size_t i = 0; i < size; ++i) {
-      tvm::runtime::NDArray temp;
-      temp.Load(strm);
+      tvm::runtime::NDArray temp = arrays[i];
       auto n = tvm::make_object<NamedNDArrayNode>();
       n->name = std::move(names[i]);
       n->array = temp;
@@ -33,10 +33,16 @@
 #include <tvm/tir/ir_pass.h>
 #include <tvm/te/operation.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <thread>
 #include <typeinfo>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace tvm {
 namespace relay {
@@ -122,6 +128,55 @@ BindParamsByName(relay::Function func,
   return ret;
 }
 
+/*!
+ * \brief Get the number of threads compiling functions in parallel during a
+ *  build, set by the TVM_BUILD_NUM_THREADS environment variable.
+ *
+ * \return The number of threads, by default the number of hardware threads.
+ */
+inline int GetNumBuildThreads() {
+  if (const char* val = getenv("TVM_BUILD_NUM_THREADS")) {
+    return std::max(atoi(val), 1);
+  }
+  return std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+}
+
+/*!
+ * \brief Run f(i) for every i in [0, n) on up to num_threads threads,
+ *  including the calling one.
+ *
+ *  An error raised by f stops the threads from taking more indices and is
+ *  rethrown on the calling thread.
+ *
+ * \param n The number of indices.
+ * \param num_threads The maximum number of threads.
+ * \param f The function.
+ */
+template <typename F>
+void ParallelFor(int n, int num_threads, F f) {
+  std::atomic<int> next{0};
+  std::atomic<bool> failed{false};
+  std::exception_ptr error;
+  auto worker = [&]() {
+    for (int i = next++; i < n && !failed.load(); i = next++) {
+      try {
+        f(i);
+      } catch (...) {
+        if (!failed.exchange(true)) error = std::current_exception();
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < std::min(n, num_threads); ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& t : threads) {
+    t.join();
+  }
+  if (error) std::rethrow_exception(error);
+}
+
 }  // namespace backend
 }  // namespace relay
 }  // namespace tvm
@@ -58,6 +58,12 @@ Pass ManifestAlloc(Target target_host) {
   return (*f)(target_host);
 }
 
+Pass MemoryPlan() {
+  auto f = tvm::runtime::Registry::Get("relay.transform.MemoryPlan");
+  CHECK(f != nullptr) << "could not load memory planning pass";
+  return (*f)();
+}
+
 }  // namespace transform
 
 namespace vm {
@@ -283,9 +289,12 @@ class VMFunctionCompiler : ExprFunctor<void(const Expr& expr)> {
       case Opcode::AllocStorage:
       case Opcode::Move:
       case Opcode::InvokeClosure:
+      case Opcode::AllocStorageTensor:
         last_register_ = instr.dst;
         break;
       case Opcode::InvokePacked:
+      case Opcode::InvokeShapeFunc:
+      case Opcode::InvokePackedConst:
       case Opcode::If:
       case Opcode::Ret:
       case Opcode::Goto:
@@ -431,7 +440,7 @@ class VMFunctionCompiler : ExprFunctor<void(const Expr& expr)> {
       argument_registers.push_back(reg->second);
     }
 
-    Emit(Instruction::InvokePacked(op_index,
+    Emit(Instruction::InvokeShapeFunc(op_index,
       argument_registers.size(),
       outputs.size(),
       argument_registers));
@@ -553,8 +562,11 @@ class VMFunctionCompiler : ExprFunctor<void(const Expr& expr)> {
             }
 
             // Add context field.
-            Emit(Instruction::AllocTensor(storage_register, raw_shape, dtype, NewRegister()));
+            Emit(Instruction::AllocTensor(storage_register, alloc_attrs->offset, raw_shape, dtype,
+                                          NewRegister()));
           } else {
+            CHECK_EQ(alloc_attrs->offset, 0)
+                << "tensors with a dynamic shape are allocated at the start of their storage";
             this->VisitExpr(args[1]);
             auto shape_register = last_register_;
             Emit(Instruction::AllocTensorReg(
@@ -854,6 +866,12 @@ void VMCompiler::Lower(IRModule mod,
     exec_->constants.push_back(data);
   }
 
+  // Fuse the recurring instruction sequences.
+  transform::PassContext pass_ctx = PassContext::Current();
+  if (pass_ctx->opt_level >= 1 && pass_ctx->fuse_bytecode) {
+    FuseBytecode(exec_.get());
+  }
+
   // update global function map
   for (auto gv : context_.global_map) {
     exec_->global_map.insert({gv.first->name_hint, gv.second});
@@ -938,6 +956,9 @@ IRModule VMCompiler::OptimizeModule(const IRModule& mod, const TargetsMap& targe
   pass_seqs.push_back(transform::FuseOps());
   // Manifest the allocations needed for the shape functions.
   pass_seqs.push_back(transform::ManifestAlloc(this->target_host_));
+  // Coalesce the storages of the tensors with a static shape, the others
+  // keep being served by the allocator at runtime.
+  pass_seqs.push_back(transform::MemoryPlan());
 
   transform::Sequential seq(pass_seqs);
   transform::PassContext pass_ctx = PassContext::Current();
@@ -80,6 +80,14 @@ struct VMCompilerContext {
 };
 
 
+/*!
+ * \brief Fuse recurring instruction sequences of the functions of an executable
+ *  into superinstructions.
+ *
+ * \param exec The executable, with its functions and constants populated.
+ */
+void FuseBytecode(Executable* exec);
+
 class VMCompiler : public runtime::ModuleNode {
  public:
   virtual ~VMCompiler() {}
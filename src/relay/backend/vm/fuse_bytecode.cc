@@ -0,0 +1,271 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file tvm/relay/backend/vm/fuse_bytecode.cc
+ * \brief Fuse recurring instruction sequences of the compiled VM functions
+ * into superinstructions.
+ */
+
+#include <tvm/runtime/ndarray.h>
+#include <tvm/runtime/vm.h>
+#include <tvm/support/logging.h>
+
+#include <vector>
+
+#include "compiler.h"
+
+namespace tvm {
+namespace relay {
+namespace vm {
+
+/*! \brief Call f on each register read by an instruction. */
+template <typename F>
+static void ForEachRegisterRead(const Instruction& instr, F f) {
+  switch (instr.op) {
+    case Opcode::Move:
+      f(instr.from);
+      break;
+    case Opcode::Ret:
+      f(instr.result);
+      break;
+    case Opcode::Invoke:
+      for (Index i = 0; i < instr.num_args; ++i) f(instr.invoke_args_registers[i]);
+      break;
+    case Opcode::InvokeClosure:
+      f(instr.closure);
+      for (Index i = 0; i < instr.num_closure_args; ++i) f(instr.closure_args[i]);
+      break;
+    case Opcode::InvokePacked:
+    case Opcode::InvokeShapeFunc:
+    case Opcode::InvokePackedConst:
+      for (Index i = 0; i < instr.arity; ++i) {
+        if (instr.packed_args[i] >= 0) f(instr.packed_args[i]);
+      }
+      break;
+    case Opcode::AllocTensor:
+      f(instr.alloc_tensor.storage);
+      break;
+    case Opcode::AllocTensorReg:
+      f(instr.alloc_tensor_reg.storage);
+      f(instr.alloc_tensor_reg.shape_register);
+      break;
+    case Opcode::AllocADT:
+      for (Index i = 0; i < instr.num_fields; ++i) f(instr.datatype_fields[i]);
+      break;
+    case Opcode::AllocClosure:
+      for (Index i = 0; i < instr.num_freevar; ++i) f(instr.free_vars[i]);
+      break;
+    case Opcode::GetField:
+      f(instr.object);
+      break;
+    case Opcode::GetTag:
+      f(instr.get_tag.object);
+      break;
+    case Opcode::If:
+      f(instr.if_op.test);
+      f(instr.if_op.target);
+      break;
+    case Opcode::AllocStorage:
+      f(instr.alloc_storage.allocation_size);
+      f(instr.alloc_storage.alignment);
+      break;
+    case Opcode::LoadConst:
+    case Opcode::LoadConsti:
+    case Opcode::Goto:
+    case Opcode::Fatal:
+    case Opcode::AllocStorageTensor:
+      break;
+  }
+}
+
+/*! \brief Whether an instruction writes its destination register. */
+static bool WritesRegister(const Instruction& instr) {
+  switch (instr.op) {
+    case Opcode::AllocADT:
+    case Opcode::AllocTensor:
+    case Opcode::AllocTensorReg:
+    case Opcode::GetField:
+    case Opcode::GetTag:
+    case Opcode::LoadConst:
+    case Opcode::LoadConsti:
+    case Opcode::Invoke:
+    case Opcode::AllocClosure:
+    case Opcode::AllocStorage:
+    case Opcode::Move:
+    case Opcode::InvokeClosure:
+    case Opcode::AllocStorageTensor:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/*!
+ * \brief Read a constant integer scalar on the CPU.
+ * \param obj The constant.
+ * \param value The value of the constant.
+ * \return Whether the constant is an integer scalar on the CPU.
+ */
+static bool GetConstantInt(const ObjectRef& obj, int64_t* value) {
+  const auto* tensor = obj.as<NDArray::Container>();
+  if (tensor == nullptr) return false;
+  const DLTensor& t = tensor->dl_tensor;
+  if (t.ctx.device_type != kDLCPU || t.dtype.code != kDLInt || t.dtype.lanes != 1 ||
+      GetDataSize(t) * 8 != t.dtype.bits) {
+    return false;
+  }
+  const char* data = static_cast<const char*>(t.data) + t.byte_offset;
+  switch (t.dtype.bits) {
+    case 8: *value = *reinterpret_cast<const int8_t*>(data); return true;
+    case 16: *value = *reinterpret_cast<const int16_t*>(data); return true;
+    case 32: *value = *reinterpret_cast<const int32_t*>(data); return true;
+    case 64: *value = *reinterpret_cast<const int64_t*>(data); return true;
+    default: return false;
+  }
+}
+
+/*!
+ * \brief Fuse the instructions of a function.
+ *
+ * A register written once by a LoadConst and read by a single instruction is
+ * replaced by the constant in the instruction reading it, and its LoadConst
+ * dropped:
+ *  - The constant inputs of an InvokePacked make it an InvokePackedConst.
+ *  - An AllocStorage of a constant size and alignment followed by the only
+ *    AllocTensor of a constant shape from its storage become an
+ *    AllocStorageTensor.
+ * The jumps are then retargeted to the remaining instructions.
+ */
+static void FuseFunction(const std::vector<ObjectRef>& constants, VMFunction* func) {
+  std::vector<Instruction>& code = func->instructions;
+  size_t num_instrs = code.size();
+  Index num_params = func->params.size();
+  std::vector<int> num_reads(func->register_file_size, 0);
+  std::vector<int> num_writes(func->register_file_size, 0);
+  std::vector<Index> def(func->register_file_size, -1);
+  std::vector<bool> is_target(num_instrs + 1, false);
+  for (size_t pc = 0; pc < num_instrs; ++pc) {
+    const Instruction& instr = code[pc];
+    ForEachRegisterRead(instr, [&num_reads](RegName r) { ++num_reads[r]; });
+    if (WritesRegister(instr)) {
+      ++num_writes[instr.dst];
+      def[instr.dst] = pc;
+    }
+    if (instr.op == Opcode::If) {
+      is_target[pc + instr.if_op.true_offset] = true;
+      is_target[pc + instr.if_op.false_offset] = true;
+    } else if (instr.op == Opcode::Goto) {
+      is_target[pc + instr.pc_offset] = true;
+    }
+  }
+
+  std::vector<bool> removed(num_instrs, false);
+  // The LoadConst defining a register read `reads` times in total, or -1.
+  auto single_use_const = [&](RegName r, int reads) -> Index {
+    if (r < num_params || num_writes[r] != 1 || num_reads[r] != reads) return -1;
+    Index pc = def[r];
+    if (code[pc].op != Opcode::LoadConst || removed[pc]) return -1;
+    return pc;
+  };
+
+  for (size_t pc = 0; pc < num_instrs; ++pc) {
+    const Instruction& instr = code[pc];
+    if (instr.op == Opcode::InvokePacked) {
+      std::vector<RegName> args(instr.packed_args, instr.packed_args + instr.arity);
+      bool fused = false;
+      for (Index i = 0; i < instr.arity - instr.output_size; ++i) {
+        RegName r = instr.packed_args[i];
+        int reads = 0;
+        for (Index j = 0; j < instr.arity; ++j) reads += instr.packed_args[j] == r;
+        Index const_pc = single_use_const(r, reads);
+        if (const_pc < 0) continue;
+        for (Index j = 0; j < instr.arity; ++j) {
+          if (instr.packed_args[j] == r) args[j] = -1 - code[const_pc].const_index;
+        }
+        removed[const_pc] = true;
+        fused = true;
+      }
+      if (fused) {
+        code[pc] = Instruction::InvokePackedConst(instr.packed_index, instr.arity,
+                                                  instr.output_size, args);
+      }
+    } else if (instr.op == Opcode::AllocStorage && pc + 1 < num_instrs && !is_target[pc + 1]) {
+      const Instruction& next = code[pc + 1];
+      RegName storage = instr.dst;
+      if (next.op != Opcode::AllocTensor || next.alloc_tensor.storage != storage ||
+          next.alloc_tensor.offset != 0 || storage < num_params ||
+          num_writes[storage] != 1 || num_reads[storage] != 1) {
+        continue;
+      }
+      const auto& alloc = instr.alloc_storage;
+      Index size_pc = single_use_const(alloc.allocation_size, 1);
+      Index alignment_pc = single_use_const(alloc.alignment, 1);
+      int64_t size, alignment;
+      if (size_pc < 0 || alignment_pc < 0 ||
+          !GetConstantInt(constants[code[size_pc].const_index], &size) ||
+          !GetConstantInt(constants[code[alignment_pc].const_index], &alignment)) {
+        continue;
+      }
+      std::vector<int64_t> shape(next.alloc_tensor.shape,
+                                 next.alloc_tensor.shape + next.alloc_tensor.ndim);
+      code[pc] = Instruction::AllocStorageTensor(size, alignment, alloc.dtype_hint, shape,
+                                                 next.alloc_tensor.dtype, next.dst);
+      removed[pc + 1] = true;
+      removed[size_pc] = true;
+      removed[alignment_pc] = true;
+      ++pc;
+    }
+  }
+
+  // A jump to a removed instruction goes to the next remaining one, as the
+  // removed instructions only wrote registers nothing else reads.
+  std::vector<Index> new_pc(num_instrs + 1);
+  Index next_pc = 0;
+  for (size_t pc = 0; pc < num_instrs; ++pc) {
+    new_pc[pc] = next_pc;
+    if (!removed[pc]) ++next_pc;
+  }
+  new_pc[num_instrs] = next_pc;
+  if (next_pc == static_cast<Index>(num_instrs)) return;
+  std::vector<Instruction> fused_code;
+  fused_code.reserve(next_pc);
+  for (size_t pc = 0; pc < num_instrs; ++pc) {
+    if (removed[pc]) continue;
+    Instruction instr = code[pc];
+    if (instr.op == Opcode::If) {
+      instr.if_op.true_offset = new_pc[pc + instr.if_op.true_offset] - new_pc[pc];
+      instr.if_op.false_offset = new_pc[pc + instr.if_op.false_offset] - new_pc[pc];
+    } else if (instr.op == Opcode::Goto) {
+      instr.pc_offset = new_pc[pc + instr.pc_offset] - new_pc[pc];
+    }
+    fused_code.push_back(instr);
+  }
+  code = std::move(fused_code);
+}
+
+void FuseBytecode(Executable* exec) {
+  for (VMFunction& func : exec->functions) {
+    FuseFunction(exec->constants, &func);
+  }
+}
+
+}  // namespace vm
+}  // namespace relay
+}  // namespace tvm
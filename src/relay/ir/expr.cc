@@ -23,6 +23,8 @@
  */
 #include <tvm/ir/module.h>
 #include <tvm/relay/expr.h>
+#include <utility>
+#include <vector>
 
 namespace tvm {
 namespace relay {
@@ -30,6 +32,44 @@ namespace relay {
 using tvm::ReprPrinter;
 using namespace tvm::runtime;
 
+namespace {
+/*! \brief The queue of the releaser of this thread, or nullptr when there is none. */
+thread_local std::vector<ObjectRef>* release_queue = nullptr;
+
+/*!
+ * \brief Release the operands of a node being destroyed without recursing
+ *  into their destructors, so that a deep graph is freed in a constant stack
+ *  depth.
+ *
+ *  The operands freed last are queued, and the outermost releaser of the
+ *  thread frees them in a loop; the nodes destroyed there queue their own
+ *  operands to it instead of freeing them.
+ */
+class Releaser {
+ public:
+  Releaser() {
+    if (release_queue == nullptr) release_queue = &queue_;
+  }
+
+  ~Releaser() {
+    if (release_queue != &queue_) return;
+    while (!queue_.empty()) {
+      ObjectRef ref = std::move(queue_.back());
+      queue_.pop_back();
+    }
+    release_queue = nullptr;
+  }
+
+  /*! \brief Release a field, queued when this is its last reference. */
+  void Release(ObjectRef* ref) {
+    if (ref->unique()) release_queue->push_back(std::move(*ref));
+  }
+
+ private:
+  std::vector<ObjectRef> queue_;
+};
+}  // namespace
+
 Constant ConstantNode::make(runtime::NDArray data) {
   ObjectPtr<ConstantNode> n = make_object<ConstantNode>();
   n->data = std::move(data);
@@ -69,6 +109,11 @@ Tuple TupleNode::make(tvm::Array<relay::Expr> fields) {
   return Tuple(n);
 }
 
+TupleNode::~TupleNode() {
+  Releaser releaser;
+  releaser.Release(&fields);
+}
+
 TVM_REGISTER_NODE_TYPE(TupleNode);
 
 TVM_REGISTER_GLOBAL("relay.ir.Tuple")
@@ -121,6 +166,12 @@ Call CallNode::make(Expr op, Array<Expr> args, Attrs attrs,
   return Call(n);
 }
 
+CallNode::~CallNode() {
+  Releaser releaser;
+  releaser.Release(&op);
+  releaser.Release(&args);
+}
+
 TVM_REGISTER_NODE_TYPE(CallNode);
 
 TVM_REGISTER_GLOBAL("relay.ir.Call")
@@ -141,6 +192,12 @@ Let LetNode::make(Var var, Expr value, Expr body) {
   return Let(n);
 }
 
+LetNode::~LetNode() {
+  Releaser releaser;
+  releaser.Release(&value);
+  releaser.Release(&body);
+}
+
 TVM_REGISTER_NODE_TYPE(LetNode);
 
 TVM_REGISTER_GLOBAL("relay.ir.Let")
@@ -180,6 +237,11 @@ TupleGetItem TupleGetItemNode::make(Expr tuple, int index) {
   return TupleGetItem(n);
 }
 
+TupleGetItemNode::~TupleGetItemNode() {
+  Releaser releaser;
+  releaser.Release(&tuple);
+}
+
 TVM_REGISTER_NODE_TYPE(TupleGetItemNode);
 
 TVM_REGISTER_GLOBAL("relay.ir.TupleGetItem")
@@ -326,6 +326,70 @@ void ExprVisitor::VisitPattern(const Pattern& p) { return; }
 
 void ExprVisitor::VisitType(const Type& t) { return; }
 
+void MixedModeVisitor::VisitExpr(const Expr& expr) {
+  if (size_t* count = dense_visit_counter_.Find(expr.get())) {
+    ++*count;
+    return;
+  }
+  ExpandDataflow(
+      expr,
+      [this](const Expr& e) {
+        return dense_visit_counter_.Find(e.get()) != nullptr;
+      },
+      [this](const Expr& e) {
+        ExprFunctor::VisitExpr(e);
+        // The references from the VisitExpr_ of the users of e are counted then.
+        dense_visit_counter_.Insert(e, 0);
+      });
+  ++*dense_visit_counter_.Find(expr.get());
+}
+
+Expr MixedModeMutator::VisitExpr(const Expr& expr) {
+  if (Expr* ret = dense_memo_.Find(expr.get())) {
+    return *ret;
+  }
+  ExpandDataflow(
+      expr,
+      [this](const Expr& e) {
+        return dense_memo_.Find(e.get()) != nullptr;
+      },
+      [this](const Expr& e) {
+        Expr new_expr = ExprFunctor::VisitExpr(e);
+        dense_memo_.Insert(e, new_expr);
+      });
+  return *dense_memo_.Find(expr.get());
+}
+
+void MixedModeVisitor::VisitExpr_(const LetNode* op) {
+  ExpandANormalForm(
+      op,
+      [this](const LetNode* let) {
+        this->VisitExpr(let->value);
+        this->VisitExpr(let->var);
+      },
+      [this, op](const LetNode* let) {
+        // The body is a memo hit when it is a let of the chain.
+        this->VisitExpr(let->body);
+        if (let != op) dense_visit_counter_.Insert(GetRef<Expr>(let), 0);
+      });
+}
+
+Expr MixedModeMutator::VisitExpr_(const LetNode* op) {
+  Expr ret;
+  ExpandANormalForm(
+      op,
+      [this](const LetNode* let) {
+        this->Mutate(let->var);
+        this->Mutate(let->value);
+      },
+      [this, op, &ret](const LetNode* let) {
+        // The body is a memo hit when it is a let of the chain.
+        ret = ExprMutator::VisitExpr_(let);
+        if (let != op) dense_memo_.Insert(GetRef<Expr>(let), ret);
+      });
+  return ret;
+}
+
 // visitor to implement apply
 class ExprApplyVisit : public ExprVisitor {
  public:
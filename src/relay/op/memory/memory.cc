@@ -89,9 +89,11 @@ RELAY_REGISTER_OP("memory.alloc_storage")
 
 TVM_REGISTER_GLOBAL("relay.op.memory._make.alloc_tensor")
     .set_body_typed(
-        [](Expr storage, tvm::relay::Expr shape, DataType dtype, Array<IndexExpr> assert_shape) {
+        [](Expr storage, tvm::relay::Expr shape, DataType dtype, Array<IndexExpr> assert_shape,
+           int64_t offset) {
           auto attrs = make_object<AllocTensorAttrs>();
           attrs->dtype = dtype;
+          attrs->offset = offset;
           if (assert_shape.defined()) {
             attrs->assert_shape = assert_shape;
           } else {
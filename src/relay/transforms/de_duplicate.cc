@@ -32,7 +32,7 @@ namespace relay {
 
 Expr DeDup(const Expr& e) {
   class DeDupMutator : public TypeMutator,
-                       public ExprMutator,
+                       public MixedModeMutator,
                        public PatternMutator {
    public:
     TypeVar Fresh(const TypeVar& tv) {
@@ -43,14 +43,14 @@ Expr DeDup(const Expr& e) {
 
     Var Fresh(const Var& v) {
       CHECK_EQ(rename_.count(v), 0);
-      CHECK_EQ(memo_.count(v), 0) << v.as<VarNode>();
+      CHECK(dense_memo_.Find(v.get()) == nullptr) << v.as<VarNode>();
       Var ret = VarNode::make(v->name_hint(), VisitType(v->type_annotation));
       rename_[v] = ret;
       return ret;
     }
 
     Expr VisitExpr(const Expr& e) final {
-      auto ret = ExprMutator::VisitExpr(e);
+      auto ret = MixedModeMutator::VisitExpr(e);
       ret->checked_type_ = e->checked_type_;
       return ret;
     }
@@ -61,8 +61,19 @@ Expr DeDup(const Expr& e) {
     }
 
     Expr VisitExpr_(const LetNode* op) final {
-      Var v = Fresh(op->var);
-      return LetNode::make(v, VisitExpr(op->value), VisitExpr(op->body));
+      Expr ret;
+      ExpandANormalForm(
+          op,
+          [this](const LetNode* let) {
+            Fresh(let->var);
+            VisitExpr(let->value);
+          },
+          [this, op, &ret](const LetNode* let) {
+            ret = LetNode::make(rename_.at(let->var), VisitExpr(let->value),
+                                VisitExpr(let->body));
+            if (let != op) dense_memo_.Insert(GetRef<Expr>(let), ret);
+          });
+      return ret;
     }
 
     Type VisitType(const Type& t) final {
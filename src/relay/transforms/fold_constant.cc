@@ -37,7 +37,7 @@ namespace relay {
 
 using FInterpreter = runtime::TypedPackedFunc<ObjectRef(Expr)>;
 
-class ConstantChecker : private ExprVisitor {
+class ConstantChecker : private MixedModeVisitor {
  public:
   // Check whether an expression is constant. The results are memoized.
   bool Check(const Expr& expr) {
@@ -78,7 +78,7 @@ TVM_REGISTER_GLOBAL("relay.analysis.check_constant")
 
 // TODO(tvm-team) consider combine dead-code with constant folder.
 // or make a more powerful partial evaluator.
-class ConstantFolder : public ExprMutator {
+class ConstantFolder : public MixedModeMutator {
  public:
   explicit ConstantFolder(FInterpreter executor, IRModule module)
       : executor_(executor),
@@ -91,21 +91,36 @@ class ConstantFolder : public ExprMutator {
         cast_op_(Op::Get("cast")) {}
 
   Expr VisitExpr_(const LetNode* op) final {
-    Expr value = this->Mutate(op->value);
-    if (value.as<ConstantNode>()) {
-      memo_[op->var] = value;
-      return this->Mutate(op->body);
-    } else {
-      Var var = Downcast<Var>(this->Mutate(op->var));
-      Expr body = this->Mutate(op->body);
-      if (var.same_as(op->var) &&
-          value.same_as(op->value) &&
-          body.same_as(op->body)) {
-        return GetRef<Expr>(op);
-      } else {
-        return LetNode::make(var, value, body);
-      }
-    }
+    Expr ret;
+    ExpandANormalForm(
+        op,
+        [this](const LetNode* let) {
+          Expr value = this->Mutate(let->value);
+          if (value.as<ConstantNode>()) {
+            dense_memo_.Insert(let->var, value);
+          } else {
+            this->Mutate(let->var);
+          }
+        },
+        [this, op, &ret](const LetNode* let) {
+          // The value, the var and a body of the chain are memo hits.
+          Expr value = this->Mutate(let->value);
+          if (value.as<ConstantNode>()) {
+            ret = this->Mutate(let->body);
+          } else {
+            Var var = Downcast<Var>(this->Mutate(let->var));
+            Expr body = this->Mutate(let->body);
+            if (var.same_as(let->var) &&
+                value.same_as(let->value) &&
+                body.same_as(let->body)) {
+              ret = GetRef<Expr>(let);
+            } else {
+              ret = LetNode::make(var, value, body);
+            }
+          }
+          if (let != op) dense_memo_.Insert(GetRef<Expr>(let), ret);
+        });
+    return ret;
   }
 
   Expr VisitExpr_(const CallNode* call) final {
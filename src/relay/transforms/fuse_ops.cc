@@ -145,7 +145,7 @@ class IndexedForwardGraph {
 };
 
 // Creator of post dominator tree of the dataflow
-class IndexedForwardGraph::Creator : private ExprVisitor {
+class IndexedForwardGraph::Creator : private MixedModeVisitor {
  public:
   explicit Creator(support::Arena* arena)
       : arena_(arena) {}
@@ -163,19 +163,22 @@ class IndexedForwardGraph::Creator : private ExprVisitor {
   IndexedForwardGraph graph_;
   // attribute equal comparator
   AttrsEqual attr_equal_;
+  // Get the node of an expression, creating it when missing. The dataflow
+  // operands are visited before their users, which update their nodes later.
+  IndexedForwardGraph::Node* GetNode(const tvm::Object* key) {
+    auto it = graph_.node_map.find(key);
+    if (it != graph_.node_map.end()) {
+      return it->second;
+    }
+    IndexedForwardGraph::Node* node = arena_->make<IndexedForwardGraph::Node>();
+    graph_.node_map[key] = node;
+    return node;
+  }
   // Update the message stored at the node.
   void Update(const Expr& node,
               IndexedForwardGraph::Node* parent,
               OpPatternKind pattern) {
-    const tvm::Object* key = node.get();
-    IndexedForwardGraph::Node* current;
-    auto it = graph_.node_map.find(key);
-    if (it != graph_.node_map.end()) {
-      current = it->second;
-    } else {
-      current = arena_->make<IndexedForwardGraph::Node>();
-      graph_.node_map[key] = current;
-    }
+    IndexedForwardGraph::Node* current = GetNode(node.get());
     if (parent != nullptr) {
       auto* link = arena_->make<LinkNode<IndexedForwardGraph::Edge> >();
       link->value.node = parent;
@@ -187,10 +190,7 @@ class IndexedForwardGraph::Creator : private ExprVisitor {
   }
 
   void AddNode(const tvm::Object* key) {
-    auto it = graph_.node_map.find(key);
-    CHECK(it != graph_.node_map.end())
-        << "Cannot find node " << GetRef<ObjectRef>(key);
-    IndexedForwardGraph::Node* node = it->second;
+    IndexedForwardGraph::Node* node = GetNode(key);
     CHECK(node->ref == nullptr);
     node->ref = key;
     node->index = graph_.post_dfs_order.size();
@@ -227,8 +227,7 @@ class IndexedForwardGraph::Creator : private ExprVisitor {
   }
 
   void VisitExpr_(const CallNode* call) final {
-    CHECK(graph_.node_map.count(call));
-    Node* node = graph_.node_map.at(call);
+    Node* node = GetNode(call);
     static auto fpattern =
         Op::GetAttr<TOpPattern>("TOpPattern");
     // Now we set the pattern of this call.
@@ -269,8 +268,7 @@ class IndexedForwardGraph::Creator : private ExprVisitor {
   }
 
   void VisitExpr_(const TupleNode* op) final {
-    CHECK(graph_.node_map.count(op));
-    Node* tuple_node = graph_.node_map.at(op);
+    Node* tuple_node = GetNode(op);
     tuple_node->pattern = kTuple;
     for (const Expr& field : op->fields) {
       if (field->checked_type().as<TensorTypeNode>()) {
@@ -301,8 +299,7 @@ class IndexedForwardGraph::Creator : private ExprVisitor {
     if (has_non_tensor) {
       this->Update(op->tuple, nullptr, kOpaque);
     } else {
-      CHECK(graph_.node_map.count(op));
-      Node* node = graph_.node_map.at(op);
+      Node* node = GetNode(op);
       node->pattern = kInjective;
       this->Update(op->tuple, node, kInjective);
     }
@@ -315,11 +312,24 @@ class IndexedForwardGraph::Creator : private ExprVisitor {
   }
 
   void VisitExpr_(const LetNode* op) final {
-    // do not fuse through let.
-    this->Update(op->var, nullptr, kOpaque);
-    this->Update(op->value, nullptr, kOpaque);
-    this->Update(op->body, nullptr, kOpaque);
-    ExprVisitor::VisitExpr_(op);
+    ExpandANormalForm(
+        op,
+        [this](const LetNode* let) {
+          // do not fuse through let.
+          this->Update(let->var, nullptr, kOpaque);
+          this->Update(let->value, nullptr, kOpaque);
+          this->Update(let->body, nullptr, kOpaque);
+          this->VisitExpr(let->value);
+          this->VisitExpr(let->var);
+        },
+        [this, op](const LetNode* let) {
+          if (let->body.as<LetNode>() == nullptr) this->VisitExpr(let->body);
+          // The lets of the body are added before the let, in post DFS order.
+          if (let != op) {
+            this->AddNode(let);
+            dense_visit_counter_.Insert(GetRef<Expr>(let), 1);
+          }
+        });
     this->AddNode(op);
   }
 
@@ -802,7 +812,7 @@ GraphPartitioner::Partition(const IndexedForwardGraph& graph) {
   return std::move(groups_);
 }
 
-class FuseMutator : private ExprMutator {
+class FuseMutator : private MixedModeMutator {
  public:
   // Run the transform
   Expr Transform(const Expr& body, int fuse_opt_level) {
@@ -873,7 +883,7 @@ class FuseMutator : private ExprMutator {
       // then we must have a group assignment for it already.
       CHECK(gmap_.count(call));
       if (call->op == stop_fusion_op) {
-        return ExprMutator::VisitExpr(call->args[0]);
+        return this->Mutate(call->args[0]);
       }
       auto* ret_group = gmap_.at(call)->FindRoot();
       Array<Expr> new_args = GetNewArguments(call->args, ret_group);
@@ -932,9 +942,29 @@ class FuseMutator : private ExprMutator {
     } visitor;
     visitor(body);
     const GroupInfo& ginfo = ginfo_[group];
-    auto func = Function(ginfo.params, body, ret_type, {});
+    // The parameters are allocated as the operands are mutated, in post order.
+    // Order them by their first use in the body instead, as a depth first
+    // mutation would.
+    Array<Var> params;
+    Array<Expr> arguments;
+    std::vector<bool> placed(ginfo.params.size(), false);
+    auto fplace = [&](size_t i) {
+      if (placed[i]) return;
+      placed[i] = true;
+      params.push_back(ginfo.params[i]);
+      arguments.push_back(ginfo.arguments[i]);
+    };
+    for (const Var& var : FreeVars(body)) {
+      for (size_t i = 0; i < ginfo.params.size(); ++i) {
+        if (var.same_as(ginfo.params[i])) fplace(i);
+      }
+    }
+    for (size_t i = 0; i < ginfo.params.size(); ++i) {
+      fplace(i);
+    }
+    auto func = Function(params, body, ret_type, {});
     func = WithAttr(std::move(func), attr::kPrimitive, tvm::Integer(visitor.has_call));
-    return CallNode::make(func, ginfo.arguments, Attrs());
+    return CallNode::make(func, arguments, Attrs());
   }
 
   Array<Expr> GetNewArguments(const tvm::Array<Expr>& args,
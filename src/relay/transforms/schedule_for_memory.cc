@@ -0,0 +1,363 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file schedule_for_memory.cc
+ * \brief Reorder the calls of a function to reduce its peak memory.
+ *
+ *  The graph runtime runs the calls in the order the codegen visits them and
+ *  the memory is planned over that order. The pass tries two orders, a list
+ *  schedule picking at each step the ready call that grows the live memory the
+ *  least, and a depth first order visiting first the arguments that need the
+ *  most memory to compute, as in Sethi-Ullman numbering. The one with the
+ *  lowest peak is fixed with a chain of lets when it is lower than the
+ *  original peak.
+ */
+#include <tvm/relay/analysis.h>
+#include <tvm/relay/expr_functor.h>
+#include <tvm/relay/transform.h>
+#include <tvm/tir/op.h>
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "let_list.h"
+
+namespace tvm {
+namespace relay {
+
+class MemoryScheduler : private ExprVisitor {
+ public:
+  Function Schedule(const Function& func) {
+    this->VisitExpr(func->body);
+    if (!supported_ || calls_.size() < 2) return func;
+    size_t num_calls = calls_.size();
+    preds_.resize(num_calls);
+    succs_.resize(num_calls);
+    bytes_.resize(num_calls);
+    pinned_.resize(num_calls, false);
+    for (size_t i = 0; i < num_calls; ++i) {
+      for (Expr arg : calls_[i]->args) {
+        Producers(arg, &preds_[i]);
+      }
+      std::sort(preds_[i].begin(), preds_[i].end());
+      preds_[i].erase(std::unique(preds_[i].begin(), preds_[i].end()), preds_[i].end());
+      for (size_t p : preds_[i]) {
+        succs_[p].push_back(i);
+      }
+      bytes_[i] = Bytes(calls_[i]->checked_type());
+      if (!supported_) return func;
+    }
+    // the outputs of the function are never freed.
+    Producers(func->body, &outputs_);
+    for (size_t i : outputs_) {
+      pinned_[i] = true;
+    }
+
+    std::vector<size_t> original(num_calls);
+    for (size_t i = 0; i < num_calls; ++i) {
+      original[i] = i;
+    }
+    size_t best_peak = Peak(original);
+    std::vector<size_t> best;
+    for (const std::vector<size_t>& order : {ListSchedule(), DepthFirstSchedule()}) {
+      if (order.size() != num_calls) continue;
+      size_t peak = Peak(order);
+      if (peak < best_peak) {
+        best_peak = peak;
+        best = order;
+      }
+    }
+    if (best.empty()) return func;
+    return Rebuild(func, best);
+  }
+
+ private:
+  void VisitExpr_(const CallNode* op) final {
+    for (Expr arg : op->args) {
+      this->VisitExpr(arg);
+    }
+    index_[op] = calls_.size();
+    calls_.push_back(op);
+  }
+
+  void VisitExpr_(const FunctionNode* op) final {
+    // do not recursive into sub function.
+  }
+
+  void VisitExpr_(const LetNode* op) final {
+    supported_ = false;
+  }
+
+  void VisitExpr_(const IfNode* op) final {
+    supported_ = false;
+  }
+
+  /*!
+   * \brief Collect the calls producing the value of an expression.
+   * \param expr The expression.
+   * \param producers The indices of the calls.
+   */
+  void Producers(const Expr& expr, std::vector<size_t>* producers) {
+    if (const auto* call = expr.as<CallNode>()) {
+      producers->push_back(index_.at(call));
+    } else if (const auto* tuple = expr.as<TupleNode>()) {
+      for (Expr field : tuple->fields) {
+        Producers(field, producers);
+      }
+    } else if (const auto* get = expr.as<TupleGetItemNode>()) {
+      Producers(get->tuple, producers);
+    }
+  }
+
+  /*!
+   * \brief Get the number of bytes of a value.
+   * \param type The type of the value.
+   * \return The bytes, zero when the type is not supported.
+   */
+  size_t Bytes(const Type& type) {
+    if (const auto* tuple_type = type.as<TupleTypeNode>()) {
+      size_t bytes = 0;
+      for (Type field : tuple_type->fields) {
+        bytes += Bytes(field);
+      }
+      return bytes;
+    }
+    const auto* ttype = type.as<TensorTypeNode>();
+    if (ttype == nullptr) {
+      supported_ = false;
+      return 0;
+    }
+    size_t size = (ttype->dtype.bits() * ttype->dtype.lanes() + 7) / 8;
+    for (IndexExpr dim : ttype->shape) {
+      const int64_t* pval = tir::as_const_int(dim);
+      if (pval == nullptr) {
+        supported_ = false;
+        return 0;
+      }
+      size *= static_cast<size_t>(*pval);
+    }
+    return size;
+  }
+
+  /*!
+   * \brief Get the peak of the live bytes when running the calls in an order.
+   *
+   *  The arguments of a call stay alive while it runs, and its output is freed
+   *  right away when it has no users.
+   * \param order The order.
+   * \return The peak.
+   */
+  size_t Peak(const std::vector<size_t>& order) const {
+    std::vector<size_t> remaining(calls_.size());
+    for (size_t i = 0; i < calls_.size(); ++i) {
+      remaining[i] = succs_[i].size();
+    }
+    size_t live = 0, peak = 0;
+    for (size_t i : order) {
+      live += bytes_[i];
+      peak = std::max(peak, live);
+      for (size_t p : preds_[i]) {
+        if (--remaining[p] == 0 && !pinned_[p]) live -= bytes_[p];
+      }
+      if (remaining[i] == 0 && !pinned_[i]) live -= bytes_[i];
+    }
+    return peak;
+  }
+
+  /*!
+   * \brief Order the calls, picking at each step the ready call with the
+   *  smallest growth of the live bytes, the earliest on ties.
+   * \return The order.
+   */
+  std::vector<size_t> ListSchedule() const {
+    size_t num_calls = calls_.size();
+    std::vector<size_t> remaining(num_calls), pending(num_calls);
+    std::vector<size_t> ready, order;
+    for (size_t i = 0; i < num_calls; ++i) {
+      remaining[i] = succs_[i].size();
+      pending[i] = preds_[i].size();
+      if (pending[i] == 0) ready.push_back(i);
+    }
+    while (!ready.empty()) {
+      size_t best = 0;
+      int64_t best_growth = 0;
+      for (size_t k = 0; k < ready.size(); ++k) {
+        size_t i = ready[k];
+        int64_t growth = remaining[i] == 0 && !pinned_[i] ? 0 : static_cast<int64_t>(bytes_[i]);
+        for (size_t p : preds_[i]) {
+          if (remaining[p] == 1 && !pinned_[p]) growth -= static_cast<int64_t>(bytes_[p]);
+        }
+        if (k == 0 || growth < best_growth ||
+            (growth == best_growth && i < ready[best])) {
+          best = k;
+          best_growth = growth;
+        }
+      }
+      size_t i = ready[best];
+      ready.erase(ready.begin() + best);
+      order.push_back(i);
+      for (size_t p : preds_[i]) {
+        --remaining[p];
+      }
+      for (size_t s : succs_[i]) {
+        if (--pending[s] == 0) ready.push_back(s);
+      }
+    }
+    CHECK_EQ(order.size(), num_calls);
+    return order;
+  }
+
+  /*!
+   * \brief Order the calls depth first, visiting the arguments by decreasing
+   *  difference between the peak of computing them and their size.
+   * \return The order.
+   */
+  std::vector<size_t> DepthFirstSchedule() const {
+    size_t num_calls = calls_.size();
+    // the peak of computing each call on its own, ignoring shared arguments.
+    std::vector<size_t> peak(num_calls);
+    auto by_saving = [&peak, this](std::vector<size_t> nodes) {
+      std::stable_sort(nodes.begin(), nodes.end(), [&peak, this](size_t a, size_t b) {
+          return peak[a] - bytes_[a] > peak[b] - bytes_[b];
+        });
+      return nodes;
+    };
+    std::vector<std::vector<size_t> > children(num_calls);
+    // the arguments of a call come before it in the original order.
+    for (size_t i = 0; i < num_calls; ++i) {
+      children[i] = by_saving(preds_[i]);
+      size_t running = 0;
+      for (size_t c : children[i]) {
+        peak[i] = std::max(peak[i], running + peak[c]);
+        running += bytes_[c];
+      }
+      peak[i] = std::max(peak[i], running + bytes_[i]);
+    }
+    std::vector<size_t> order;
+    std::vector<bool> visited(num_calls, false);
+    // the stack of the calls being visited and their next argument.
+    std::vector<std::pair<size_t, size_t> > stack;
+    for (size_t root : by_saving(outputs_)) {
+      if (visited[root]) continue;
+      visited[root] = true;
+      stack.emplace_back(root, 0);
+      while (!stack.empty()) {
+        auto& top = stack.back();
+        if (top.second < children[top.first].size()) {
+          size_t c = children[top.first][top.second++];
+          if (!visited[c]) {
+            visited[c] = true;
+            stack.emplace_back(c, 0);
+          }
+        } else {
+          order.push_back(top.first);
+          stack.pop_back();
+        }
+      }
+    }
+    // calls only reachable through unused tuple fields keep their place.
+    if (order.size() != num_calls) return {};
+    return order;
+  }
+
+  /*!
+   * \brief Bind the calls to lets in an order.
+   * \param func The function.
+   * \param order The order of the calls.
+   * \return The function with the calls in order.
+   */
+  Function Rebuild(const Function& func, const std::vector<size_t>& order) {
+    LetList ll;
+    std::unordered_map<const Object*, Expr> memo;
+    std::function<Expr(const Expr&)> rewrite = [&](const Expr& expr) -> Expr {
+      auto it = memo.find(expr.get());
+      if (it != memo.end()) return it->second;
+      Expr ret = expr;
+      if (const auto* tuple = expr.as<TupleNode>()) {
+        Array<Expr> fields;
+        for (Expr field : tuple->fields) {
+          fields.push_back(rewrite(field));
+        }
+        ret = TupleNode::make(fields);
+      } else if (const auto* get = expr.as<TupleGetItemNode>()) {
+        ret = TupleGetItemNode::make(rewrite(get->tuple), get->index);
+      } else {
+        CHECK(!expr.as<CallNode>()) << "The call is not scheduled before its users";
+      }
+      memo[expr.get()] = ret;
+      return ret;
+    };
+    for (size_t i : order) {
+      const CallNode* call = calls_[i];
+      Array<Expr> args;
+      for (Expr arg : call->args) {
+        args.push_back(rewrite(arg));
+      }
+      Var var = VarNode::make("x" + std::to_string(i), call->checked_type());
+      memo[call] = ll.Push(var, CallNode::make(call->op, args, call->attrs, call->type_args));
+    }
+    Expr body = ll.Get(rewrite(func->body));
+    return Function(func->params, body, func->ret_type, func->type_params, func->attrs);
+  }
+
+  /*! \brief Whether the function can be scheduled. */
+  bool supported_{true};
+  /*! \brief The calls in the original order. */
+  std::vector<const CallNode*> calls_;
+  std::unordered_map<const CallNode*, size_t> index_;
+  /*! \brief The calls each call uses the output of. */
+  std::vector<std::vector<size_t> > preds_;
+  /*! \brief The calls using the output of each call. */
+  std::vector<std::vector<size_t> > succs_;
+  /*! \brief The number of bytes of the output of each call. */
+  std::vector<size_t> bytes_;
+  /*! \brief Whether the output of each call is an output of the function. */
+  std::vector<bool> pinned_;
+  /*! \brief The calls producing the outputs of the function. */
+  std::vector<size_t> outputs_;
+};
+
+Function ScheduleForMemory(const Function& func) {
+  if (func->HasNonzeroAttr(attr::kPrimitive)) return func;
+  return MemoryScheduler().Schedule(func);
+}
+
+namespace transform {
+
+Pass ScheduleForMemory() {
+  runtime::TypedPackedFunc<Function(Function, IRModule, PassContext)> pass_func =
+    [=](Function f, IRModule m, PassContext pc) {
+    return relay::ScheduleForMemory(f);
+  };
+  return CreateFunctionPass(pass_func, 4, "ScheduleForMemory",
+                            {tir::StringImmNode::make("InferType")});
+}
+
+TVM_REGISTER_GLOBAL("relay._transform.ScheduleForMemory")
+.set_body_typed(ScheduleForMemory);
+
+}  // namespace transform
+
+}  // namespace relay
+}  // namespace tvm
@@ -110,7 +110,7 @@ class Fill : ExprFunctor<Expr(const Expr&, const Var&)> {
  private:
   const DependencyGraph& dg_;
   std::unordered_map<DependencyGraph::Node*, Scope>* node_scope_;
-  std::unordered_map<Expr, Expr, ObjectHash, ObjectEqual> memo;
+  DenseExprMemo<Expr> memo;
 
   Fill(const DependencyGraph& dg,
        std::unordered_map<DependencyGraph::Node*, Scope>* node_scope) :
@@ -134,12 +134,23 @@ class Fill : ExprFunctor<Expr(const Expr&, const Var&)> {
   }
 
   Expr VisitExpr(const Expr& e, const Var& v) final {
-    if (memo.count(e) == 0) {
-      memo.insert({e, ExprFunctor<Expr(const Expr&, const Var&)>::VisitExpr(e, v)});
+    if (memo.Find(e.get()) == nullptr) {
+      // Fill the dataflow operands first, in evaluation order, so that long
+      // chains of calls do not recurse.
+      ExpandDataflow(
+          e,
+          [this](const Expr& n) {
+            return memo.Find(n.get()) != nullptr;
+          },
+          [this, &e, &v](const Expr& n) {
+            Var bind = n.same_as(e) ? v : Var();
+            memo.Insert(n, ExprFunctor<Expr(const Expr&, const Var&)>::VisitExpr(n, bind));
+          },
+          false);
     } else if (v.defined()) {
-      GetScope(e)->ll->Push(v, memo.at(e));
+      GetScope(e)->ll->Push(v, *memo.Find(e.get()));
     }
-    auto ret = memo.at(e);
+    auto ret = *memo.Find(e.get());
     CHECK(IsAtomic(ret));
     return ret;
   }
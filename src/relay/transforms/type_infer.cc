@@ -127,7 +127,7 @@ class TypeInferencer : private ExprFunctor<Type(const Expr&)>,
 
   // map from expression to checked type
   // type inferencer will populate it up
-  std::unordered_map<Expr, ResolvedTypeInfo, ObjectHash, ObjectEqual> type_map_;
+  DenseExprMemo<ResolvedTypeInfo> type_map_;
 
   // The solver used by the inferencer.
   TypeSolver solver_;
@@ -156,16 +156,27 @@ class TypeInferencer : private ExprFunctor<Type(const Expr&)>,
   // Lazily get type for expr
   // expression, we will populate it now, and return the result.
   Type GetType(const Expr &expr) {
-    auto it = type_map_.find(expr);
-    if (it != type_map_.end() && it->second.checked_type.defined()) {
-      return it->second.checked_type;
-    }
-    Type ret = this->VisitExpr(expr);
-    CHECK(ret.defined());
-    KindCheck(ret, mod_);
-    ResolvedTypeInfo& rti = type_map_[expr];
-    rti.checked_type = ret;
-    return ret;
+    ResolvedTypeInfo* info = type_map_.Find(expr.get());
+    if (info != nullptr && info->checked_type.defined()) {
+      return info->checked_type;
+    }
+    // Type the dataflow operands first, in evaluation order, so that long
+    // chains of calls are typed without recursion.
+    ExpandDataflow(
+        expr,
+        [this](const Expr& e) {
+          ResolvedTypeInfo* info = type_map_.Find(e.get());
+          return info != nullptr && info->checked_type.defined();
+        },
+        [this](const Expr& e) {
+          Type ret = this->VisitExpr(e);
+          CHECK(ret.defined());
+          KindCheck(ret, mod_);
+          ResolvedTypeInfo& rti = type_map_[e];
+          rti.checked_type = ret;
+        },
+        false);
+    return type_map_[expr].checked_type;
   }
 
   void ReportFatalError(const ObjectRef& expr, const Error& err) {
@@ -332,28 +343,38 @@ class TypeInferencer : private ExprFunctor<Type(const Expr&)>,
     return op->op_type;
   }
 
-  Type VisitExpr_(const LetNode* let) final {
-    // if the definition is a function literal, permit recursion
-    bool is_functional_literal = let->value.as<FunctionNode>() != nullptr;
-    Type let_type = IncompleteType(Kind::kType);
+  Type VisitExpr_(const LetNode* op) final {
+    Type body_type;
+    ExpandANormalForm(
+        op,
+        [this](const LetNode* let) {
+          // if the definition is a function literal, permit recursion
+          bool is_functional_literal = let->value.as<FunctionNode>() != nullptr;
+          Type let_type = IncompleteType(Kind::kType);
 
-    if (is_functional_literal) {
-      let_type = GetType(let->var);
-      type_map_[let->var].checked_type = let_type;
-    }
+          if (is_functional_literal) {
+            let_type = GetType(let->var);
+            type_map_[let->var].checked_type = let_type;
+          }
 
 
-    if (let->var->type_annotation.defined()) {
-      let_type = Unify(let_type, let->var->type_annotation, GetRef<Let>(let));
-    }
+          if (let->var->type_annotation.defined()) {
+            let_type = Unify(let_type, let->var->type_annotation, GetRef<Let>(let));
+          }
 
-    Type vtype = GetType(let->value);
-    let_type = Unify(let_type, vtype, GetRef<Let>(let));
+          Type vtype = GetType(let->value);
+          let_type = Unify(let_type, vtype, GetRef<Let>(let));
 
-    CHECK(is_functional_literal || !type_map_.count(let->var));
-    // NOTE: no scoping is necessary because var are unique in program
-    type_map_[let->var].checked_type = let_type;
-    return GetType(let->body);
+          CHECK(is_functional_literal || type_map_.Find(let->var.get()) == nullptr);
+          // NOTE: no scoping is necessary because var are unique in program
+          type_map_[let->var].checked_type = let_type;
+        },
+        [this, op, &body_type](const LetNode* let) {
+          if (let->body.as<LetNode>() == nullptr) body_type = GetType(let->body);
+          // Every let of the chain has the type of the last body.
+          if (let != op) type_map_[GetRef<Expr>(let)].checked_type = body_type;
+        });
+    return body_type;
   }
 
   Type VisitExpr_(const IfNode* ite) final {
@@ -439,12 +460,12 @@ class TypeInferencer : private ExprFunctor<Type(const Expr&)>,
 
 
   void AddTypeArgs(const Expr& expr, Array<Type> type_args) {
-    auto type_info = type_map_.find(expr);
-    if (type_info == type_map_.end()) {
-      type_map_.insert({expr, ResolvedTypeInfo(Type(), type_args)});
+    ResolvedTypeInfo* type_info = type_map_.Find(expr.get());
+    if (type_info == nullptr) {
+      type_map_.Insert(expr, ResolvedTypeInfo(Type(), type_args));
     } else {
-      CHECK(!type_info->second.type_args.defined());
-      type_info->second.type_args = type_args;
+      CHECK(!type_info->type_args.defined());
+      type_info->type_args = type_args;
     }
   }
 
@@ -599,10 +620,9 @@ class TypeInferencer : private ExprFunctor<Type(const Expr&)>,
   }
 };
 
-class TypeInferencer::Resolver : public ExprMutator, PatternMutator {
+class TypeInferencer::Resolver : public MixedModeMutator, PatternMutator {
  public:
-  Resolver(const std::unordered_map<Expr, ResolvedTypeInfo, ObjectHash, ObjectEqual>& tmap,
-           TypeSolver* solver)
+  Resolver(const DenseExprMemo<ResolvedTypeInfo>& tmap, TypeSolver* solver)
     : tmap_(tmap), solver_(solver) {
   }
 
@@ -639,7 +659,19 @@ class TypeInferencer::Resolver : public ExprMutator, PatternMutator {
   }
 
   Expr VisitExpr_(const LetNode* op) final {
-    return AttachCheckedType(op);
+    Expr ret;
+    ExpandANormalForm(
+        op,
+        [this](const LetNode* let) {
+          VisitExpr(let->var);
+          VisitExpr(let->value);
+        },
+        [this, op, &ret](const LetNode* let) {
+          // The body is a memo hit when it is a let of the chain.
+          ret = AttachCheckedType(let);
+          if (let != op) dense_memo_.Insert(GetRef<Expr>(let), ret);
+        });
+    return ret;
   }
 
   Expr VisitExpr_(const IfNode* op) final {
@@ -680,9 +712,9 @@ class TypeInferencer::Resolver : public ExprMutator, PatternMutator {
   // attach checked type to the mutated node.
   template<typename T>
   Expr AttachCheckedType(const T* op) {
-    auto it = tmap_.find(GetRef<Expr>(op));
-    CHECK(it != tmap_.end());
-    Type checked_type = solver_->Resolve(it->second.checked_type);
+    const ResolvedTypeInfo* info = tmap_.Find(op);
+    CHECK(info != nullptr);
+    Type checked_type = solver_->Resolve(info->checked_type);
 
     // TODO(@jroesch): it would be nice if we would report resolution
     // errors directly on the program.
@@ -707,8 +739,8 @@ class TypeInferencer::Resolver : public ExprMutator, PatternMutator {
     bool need_update_type = !checked_type.same_as(new_e->checked_type_);
     bool need_update_call = (
         std::is_base_of<CallNode, T>::value &&
-        it->second.type_args.defined() &&
-        !it->second.type_args.same_as(new_call->type_args));
+        info->type_args.defined() &&
+        !info->type_args.same_as(new_call->type_args));
     bool need_update_var = (
         std::is_base_of<VarNode, T>::value &&
         update_missing_type_annotation_ &&
@@ -749,7 +781,7 @@ class TypeInferencer::Resolver : public ExprMutator, PatternMutator {
     }
 
     if (need_update_call) {
-      new_call->type_args = it->second.type_args;
+      new_call->type_args = info->type_args;
       for (size_t i = 0; i < new_call->type_args.size(); i++) {
         new_call->type_args.Set(i, solver_->Resolve(new_call->type_args[i]));
       }
@@ -771,7 +803,7 @@ class TypeInferencer::Resolver : public ExprMutator, PatternMutator {
 
  private:
   std::unordered_map<Var, Var, ObjectHash, ObjectEqual> vmap_;
-  const std::unordered_map<Expr, ResolvedTypeInfo, ObjectHash, ObjectEqual>& tmap_;
+  const DenseExprMemo<ResolvedTypeInfo>& tmap_;
   TypeSolver* solver_;
   // whether attach the checked type as type_annotation
   // if original type anntation is missing.
@@ -791,13 +823,13 @@ Expr TypeInferencer::Infer(Expr expr) {
   return resolved_expr;
 }
 
-struct AllCheckTypePopulated : ExprVisitor {
+struct AllCheckTypePopulated : MixedModeVisitor {
   void VisitExpr(const Expr& e) {
     if (e.as<OpNode>()) { return; }
     if (e.as<GlobalVarNode>()) { return; }
     if (e.as<ConstructorNode>()) { return; }
     CHECK(e->checked_type_.defined()) << "Expression: " << e;
-    return ExprVisitor::VisitExpr(e);
+    return MixedModeVisitor::VisitExpr(e);
   }
 };
 
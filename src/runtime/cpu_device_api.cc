@@ -24,16 +24,58 @@
 #include <dmlc/thread_local.h>
 #include <tvm/runtime/registry.h>
 #include <tvm/runtime/device_api.h>
+#include <tvm/runtime/threading_backend.h>
 #include <cstdlib>
 #include <cstring>
+#include <string>
 #include "workspace_pool.h"
 
 #ifdef __ANDROID__
 #include <android/api-level.h>
 #endif
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 namespace tvm {
 namespace runtime {
+
+#if defined(__linux__) && !defined(__ANDROID__)
+/*!
+ * \brief Place the pages of a fresh allocation on the NUMA node the calling
+ *  thread is bound to, so that the buffers of a pinned runtime stay on its socket.
+ *
+ *  The node is set as preferred policy of the range, so later first touches by
+ *  any thread land on it. When the kernel rejects the policy the pages are
+ *  touched by the calling thread instead.
+ */
+static void PlaceOnCurrentNumaNode(void* ptr, size_t nbytes) {
+  int node = threading::CurrentNumaNode();
+  if (node < 0) return;
+  const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  uintptr_t begin = (reinterpret_cast<uintptr_t>(ptr) + page - 1) / page * page;
+  uintptr_t end = (reinterpret_cast<uintptr_t>(ptr) + nbytes) / page * page;
+  if (begin >= end) return;
+#ifdef SYS_mbind
+  // MPOL_PREFERRED from linux/mempolicy.h
+  constexpr int kMPolPreferred = 1;
+  constexpr size_t kMaskBits = 8 * sizeof(unsigned long);  // NOLINT(*)
+  unsigned long nodemask[1024 / kMaskBits] = {0};  // NOLINT(*)
+  if (static_cast<size_t>(node) < 1024) {
+    nodemask[node / kMaskBits] |= 1UL << (node % kMaskBits);
+    if (syscall(SYS_mbind, begin, end - begin, kMPolPreferred,
+                nodemask, 1024, 0) == 0) {
+      return;
+    }
+  }
+#endif
+  for (uintptr_t p = begin; p < end; p += page) {
+    *reinterpret_cast<volatile char*>(p) = 0;
+  }
+}
+#endif
+
 class CPUDeviceAPI final : public DeviceAPI {
  public:
   void SetDevice(TVMContext ctx) final {}
@@ -57,6 +99,9 @@ class CPUDeviceAPI final : public DeviceAPI {
     // posix_memalign is available in android ndk since __ANDROID_API__ >= 17
     int ret = posix_memalign(&ptr, alignment, nbytes);
     if (ret != 0) throw std::bad_alloc();
+#endif
+#if defined(__linux__) && !defined(__ANDROID__)
+    PlaceOnCurrentNumaNode(ptr, nbytes);
 #endif
     return ptr;
   }
@@ -117,5 +162,41 @@ TVM_REGISTER_GLOBAL("device_api.cpu")
     DeviceAPI* ptr = CPUDeviceAPI::Global().get();
     *rv = static_cast<void*>(ptr);
   });
+
+// The CPU workspace pool is thread local, so both functions act on the pool
+// of the calling thread.
+TVM_REGISTER_GLOBAL("runtime.workspace_pool_stats")
+.set_body([](TVMArgs args, TVMRetValue* rv) {
+    TVMContext ctx = args[0];
+    std::string key = args[1];
+    CHECK_EQ(ctx.device_type, kDLCPU)
+        << "workspace pool statistics are only available for the CPU";
+    WorkspacePool::Stats stats =
+        dmlc::ThreadLocalStore<CPUWorkspacePool>::Get()->GetStats(ctx);
+    size_t value;
+    if (key == "num_alloc") {
+      value = stats.num_alloc;
+    } else if (key == "num_device_alloc") {
+      value = stats.num_device_alloc;
+    } else if (key == "bytes_in_use") {
+      value = stats.bytes_in_use;
+    } else if (key == "bytes_reserved") {
+      value = stats.bytes_reserved;
+    } else if (key == "peak_bytes_in_use") {
+      value = stats.peak_bytes_in_use;
+    } else {
+      LOG(FATAL) << "Unknown workspace pool statistic " << key;
+      return;
+    }
+    *rv = static_cast<int64_t>(value);
+  });
+
+TVM_REGISTER_GLOBAL("runtime.workspace_pool_trim")
+.set_body([](TVMArgs args, TVMRetValue* rv) {
+    TVMContext ctx = args[0];
+    CHECK_EQ(ctx.device_type, kDLCPU)
+        << "workspace pool trimming is only available for the CPU";
+    dmlc::ThreadLocalStore<CPUWorkspacePool>::Get()->Trim(ctx);
+  });
 }  // namespace runtime
 }  // namespace tvm
@@ -0,0 +1,139 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file dataflow_executor.cc
+ */
+#include <dmlc/logging.h>
+#include <tvm/runtime/threading_backend.h>
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include "dataflow_executor.h"
+
+namespace tvm {
+namespace runtime {
+
+DataflowExecutor::DataflowExecutor(const std::vector<std::function<void()> >* op_execs,
+                                   std::vector<std::vector<uint32_t> > successors,
+                                   int num_threads)
+    : op_execs_(op_execs), successors_(std::move(successors)) {
+  CHECK_EQ(op_execs_->size(), successors_.size());
+  CHECK_GE(num_threads, 1);
+  num_preds_.resize(successors_.size(), 0);
+  for (const auto& succ : successors_) {
+    for (uint32_t nid : succ) {
+      ++num_preds_[nid];
+    }
+  }
+  pending_.resize(successors_.size());
+  team_size_ = std::max(1, threading::MaxConcurrency() / num_threads);
+  for (int i = 1; i < num_threads; ++i) {
+    threads_.emplace_back([this] { this->WorkerLoop(); });
+  }
+}
+
+DataflowExecutor::~DataflowExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    exit_ = true;
+  }
+  cv_.notify_all();
+  for (std::thread& t : threads_) {
+    t.join();
+  }
+}
+
+void DataflowExecutor::Run() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CHECK_EQ(op_execs_->size(), successors_.size());
+    ready_.clear();
+    for (size_t nid = 0; nid < pending_.size(); ++nid) {
+      pending_[nid] = num_preds_[nid];
+      if (pending_[nid] == 0) ready_.push_back(static_cast<uint32_t>(nid));
+    }
+    num_remaining_ = pending_.size();
+    error_.clear();
+    ++run_id_;
+  }
+  cv_.notify_all();
+  int old_team_size = threading::SetMaxTeamSize(team_size_);
+  this->Work();
+  threading::SetMaxTeamSize(old_team_size);
+  std::string error;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::swap(error, error_);
+  }
+  if (!error.empty()) {
+    LOG(FATAL) << error;
+  }
+}
+
+void DataflowExecutor::Work() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [this] { return !ready_.empty() || num_remaining_ == 0 || exit_; });
+    if (ready_.empty()) return;
+    uint32_t nid = ready_.front();
+    ready_.pop_front();
+    // after an error the remaining operators are only marked done
+    bool skip = !error_.empty();
+    lock.unlock();
+    std::string error;
+    if (!skip && (*op_execs_)[nid]) {
+      try {
+        (*op_execs_)[nid]();
+      } catch (const std::exception& e) {
+        error = e.what();
+      } catch (...) {
+        error = "unknown exception";
+      }
+    }
+    lock.lock();
+    if (!error.empty() && error_.empty()) {
+      error_ = error;
+    }
+    for (uint32_t succ : successors_[nid]) {
+      if (--pending_[succ] == 0) ready_.push_back(succ);
+    }
+    --num_remaining_;
+    cv_.notify_all();
+  }
+}
+
+void DataflowExecutor::WorkerLoop() {
+  threading::SetMaxTeamSize(team_size_);
+  uint64_t last_run = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [this, last_run] { return exit_ || run_id_ != last_run; });
+    if (exit_) return;
+    last_run = run_id_;
+    lock.unlock();
+    this->Work();
+    lock.lock();
+  }
+}
+
+}  // namespace runtime
+}  // namespace tvm
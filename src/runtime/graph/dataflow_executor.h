@@ -0,0 +1,100 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file dataflow_executor.h
+ * \brief Run the operators of a graph concurrently in dependency order.
+ */
+#ifndef TVM_RUNTIME_GRAPH_DATAFLOW_EXECUTOR_H_
+#define TVM_RUNTIME_GRAPH_DATAFLOW_EXECUTOR_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+
+/*!
+ * \brief Executor running the operators of a graph on several threads as soon
+ *  as their dependencies are done.
+ *
+ *  Each thread limits the parallel launches of its operators to an equal share
+ *  of the thread pool, so concurrent operators run on disjoint teams.
+ */
+class DataflowExecutor {
+ public:
+  /*!
+   * \brief Create the executor.
+   * \param op_execs The executor of each node, empty for nodes without work.
+   *  Must outlive the executor, its functions may be replaced between runs.
+   * \param successors The nodes depending on each node.
+   * \param num_threads The number of threads running operators, including
+   *  the one calling Run.
+   */
+  DataflowExecutor(const std::vector<std::function<void()> >* op_execs,
+                   std::vector<std::vector<uint32_t> > successors,
+                   int num_threads);
+  ~DataflowExecutor();
+  /*!
+   * \brief Run all the operators and wait for them.
+   *
+   *  The first error raised by an operator is raised again once the
+   *  operators that already started are done; the remaining ones are skipped.
+   */
+  void Run();
+
+ private:
+  /*! \brief Run operators until the current run is complete. */
+  void Work();
+  /*! \brief The loop of the helper threads. */
+  void WorkerLoop();
+
+  const std::vector<std::function<void()> >* op_execs_;
+  std::vector<std::vector<uint32_t> > successors_;
+  /*! \brief The number of predecessors of each node. */
+  std::vector<int> num_preds_;
+  /*! \brief The maximum team size of the parallel launches of each thread. */
+  int team_size_;
+  std::vector<std::thread> threads_;
+  /*! \brief Protects the members below. */
+  std::mutex mutex_;
+  /*! \brief The number of predecessors not done yet in the current run. */
+  std::vector<int> pending_;
+  std::condition_variable cv_;
+  /*! \brief The nodes ready to run. */
+  std::deque<uint32_t> ready_;
+  /*! \brief The number of nodes not done in the current run. */
+  size_t num_remaining_{0};
+  /*! \brief Increased at the start of every run to wake the helper threads. */
+  uint64_t run_id_{0};
+  /*! \brief The first error of the current run. */
+  std::string error_;
+  bool exit_{false};
+};
+
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_GRAPH_DATAFLOW_EXECUTOR_H_
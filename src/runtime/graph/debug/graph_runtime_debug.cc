@@ -23,14 +23,103 @@
 #include <tvm/runtime/packed_func.h>
 #include <tvm/runtime/registry.h>
 #include <tvm/runtime/ndarray.h>
+#include <tvm/runtime/threading_backend.h>
+#include <dmlc/json.h>
 
+#ifdef __linux__
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <iomanip>
 #include <sstream>
 #include "../graph_runtime.h"
 
 namespace tvm {
 namespace runtime {
 
+/*!
+ * \brief The hardware counters of all the threads of the process, read
+ *  through perf_event_open. No counter is available on other platforms.
+ */
+class HardwareCounters {
+ public:
+  /*! \brief The number of counted events. */
+  static constexpr int kNumEvents = 2;
+
+  /*! \brief The name of a counted event. */
+  static const char* EventName(int event) {
+    static const char* names[kNumEvents] = {"cycles", "llc_misses"};
+    return names[event];
+  }
+
+  /*!
+   * \brief Start counting on the threads alive, so the thread pool must be
+   *  started before.
+   * \return Whether any counter could be opened.
+   */
+  bool Open() {
+#ifdef __linux__
+    const uint64_t configs[kNumEvents] = {PERF_COUNT_HW_CPU_CYCLES,
+                                          PERF_COUNT_HW_CACHE_MISSES};
+    DIR* dir = opendir("/proc/self/task");
+    if (dir == nullptr) return false;
+    while (dirent* entry = readdir(dir)) {
+      if (entry->d_name[0] == '.') continue;
+      pid_t tid = static_cast<pid_t>(atoi(entry->d_name));
+      for (int i = 0; i < kNumEvents; ++i) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, tid, -1, -1, 0));
+        if (fd >= 0) fds_[i].push_back(fd);
+      }
+    }
+    closedir(dir);
+    return !fds_[0].empty() || !fds_[1].empty();
+#else
+    return false;
+#endif
+  }
+
+  /*!
+   * \brief Read the counts summed over the threads.
+   * \param counts The count of each event.
+   */
+  void Read(uint64_t* counts) const {
+    for (int i = 0; i < kNumEvents; ++i) {
+      counts[i] = 0;
+#ifdef __linux__
+      for (int fd : fds_[i]) {
+        uint64_t value;
+        if (read(fd, &value, sizeof(value)) == sizeof(value)) counts[i] += value;
+      }
+#endif
+    }
+  }
+
+  ~HardwareCounters() {
+#ifdef __linux__
+    for (int i = 0; i < kNumEvents; ++i) {
+      for (int fd : fds_[i]) close(fd);
+    }
+#endif
+  }
+
+ private:
+  /*! \brief The counter of each thread, for each event. */
+  std::vector<int> fds_[kNumEvents];
+};
+
 /*!
  * \brief Graph runtime with debug .
  *
@@ -105,6 +194,117 @@ class GraphRuntimeDebug : public GraphRuntime {
     return os.str();
   }
 
+  /*!
+   * \brief Run each operation in the graph and record a timeline of them.
+   *
+   *  Each run of an op is a complete event of the Chrome trace event format,
+   *  with the bytes of its inputs and outputs, the bandwidth they imply, and
+   *  the thread pool utilization: the time spent running its tasks over the
+   *  time of all the threads of the pool. An op making no parallel launch
+   *  counts as one thread busy for its whole duration.
+   *
+   * \param repeat The number of times to run the whole graph, after a warmup run.
+   * \param hardware_counters Whether to also record the cycles and the last level
+   *        cache misses of each op, when perf_event_open is available.
+   * \return The timeline in the Chrome trace event JSON format.
+   */
+  std::string ProfileTimeline(int repeat, bool hardware_counters) {
+    // warmup run, which also starts the thread pool
+    GraphRuntime::Run();
+    HardwareCounters counters;
+    bool use_counters = hardware_counters && counters.Open();
+    if (hardware_counters && !use_counters) {
+      LOG(WARNING) << "Hardware counters are not available, they are not recorded";
+    }
+    // one busy time slot per worker and one for the callers
+    int num_slots = std::max(static_cast<int>(threading::TaskBusyTime().size()), 1);
+    // turn the task profiling off however the runs exit
+    struct TaskProfilingScope {
+      TaskProfilingScope() { threading::SetTaskProfiling(true); }
+      ~TaskProfilingScope() { threading::SetTaskProfiling(false); }
+    } profiling;
+    uint64_t counts_begin[HardwareCounters::kNumEvents];
+    uint64_t counts_end[HardwareCounters::kNumEvents];
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3);
+    dmlc::JSONWriter writer(&os);
+    os << "{\"traceEvents\": [";
+    const char* sep = "\n";
+    auto tstart = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < repeat; ++i) {
+      for (size_t index = 0; index < op_execs_.size(); ++index) {
+        if (!op_execs_[index]) continue;
+        const TVMContext& ctx = data_entry_[entry_id(index, 0)]->ctx;
+        if (use_counters) counters.Read(counts_begin);
+        std::vector<int64_t> busy_begin = threading::TaskBusyTime();
+        auto op_tbegin = std::chrono::high_resolution_clock::now();
+        op_execs_[index]();
+        TVMSynchronize(ctx.device_type, ctx.device_id, nullptr);
+        auto op_tend = std::chrono::high_resolution_clock::now();
+        std::vector<int64_t> busy_end = threading::TaskBusyTime();
+        if (use_counters) counters.Read(counts_end);
+
+        double ts = std::chrono::duration_cast<std::chrono::duration<double, std::micro> >(
+            op_tbegin - tstart).count();
+        double dur = std::chrono::duration_cast<std::chrono::duration<double, std::micro> >(
+            op_tend - op_tbegin).count();
+        double busy = 0;
+        int threads = 0;
+        for (size_t j = 0; j < busy_end.size(); ++j) {
+          busy += (busy_end[j] - busy_begin[j]) * 1e-3;
+          threads += busy_end[j] > busy_begin[j];
+        }
+        if (threads == 0) {
+          busy = dur;
+          threads = 1;
+        }
+        // a nested launch counts in the slots of both the worker and the callers
+        double utilization = dur > 0 ? std::min(busy / (dur * num_slots), 1.0) : 0;
+        size_t bytes = GetNodeBytes(index);
+
+        os << sep << "  {\"name\": ";
+        writer.WriteString(GetNodeName(index));
+        os << ", \"cat\": \"op\", \"ph\": \"X\", \"ts\": " << ts << ", \"dur\": " << dur
+           << ", \"pid\": 0, \"tid\": 0, \"args\": {\"repeat\": " << i
+           << ", \"bytes\": " << bytes
+           << ", \"bandwidth_GBps\": " << (dur > 0 ? bytes / dur * 1e-3 : 0.0)
+           << ", \"threads\": " << threads
+           << ", \"utilization\": " << utilization;
+        if (use_counters) {
+          for (int e = 0; e < HardwareCounters::kNumEvents; ++e) {
+            os << ", \"" << HardwareCounters::EventName(e)
+               << "\": " << counts_end[e] - counts_begin[e];
+          }
+        }
+        os << "}}";
+        sep = ",\n";
+        // plot the utilization as a counter track under the ops
+        os << sep << "  {\"name\": \"thread pool utilization\", \"ph\": \"C\", \"ts\": " << ts
+           << ", \"pid\": 0, \"args\": {\"utilization\": " << utilization << "}}";
+        os << sep << "  {\"name\": \"thread pool utilization\", \"ph\": \"C\", \"ts\": "
+           << ts + dur << ", \"pid\": 0, \"args\": {\"utilization\": 0}}";
+      }
+    }
+    os << "\n], \"displayTimeUnit\": \"ns\"}";
+    return os.str();
+  }
+
+  /*!
+   * \brief Get the bytes of the inputs and outputs of a node.
+   * \param nid The node index.
+   * \return The bytes read and written by the node.
+   */
+  size_t GetNodeBytes(uint32_t nid) const {
+    size_t bytes = 0;
+    for (const auto& e : nodes_[nid].inputs) {
+      bytes += GetDataSize(*data_entry_[entry_id(e)].operator->());
+    }
+    for (uint32_t i = 0; i < nodes_[nid].param.num_outputs; ++i) {
+      bytes += GetDataSize(*data_entry_[entry_id(nid, i)].operator->());
+    }
+    return bytes;
+  }
+
   /*!
    * \brief Run each operation and get the output.
    * \param index The index of op which needs to be returned.
@@ -192,6 +392,13 @@ PackedFunc GraphRuntimeDebug::GetFunction(
       CHECK_GE(min_repeat_ms, 0);
       *rv = this->RunIndividual(number, repeat, min_repeat_ms);
     });
+  } else if (name == "profile_timeline") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      int repeat = args[0];
+      bool hardware_counters = args[1];
+      CHECK_GT(repeat, 0);
+      *rv = this->ProfileTimeline(repeat, hardware_counters);
+    });
   } else {
     return GraphRuntime::GetFunction(name, sptr_to_self);
   }
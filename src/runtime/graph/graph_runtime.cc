@@ -25,17 +25,23 @@
 #include <tvm/runtime/packed_func.h>
 #include <tvm/runtime/registry.h>
 #include <tvm/runtime/serializer.h>
+#include <dmlc/memory_io.h>
 
 #include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <functional>
 #include <memory>
 #include <numeric>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "graph_runtime.h"
+#include "../library_module.h"
+#include "../mapped_file.h"
 
 namespace tvm {
 namespace runtime {
@@ -45,17 +51,200 @@ inline size_t GetDataAlignment(const DLTensor& arr) {
   if (align < kAllocAlignment) return kAllocAlignment;
   return align;
 }
+
+/*! \brief The location of one tensor in an aligned parameter blob. */
+struct AlignedParamEntry {
+  std::string name;
+  DLDataType dtype;
+  std::vector<int64_t> shape;
+  uint64_t offset;
+  uint64_t nbytes;
+};
+
+/*!
+ * \brief Read the header of an aligned parameter blob.
+ * \param data The start of the blob.
+ * \param size The size of the blob in bytes.
+ * \return The entries, whose payloads are checked to lie within the blob.
+ */
+std::vector<AlignedParamEntry> ReadAlignedParamHeader(const char* data, size_t size) {
+  dmlc::MemoryFixedSizeStream strm(const_cast<char*>(data), size);
+  uint64_t header, alignment;
+  CHECK(strm.Read(&header) && header == kTVMAlignedNDArrayListMagic)
+      << "Invalid parameters file format";
+  CHECK(strm.Read(&alignment))
+      << "Invalid parameters file format";
+  std::vector<std::string> names;
+  CHECK(strm.Read(&names))
+      << "Invalid parameters file format";
+  uint64_t sz;
+  CHECK(strm.Read(&sz) && sz == names.size())
+      << "Invalid parameters file format";
+  std::vector<AlignedParamEntry> entries(sz);
+  for (size_t i = 0; i < entries.size(); ++i) {
+    AlignedParamEntry& e = entries[i];
+    e.name = std::move(names[i]);
+    DLContext ctx;
+    int ndim;
+    CHECK(strm.Read(&ctx) && strm.Read(&ndim) && strm.Read(&e.dtype))
+        << "Invalid parameters file format";
+    CHECK_EQ(ctx.device_type, kDLCPU)
+        << "Invalid DLTensor context: can only save as CPU tensor";
+    e.shape.resize(ndim);
+    if (ndim != 0) {
+      CHECK(strm.ReadArray(&e.shape[0], ndim))
+          << "Invalid parameters file format";
+    }
+    CHECK(strm.Read(&e.offset) && strm.Read(&e.nbytes))
+        << "Invalid parameters file format";
+    int64_t num_elems = 1;
+    for (int64_t s : e.shape) num_elems *= s;
+    CHECK_EQ(e.nbytes, static_cast<uint64_t>(num_elems * ((e.dtype.bits * e.dtype.lanes + 7) / 8)))
+        << "Invalid parameters file format";
+    CHECK(e.offset <= size && e.nbytes <= size - e.offset)
+        << "Parameter " << e.name << " lies beyond the end of the parameters file";
+  }
+  return entries;
+}
+
+/*! \brief A DLPack tensor viewing part of a storage it keeps alive. */
+struct OffsetView {
+  DLManagedTensor tensor;
+  std::vector<int64_t> shape;
+  NDArray storage;
+
+  static void Deleter(DLManagedTensor* self) {
+    delete static_cast<OffsetView*>(self->manager_ctx);
+  }
+};
 }  // namespace details
 
 /*!
  * \brief Run all the operations one by one.
  */
 void GraphRuntime::Run() {
+  if (dataflow_ != nullptr) {
+    dataflow_->Run();
+    return;
+  }
+  if (use_call_table_) {
+    for (const CallRecord& call : call_table_) {
+      if (call.packed_cfunc == nullptr) {
+        op_execs_[call.nid]();
+        continue;
+      }
+      TVMValue ret_value;
+      int ret_type_code = kTVMNullptr;
+      int ret = (*call.packed_cfunc)(call.arg_values, call.arg_tcodes, call.num_args,
+                                     &ret_value, &ret_type_code);
+      CHECK_EQ(ret, 0) << TVMGetLastError();
+    }
+    return;
+  }
   // setup the array and requirements.
   for (size_t i = 0; i < op_execs_.size(); ++i) {
     if (op_execs_[i]) op_execs_[i]();
   }
 }
+void GraphRuntime::SetInterOpThreads(int num_threads) {
+  dataflow_.reset();
+  if (num_threads <= 1) return;
+  // Walk the operators in the serial order, which the memory plan assumes, and
+  // make each one wait for the last writers of what it reads and, since storage
+  // is reused, for the last writers and the readers of the bytes it writes.
+  struct Access {
+    size_t begin, end;
+    uint32_t nid;
+    bool write;
+  };
+  std::vector<std::unordered_set<uint32_t> > successors(this->GetNumOfNodes());
+  std::unordered_map<int, std::vector<Access> > accesses;
+  auto add_edge = [&successors](uint32_t from, uint32_t to) {
+    if (from != to) successors[from].insert(to);
+  };
+  auto access = [this, &accesses, &add_edge](uint32_t eid, uint32_t nid, bool write) {
+    size_t begin = attrs_.storage_offset.empty() ? 0 : attrs_.storage_offset[eid];
+    size_t end = begin + GetDataSize(*data_entry_[eid].operator->());
+    std::vector<Access>& list = accesses[attrs_.storage_id[eid]];
+    std::vector<Access> kept;
+    for (const Access& a : list) {
+      bool overlap = a.begin < end && begin < a.end;
+      if (overlap && (write || a.write)) add_edge(a.nid, nid);
+      // a write hides the accesses it covers from the later ones.
+      if (!(write && begin <= a.begin && a.end <= end)) kept.push_back(a);
+    }
+    kept.push_back({begin, end, nid, write});
+    list.swap(kept);
+  };
+  for (uint32_t nid = 0; nid < this->GetNumOfNodes(); ++nid) {
+    const auto& inode = nodes_[nid];
+    if (inode.op_type == "null") continue;
+    for (const auto& e : inode.inputs) {
+      if (nodes_[e.node_id].op_type != "null") add_edge(e.node_id, nid);
+      access(this->entry_id(e), nid, false);
+    }
+    for (uint32_t index = 0; index < inode.param.num_outputs; ++index) {
+      access(this->entry_id(nid, index), nid, true);
+    }
+  }
+  std::vector<std::vector<uint32_t> > succ_list(successors.size());
+  for (size_t i = 0; i < successors.size(); ++i) {
+    succ_list[i].assign(successors[i].begin(), successors[i].end());
+    std::sort(succ_list[i].begin(), succ_list[i].end());
+  }
+  dataflow_ = std::make_shared<DataflowExecutor>(&op_execs_, std::move(succ_list), num_threads);
+}
+
+void GraphRuntime::RunNodes(uint32_t begin, uint32_t end) {
+  CHECK_LE(end, op_execs_.size());
+  for (uint32_t i = begin; i < end; ++i) {
+    if (op_execs_[i]) op_execs_[i]();
+  }
+}
+
+std::vector<uint32_t> GraphRuntime::DeviceStages() const {
+  std::vector<uint32_t> begins{0};
+  bool has_prev = false;
+  TVMContext prev;
+  for (uint32_t nid = 0; nid < this->GetNumOfNodes(); ++nid) {
+    if (nodes_[nid].op_type == "null") continue;
+    TVMContext ctx = NodeContext(nid);
+    if (has_prev && (ctx.device_type != prev.device_type || ctx.device_id != prev.device_id)) {
+      begins.push_back(nid);
+    }
+    prev = ctx;
+    has_prev = true;
+  }
+  return begins;
+}
+
+NDArray GraphRuntime::CreateOffsetView(const NDArray& storage, int64_t offset,
+                                       const std::vector<int64_t>& shape, DLDataType dtype) {
+  const DLTensor* base = storage.operator->();
+  // The kernels require a zero byte_offset, so the view moves the data pointer,
+  // which only addresses memory on these devices.
+  DLDeviceType device_type = base->ctx.device_type;
+  CHECK(device_type == kDLCPU || device_type == kDLCPUPinned || device_type == kDLGPU ||
+        device_type == kDLROCM)
+      << "storage_offset is not supported on device type " << device_type;
+  details::OffsetView* view = new details::OffsetView();
+  view->shape = shape;
+  view->storage = storage;
+  view->tensor.manager_ctx = view;
+  view->tensor.deleter = details::OffsetView::Deleter;
+  DLTensor& t = view->tensor.dl_tensor;
+  t.data = static_cast<char*>(base->data) + base->byte_offset + offset;
+  t.ctx = base->ctx;
+  t.ndim = static_cast<int>(view->shape.size());
+  t.dtype = dtype;
+  t.shape = view->shape.data();
+  t.strides = nullptr;
+  t.byte_offset = 0;
+  CHECK_LE(static_cast<size_t>(offset) + GetDataSize(t), GetDataSize(*base))
+      << "The view exceeds its storage";
+  return NDArray::FromDLPack(&view->tensor);
+}
+
 /*!
  * \brief Initialize the graph executor with graph and context.
  * \param graph_json The execution graph.
@@ -66,19 +255,20 @@ void GraphRuntime::Run() {
  */
 void GraphRuntime::Init(const std::string& graph_json,
                         tvm::runtime::Module module,
-                        const std::vector<TVMContext>& ctxs) {
+                        const std::vector<TVMContext>& ctxs,
+                        const std::unordered_map<std::string, NDArray>& shared_params) {
   std::istringstream is(graph_json);
   dmlc::JSONReader reader(&is);
   this->Load(&reader);
   module_ = module;
   ctxs_ = ctxs;
-  this->SetupStorage();
-  this->SetupOpExecs();
   for (size_t i = 0; i < input_nodes_.size(); i++) {
     const uint32_t nid = input_nodes_[i];
     std::string& name = nodes_[nid].name;
     input_map_[name] = i;
   }
+  this->SetupStorage(shared_params);
+  this->SetupOpExecs();
 }
 /*!
  * \brief Get the input index given the name of input.
@@ -101,6 +291,8 @@ int GraphRuntime::GetInputIndex(const std::string& name) {
 void GraphRuntime::SetInput(int index, DLTensor* data_in) {
   CHECK_LT(static_cast<size_t>(index), input_nodes_.size());
   uint32_t eid = this->entry_id(input_nodes_[index], 0);
+  CHECK_EQ(shared_entries_.count(eid), 0U)
+      << "Input " << nodes_[input_nodes_[index]].name << " is shared and read-only";
   data_entry_[eid].CopyFrom(data_in);
 }
 /*!
@@ -182,10 +374,103 @@ void GraphRuntime::CopyOutputTo(int index, DLTensor* data_out) {
  * \param param_blob A binary blob of parameter.
  */
 void GraphRuntime::LoadParams(const std::string& param_blob) {
+  uint64_t header = 0;
+  if (param_blob.size() >= sizeof(header)) {
+    std::memcpy(&header, param_blob.data(), sizeof(header));
+  }
+  if (header == kTVMAlignedNDArrayListMagic) {
+    this->LoadAlignedParams(param_blob.data(), param_blob.size(), nullptr);
+    return;
+  }
   dmlc::MemoryStringStream strm(const_cast<std::string*>(&param_blob));
   this->LoadParams(&strm);
 }
 
+void GraphRuntime::LoadParamsMmap(const std::string& path) {
+#ifdef _WIN32
+  // No mmap support, read the file and copy the parameters.
+  std::ifstream fs(path, std::ios::in | std::ios::binary);
+  CHECK(!fs.fail()) << "Cannot open " << path;
+  std::string param_blob((std::istreambuf_iterator<char>(fs)),
+                         std::istreambuf_iterator<char>());
+  this->LoadParams(param_blob);
+#else
+  auto file = std::make_shared<MappedFile>(path);
+  CHECK_GE(file->size(), 2 * sizeof(uint64_t)) << "Invalid parameters file format";
+  uint64_t header;
+  std::memcpy(&header, file->data(), sizeof(header));
+  if (header == kTVMAlignedNDArrayListMagic) {
+    this->LoadAlignedParams(file->data(), file->size(), file);
+  } else {
+    dmlc::MemoryFixedSizeStream strm(const_cast<char*>(file->data()), file->size());
+    this->LoadParams(&strm);
+  }
+#endif
+}
+
+void GraphRuntime::LoadAlignedParams(const char* data, size_t size,
+                                     std::shared_ptr<void> mapping) {
+  std::vector<details::AlignedParamEntry> entries =
+      details::ReadAlignedParamHeader(data, size);
+  bool bound = false;
+  for (details::AlignedParamEntry& e : entries) {
+    int in_idx = GetInputIndex(e.name);
+    CHECK_GE(in_idx, 0) << "Found param for non-existent input: " << e.name;
+    uint32_t eid = this->entry_id(input_nodes_[in_idx], 0);
+    CHECK_LT(eid, data_entry_.size());
+    CHECK_EQ(shared_entries_.count(eid), 0U)
+        << "Param " << e.name << " is shared and read-only";
+    const DLTensor* old_t = data_entry_[eid].operator->();
+    CHECK_EQ(old_t->ndim, static_cast<int>(e.shape.size()))
+        << "Shape mismatch of param " << e.name;
+    for (int i = 0; i < old_t->ndim; ++i) {
+      CHECK_EQ(old_t->shape[i], e.shape[i]) << "Shape mismatch of param " << e.name;
+    }
+    CHECK(old_t->dtype.code == e.dtype.code && old_t->dtype.bits == e.dtype.bits &&
+          old_t->dtype.lanes == e.dtype.lanes)
+        << "Data type mismatch of param " << e.name;
+    const char* payload = data + e.offset;
+    if (!DMLC_IO_NO_ENDIAN_SWAP) {
+      NDArray temp = NDArray::Empty(e.shape, e.dtype, {kDLCPU, 0});
+      std::memcpy(temp->data, payload, e.nbytes);
+      int elem_bytes = (e.dtype.bits + 7) / 8;
+      dmlc::ByteSwap(temp->data, elem_bytes, e.nbytes / elem_bytes);
+      data_entry_[eid].CopyFrom(temp);
+      continue;
+    }
+    if (mapping == nullptr || old_t->ctx.device_type != kDLCPU ||
+        reinterpret_cast<size_t>(payload) % data_alignment_[eid] != 0) {
+      data_entry_[eid].CopyFromBytes(payload, e.nbytes);
+      continue;
+    }
+    // Bind the entry to the mapped payload.
+    MappedTensor* mt = new MappedTensor();
+    mt->shape = std::move(e.shape);
+    mt->buffer = mapping;
+    mt->tensor.manager_ctx = mt;
+    mt->tensor.deleter = MappedTensor::Deleter;
+    DLTensor& t = mt->tensor.dl_tensor;
+    t.data = const_cast<char*>(payload);
+    t.ctx = old_t->ctx;
+    t.ndim = static_cast<int>(mt->shape.size());
+    t.dtype = e.dtype;
+    t.shape = mt->shape.data();
+    t.strides = nullptr;
+    t.byte_offset = 0;
+    data_entry_[eid] = NDArray::FromDLPack(&mt->tensor);
+    for (DLTensor* arg : input_dltensors_[eid]) {
+      arg->data = t.data;
+    }
+    bound = true;
+  }
+  if (bound) {
+    // Release the pool entries no longer viewed by any data entry.
+    for (NDArray& storage : storage_pool_) {
+      if (storage.defined() && storage.use_count() == 1) storage = NDArray();
+    }
+  }
+}
+
 void GraphRuntime::LoadParams(dmlc::Stream* strm) {
   uint64_t header, reserved;
   CHECK(strm->Read(&header))
@@ -208,6 +493,8 @@ void GraphRuntime::LoadParams(dmlc::Stream* strm) {
     CHECK_GE(in_idx, 0) << "Found param for non-existent input: " << names[i];
     uint32_t eid = this->entry_id(input_nodes_[in_idx], 0);
     CHECK_LT(eid, data_entry_.size());
+    CHECK_EQ(shared_entries_.count(eid), 0U)
+        << "Param " << names[i] << " is shared and read-only";
 
     // The data_entry is allocated on device, NDArray.load always load the array into CPU.
     NDArray temp;
@@ -244,17 +531,37 @@ void GraphRuntime::ShareParams(const GraphRuntime& other, dmlc::Stream* strm) {
   this->SetupOpExecs();
 }
 
-void GraphRuntime::SetupStorage() {
+void GraphRuntime::SetupStorage(const std::unordered_map<std::string, NDArray>& shared_params) {
   // Grab saved optimization plan from graph.
   std::vector<DLDataType> vtype;
   for (const std::string& s_type : attrs_.dltype) {
     vtype.push_back(tvm::runtime::String2DLDataType(s_type));
   }
 
+  // Entries bound to shared arrays take no space in the pool.
+  std::unordered_map<uint32_t, NDArray> shared_arrays;
+  for (const auto& kv : shared_params) {
+    int in_idx = GetInputIndex(kv.first);
+    CHECK_GE(in_idx, 0) << "Found shared param for non-existent input: " << kv.first;
+    uint32_t eid = this->entry_id(input_nodes_[in_idx], 0);
+    const DLTensor* t = kv.second.operator->();
+    CHECK_EQ(static_cast<size_t>(t->ndim), attrs_.shape[eid].size())
+        << "Shape mismatch of shared param " << kv.first;
+    for (int i = 0; i < t->ndim; ++i) {
+      CHECK_EQ(t->shape[i], attrs_.shape[eid][i]) << "Shape mismatch of shared param " << kv.first;
+    }
+    CHECK(t->dtype.code == vtype[eid].code && t->dtype.bits == vtype[eid].bits &&
+          t->dtype.lanes == vtype[eid].lanes)
+        << "Data type mismatch of shared param " << kv.first;
+    shared_arrays[eid] = kv.second;
+    shared_entries_.insert(eid);
+  }
+
   // Size and device type of each storage pool entry.
   std::vector<PoolEntry> pool_entry;
   // Find the maximum space size.
   for (size_t i = 0; i < attrs_.shape.size(); ++i) {
+    if (shared_arrays.count(i)) continue;
     int storage_id = attrs_.storage_id[i];
     // Use the fallback device if no device index is available.
     int device_type = static_cast<int>(ctxs_[0].device_type);
@@ -270,6 +577,11 @@ void GraphRuntime::SetupStorage() {
     size_t bits = t.bits * t.lanes;
     CHECK(bits % 8U ==  0U || bits ==1U);
     size_t bytes = ((bits + 7U) / 8U) * size;
+    // Entries planned at an offset need the storage up to their end.
+    if (!attrs_.storage_offset.empty()) {
+      CHECK_GE(attrs_.storage_offset[i], 0);
+      bytes += static_cast<size_t>(attrs_.storage_offset[i]);
+    }
 
     uint32_t sid = static_cast<uint32_t>(storage_id);
     if (sid >= pool_entry.size()) {
@@ -285,6 +597,11 @@ void GraphRuntime::SetupStorage() {
 
   // Allocate the space.
   for (const auto& pit : pool_entry) {
+    if (pit.device_type == -1) {
+      // Only used by shared entries.
+      storage_pool_.push_back(NDArray());
+      continue;
+    }
     std::vector<int64_t> shape;
     // This for loop is very fast since there are usually only a couple of
     // devices available on the same hardware.
@@ -304,10 +621,21 @@ void GraphRuntime::SetupStorage() {
   data_entry_.resize(num_node_entries());
   data_alignment_.resize(num_node_entries());
   for (size_t i = 0; i < data_entry_.size(); ++i) {
-    int storage_id = attrs_.storage_id[i];
-    CHECK_LT(static_cast<size_t>(storage_id), storage_pool_.size());
-    data_entry_[i] =
-        storage_pool_[storage_id].CreateView(attrs_.shape[i], vtype[i]);
+    auto it = shared_arrays.find(i);
+    if (it != shared_arrays.end()) {
+      data_entry_[i] = it->second;
+    } else {
+      int storage_id = attrs_.storage_id[i];
+      CHECK_LT(static_cast<size_t>(storage_id), storage_pool_.size());
+      int64_t offset = attrs_.storage_offset.empty() ? 0 : attrs_.storage_offset[i];
+      if (offset == 0) {
+        data_entry_[i] =
+            storage_pool_[storage_id].CreateView(attrs_.shape[i], vtype[i]);
+      } else {
+        data_entry_[i] = CreateOffsetView(storage_pool_[storage_id], offset,
+                                          attrs_.shape[i], vtype[i]);
+      }
+    }
     const DLTensor* tmp = data_entry_[i].operator->();
     data_alignment_[i] = details::GetDataAlignment(*tmp);
   }
@@ -315,6 +643,8 @@ void GraphRuntime::SetupStorage() {
 
 void GraphRuntime::SetupOpExecs() {
   op_execs_.resize(this->GetNumOfNodes());
+  call_table_.clear();
+  input_dltensors_.clear();
   input_dltensors_.resize(num_node_entries());
   std::unordered_set<uint32_t> input_node_eids;
   for (size_t i = 0; i < input_nodes_.size(); i++) {
@@ -340,6 +670,13 @@ void GraphRuntime::SetupOpExecs() {
     std::shared_ptr<OpArgs> op_args = nullptr;
     std::tie(op_execs_[nid], op_args) =
         CreateTVMOp(inode.param, args, inode.inputs.size());
+    if (inode.param.func_name != "__nop") {
+      call_table_.push_back({op_args->packed_cfunc,
+                             op_args->arg_values.data(),
+                             op_args->arg_tcodes.data(),
+                             static_cast<int>(op_args->arg_values.size()),
+                             nid});
+    }
 
     for (size_t i = 0; i < inode.inputs.size(); i++) {
       uint32_t eid = this->entry_id(inode.inputs[i]);
@@ -393,6 +730,7 @@ std::pair<std::function<void()>, std::shared_ptr<GraphRuntime::OpArgs> > GraphRu
   // code.
   tvm::runtime::PackedFunc pf = module_.GetFunction(param.func_name, true);
   CHECK(pf != nullptr) << "no such function in module: " << param.func_name;
+  arg_ptr->packed_cfunc = GetWrappedPackedCFunc(pf);
 
   auto fexec = [arg_ptr, pf]() {
     TVMRetValue rv;
@@ -457,6 +795,18 @@ PackedFunc GraphRuntime::GetFunction(
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
         this->LoadParams(args[0].operator std::string());
       });
+  } else if (name == "set_inter_op_threads") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        this->SetInterOpThreads(args[0]);
+      });
+  } else if (name == "use_call_table") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        this->UseCallTable(args[0]);
+      });
+  } else if (name == "load_params_mmap") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        this->LoadParamsMmap(args[0]);
+      });
   } else if (name == "share_params") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
         const auto& module = args[0].operator Module();
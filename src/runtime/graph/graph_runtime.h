@@ -28,15 +28,19 @@
 #include <dlpack/dlpack.h>
 #include <dmlc/memory_io.h>
 #include <dmlc/json.h>
+#include <tvm/runtime/c_backend_api.h>
 #include <tvm/runtime/ndarray.h>
 #include <tvm/runtime/packed_func.h>
 
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 #include <string>
 
+#include "dataflow_executor.h"
+
 namespace tvm {
 namespace runtime {
 
@@ -50,6 +54,14 @@ namespace runtime {
 
 /*! \brief Magic number for NDArray list file  */
 constexpr uint64_t kTVMNDArrayListMagic = 0xF7E58D4F05049CB7;
+/*!
+ * \brief Magic number for NDArray list file whose tensor payloads are aligned.
+ *
+ *  The header lists the name, dtype, shape, file offset and byte size of every
+ *  tensor; the payloads follow, each starting at a multiple of the alignment
+ *  recorded in the header, so the file can be memory-mapped and used in place.
+ */
+constexpr uint64_t kTVMAlignedNDArrayListMagic = 0xF7E58D4F05049CB8;
 
 /*! \brief operator attributes about tvm op */
 struct TVMOpParam {
@@ -71,6 +83,21 @@ class TVM_DLL GraphRuntime : public ModuleNode {
     std::vector<TVMValue> arg_values;
     std::vector<int> arg_tcodes;
     std::vector<int64_t> shape_data;
+    /*! \brief The raw function behind the op, nullptr if there is none. */
+    TVMBackendPackedCFunc packed_cfunc{nullptr};
+  };
+  /*!
+   * \brief A prepacked call of one op in the call table.
+   *
+   *  The argument arrays belong to the OpArgs kept alive by op_execs_.
+   */
+  struct CallRecord {
+    /*! \brief The raw function, nullptr to run op_execs_[nid] instead. */
+    TVMBackendPackedCFunc packed_cfunc;
+    TVMValue* arg_values;
+    int* arg_tcodes;
+    int num_args;
+    uint32_t nid;
   };
 
  public:
@@ -90,6 +117,50 @@ class TVM_DLL GraphRuntime : public ModuleNode {
     return "GraphRuntime";
   }
   void Run();
+  /*!
+   * \brief Run independent operations concurrently on several threads.
+   *
+   *  Run() then executes each operator once the operators it depends on are
+   *  done, either through data or through storage reused by the memory plan,
+   *  and takes precedence over the call table. Each thread limits the parallel
+   *  launches of its operators to an equal share of the thread pool.
+   * \param num_threads The number of threads including the caller of Run(),
+   *  1 or less to run the operators one by one.
+   */
+  void SetInterOpThreads(int num_threads);
+  /*!
+   * \brief Run the operations of the nodes in [begin, end) one by one.
+   * \param begin The first node.
+   * \param end The node after the last one.
+   */
+  void RunNodes(uint32_t begin, uint32_t end);
+  /*!
+   * \brief Split the nodes into contiguous stages running on one device each.
+   *
+   *  A stage starts at every operator whose outputs live on another device
+   *  than the outputs of the previous operator.
+   * \return The first node of each stage, starting with 0.
+   */
+  std::vector<uint32_t> DeviceStages() const;
+  /*!
+   * \brief Get the context of a node's outputs.
+   * \param nid The node.
+   * \return The context.
+   */
+  TVMContext NodeContext(uint32_t nid) const {
+    return data_entry_[entry_id(nid, 0)]->ctx;
+  }
+  /*!
+   * \brief Enable or disable the call table execution mode.
+   *
+   *  In this mode Run() walks a flat array of prepacked calls, invoking the
+   *  raw TVMBackendPackedCFunc of each op directly instead of going through
+   *  its PackedFunc. Ops without a raw function keep using their executor.
+   * \param enable Whether to use the call table.
+   */
+  void UseCallTable(bool enable) {
+    use_call_table_ = enable;
+  }
 
   /*!
    * \brief Initialize the graph executor with graph and context.
@@ -98,11 +169,15 @@ class TVM_DLL GraphRuntime : public ModuleNode {
    *  processor.
    * \param ctxs The context of the host and devices where graph nodes will be
    *  executed on.
+   * \param shared_params Arrays bound to the inputs of the same name in place of
+   *  storage of this runtime, e.g. weights shared by several runtimes. They are
+   *  read-only through this runtime.
    */
 
   void Init(const std::string& graph_json,
             tvm::runtime::Module module,
-            const std::vector<TVMContext>& ctxs);
+            const std::vector<TVMContext>& ctxs,
+            const std::unordered_map<std::string, NDArray>& shared_params = {});
 
   /*!
    * \brief Get the input index given the name of input.
@@ -159,6 +234,17 @@ class TVM_DLL GraphRuntime : public ModuleNode {
    * \param param_blob A binary blob of parameter.
    */
   void LoadParams(const std::string& param_blob);
+  /*!
+   * \brief Load parameters by memory-mapping a parameter file.
+   *
+   *  For a file with aligned payloads, the parameters living on CPU are bound
+   *  to the mapped pages instead of being copied, and their storage is
+   *  released. The mapping is private, so the pages are shared through the page
+   *  cache by every process mapping the same file until one of them writes.
+   *  Files in the plain format are loaded by copying.
+   * \param path The path of the parameter file.
+   */
+  void LoadParamsMmap(const std::string& path);
 
   /*!
    * \brief Share parameters from pre-existing GraphRuntime instance.
@@ -272,6 +358,7 @@ class TVM_DLL GraphRuntime : public ModuleNode {
   struct GraphAttr {
     size_t storage_num_not_alloctaed{0};
     std::vector<int> storage_id;
+    std::vector<int64_t> storage_offset;
     std::vector<int> device_index;
     std::vector<std::string> dltype;
     std::vector<std::vector<int64_t> > shape;
@@ -308,6 +395,14 @@ class TVM_DLL GraphRuntime : public ModuleNode {
           reader->Read(&shape);
           CHECK(!reader->NextArrayItem());
           bitmask |= 4;
+        } else if (key == "storage_offset") {
+          reader->BeginArray();
+          CHECK(reader->NextArrayItem());
+          reader->Read(&type);
+          CHECK_EQ(type, "list_int");
+          CHECK(reader->NextArrayItem());
+          reader->Read(&storage_offset);
+          CHECK(!reader->NextArrayItem());
         } else if (key == "device_index") {
           reader->BeginArray();
           CHECK(reader->NextArrayItem());
@@ -366,10 +461,30 @@ class TVM_DLL GraphRuntime : public ModuleNode {
       }
       CHECK_EQ(bitmask, 1|2|4|8|16) << "invalid format";
   }
-  /*! \brief Setup the temporal storage */
-  void SetupStorage();
+  /*!
+   * \brief Setup the temporal storage
+   * \param shared_params The arrays to bind the inputs of the same name to.
+   */
+  void SetupStorage(const std::unordered_map<std::string, NDArray>& shared_params = {});
+  /*!
+   * \brief Create a view of a storage pool entry starting at an offset.
+   * \param storage The storage pool entry.
+   * \param offset The offset of the view in bytes.
+   * \param shape The shape of the view.
+   * \param dtype The data type of the view.
+   * \return The view, keeping the storage alive.
+   */
+  static NDArray CreateOffsetView(const NDArray& storage, int64_t offset,
+                                  const std::vector<int64_t>& shape, DLDataType dtype);
   /*! \brief Setup the executors. */
   void SetupOpExecs();
+  /*!
+   * \brief Load the parameters of an aligned parameter blob.
+   * \param data The start of the blob.
+   * \param size The size of the blob in bytes.
+   * \param mapping The mapping owning the blob, nullptr to copy every parameter.
+   */
+  void LoadAlignedParams(const char* data, size_t size, std::shared_ptr<void> mapping);
   /*!
    * \brief Create an execution function given input.
    * \param attrs The node attributes.
@@ -416,8 +531,16 @@ class TVM_DLL GraphRuntime : public ModuleNode {
   std::vector<NDArray> data_entry_;
   /*! \brief Data alignment of each node. */
   std::vector<size_t> data_alignment_;
+  /*! \brief Entries bound to arrays shared with other runtimes. */
+  std::unordered_set<uint32_t> shared_entries_;
   /*! \brief Operator on each node. */
   std::vector<std::function<void()> > op_execs_;
+  /*! \brief Prepacked calls of all the ops, in execution order. */
+  std::vector<CallRecord> call_table_;
+  /*! \brief Whether Run() uses call_table_. */
+  bool use_call_table_{false};
+  /*! \brief The executor of inter-op parallel runs, nullptr to run serially. */
+  std::shared_ptr<DataflowExecutor> dataflow_;
 };
 
 std::vector<TVMContext> GetAllContext(const TVMArgs& args);
@@ -0,0 +1,387 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file graph_runtime_pipeline.cc
+ * \brief Pipelined execution of a graph split into stages.
+ */
+#include <tvm/runtime/device_api.h>
+#include <tvm/runtime/packed_func.h>
+#include <tvm/runtime/registry.h>
+#include <dmlc/memory_io.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "graph_runtime.h"
+
+namespace tvm {
+namespace runtime {
+
+/*!
+ * \brief A blocking FIFO queue of bounded capacity.
+ * \tparam T The element type.
+ */
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity) : capacity_(capacity) {}
+  /*!
+   * \brief Push an element, waiting while the queue is full.
+   * \param value The element.
+   */
+  void Push(T value) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return queue_.size() < capacity_; });
+    queue_.push_back(std::move(value));
+    not_empty_.notify_one();
+  }
+  /*!
+   * \brief Pop the oldest element, waiting while the queue is empty.
+   * \return The element.
+   */
+  T Pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return !queue_.empty(); });
+    T value = std::move(queue_.front());
+    queue_.pop_front();
+    not_full_.notify_one();
+    return value;
+  }
+
+ private:
+  size_t capacity_;
+  std::deque<T> queue_;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+};
+
+/*!
+ * \brief Pipelined executor of a graph.
+ *
+ *  The nodes are split into contiguous stages, by default at device
+ *  boundaries, each run by its own thread. Stages are connected by bounded
+ *  queues, so stage 0 of a request overlaps with stage 1 of the previous one.
+ *  Since the memory plan of a graph assumes serial execution, every request
+ *  in flight runs on its own GraphRuntime, all of them sharing the loaded
+ *  parameters. Requests complete in submission order.
+ */
+class GraphRuntimePipeline : public ModuleNode {
+ public:
+  /*!
+   * \brief Create a pipeline.
+   * \param graph_json The execution graph.
+   * \param module The module containing the compiled functions.
+   * \param ctxs The context of the host and devices.
+   * \param max_in_flight The maximum number of requests in flight, 0 for twice
+   *  the number of stages.
+   * \param stage_begins The first node of every stage but the first one, empty
+   *  to split at device boundaries.
+   */
+  GraphRuntimePipeline(const std::string& graph_json,
+                       tvm::runtime::Module module,
+                       const std::vector<TVMContext>& ctxs,
+                       int max_in_flight,
+                       std::vector<uint32_t> stage_begins)
+      : graph_json_(graph_json), module_(module), ctxs_(ctxs) {
+    CHECK_GE(max_in_flight, 0);
+    ObjectPtr<GraphRuntime> first = CreateRuntime(params_);
+    if (stage_begins.empty()) {
+      stage_begins = first->DeviceStages();
+    } else {
+      stage_begins.insert(stage_begins.begin(), 0);
+    }
+    stage_begins.push_back(first->GetNumOfNodes());
+    for (size_t i = 0; i + 1 < stage_begins.size(); ++i) {
+      CHECK_LT(stage_begins[i], stage_begins[i + 1])
+          << "The stages must be given as increasing node ids";
+      CHECK_LE(stage_begins[i + 1], first->GetNumOfNodes());
+      Stage stage;
+      stage.begin = stage_begins[i];
+      stage.end = stage_begins[i + 1];
+      for (uint32_t nid = stage.begin; nid < stage.end; ++nid) {
+        TVMContext ctx = first->NodeContext(nid);
+        auto it = std::find_if(stage.ctxs.begin(), stage.ctxs.end(), [&ctx](const TVMContext& c) {
+            return c.device_type == ctx.device_type && c.device_id == ctx.device_id;
+          });
+        if (it == stage.ctxs.end()) stage.ctxs.push_back(ctx);
+      }
+      stages_.push_back(stage);
+    }
+    size_t num_slots = max_in_flight > 0 ? max_in_flight : 2 * stages_.size();
+    runtimes_.push_back(first);
+    for (size_t i = 1; i < num_slots; ++i) {
+      runtimes_.push_back(CreateRuntime(params_));
+    }
+    errors_.resize(num_slots);
+    free_.reset(new BoundedQueue<int>(num_slots));
+    done_.reset(new BoundedQueue<int>(num_slots));
+    for (size_t i = 0; i < num_slots; ++i) {
+      free_->Push(static_cast<int>(i));
+    }
+    for (size_t i = 0; i < stages_.size(); ++i) {
+      queues_.emplace_back(new BoundedQueue<int>(num_slots));
+    }
+    for (size_t i = 0; i < stages_.size(); ++i) {
+      threads_.emplace_back([this, i] { this->StageLoop(i); });
+    }
+  }
+
+  ~GraphRuntimePipeline() {
+    // Requests already submitted drain through the stages before the sentinel.
+    queues_[0]->Push(-1);
+    for (std::thread& t : threads_) {
+      t.join();
+    }
+  }
+
+  const char* type_key() const final {
+    return "GraphRuntimePipeline";
+  }
+
+  PackedFunc GetFunction(const std::string& name,
+                         const ObjectPtr<Object>& sptr_to_self) final;
+
+  /*!
+   * \brief Load parameters shared by all the requests. No request may be in flight.
+   * \param param_blob A binary blob of parameter.
+   */
+  void LoadParams(const std::string& param_blob) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CHECK_EQ(num_in_flight_, 0) << "Cannot load parameters with requests in flight";
+    dmlc::MemoryStringStream strm(const_cast<std::string*>(&param_blob));
+    uint64_t header, reserved;
+    std::vector<std::string> names;
+    CHECK(strm.Read(&header) && strm.Read(&reserved) && strm.Read(&names))
+        << "Invalid parameters file format";
+    // Shared parameters are read-only, so a loader loads its own copy of the
+    // parameters in the blob, which outlive it in params_.
+    std::unordered_map<std::string, NDArray> kept = params_;
+    for (const std::string& name : names) {
+      kept.erase(name);
+    }
+    ObjectPtr<GraphRuntime> loader = CreateRuntime(kept);
+    loader->LoadParams(param_blob);
+    for (const std::string& name : names) {
+      int in_idx = loader->GetInputIndex(name);
+      CHECK_GE(in_idx, 0) << "Found param for non-existent input: " << name;
+      params_[name] = loader->GetInput(in_idx);
+    }
+    // Recreate the runtimes sharing the new parameters.
+    for (size_t i = 0; i < runtimes_.size(); ++i) {
+      runtimes_[i] = CreateRuntime(params_);
+    }
+  }
+
+  /*!
+   * \brief Submit a request, waiting while max_in_flight requests are in flight.
+   * \param args The inputs as name, value pairs.
+   */
+  void Submit(TVMArgs args) {
+    CHECK_EQ(args.num_args % 2, 0) << "The inputs must be given as name, value pairs";
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++num_in_flight_;
+    }
+    int slot = free_->Pop();
+    try {
+      GraphRuntime* rt = runtimes_[slot].get();
+      for (int i = 0; i < args.num_args; i += 2) {
+        int in_idx = rt->GetInputIndex(args[i]);
+        CHECK_GE(in_idx, 0) << "Cannot find input " << args[i].operator std::string();
+        rt->SetInput(in_idx, args[i + 1]);
+      }
+    } catch (const std::exception& e) {
+      errors_[slot] = e.what();
+    } catch (...) {
+      errors_[slot] = "unknown exception";
+    }
+    queues_[0]->Push(slot);
+  }
+
+  /*!
+   * \brief Wait for the oldest request and copy its outputs.
+   * \param args The arrays to copy the outputs to, in order, may be fewer than the outputs.
+   */
+  void Collect(TVMArgs args) {
+    int slot = done_->Pop();
+    std::string error;
+    std::swap(error, errors_[slot]);
+    if (error.empty()) {
+      try {
+        for (int i = 0; i < args.num_args; ++i) {
+          runtimes_[slot]->CopyOutputTo(i, args[i]);
+        }
+      } catch (const std::exception& e) {
+        error = e.what();
+      } catch (...) {
+        error = "unknown exception";
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --num_in_flight_;
+    }
+    free_->Push(slot);
+    if (!error.empty()) {
+      LOG(FATAL) << "Pipelined request failed: " << error;
+    }
+  }
+
+  /*! \return The number of stages. */
+  int NumStages() const {
+    return static_cast<int>(stages_.size());
+  }
+
+ private:
+  /*! \brief A contiguous range of nodes run by one thread. */
+  struct Stage {
+    uint32_t begin;
+    uint32_t end;
+    /*! \brief The contexts of the outputs of the nodes. */
+    std::vector<TVMContext> ctxs;
+  };
+
+  ObjectPtr<GraphRuntime> CreateRuntime(const std::unordered_map<std::string, NDArray>& params) {
+    auto rt = make_object<GraphRuntime>();
+    rt->Init(graph_json_, module_, ctxs_, params);
+    return rt;
+  }
+
+  void StageLoop(size_t index) {
+    const Stage& stage = stages_[index];
+    BoundedQueue<int>* next =
+        index + 1 < stages_.size() ? queues_[index + 1].get() : nullptr;
+    while (true) {
+      int slot = queues_[index]->Pop();
+      if (slot < 0) {
+        if (next != nullptr) next->Push(slot);
+        return;
+      }
+      if (errors_[slot].empty()) {
+        try {
+          runtimes_[slot]->RunNodes(stage.begin, stage.end);
+          // The next stage may run on another device, finish the work first.
+          for (const TVMContext& ctx : stage.ctxs) {
+            TVMSynchronize(ctx.device_type, ctx.device_id, nullptr);
+          }
+        } catch (const std::exception& e) {
+          errors_[slot] = e.what();
+        } catch (...) {
+          errors_[slot] = "unknown exception";
+        }
+      }
+      if (next != nullptr) {
+        next->Push(slot);
+      } else {
+        done_->Push(slot);
+      }
+    }
+  }
+
+  /*! \brief The execution graph. */
+  std::string graph_json_;
+  /*! \brief The module containing the compiled functions. */
+  tvm::runtime::Module module_;
+  /*! \brief Execution context of all devices including the host. */
+  std::vector<TVMContext> ctxs_;
+  /*! \brief The parameters shared by the runtimes. */
+  std::unordered_map<std::string, NDArray> params_;
+  /*! \brief The stages. */
+  std::vector<Stage> stages_;
+  /*! \brief The runtime of each request slot. */
+  std::vector<ObjectPtr<GraphRuntime> > runtimes_;
+  /*! \brief The error of the request in each slot, empty if none. */
+  std::vector<std::string> errors_;
+  /*! \brief The free slots. */
+  std::unique_ptr<BoundedQueue<int> > free_;
+  /*! \brief The input queue of each stage. */
+  std::vector<std::unique_ptr<BoundedQueue<int> > > queues_;
+  /*! \brief The slots of the completed requests, in submission order. */
+  std::unique_ptr<BoundedQueue<int> > done_;
+  /*! \brief The stage threads. */
+  std::vector<std::thread> threads_;
+  /*! \brief Protects num_in_flight_ and the parameters. */
+  std::mutex mutex_;
+  /*! \brief The number of requests submitted and not collected. */
+  int num_in_flight_{0};
+};
+
+PackedFunc GraphRuntimePipeline::GetFunction(
+    const std::string& name,
+    const ObjectPtr<Object>& sptr_to_self) {
+  if (name == "load_params") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        this->LoadParams(args[0].operator std::string());
+      });
+  } else if (name == "submit") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        this->Submit(args);
+      });
+  } else if (name == "collect") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        this->Collect(args);
+      });
+  } else if (name == "get_num_stages") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        *rv = this->NumStages();
+      });
+  } else {
+    return PackedFunc();
+  }
+}
+
+// Arguments: graph_json, module, max_in_flight, stage_begins, then the device
+// type and id of each context as in tvm.graph_runtime.create. stage_begins is
+// a comma separated list of node ids, empty to split at device boundaries.
+TVM_REGISTER_GLOBAL("tvm.graph_runtime.create_pipeline")
+  .set_body([](TVMArgs args, TVMRetValue* rv) {
+    CHECK_GE(args.num_args, 6)
+        << "The expected number of arguments for graph_runtime.create_pipeline is "
+           "at least 6, but it has "
+        << args.num_args;
+    std::vector<uint32_t> stage_begins;
+    std::istringstream is(args[3].operator std::string());
+    std::string item;
+    while (std::getline(is, item, ',')) {
+      if (!item.empty()) stage_begins.push_back(static_cast<uint32_t>(std::stoul(item)));
+    }
+    std::vector<TVMContext> ctxs;
+    for (int i = 4; i + 1 < args.num_args; i += 2) {
+      TVMContext ctx;
+      int dev_type = args[i];
+      ctx.device_type = static_cast<DLDeviceType>(dev_type);
+      ctx.device_id = args[i + 1];
+      ctxs.push_back(ctx);
+    }
+    auto pipeline = make_object<GraphRuntimePipeline>(
+        args[0], args[1], ctxs, args[2], stage_begins);
+    *rv = Module(pipeline);
+  });
+}  // namespace runtime
+}  // namespace tvm
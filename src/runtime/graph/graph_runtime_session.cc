@@ -0,0 +1,255 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file graph_runtime_session.cc
+ * \brief Serve concurrent requests of one graph with shared weights.
+ */
+#include <tvm/runtime/packed_func.h>
+#include <tvm/runtime/registry.h>
+#include <dmlc/memory_io.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "graph_runtime.h"
+
+namespace tvm {
+namespace runtime {
+
+/*!
+ * \brief A session serving concurrent requests of one graph.
+ *
+ *  The parameters loaded into the session are shared read-only by all its
+ *  requests. Each request acquires an arena, a GraphRuntime holding only the
+ *  activations and inputs, runs it from a single thread and releases it back
+ *  to the session, so the memory is roughly weights + k x activations for k
+ *  requests in flight.
+ */
+class GraphRuntimeSession : public ModuleNode {
+ public:
+  /*!
+   * \brief Create a session.
+   * \param graph_json The execution graph.
+   * \param module The module containing the compiled functions.
+   * \param ctxs The context of the host and devices.
+   * \param max_arenas The maximum number of arenas, requests wait for an
+   *  arena to be released beyond it. Zero for no limit.
+   */
+  GraphRuntimeSession(const std::string& graph_json,
+                      tvm::runtime::Module module,
+                      const std::vector<TVMContext>& ctxs,
+                      int max_arenas)
+      : graph_json_(graph_json), module_(module), ctxs_(ctxs), max_arenas_(max_arenas) {
+    CHECK_GE(max_arenas, 0);
+  }
+
+  const char* type_key() const final {
+    return "GraphRuntimeSession";
+  }
+
+  PackedFunc GetFunction(const std::string& name,
+                         const ObjectPtr<Object>& sptr_to_self) final;
+
+  /*!
+   * \brief Load parameters and share them with all the arenas.
+   *
+   *  No request may be in flight. Parameters loaded before are replaced by
+   *  new arrays rather than overwritten, as arenas never write shared arrays.
+   * \param param_blob A binary blob of parameter.
+   */
+  void LoadParams(const std::string& param_blob) {
+    std::vector<std::string> names = ReadParamNames(param_blob);
+    std::unique_lock<std::mutex> lock(mutex_);
+    CHECK(busy_.empty() && static_cast<size_t>(num_arenas_) == idle_.size())
+        << "Cannot load parameters with requests in flight";
+    // A loader shares the parameters the blob leaves alone and loads its own
+    // copy of the others, which outlive it in params_.
+    std::unordered_map<std::string, NDArray> kept = params_;
+    for (const std::string& name : names) {
+      kept.erase(name);
+    }
+    ObjectPtr<GraphRuntime> loader = CreateArena(kept);
+    loader->LoadParams(param_blob);
+    for (const std::string& name : names) {
+      int in_idx = loader->GetInputIndex(name);
+      CHECK_GE(in_idx, 0) << "Found param for non-existent input: " << name;
+      params_[name] = loader->GetInput(in_idx);
+    }
+    // Drop the arenas sharing the replaced parameters, they are created again
+    // sharing the new ones.
+    idle_.clear();
+    num_arenas_ = 0;
+  }
+
+  /*!
+   * \brief Acquire an arena for a request, waiting if max_arenas are in use.
+   * \return The arena, a GraphRuntime module.
+   */
+  Module Acquire() {
+    std::unordered_map<std::string, NDArray> params;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] {
+          return !idle_.empty() || max_arenas_ == 0 || num_arenas_ < max_arenas_;
+        });
+      if (!idle_.empty()) {
+        ObjectPtr<GraphRuntime> arena = idle_.back();
+        idle_.pop_back();
+        busy_.insert(arena.get());
+        return Module(arena);
+      }
+      ++num_arenas_;
+      params = params_;
+    }
+    // Create the arena outside of the lock, other requests need not wait for it.
+    ObjectPtr<GraphRuntime> arena;
+    try {
+      arena = CreateArena(params);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --num_arenas_;
+      cv_.notify_one();
+      throw;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    busy_.insert(arena.get());
+    return Module(arena);
+  }
+
+  /*!
+   * \brief Release an arena acquired from this session.
+   * \param arena The arena.
+   */
+  void Release(const Module& arena) {
+    const ModuleNode* node = arena.operator->();
+    std::lock_guard<std::mutex> lock(mutex_);
+    CHECK_EQ(busy_.erase(node), 1U) << "The arena was not acquired from this session";
+    idle_.push_back(GetObjectPtr<GraphRuntime>(
+        static_cast<GraphRuntime*>(const_cast<ModuleNode*>(node))));
+    cv_.notify_one();
+  }
+
+  /*! \return The number of arenas created and not dropped. */
+  int NumArenas() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_arenas_;
+  }
+
+ private:
+  /*!
+   * \brief Create an arena.
+   * \param params The parameters to share.
+   * \return The arena.
+   */
+  ObjectPtr<GraphRuntime> CreateArena(const std::unordered_map<std::string, NDArray>& params) {
+    auto arena = make_object<GraphRuntime>();
+    arena->Init(graph_json_, module_, ctxs_, params);
+    return arena;
+  }
+  /*!
+   * \brief Read the parameter names from the header of a parameter blob.
+   * \param param_blob The blob, in either format accepted by GraphRuntime::LoadParams.
+   * \return The names.
+   */
+  static std::vector<std::string> ReadParamNames(const std::string& param_blob) {
+    dmlc::MemoryStringStream strm(const_cast<std::string*>(&param_blob));
+    uint64_t header, reserved;
+    CHECK(strm.Read(&header) &&
+          (header == kTVMNDArrayListMagic || header == kTVMAlignedNDArrayListMagic))
+        << "Invalid parameters file format";
+    CHECK(strm.Read(&reserved))
+        << "Invalid parameters file format";
+    std::vector<std::string> names;
+    CHECK(strm.Read(&names))
+        << "Invalid parameters file format";
+    return names;
+  }
+
+  /*! \brief The execution graph. */
+  std::string graph_json_;
+  /*! \brief The module containing the compiled functions. */
+  tvm::runtime::Module module_;
+  /*! \brief Execution context of all devices including the host. */
+  std::vector<TVMContext> ctxs_;
+  /*! \brief The maximum number of arenas, zero for no limit. */
+  int max_arenas_;
+  /*! \brief The shared parameters. */
+  std::unordered_map<std::string, NDArray> params_;
+  /*! \brief Protects the members below, and params_ against LoadParams. */
+  std::mutex mutex_;
+  /*! \brief Signaled when an arena is released. */
+  std::condition_variable cv_;
+  /*! \brief The arenas ready for requests. */
+  std::vector<ObjectPtr<GraphRuntime> > idle_;
+  /*! \brief The arenas in use by requests. */
+  std::unordered_set<const ModuleNode*> busy_;
+  /*! \brief The number of arenas, idle, in use, or being created. */
+  int num_arenas_{0};
+};
+
+PackedFunc GraphRuntimeSession::GetFunction(
+    const std::string& name,
+    const ObjectPtr<Object>& sptr_to_self) {
+  if (name == "load_params") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        this->LoadParams(args[0].operator std::string());
+      });
+  } else if (name == "acquire") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        *rv = this->Acquire();
+      });
+  } else if (name == "release") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        this->Release(args[0]);
+      });
+  } else if (name == "get_num_arenas") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        *rv = this->NumArenas();
+      });
+  } else {
+    return PackedFunc();
+  }
+}
+
+// Arguments: graph_json, module, max_arenas, then the device type and id of
+// each context as in tvm.graph_runtime.create.
+TVM_REGISTER_GLOBAL("tvm.graph_runtime.create_session")
+  .set_body([](TVMArgs args, TVMRetValue* rv) {
+    CHECK_GE(args.num_args, 5)
+        << "The expected number of arguments for graph_runtime.create_session is "
+           "at least 5, but it has "
+        << args.num_args;
+    std::vector<TVMContext> ctxs;
+    for (int i = 3; i + 1 < args.num_args; i += 2) {
+      TVMContext ctx;
+      int dev_type = args[i];
+      ctx.device_type = static_cast<DLDeviceType>(dev_type);
+      ctx.device_id = args[i + 1];
+      ctxs.push_back(ctx);
+    }
+    auto sess = make_object<GraphRuntimeSession>(args[0], args[1], ctxs, args[2]);
+    *rv = Module(sess);
+  });
+}  // namespace runtime
+}  // namespace tvm
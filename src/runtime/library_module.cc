@@ -75,22 +75,45 @@ class ModuleInternal {
   }
 };
 
+/*! \brief The body of the packed functions made by WrapPackedFunc. */
+class PackedCFuncWrapper {
+ public:
+  PackedCFuncWrapper(TVMBackendPackedCFunc faddr, const ObjectPtr<Object>& sptr_to_self)
+      : faddr_(faddr), sptr_to_self_(sptr_to_self) {}
+
+  void operator()(TVMArgs args, TVMRetValue* rv) const {
+    TVMValue ret_value;
+    int ret_type_code = kTVMNullptr;
+    int ret = (*faddr_)(
+        const_cast<TVMValue*>(args.values),
+        const_cast<int*>(args.type_codes),
+        args.num_args,
+        &ret_value,
+        &ret_type_code);
+    CHECK_EQ(ret, 0) << TVMGetLastError();
+    if (ret_type_code != kTVMNullptr) {
+      *rv = TVMRetValue::MoveFromCHost(ret_value, ret_type_code);
+    }
+  }
+
+  TVMBackendPackedCFunc faddr() const {
+    return faddr_;
+  }
+
+ private:
+  TVMBackendPackedCFunc faddr_;
+  ObjectPtr<Object> sptr_to_self_;
+};
+
 PackedFunc WrapPackedFunc(TVMBackendPackedCFunc faddr,
                           const ObjectPtr<Object>& sptr_to_self) {
-  return PackedFunc([faddr, sptr_to_self](TVMArgs args, TVMRetValue* rv) {
-      TVMValue ret_value;
-      int ret_type_code = kTVMNullptr;
-      int ret = (*faddr)(
-          const_cast<TVMValue*>(args.values),
-          const_cast<int*>(args.type_codes),
-          args.num_args,
-          &ret_value,
-          &ret_type_code);
-      CHECK_EQ(ret, 0) << TVMGetLastError();
-      if (ret_type_code != kTVMNullptr) {
-        *rv = TVMRetValue::MoveFromCHost(ret_value, ret_type_code);
-      }
-    });
+  return PackedFunc(PackedCFuncWrapper(faddr, sptr_to_self));
+}
+
+TVMBackendPackedCFunc GetWrappedPackedCFunc(const PackedFunc& pf) {
+  PackedFunc::FType body = pf.body();
+  const PackedCFuncWrapper* wrapper = body.target<PackedCFuncWrapper>();
+  return wrapper == nullptr ? nullptr : wrapper->faddr();
 }
 
 void InitContextFunctions(std::function<void*(const char*)> fgetsymbol) {
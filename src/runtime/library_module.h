@@ -59,6 +59,15 @@ class Library : public Object {
  */
 PackedFunc WrapPackedFunc(TVMBackendPackedCFunc faddr, const ObjectPtr<Object>& mptr);
 
+/*!
+ * \brief Get the TVMBackendPackedCFunc behind a packed function made by WrapPackedFunc.
+ *
+ *  The function address stays valid as long as the packed function is alive.
+ * \param pf The packed function.
+ * \return The function address, nullptr if pf does not wrap one.
+ */
+TVMBackendPackedCFunc GetWrappedPackedCFunc(const PackedFunc& pf);
+
 /*!
  * \brief Utility to initialize conext function symbols during startup
  * \param fgetsymbol A symbol lookup function.
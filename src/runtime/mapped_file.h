@@ -0,0 +1,96 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ * 
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file mapped_file.h
+ * \brief Memory-mapped files and the tensors viewing them.
+ */
+#ifndef TVM_RUNTIME_MAPPED_FILE_H_
+#define TVM_RUNTIME_MAPPED_FILE_H_
+
+#include <dlpack/dlpack.h>
+#include <dmlc/logging.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+
+#ifndef _WIN32
+/*! \brief A private read-write mapping of a whole file, unmapped on destruction. */
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    CHECK_GE(fd, 0) << "Cannot open " << path << ": " << strerror(errno);
+    // close the descriptor on every exit, including a failed CHECK below
+    struct FileCloser {
+      int fd;
+      ~FileCloser() { close(fd); }
+    } closer{fd};
+    struct stat st;
+    CHECK_EQ(fstat(fd, &st), 0) << "Cannot stat " << path << ": " << strerror(errno);
+    size_ = static_cast<size_t>(st.st_size);
+    CHECK_GT(size_, 0U) << "Cannot mmap the empty file " << path;
+    // Private mapping: pages stay shared with the page cache until written to.
+    data_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    CHECK(data_ != MAP_FAILED) << "Cannot mmap " << path << ": " << strerror(err);
+  }
+  ~MappedFile() {
+    munmap(data_, size_);
+  }
+  const char* data() const {
+    return static_cast<const char*>(data_);
+  }
+  size_t size() const {
+    return size_;
+  }
+
+ private:
+  void* data_;
+  size_t size_;
+};
+#endif
+
+/*! \brief A DLPack tensor whose data lives in a buffer it keeps alive. */
+struct MappedTensor {
+  DLManagedTensor tensor;
+  std::vector<int64_t> shape;
+  std::shared_ptr<void> buffer;
+
+  static void Deleter(DLManagedTensor* self) {
+    delete static_cast<MappedTensor*>(self->manager_ctx);
+  }
+};
+
+}  // namespace runtime
+}  // namespace tvm
+#endif  // TVM_RUNTIME_MAPPED_FILE_H_
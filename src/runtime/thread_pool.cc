@@ -32,6 +32,7 @@
 #include <omp.h>
 #endif
 #include <thread>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <atomic>
@@ -49,6 +50,7 @@ namespace runtime {
 namespace {
 
 constexpr uint32_t kDefaultSpinCount = 300000;
+constexpr int kDefaultChunksPerWorker = 4;
 
 uint32_t GetSpinCount() {
   const char* val = getenv("TVM_THREAD_POOL_SPIN_COUNT");
@@ -58,11 +60,91 @@ uint32_t GetSpinCount() {
   return atoi(val);
 }
 
+bool GetWorkStealing() {
+  const char* val = getenv("TVM_THREAD_POOL_WORK_STEALING");
+  return val != nullptr && atoi(val) != 0;
+}
+
+int GetChunksPerWorker() {
+  const char* val = getenv("TVM_THREAD_POOL_CHUNKS_PER_WORKER");
+  if (!val || atoi(val) <= 0) {
+    return kDefaultChunksPerWorker;
+  }
+  return atoi(val);
+}
+
 }  // namespace
 
 // stride in the page, fit to cache line.
 constexpr int kSyncStride = 64 / sizeof(std::atomic<int>);
 
+/*!
+ * \brief A contiguous range of task ids owned by one worker.
+ *
+ *  The owner takes tasks from the front while idle workers steal from the back.
+ *  Both bounds are packed into one atomic word, so each side only needs a single
+ *  compare-and-swap and the range can only ever shrink until it is reset.
+ */
+class StealableTaskRange {
+ public:
+  /*!
+   * \brief Reset the range, must not be called while others access the range.
+   * \param begin The first task id in the range.
+   * \param end One past the last task id in the range.
+   */
+  void Reset(int32_t begin, int32_t end) {
+    range_.store(Pack(begin, end), std::memory_order_release);
+  }
+  /*!
+   * \brief Take the first task of the range, used by the owner.
+   * \param task_id The task id taken.
+   * \return Whether a task is taken.
+   */
+  bool PopFront(int32_t* task_id) {
+    uint64_t old = range_.load(std::memory_order_acquire);
+    while (Begin(old) < End(old)) {
+      if (range_.compare_exchange_weak(old, Pack(Begin(old) + 1, End(old)),
+                                       std::memory_order_acq_rel)) {
+        *task_id = Begin(old);
+        return true;
+      }
+    }
+    return false;
+  }
+  /*!
+   * \brief Take the last task of the range, used by the thieves.
+   * \param task_id The task id taken.
+   * \return Whether a task is taken.
+   */
+  bool StealBack(int32_t* task_id) {
+    uint64_t old = range_.load(std::memory_order_acquire);
+    while (Begin(old) < End(old)) {
+      if (range_.compare_exchange_weak(old, Pack(Begin(old), End(old) - 1),
+                                       std::memory_order_acq_rel)) {
+        *task_id = End(old) - 1;
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  static uint64_t Pack(int32_t begin, int32_t end) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(begin)) << 32) |
+        static_cast<uint64_t>(static_cast<uint32_t>(end));
+  }
+  static int32_t Begin(uint64_t range) {
+    return static_cast<int32_t>(range >> 32);
+  }
+  static int32_t End(uint64_t range) {
+    return static_cast<int32_t>(range & 0xFFFFFFFFUL);
+  }
+  // packed [begin, end) of the remaining tasks
+  std::atomic<uint64_t> range_{0};
+  // avoid false sharing between the ranges of different workers
+  char pad_[kL1CacheBytes - sizeof(std::atomic<uint64_t>)];
+};
+
 /*!
  * \brief Thread local master environment.
  */
@@ -77,14 +159,16 @@ class ParallelLauncher {
     this->cdata = cdata;
     this->flambda = flambda;
     this->env.num_task = num_task;
+    this->work_stealing = false;
     has_error_.store(false);
     // reshape
     if (static_cast<size_t>(num_task) > par_errors_.size()) {
       par_errors_.resize(num_task + 1);
-      if (need_sync) {
-        delete[] sync_counter_;
-        sync_counter_ = new std::atomic<int>[num_task * kSyncStride];
-      }
+    }
+    if (need_sync && num_task > num_sync_counter_) {
+      delete[] sync_counter_;
+      sync_counter_ = new std::atomic<int>[num_task * kSyncStride];
+      num_sync_counter_ = num_task;
     }
     if (need_sync) {
       for (int i = 0; i < num_task; ++i) {
@@ -96,6 +180,41 @@ class ParallelLauncher {
       this->env.sync_handle = nullptr;
     }
   }
+  /*!
+   * \brief Split the tasks into one stealable range per worker.
+   *  Must be called after Init, the pending count then tracks workers instead of tasks.
+   * \param num_workers The number of workers taking part in the launch.
+   */
+  void InitWorkStealing(int num_workers) {
+    if (num_workers > num_ranges_capacity_) {
+      ranges_.reset(new StealableTaskRange[num_workers]);
+      num_ranges_capacity_ = num_workers;
+    }
+    const int64_t num_task = this->env.num_task;
+    for (int i = 0; i < num_workers; ++i) {
+      ranges_[i].Reset(static_cast<int32_t>(num_task * i / num_workers),
+                       static_cast<int32_t>(num_task * (i + 1) / num_workers));
+    }
+    num_ranges_ = num_workers;
+    this->work_stealing = true;
+    num_pending_.store(num_workers);
+  }
+  /*!
+   * \brief Run the tasks of a worker's own range, then steal from the other workers
+   *  until every range is drained. The caller signals the finish of the worker.
+   * \param worker_slot The index of the range owned by the calling worker.
+   */
+  void RunWorkStealing(int worker_slot) {
+    int32_t task_id;
+    // ranges only shrink during a launch, so a failed scan means all tasks are taken.
+    while (ranges_[worker_slot].PopFront(&task_id) ||
+           StealTask(worker_slot, &task_id)) {
+      if ((*flambda)(task_id, &env, cdata) != 0) {
+        par_errors_[task_id] = TVMGetLastError();
+        has_error_.store(true);
+      }
+    }
+  }
   ~ParallelLauncher() {
     delete[] sync_counter_;
   }
@@ -125,29 +244,84 @@ class ParallelLauncher {
   void SignalJobFinish() {
     num_pending_.fetch_sub(1);
   }
-  // Get thread local version of the store.
-  static ParallelLauncher* ThreadLocal() {
-    return dmlc::ThreadLocalStore<ParallelLauncher>::Get();
-  }
   // The parallel lambda
   FTVMParallelLambda flambda;
   // The closure data
   void* cdata;
   // Local env
   TVMParallelGroupEnv env;
-  // Whether this thread is worker of the pool.
-  // used to prevent recursive launch.
-  bool is_worker{false};
+  // Whether the current launch uses the work-stealing schedule.
+  bool work_stealing{false};
+  // The ids of the pool workers claimed by the current launch.
+  std::vector<int> team;
 
  private:
+  // Steal one task from the back of another worker's range.
+  bool StealTask(int thief, int32_t* task_id) {
+    for (int k = 1; k < num_ranges_; ++k) {
+      if (ranges_[(thief + k) % num_ranges_].StealBack(task_id)) return true;
+    }
+    return false;
+  }
   // The pending jobs.
   std::atomic<int32_t> num_pending_;
   // Whether error has been countered.
   std::atomic<bool> has_error_;
   // The counter page.
   std::atomic<int32_t>* sync_counter_{nullptr};
+  // The number of tasks the counter page can host.
+  int num_sync_counter_{0};
   // The error message
   std::vector<std::string> par_errors_;
+  // The per-worker task ranges of the work-stealing schedule.
+  std::unique_ptr<StealableTaskRange[]> ranges_;
+  // The number of ranges used by the current launch.
+  int num_ranges_{0};
+  // The number of allocated ranges.
+  int num_ranges_capacity_{0};
+};
+
+/*!
+ * \brief Thread local stack of launchers, one per nesting level.
+ *
+ *  A task that launches a parallel job itself, either on a pool worker or on the
+ *  caller thread that runs task 0, gets a fresh launcher so that the enclosing
+ *  launch is left intact.
+ */
+class ParallelLauncherStack {
+ public:
+  /*! \brief RAII entry of one nesting level. */
+  class Scope {
+   public:
+    Scope() : stack_(ParallelLauncherStack::ThreadLocal()) {
+      if (stack_->depth_ == stack_->launchers_.size()) {
+        stack_->launchers_.emplace_back(new ParallelLauncher());
+      }
+      launcher_ = stack_->launchers_[stack_->depth_++].get();
+    }
+    ~Scope() {
+      --stack_->depth_;
+    }
+    ParallelLauncher* launcher() const {
+      return launcher_;
+    }
+
+   private:
+    ParallelLauncherStack* stack_;
+    ParallelLauncher* launcher_;
+  };
+  // Get thread local version of the store.
+  static ParallelLauncherStack* ThreadLocal() {
+    return dmlc::ThreadLocalStore<ParallelLauncherStack>::Get();
+  }
+  // The maximum team size of the launches of this thread, 0 for no limit.
+  int max_team_size{0};
+
+ private:
+  // The launchers of each nesting level.
+  std::vector<std::unique_ptr<ParallelLauncher> > launchers_;
+  // The current nesting level.
+  size_t depth_{0};
 };
 
 /*! \brief Lock-free single-producer-single-consumer queue for each thread */
@@ -213,6 +387,23 @@ class SpscTaskQueue {
     return true;
   }
 
+  /*!
+   * \brief Try to claim the worker behind this queue for one launch.
+   *  The claimer becomes the single producer until the worker releases the queue.
+   * \return Whether the queue is claimed by the caller.
+   */
+  bool TryClaim() {
+    return !claimed_.load(std::memory_order_relaxed) &&
+        !claimed_.exchange(true, std::memory_order_acquire);
+  }
+
+  /*!
+   * \brief Release the claim, called by the consumer once it has taken its task.
+   */
+  void Release() {
+    claimed_.store(false, std::memory_order_release);
+  }
+
   /*!
    * \brief Signal to terminate the worker.
    */
@@ -266,6 +457,10 @@ class SpscTaskQueue {
   // signal for exit now
   std::atomic<bool> exit_now_{false};
 
+  cache_line_pad_t pad5_;
+  // whether a launch owns the producer side of the queue
+  std::atomic<bool> claimed_{false};
+
   // internal mutex
   std::mutex mutex_;
   // cv for consumer
@@ -275,7 +470,47 @@ class SpscTaskQueue {
 // The thread pool
 class ThreadPool {
  public:
-  ThreadPool(): num_workers_(tvm::runtime::threading::MaxConcurrency()) {
+  /*! \brief The way tasks of a launch are assigned to workers. */
+  enum ScheduleMode : int {
+    /*! \brief One task per worker, pushed through the worker's queue. */
+    kStatic = 0,
+    /*!
+     * \brief Finer tasks in per-worker ranges that idle workers steal from,
+     *  so one slow core does not stall the whole parallel region.
+     */
+    kWorkStealing = 1,
+  };
+
+  /*!
+   * \brief The configuration a launch runs with.
+   *  A configuration is never modified once published, so a launch reads one
+   *  consistent snapshot while another thread reconfigures the pool.
+   */
+  struct Config {
+    // number of workers used (can be restricted with affinity pref)
+    int num_workers_used{0};
+    // how tasks are assigned to workers
+    ScheduleMode schedule_mode{kStatic};
+    // number of tasks per used worker when the work-stealing launch picks the task count
+    int chunks_per_worker{1};
+    // whether launches use a team of the caller's NUMA node
+    bool numa_teams{false};
+    // the NUMA node of each worker, -1 if not bound to one
+    std::vector<int> worker_nodes;
+    // the number of used workers of each NUMA node
+    std::vector<int> node_num_workers;
+  };
+
+  ThreadPool()
+      : num_workers_(tvm::runtime::threading::MaxConcurrency()) {
+    std::shared_ptr<Config> config = std::make_shared<Config>();
+    config->schedule_mode = GetWorkStealing() ? kWorkStealing : kStatic;
+    config->chunks_per_worker = GetChunksPerWorker();
+    config_ = config;
+    busy_ns_.reset(new std::atomic<int64_t>[num_workers_ + 1]);
+    for (int i = 0; i <= num_workers_; ++i) {
+      busy_ns_[i].store(0);
+    }
     for (int i = 0; i < num_workers_; ++i) {
       // The SpscTaskQueue only hosts ONE item at a time
       queues_.emplace_back(std::unique_ptr<SpscTaskQueue>(new SpscTaskQueue()));
@@ -288,7 +523,7 @@ class ThreadPool {
         new tvm::runtime::threading::ThreadGroup(
           num_workers_, [this](int worker_id) { this->RunWorker(worker_id); },
           exclude_worker0_ /* include_main_thread */));
-    num_workers_used_ = threads_->Configure(threading::ThreadGroup::kBig, 0, exclude_worker0_);
+    UpdateWorkerConfiguration(threading::ThreadGroup::kBig, 0);
   }
   ~ThreadPool() {
     for (std::unique_ptr<SpscTaskQueue>& q : queues_) {
@@ -300,89 +535,276 @@ class ThreadPool {
              void* cdata,
              int num_task,
              int need_sync) {
-    ParallelLauncher* launcher = ParallelLauncher::ThreadLocal();
-    CHECK(!launcher->is_worker)
-        << "Cannot launch parallel job inside worker, consider fuse then parallel";
+    ParallelLauncherStack::Scope scope;
+    ParallelLauncher* launcher = scope.launcher();
+    std::shared_ptr<const Config> config = std::atomic_load(&config_);
+    int num_workers_used = config->num_workers_used;
+    int max_team = num_task == 0 ? num_workers_used : std::min(num_task, num_workers_used);
+    int max_team_size = ParallelLauncherStack::ThreadLocal()->max_team_size;
+    if (max_team_size > 0) {
+      max_team = std::min(max_team, max_team_size);
+    }
+    // a caller bound to a NUMA node only uses the workers of its node
+    int node = config->numa_teams ? threading::CurrentNumaNode() : -1;
+    if (node >= static_cast<int>(config->node_num_workers.size())) node = -1;
+    if (node >= 0) {
+      max_team = std::min(max_team, config->node_num_workers[node]);
+    }
+    ClaimTeam(*config, max_team - exclude_worker0_, node, &(launcher->team));
+    // the caller runs the first slot when worker 0 is excluded or no worker is idle
+    int caller_slot = exclude_worker0_ || launcher->team.empty();
+    int team_size = static_cast<int>(launcher->team.size()) + caller_slot;
+    if (config->schedule_mode == kWorkStealing) {
+      return LaunchWorkStealing(launcher, flambda, cdata, num_task, caller_slot,
+                                config->chunks_per_worker);
+    }
     if (num_task == 0) {
-      num_task = num_workers_used_;
+      num_task = team_size;
     }
     if (need_sync != 0) {
-      CHECK_LE(num_task, num_workers_used_)
+      CHECK_LE(num_task, num_workers_used)
           << "Request parallel sync task larger than number of threads used "
-          << " workers=" << num_workers_used_ << " request=" << num_task;
+          << " workers=" << num_workers_used << " request=" << num_task;
     }
     launcher->Init(flambda, cdata, num_task, need_sync != 0);
     SpscTaskQueue::Task tsk;
     tsk.launcher = launcher;
-    // if worker0 is taken by the master, queues_[0] is abandoned
-    for (int i = exclude_worker0_; i < num_task; ++i) {
-      tsk.task_id = i;
-      queues_[i]->Push(tsk);
-    }
-    // use the master thread to run task 0
-    if (exclude_worker0_) {
-      TVMParallelGroupEnv* penv = &(tsk.launcher->env);
-      if ((*tsk.launcher->flambda)(0, penv, cdata) == 0) {
-        tsk.launcher->SignalJobFinish();
-      } else {
-        tsk.launcher->SignalJobError(tsk.task_id);
+    for (size_t i = 0; i < launcher->team.size(); ++i) {
+      tsk.task_id = static_cast<int32_t>(i) + caller_slot;
+      queues_[launcher->team[i]]->Push(tsk);
+    }
+    int first_task = caller_slot ? 0 : team_size;
+    // The barrier needs every task to run concurrently. When nested or
+    // concurrent launches left too few idle workers, the tasks no worker was
+    // left for run on a private team, as they did when each caller had its own pool.
+    std::vector<std::thread> private_team;
+    if (need_sync != 0) {
+      for (int task_id = std::max(team_size, first_task + 1); task_id < num_task; ++task_id) {
+        private_team.emplace_back([this, launcher, task_id]() {
+          RunTask(launcher, task_id);
+        });
       }
     }
+    // the caller runs its own slot, and without a barrier the tasks no worker was left for
+    for (int task_id = first_task; task_id < num_task;
+         task_id = private_team.empty() ? std::max(task_id + 1, team_size) : num_task) {
+      RunTask(launcher, task_id);
+    }
     int res = launcher->WaitForJobs();
+    for (std::thread& t : private_team) {
+      t.join();
+    }
     return res;
   }
 
-  static ThreadPool* ThreadLocal() {
-    return dmlc::ThreadLocalStore<ThreadPool>::Get();
+  static ThreadPool* Global() {
+    static ThreadPool inst;
+    return &inst;
   }
 
   void UpdateWorkerConfiguration(threading::ThreadGroup::AffinityMode mode, int nthreads) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    std::shared_ptr<Config> config = std::make_shared<Config>(*config_);
     // this will also reset the affinity of the ThreadGroup
     // may use less than the MaxConcurrency number of workers
-    num_workers_used_ = threads_->Configure(mode, nthreads,
-                                            exclude_worker0_);
+    config->num_workers_used = threads_->Configure(mode, nthreads,
+                                                   exclude_worker0_);
     // if MaxConcurrency restricted the number of workers (e.g., due to
     // hyperthreading), respect the restriction
-    num_workers_used_ = std::min(num_workers_, num_workers_used_);
+    config->num_workers_used = std::min(num_workers_, config->num_workers_used);
+    config->worker_nodes = threads_->WorkerNumaNodes();
+    config->numa_teams = mode == threading::ThreadGroup::kNumaNode;
+    // the worker 0 slot of each node counts for the caller thread running there
+    for (int i = 0; i < config->num_workers_used; ++i) {
+      int node = config->worker_nodes[i];
+      if (node < 0) continue;
+      if (node >= static_cast<int>(config->node_num_workers.size())) {
+        config->node_num_workers.resize(node + 1, 0);
+      }
+      ++config->node_num_workers[node];
+    }
+    std::atomic_store(&config_, std::shared_ptr<const Config>(config));
+  }
+
+  void SetTaskProfiling(bool enable) {
+    profile_tasks_.store(enable, std::memory_order_relaxed);
+  }
+
+  std::vector<int64_t> TaskBusyTime() const {
+    std::vector<int64_t> busy(num_workers_ + 1);
+    for (int i = 0; i <= num_workers_; ++i) {
+      busy[i] = busy_ns_[i].load(std::memory_order_relaxed);
+    }
+    return busy;
+  }
+
+  void UpdateScheduleConfiguration(ScheduleMode mode, int chunks_per_worker) {
+    CHECK(mode == kStatic || mode == kWorkStealing)
+        << "Unknown thread pool schedule mode " << static_cast<int>(mode);
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    std::shared_ptr<Config> config = std::make_shared<Config>(*config_);
+    config->schedule_mode = mode;
+    if (chunks_per_worker > 0) {
+      config->chunks_per_worker = chunks_per_worker;
+    }
+    std::atomic_store(&config_, std::shared_ptr<const Config>(config));
   }
 
  private:
+  // Run f, adding its duration to the busy time of the slot when profiling.
+  template <typename F>
+  void RunTimed(int slot, F f) {
+    if (!profile_tasks_.load(std::memory_order_relaxed)) {
+      f();
+      return;
+    }
+    auto begin = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    busy_ns_[slot].fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count(),
+        std::memory_order_relaxed);
+  }
+  // Run one task of a launch on a thread other than a pool worker.
+  void RunTask(ParallelLauncher* launcher, int task_id) {
+    int res;
+    RunTimed(num_workers_, [&]() {
+      res = (*launcher->flambda)(task_id, &(launcher->env), launcher->cdata);
+    });
+    if (res == 0) {
+      launcher->SignalJobFinish();
+    } else {
+      launcher->SignalJobError(task_id);
+    }
+  }
+  // Claim up to max_size idle workers as the team of one launch.
+  // Workers busy with other callers or with enclosing launches are skipped,
+  // so concurrent and nested launches partition the pool instead of oversubscribing it.
+  // Only the workers of the given NUMA node are claimed unless node is -1.
+  void ClaimTeam(const Config& config, int max_size, int node, std::vector<int>* team) {
+    team->clear();
+    for (int i = exclude_worker0_;
+         i < config.num_workers_used && static_cast<int>(team->size()) < max_size; ++i) {
+      if (node >= 0 && config.worker_nodes[i] != node) continue;
+      if (queues_[i]->TryClaim()) {
+        team->push_back(i);
+      }
+    }
+  }
+  // Launch with the work-stealing schedule.
+  // TVMBackendParallelBarrier is not available as tasks may outnumber the workers.
+  int LaunchWorkStealing(ParallelLauncher* launcher,
+                         FTVMParallelLambda flambda,
+                         void* cdata,
+                         int num_task,
+                         int caller_slot,
+                         int chunks_per_worker) {
+    int team_size = static_cast<int>(launcher->team.size()) + caller_slot;
+    if (num_task == 0) {
+      num_task = team_size * chunks_per_worker;
+    }
+    launcher->Init(flambda, cdata, num_task, false);
+    launcher->InitWorkStealing(team_size);
+    SpscTaskQueue::Task tsk;
+    tsk.launcher = launcher;
+    // the task id of the queued entry is the range owned by the worker
+    for (size_t i = 0; i < launcher->team.size(); ++i) {
+      tsk.task_id = static_cast<int32_t>(i) + caller_slot;
+      queues_[launcher->team[i]]->Push(tsk);
+    }
+    if (caller_slot) {
+      RunTimed(num_workers_, [launcher]() { launcher->RunWorkStealing(0); });
+      launcher->SignalJobFinish();
+    }
+    return launcher->WaitForJobs();
+  }
   // Internal worker function.
   void RunWorker(int worker_id) {
     SpscTaskQueue* queue = queues_[worker_id].get();
     SpscTaskQueue::Task task;
-    ParallelLauncher::ThreadLocal()->is_worker = true;
     // Initialize the spin count (from envvar TVM_THREAD_POOL_SPIN_COUNT) on
     // the global first use of the ThreadPool.
     // TODO(tulloch): should we make this configurable via standard APIs?
     static size_t spin_count = GetSpinCount();
     while (queue->Pop(&task, spin_count)) {
       CHECK(task.launcher != nullptr);
-      TVMParallelGroupEnv* penv = &(task.launcher->env);
-      void* cdata = task.launcher->cdata;
-      if ((*task.launcher->flambda)(task.task_id, penv, cdata) == 0) {
-        task.launcher->SignalJobFinish();
+      ParallelLauncher* launcher = task.launcher;
+      int res = 0;
+      RunTimed(worker_id, [&]() {
+        if (launcher->work_stealing) {
+          launcher->RunWorkStealing(task.task_id);
+        } else {
+          res = (*launcher->flambda)(task.task_id, &(launcher->env), launcher->cdata);
+        }
+      });
+      // release before signaling, so the worker is idle again when the launch returns
+      queue->Release();
+      if (res == 0) {
+        launcher->SignalJobFinish();
       } else {
-        task.launcher->SignalJobError(task.task_id);
+        launcher->SignalJobError(task.task_id);
       }
     }
   }
   int num_workers_;
-  // number of workers used (can be restricted with affinity pref)
-  int num_workers_used_;
   // if or not to exclude worker 0 and use master to run task 0
   bool exclude_worker0_{true};
+  // the current configuration, only accessed with std::atomic_load/atomic_store
+  std::shared_ptr<const Config> config_;
+  // serializes the reconfigurations, launches never take it
+  std::mutex config_mutex_;
   std::vector<std::unique_ptr<SpscTaskQueue> > queues_;
+  // whether the time spent running tasks is accounted
+  std::atomic<bool> profile_tasks_{false};
+  // the nanoseconds each worker spent running tasks, the last slot for the callers
+  std::unique_ptr<std::atomic<int64_t>[]> busy_ns_;
   std::unique_ptr<tvm::runtime::threading::ThreadGroup> threads_;
 };
 
+namespace threading {
+int SetMaxTeamSize(int size) {
+  CHECK_GE(size, 0);
+  ParallelLauncherStack* stack = ParallelLauncherStack::ThreadLocal();
+  std::swap(stack->max_team_size, size);
+  return size;
+}
+
+void SetTaskProfiling(bool enable) {
+#if !TVM_THREADPOOL_USE_OPENMP
+  ThreadPool::Global()->SetTaskProfiling(enable);
+#endif
+}
+
+std::vector<int64_t> TaskBusyTime() {
+#if !TVM_THREADPOOL_USE_OPENMP
+  return ThreadPool::Global()->TaskBusyTime();
+#else
+  return {};
+#endif
+}
+}  // namespace threading
+
+TVM_REGISTER_GLOBAL("runtime.num_numa_nodes")
+.set_body_typed([]() {
+  return static_cast<int>(threading::NumaNodeCpus().size());
+});
+
+TVM_REGISTER_GLOBAL("runtime.bind_numa_node")
+.set_body_typed(threading::BindToNumaNode);
+
 TVM_REGISTER_GLOBAL("runtime.config_threadpool")
 .set_body([](TVMArgs args, TVMRetValue* rv) {
     threading::ThreadGroup::AffinityMode mode =\
     static_cast<threading::ThreadGroup::AffinityMode>(\
     static_cast<int>(args[0]));
     int nthreads = args[1];
-    ThreadPool::ThreadLocal()->UpdateWorkerConfiguration(mode, nthreads);
+    ThreadPool::Global()->UpdateWorkerConfiguration(mode, nthreads);
+    if (args.size() > 2) {
+      ThreadPool::ScheduleMode schedule =
+          static_cast<ThreadPool::ScheduleMode>(static_cast<int>(args[2]));
+      int chunks_per_worker = args.size() > 3 ? static_cast<int>(args[3]) : 0;
+      ThreadPool::Global()->UpdateScheduleConfiguration(schedule, chunks_per_worker);
+    }
 });
 
 
@@ -395,7 +817,7 @@ int TVMBackendParallelLaunch(
     void* cdata,
     int num_task) {
 #if !TVM_THREADPOOL_USE_OPENMP
-  int res = tvm::runtime::ThreadPool::ThreadLocal()->Launch(
+  int res = tvm::runtime::ThreadPool::Global()->Launch(
       flambda, cdata, num_task, 1);
   return res;
 #else
@@ -420,6 +842,9 @@ int TVMBackendParallelBarrier(int task_id, TVMParallelGroupEnv* penv) {
   int num_task = penv->num_task;
   std::atomic<int>* sync_counter =
       reinterpret_cast<std::atomic<int>*>(penv->sync_handle);
+  CHECK(sync_counter != nullptr)
+      << "TVMBackendParallelBarrier needs every task to run concurrently, which the"
+      << " work-stealing schedule does not provide";
   int old_counter = sync_counter[task_id * kSyncStride].fetch_add(
       1, std::memory_order_release);
   for (int i = 0; i < num_task; ++i) {
@@ -25,6 +25,9 @@
 #include <dmlc/logging.h>
 #include <thread>
 #include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
 #if defined(__linux__) || defined(__ANDROID__)
 #include <fstream>
 #include <sstream>
@@ -38,6 +41,31 @@ namespace tvm {
 namespace runtime {
 namespace threading {
 
+namespace {
+// Bumped whenever the affinity of a thread is changed,
+// invalidates the NUMA node cached by each thread.
+std::atomic<int> affinity_epoch{0};
+
+#if defined(__linux__) || defined(__ANDROID__)
+// Parse a sysfs id list such as "0-17,36-53".
+std::vector<unsigned int> ParseSysfsList(const std::string& list) {
+  std::vector<unsigned int> ret;
+  std::istringstream is(list);
+  std::string range;
+  while (std::getline(is, range, ',')) {
+    if (range.find_first_of("0123456789") == std::string::npos) continue;
+    size_t dash = range.find('-');
+    unsigned int begin = std::stoul(range.substr(0, dash));
+    unsigned int end = dash == std::string::npos ? begin : std::stoul(range.substr(dash + 1));
+    for (unsigned int i = begin; i <= end; ++i) {
+      ret.push_back(i);
+    }
+  }
+  return ret;
+}
+#endif
+}  // namespace
+
 class ThreadGroup::Impl {
  public:
   Impl(int num_workers,
@@ -50,6 +78,7 @@ class ThreadGroup::Impl {
       threads_.emplace_back([worker_callback, i] { worker_callback(i); });
     }
     InitSortedOrder();
+    InitNumaOrder();
   }
   ~Impl() { Join(); }
 
@@ -79,10 +108,13 @@ class ThreadGroup::Impl {
     // ones.
     num_workers_used = std::min(num_workers_, num_workers_used);
 
+    numa_bound_ = false;
     const char *val = getenv("TVM_BIND_THREADS");
     if (val == nullptr || atoi(val) == 1) {
-      // Do not set affinity if there are more workers than found cores
-      if (sorted_order_.size() >= static_cast<unsigned int>(num_workers_)) {
+      if (mode == kNumaNode) {
+        numa_bound_ = SetNumaAffinity(exclude_worker0);
+      } else if (sorted_order_.size() >= static_cast<unsigned int>(num_workers_)) {
+        // Do not set affinity if there are more workers than found cores
           SetAffinity(exclude_worker0, mode == kLittle);
       } else {
         LOG(WARNING)
@@ -93,6 +125,16 @@ class ThreadGroup::Impl {
     return num_workers_used;
   }
 
+  std::vector<int> WorkerNumaNodes() const {
+    std::vector<int> nodes(num_workers_, -1);
+    if (numa_bound_) {
+      for (int i = 0; i < num_workers_; ++i) {
+        nodes[i] = numa_order_nodes_[i];
+      }
+    }
+    return nodes;
+  }
+
  private:
   // bind worker threads to disjoint cores
   // if worker 0 is offloaded to master, i.e. exclude_worker0 is true,
@@ -139,6 +181,32 @@ class ThreadGroup::Impl {
       // See the comment inside SetMasterThreadFullCpuAffinity function to get more detail.
       SetMasterThreadFullCpuAffinity(reverse);
     }
+    affinity_epoch.fetch_add(1, std::memory_order_release);
+#endif
+  }
+
+  // bind worker i to the i-th core of the NUMA order.
+  // the master thread is left to the caller, see BindToNumaNode.
+  bool SetNumaAffinity(bool exclude_worker0) {
+#if defined(__linux__) && !defined(__ANDROID__)
+    if (numa_order_.size() < static_cast<size_t>(num_workers_)) {
+      LOG(WARNING)
+        << "The NUMA affinity cannot be set when the number of workers"
+        << " is larger than the number of cores available on the nodes.";
+      return false;
+    }
+    for (unsigned i = 0; i < threads_.size(); ++i) {
+      cpu_set_t cpuset;
+      CPU_ZERO(&cpuset);
+      CPU_SET(numa_order_[i + exclude_worker0], &cpuset);
+      pthread_setaffinity_np(threads_[i].native_handle(),
+          sizeof(cpu_set_t), &cpuset);
+    }
+    affinity_epoch.fetch_add(1, std::memory_order_release);
+    return true;
+#else
+    LOG(WARNING) << "NUMA affinity is not supported on this platform.";
+    return false;
 #endif
   }
 
@@ -221,11 +289,36 @@ class ThreadGroup::Impl {
     }
   }
 
+  // spread the workers evenly over the nodes, taking the lowest ids of each
+  // node first which are the physical cores under the usual enumeration.
+  void InitNumaOrder() {
+    const std::vector<std::vector<unsigned int> >& nodes = NumaNodeCpus();
+    std::vector<int> node_ids;
+    for (size_t node = 0; node < nodes.size(); ++node) {
+      if (!nodes[node].empty()) node_ids.push_back(static_cast<int>(node));
+    }
+    int num_nodes = static_cast<int>(node_ids.size());
+    for (int k = 0; k < num_nodes; ++k) {
+      const std::vector<unsigned int>& cpus = nodes[node_ids[k]];
+      size_t count = std::min(cpus.size(), static_cast<size_t>(
+          num_workers_ / num_nodes + (k < num_workers_ % num_nodes)));
+      for (size_t j = 0; j < count; ++j) {
+        numa_order_.push_back(cpus[j]);
+        numa_order_nodes_.push_back(node_ids[k]);
+      }
+    }
+  }
+
   int num_workers_;
   std::vector<std::thread> threads_;
   std::vector<unsigned int> sorted_order_;
   int big_count_ = 0;
   int little_count_ = 0;
+  // the core and the node of each worker in kNumaNode mode
+  std::vector<unsigned int> numa_order_;
+  std::vector<int> numa_order_nodes_;
+  // whether the workers are currently bound by SetNumaAffinity
+  bool numa_bound_ = false;
 };
 
 ThreadGroup::ThreadGroup(int num_workers,
@@ -239,6 +332,10 @@ int ThreadGroup::Configure(AffinityMode mode, int nthreads, bool exclude_worker0
   return impl_->Configure(mode, nthreads, exclude_worker0);
 }
 
+std::vector<int> ThreadGroup::WorkerNumaNodes() const {
+  return impl_->WorkerNumaNodes();
+}
+
 void Yield() {
   std::this_thread::yield();
 }
@@ -260,6 +357,82 @@ int MaxConcurrency() {
   return std::max(max_concurrency, 1);
 }
 
+const std::vector<std::vector<unsigned int> >& NumaNodeCpus() {
+  static std::vector<std::vector<unsigned int> > nodes = [] {
+    std::vector<std::vector<unsigned int> > ret;
+#if defined(__linux__) || defined(__ANDROID__)
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string list;
+    if (!online.fail() && std::getline(online, list)) {
+      for (unsigned int node : ParseSysfsList(list)) {
+        std::ostringstream filepath;
+        filepath << "/sys/devices/system/node/node" << node << "/cpulist";
+        std::ifstream ifs(filepath.str());
+        std::string cpus;
+        if (ret.size() <= node) ret.resize(node + 1);
+        if (!ifs.fail() && std::getline(ifs, cpus)) {
+          ret[node] = ParseSysfsList(cpus);
+        }
+      }
+    }
+#endif
+    if (ret.empty()) {
+      ret.emplace_back();
+      for (unsigned int i = 0; i < std::thread::hardware_concurrency(); ++i) {
+        ret[0].push_back(i);
+      }
+    }
+    return ret;
+  }();
+  return nodes;
+}
+
+int CurrentNumaNode() {
+#if defined(__linux__) && !defined(__ANDROID__)
+  static thread_local int cached_epoch = -1;
+  static thread_local int cached_node = -1;
+  int epoch = affinity_epoch.load(std::memory_order_acquire);
+  if (epoch == cached_epoch) return cached_node;
+  const std::vector<std::vector<unsigned int> >& nodes = NumaNodeCpus();
+  int found = -1;
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  if (nodes.size() > 1 &&
+      pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) == 0) {
+    for (size_t node = 0; node < nodes.size() && found != -2; ++node) {
+      for (unsigned int cpu : nodes[node]) {
+        if (!CPU_ISSET(cpu, &cpuset)) continue;
+        // -2 marks CPUs from several nodes
+        found = (found == -1 || found == static_cast<int>(node)) ? static_cast<int>(node) : -2;
+        if (found == -2) break;
+      }
+    }
+  }
+  cached_epoch = epoch;
+  cached_node = std::max(found, -1);
+  return cached_node;
+#else
+  return -1;
+#endif
+}
+
+void BindToNumaNode(int node) {
+  const std::vector<std::vector<unsigned int> >& nodes = NumaNodeCpus();
+  CHECK(node >= 0 && node < static_cast<int>(nodes.size()) && !nodes[node].empty())
+      << "Invalid NUMA node " << node;
+#if defined(__linux__) && !defined(__ANDROID__)
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (unsigned int cpu : nodes[node]) {
+    CPU_SET(cpu, &cpuset);
+  }
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+  affinity_epoch.fetch_add(1, std::memory_order_release);
+#else
+  LOG(WARNING) << "Binding threads to NUMA nodes is not supported on this platform.";
+#endif
+}
+
 
 }  // namespace threading
 }  // namespace runtime
@@ -0,0 +1,268 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file runtime/bucketed_allocator.h
+ */
+#ifndef TVM_RUNTIME_VM_BUCKETED_ALLOCATOR_H_
+#define TVM_RUNTIME_VM_BUCKETED_ALLOCATOR_H_
+
+#include <tvm/runtime/device_api.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "memory_manager.h"
+
+namespace tvm {
+namespace runtime {
+namespace vm {
+
+/*!
+ * \brief Allocator caching buffers by size class.
+ *
+ *  Requests are rounded up to classes of (4 + j) * 2^e pages, j in [0, 4), so
+ *  buffers whose sizes differ by a little are reused while the rounding waste
+ *  stays under 25%. Freed buffers go to a small cache of the calling thread
+ *  first, then to a lock-free shared cache of fixed slots per class. The bytes
+ *  held in the caches are bounded; when a free would exceed the bound, shared
+ *  buffers of the largest classes are evicted back to the device first.
+ */
+class BucketedAllocator final : public Allocator {
+ public:
+  static constexpr size_t kPageSize = 4096;
+  /*! \brief The number of buffers cached per class by each thread. */
+  static constexpr size_t kThreadCacheSize = 4;
+  /*! \brief The number of shared cache slots per class. */
+  static constexpr size_t kSharedCacheSize = 32;
+  /*! \brief The number of size classes, covering up to 2^53 bytes. */
+  static constexpr size_t kNumClasses = 163;
+  /*! \brief The default bound of the cached bytes. */
+  static constexpr size_t kDefaultMaxCachedBytes = static_cast<size_t>(1) << 30;
+
+  explicit BucketedAllocator(TVMContext ctx, size_t max_cached_bytes = DefaultMaxCachedBytes())
+      : Allocator(kBucketed), max_cached_bytes_(max_cached_bytes),
+        used_memory_(0), cached_memory_(0), num_reused_(0), ctx_(ctx),
+        shared_(new std::atomic<void*>[kNumClasses * kSharedCacheSize]) {
+    for (size_t i = 0; i < kNumClasses * kSharedCacheSize; ++i) {
+      shared_[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~BucketedAllocator() { ReleaseAll(); }
+
+  Buffer Alloc(size_t nbytes, size_t alignment, DLDataType type_hint) override {
+    size_t cls = SizeClass(nbytes);
+    Buffer buf;
+    buf.ctx = ctx_;
+    buf.size = ClassBytes(cls);
+    ThreadCache* cache = LocalCache();
+    if (cache != nullptr && !cache->lists[cls].empty()) {
+      buf.data = cache->lists[cls].back();
+      cache->lists[cls].pop_back();
+    } else {
+      buf.data = PopShared(cls);
+    }
+    if (buf.data != nullptr) {
+      cached_memory_.fetch_sub(buf.size, std::memory_order_relaxed);
+      num_reused_.fetch_add(1, std::memory_order_relaxed);
+      return buf;
+    }
+    // page aligned, so that a cached buffer fits any later alignment request
+    buf.data = DeviceAPI::Get(ctx_)->AllocDataSpace(
+        ctx_, buf.size, std::max(alignment, static_cast<size_t>(kPageSize)), type_hint);
+    used_memory_.fetch_add(buf.size, std::memory_order_relaxed);
+    DLOG(INFO) << "allocate " << buf.size << " B, used memory " << used_memory_ << " B";
+    return buf;
+  }
+
+  void Free(const Buffer& buffer) override {
+    size_t cls = SizeClass(buffer.size);
+    CHECK_EQ(ClassBytes(cls), buffer.size)
+        << "The buffer is not allocated by the bucketed allocator";
+    if (!ReserveCache(buffer.size)) {
+      FreeToDevice(buffer.data, buffer.size);
+      return;
+    }
+    ThreadCache* cache = LocalCache();
+    if (cache != nullptr && cache->lists[cls].size() < kThreadCacheSize) {
+      cache->lists[cls].push_back(buffer.data);
+    } else if (!PushShared(cls, buffer.data)) {
+      cached_memory_.fetch_sub(buffer.size, std::memory_order_relaxed);
+      FreeToDevice(buffer.data, buffer.size);
+    }
+  }
+
+  size_t UsedMemory() const override { return used_memory_.load(std::memory_order_relaxed); }
+
+  /*! \brief The bytes held in the caches. */
+  size_t CachedMemory() const override { return cached_memory_.load(std::memory_order_relaxed); }
+
+  size_t NumReused() const override { return num_reused_.load(std::memory_order_relaxed); }
+
+  /*! \brief The bound of the cached bytes, from TVM_VM_ALLOCATOR_MAX_CACHED_BYTES if set. */
+  static size_t DefaultMaxCachedBytes() {
+    const char* val = getenv("TVM_VM_ALLOCATOR_MAX_CACHED_BYTES");
+    if (val == nullptr) return kDefaultMaxCachedBytes;
+    return static_cast<size_t>(strtoull(val, nullptr, 10));
+  }
+
+ private:
+  /*! \brief The buffers cached by one thread. */
+  struct ThreadCache {
+    BucketedAllocator* allocator{nullptr};
+    std::vector<std::vector<void*> > lists;
+    // hand the buffers to the shared cache when the thread exits
+    ~ThreadCache() {
+      if (allocator != nullptr) allocator->Flush(this);
+    }
+  };
+
+  // The cache of the calling thread, nullptr once the thread is tearing down its caches.
+  // The allocators live in the global MemoryManager, so they outlive the threads.
+  ThreadCache* LocalCache() {
+    // trivially destructible, so it stays valid while the caches are destroyed
+    static thread_local bool exited = false;
+    struct Caches {
+      std::unordered_map<const BucketedAllocator*, ThreadCache> map;
+      ~Caches() { exited = true; }
+    };
+    static thread_local Caches caches;
+    if (exited) return nullptr;
+    ThreadCache* cache = &caches.map[this];
+    if (cache->allocator == nullptr) {
+      cache->allocator = this;
+      cache->lists.resize(kNumClasses);
+    }
+    return cache;
+  }
+
+  // Move the buffers of a thread cache to the shared cache.
+  void Flush(ThreadCache* cache) {
+    for (size_t cls = 0; cls < cache->lists.size(); ++cls) {
+      for (void* data : cache->lists[cls]) {
+        if (!PushShared(cls, data)) {
+          cached_memory_.fetch_sub(ClassBytes(cls), std::memory_order_relaxed);
+          FreeToDevice(data, ClassBytes(cls));
+        }
+      }
+      cache->lists[cls].clear();
+    }
+  }
+
+  // Account nbytes as cached, evicting shared buffers of the largest classes
+  // when the bound is exceeded. Returns false if the bytes cannot be cached.
+  bool ReserveCache(size_t nbytes) {
+    if (nbytes > max_cached_bytes_) return false;
+    size_t cached = cached_memory_.fetch_add(nbytes, std::memory_order_relaxed) + nbytes;
+    for (size_t cls = kNumClasses; cls != 0 && cached > max_cached_bytes_; --cls) {
+      void* data;
+      while (cached > max_cached_bytes_ && (data = PopShared(cls - 1)) != nullptr) {
+        size_t size = ClassBytes(cls - 1);
+        FreeToDevice(data, size);
+        cached = cached_memory_.fetch_sub(size, std::memory_order_relaxed) - size;
+      }
+    }
+    if (cached > max_cached_bytes_) {
+      cached_memory_.fetch_sub(nbytes, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  // Put a buffer into a free shared slot of its class.
+  bool PushShared(size_t cls, void* data) {
+    std::atomic<void*>* slots = &shared_[cls * kSharedCacheSize];
+    for (size_t i = 0; i < kSharedCacheSize; ++i) {
+      void* expected = nullptr;
+      if (slots[i].load(std::memory_order_relaxed) == nullptr &&
+          slots[i].compare_exchange_strong(expected, data, std::memory_order_release)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Take a buffer from the shared slots of a class, nullptr if there is none.
+  void* PopShared(size_t cls) {
+    std::atomic<void*>* slots = &shared_[cls * kSharedCacheSize];
+    for (size_t i = 0; i < kSharedCacheSize; ++i) {
+      if (slots[i].load(std::memory_order_relaxed) != nullptr) {
+        void* data = slots[i].exchange(nullptr, std::memory_order_acquire);
+        if (data != nullptr) return data;
+      }
+    }
+    return nullptr;
+  }
+
+  void FreeToDevice(void* data, size_t nbytes) {
+    DeviceAPI::Get(ctx_)->FreeDataSpace(ctx_, data);
+    used_memory_.fetch_sub(nbytes, std::memory_order_relaxed);
+    DLOG(INFO) << "free " << nbytes << " B, used memory " << used_memory_ << " B";
+  }
+
+  // The thread caches are flushed when their threads exit, before the allocator is destroyed.
+  void ReleaseAll() {
+    for (size_t cls = 0; cls < kNumClasses; ++cls) {
+      while (void* data = PopShared(cls)) {
+        cached_memory_.fetch_sub(ClassBytes(cls), std::memory_order_relaxed);
+        FreeToDevice(data, ClassBytes(cls));
+      }
+    }
+    DLOG(INFO) << "release all buffers";
+  }
+
+  // The class of a request, classes 0, 1, 2 are 1, 2, 3 pages.
+  static size_t SizeClass(size_t nbytes) {
+    size_t npages = std::max((nbytes + kPageSize - 1) / kPageSize, static_cast<size_t>(1));
+    if (npages < 4) return npages - 1;
+    size_t e = 0;
+    while ((npages >> (e + 1)) != 0) ++e;
+    size_t step = static_cast<size_t>(1) << (e - 2);
+    size_t j = (npages - (static_cast<size_t>(1) << e) + step - 1) / step;
+    size_t cls = 3 + 4 * (e - 2) + j;
+    CHECK(cls < kNumClasses) << "Allocation of " << nbytes << " B is too large";
+    return cls;
+  }
+
+  // The bytes of a class.
+  static size_t ClassBytes(size_t cls) {
+    if (cls < 3) return (cls + 1) * kPageSize;
+    size_t e = (cls - 3) / 4 + 2;
+    size_t j = (cls - 3) % 4;
+    return ((4 + j) << (e - 2)) * kPageSize;
+  }
+
+ private:
+  size_t max_cached_bytes_;
+  std::atomic<size_t> used_memory_;
+  std::atomic<size_t> cached_memory_;
+  std::atomic<size_t> num_reused_;
+  TVMContext ctx_;
+  std::unique_ptr<std::atomic<void*>[]> shared_;
+};
+
+}  // namespace vm
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_VM_BUCKETED_ALLOCATOR_H_
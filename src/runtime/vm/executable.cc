@@ -24,10 +24,14 @@
 
 #include <dmlc/memory_io.h>
 #include <tvm/runtime/c_runtime_api.h>
+#include <tvm/runtime/device_api.h>
 #include <tvm/runtime/registry.h>
+#include <tvm/runtime/serializer.h>
 #include <tvm/runtime/vm.h>
 
 #include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <memory>
 #include <iostream>
 #include <iomanip>
@@ -36,6 +40,7 @@
 #include <vector>
 
 #include "serialize_util.h"
+#include "../mapped_file.h"
 
 namespace tvm {
 namespace runtime {
@@ -45,6 +50,26 @@ namespace vm {
   CHECK(val) << "Invalid VM file format in the " << section << " section." \
              << "\n";
 
+/*! \brief The alignment of the data section in a saved executable. */
+constexpr uint64_t kDataSectionAlignment = 4096;
+
+inline uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+/*!
+ * \brief Allocate a buffer aligned to kAllocAlignment.
+ * \param size The size of the buffer.
+ * \param data The aligned start of the buffer.
+ * \return The buffer.
+ */
+static std::shared_ptr<void> AllocAlignedBuffer(size_t size, char** data) {
+  char* raw = new char[size + kAllocAlignment];
+  size_t misalignment = reinterpret_cast<size_t>(raw) % kAllocAlignment;
+  *data = raw + (misalignment == 0 ? 0 : kAllocAlignment - misalignment);
+  return std::shared_ptr<void>(raw, [](char* p) { delete[] p; });
+}
+
 // Helper to serialize a vm instruction.
 VMInstructionSerializer SerializeInstruction(const Instruction& instr);
 // Helper to deserialize a serialized vm instruction.
@@ -109,11 +134,31 @@ std::string Executable::GetFunctionParameterName(std::string func_name, uint32_t
   return func.params[index];
 }
 
+const VMFunction& Executable::GetVMFunction(Index index) const {
+  CHECK_LT(static_cast<size_t>(index), functions.size());
+  if (static_cast<size_t>(index) < lazy_bytecode_.size()) {
+    LazyBytecode* lazy = lazy_bytecode_[index].get();
+    std::call_once(lazy->loaded, [this, index, lazy]() {
+      dmlc::MemoryFixedSizeStream strm(const_cast<char*>(lazy->data), lazy->size);
+      std::vector<Instruction> instructions;
+      instructions.reserve(lazy->num_instructions);
+      for (size_t i = 0; i < lazy->num_instructions; i++) {
+        VMInstructionSerializer instr;
+        STREAM_CHECK(instr.Load(&strm), "code/instruction");
+        instructions.push_back(DeserializeInstruction(instr));
+      }
+      // Only the instructions of this function are written, and only once.
+      const_cast<VMFunction&>(functions[index]).instructions = std::move(instructions);
+    });
+  }
+  return functions[index];
+}
+
 std::string Executable::GetBytecode() const {
   std::ostringstream oss;
 
   for (size_t i = 0; i < functions.size(); ++i) {
-    const auto& func = functions[i];
+    const auto& func = GetVMFunction(i);
     // Print the header of the function format.
     oss << "VM Function[" << i << "]: " << func.name << "(";
     for (const auto& param : func.params) {
@@ -204,6 +249,31 @@ void SaveHeader(dmlc::Stream* strm) {
 }
 
 TVMByteArray Executable::Save() {
+  // Serialize the instructions of each function.
+  std::vector<std::string> bytecode(functions.size());
+  for (size_t i = 0; i < functions.size(); ++i) {
+    dmlc::MemoryStringStream strm(&bytecode[i]);
+    for (const auto& instr : GetVMFunction(i).instructions) {
+      SerializeInstruction(instr).Save(&strm);
+    }
+  }
+
+  // Lay out the data section: the constants, each aligned so that it can be
+  // bound in place, followed by the bytecode of each function.
+  std::vector<uint64_t> const_offsets, code_offsets;
+  uint64_t offset = 0;
+  for (const auto& obj : this->constants) {
+    const DLTensor* tensor = Downcast<runtime::NDArray>(obj).operator->();
+    offset = AlignUp(offset, kAllocAlignment);
+    const_offsets.push_back(offset);
+    offset += GetDataSize(*tensor);
+  }
+  for (const auto& code : bytecode) {
+    code_offsets.push_back(offset);
+    offset += code.size();
+  }
+  uint64_t data_size = offset;
+
   // Initialize the stream object.
   code_.clear();
   dmlc::MemoryStringStream strm(&code_);
@@ -211,17 +281,44 @@ TVMByteArray Executable::Save() {
   // Save header
   SaveHeader(&strm);
 
+  // The location of the data section, filled in once the metadata is written.
+  size_t data_header_pos = strm.Tell();
+  uint64_t data_offset = 0;
+  strm.Write(data_offset);
+  strm.Write(data_size);
+
   // Global section.
   SaveGlobalSection(&strm);
 
   // Constant section.
-  SaveConstantSection(&strm);
+  SaveConstantSection(&strm, const_offsets);
 
   // Primitive names.
   SavePrimitiveOpNames(&strm);
 
   // Code section.
-  SaveCodeSection(&strm);
+  SaveCodeSection(&strm, code_offsets, bytecode);
+
+  // Page-align the data section so that the constants of a mapped file are
+  // bound straight to its pages.
+  data_offset = AlignUp(code_.size(), kDataSectionAlignment);
+  strm.Seek(data_header_pos);
+  strm.Write(data_offset);
+  code_.resize(data_offset + data_size, '\0');
+  char* data = &code_[data_offset];
+  for (size_t i = 0; i < constants.size(); ++i) {
+    DLTensor* tensor = const_cast<DLTensor*>(Downcast<runtime::NDArray>(constants[i]).operator->());
+    size_t nbytes = GetDataSize(*tensor);
+    char* dst = data + const_offsets[i];
+    CHECK_EQ(TVMArrayCopyToBytes(tensor, dst, nbytes), 0) << TVMGetLastError();
+    if (!DMLC_IO_NO_ENDIAN_SWAP) {
+      int elem_bytes = (tensor->dtype.bits + 7) / 8;
+      dmlc::ByteSwap(dst, elem_bytes, nbytes / elem_bytes);
+    }
+  }
+  for (size_t i = 0; i < bytecode.size(); ++i) {
+    std::memcpy(data + code_offsets[i], bytecode[i].data(), bytecode[i].size());
+  }
 
   TVMByteArray arr;
   arr.data = code_.c_str();
@@ -245,15 +342,15 @@ void Executable::SaveGlobalSection(dmlc::Stream* strm) {
   strm->Write(glbs);
 }
 
-void Executable::SaveConstantSection(dmlc::Stream* strm) {
-  std::vector<DLTensor*> arrays;
-  for (const auto& obj : this->constants) {
-    const auto cell = Downcast<runtime::NDArray>(obj);
-    arrays.push_back(const_cast<DLTensor*>(cell.operator->()));
-  }
+void Executable::SaveConstantSection(dmlc::Stream* strm, const std::vector<uint64_t>& offsets) {
   strm->Write(static_cast<uint64_t>(this->constants.size()));
-  for (const auto& it : arrays) {
-    runtime::SaveDLTensor(strm, it);
+  for (size_t i = 0; i < this->constants.size(); ++i) {
+    const DLTensor* tensor = Downcast<runtime::NDArray>(this->constants[i]).operator->();
+    strm->Write(tensor->ndim);
+    strm->Write(tensor->dtype);
+    strm->WriteArray(tensor->shape, tensor->ndim);
+    strm->Write(offsets[i]);
+    strm->Write(static_cast<uint64_t>(GetDataSize(*tensor)));
   }
 }
 
@@ -304,7 +401,9 @@ VMInstructionSerializer SerializeInstruction(const Instruction& instr) {
       // Number of fields = 0
       break;
     }
-    case Opcode::InvokePacked: {
+    case Opcode::InvokePacked:
+    case Opcode::InvokeShapeFunc:
+    case Opcode::InvokePackedConst: {
       // Number of fields = 3 + instr.arity
       // Note that arity includes both input arguments and outputs. We will
       // put all the `arity` number of fields in the end for serialization.
@@ -314,8 +413,9 @@ VMInstructionSerializer SerializeInstruction(const Instruction& instr) {
       break;
     }
     case Opcode::AllocTensor: {
-      // Number of fields = 5 + instr.alloc_tensor.ndim
+      // Number of fields = 7 + instr.alloc_tensor.ndim
       fields.push_back(instr.alloc_tensor.storage);
+      fields.push_back(instr.alloc_tensor.offset);
 
       // Save `DLDataType` and the dst register.
       const auto& dtype = instr.alloc_tensor.dtype;
@@ -359,6 +459,26 @@ VMInstructionSerializer SerializeInstruction(const Instruction& instr) {
       fields.push_back(instr.dst);
       break;
     }
+    case Opcode::AllocStorageTensor: {
+      // Number of fields = 10 + instr.alloc_storage_tensor.ndim
+      fields.push_back(instr.alloc_storage_tensor.allocation_size);
+      fields.push_back(instr.alloc_storage_tensor.alignment);
+      const auto& dtype_hint = instr.alloc_storage_tensor.dtype_hint;
+      fields.push_back(dtype_hint.code);
+      fields.push_back(dtype_hint.bits);
+      fields.push_back(dtype_hint.lanes);
+      // Save `DLDataType` of the tensor, its number of dimensions and the dst
+      // register, followed by its shape.
+      const auto& dtype = instr.alloc_storage_tensor.dtype;
+      fields.push_back(dtype.code);
+      fields.push_back(dtype.bits);
+      fields.push_back(dtype.lanes);
+      fields.push_back(instr.alloc_storage_tensor.ndim);
+      fields.push_back(instr.dst);
+      fields.insert(fields.end(), instr.alloc_storage_tensor.shape,
+                    instr.alloc_storage_tensor.shape + instr.alloc_storage_tensor.ndim);
+      break;
+    }
     case Opcode::AllocADT: {
       // Number of fields = 3 + instr.num_fields
       fields.assign({instr.constructor_tag, instr.num_fields, instr.dst});
@@ -436,10 +556,12 @@ VMInstructionSerializer SerializeInstruction(const Instruction& instr) {
   return VMInstructionSerializer(static_cast<Index>(instr.op), fields);
 }
 
-void Executable::SaveCodeSection(dmlc::Stream* strm) {
+void Executable::SaveCodeSection(dmlc::Stream* strm, const std::vector<uint64_t>& offsets,
+                                 const std::vector<std::string>& bytecode) {
   // Save the number of functions.
   strm->Write(static_cast<uint64_t>(this->functions.size()));
-  for (const auto& func : this->functions) {
+  for (size_t i = 0; i < this->functions.size(); ++i) {
+    const auto& func = this->functions[i];
     // Save the function info.
     VMFunctionSerializer func_format(func.name,
                                      func.register_file_size,
@@ -447,11 +569,9 @@ void Executable::SaveCodeSection(dmlc::Stream* strm) {
                                      func.params);
     func_format.Save(strm);
 
-    // Serialize each instruction.
-    for (const auto& instr : func.instructions) {
-      const auto& serialized_instr = SerializeInstruction(instr);
-      serialized_instr.Save(strm);
-    }
+    // Save where the serialized instructions are in the data section.
+    strm->Write(offsets[i]);
+    strm->Write(static_cast<uint64_t>(bytecode[i].size()));
   }
 }
 
@@ -468,14 +588,51 @@ void LoadHeader(dmlc::Stream* strm) {
 }
 
 runtime::Module Executable::Load(const std::string& code, const runtime::Module lib) {
+  // Copy the bytes once into an aligned buffer, which the constants view.
+  char* data = nullptr;
+  std::shared_ptr<void> buffer = AllocAlignedBuffer(code.size(), &data);
+  std::memcpy(data, code.data(), code.size());
+  return LoadBuffer(data, code.size(), std::move(buffer), lib);
+}
+
+runtime::Module Executable::LoadFile(const std::string& path, const runtime::Module lib) {
+#ifndef _WIN32
+  auto file = std::make_shared<MappedFile>(path);
+  const char* data = file->data();
+  size_t size = file->size();
+  return LoadBuffer(data, size, std::move(file), lib);
+#else
+  std::ifstream fs(path, std::ios::in | std::ios::binary);
+  CHECK(!fs.fail()) << "Cannot open " << path;
+  fs.seekg(0, std::ios::end);
+  size_t size = static_cast<size_t>(fs.tellg());
+  fs.seekg(0, std::ios::beg);
+  char* data = nullptr;
+  std::shared_ptr<void> buffer = AllocAlignedBuffer(size, &data);
+  fs.read(data, size);
+  return LoadBuffer(data, size, std::move(buffer), lib);
+#endif
+}
+
+runtime::Module Executable::LoadBuffer(const char* data, size_t size,
+                                       std::shared_ptr<void> buffer,
+                                       const runtime::Module lib) {
   auto exec = make_object<Executable>();
   exec->lib = lib;
-  exec->code_ = code;
-  dmlc::MemoryStringStream strm(&exec->code_);
+  exec->buffer_ = std::move(buffer);
+  dmlc::MemoryFixedSizeStream strm(const_cast<char*>(data), size);
 
   // Load header.
   LoadHeader(&strm);
 
+  // Locate the data section.
+  uint64_t data_offset, data_size;
+  STREAM_CHECK(strm.Read(&data_offset), "header");
+  STREAM_CHECK(strm.Read(&data_size), "header");
+  STREAM_CHECK(data_offset <= size && data_size <= size - data_offset, "header");
+  exec->data_section_ = data + data_offset;
+  exec->data_section_size_ = static_cast<size_t>(data_size);
+
   // Global section.
   exec->LoadGlobalSection(&strm);
 
@@ -507,8 +664,50 @@ void Executable::LoadConstantSection(dmlc::Stream* strm) {
   size_t size = static_cast<size_t>(sz);
   // Load each of the constants.
   for (size_t i = 0; i < size; i++) {
-    runtime::NDArray constant;
-    STREAM_CHECK(constant.Load(strm), "constant");
+    int ndim;
+    DLDataType dtype;
+    STREAM_CHECK(strm->Read(&ndim), "constant");
+    STREAM_CHECK(ndim >= 0, "constant");
+    STREAM_CHECK(strm->Read(&dtype), "constant");
+    std::vector<int64_t> shape(ndim);
+    if (ndim != 0) {
+      STREAM_CHECK(strm->ReadArray(shape.data(), ndim), "constant");
+    }
+    uint64_t offset, nbytes;
+    STREAM_CHECK(strm->Read(&offset), "constant");
+    STREAM_CHECK(strm->Read(&nbytes), "constant");
+    STREAM_CHECK(offset <= data_section_size_ && nbytes <= data_section_size_ - offset,
+                 "constant");
+    const char* payload = data_section_ + offset;
+
+    if (!DMLC_IO_NO_ENDIAN_SWAP ||
+        reinterpret_cast<size_t>(payload) % kAllocAlignment != 0) {
+      runtime::NDArray constant = runtime::NDArray::Empty(shape, dtype, {kDLCPU, 0});
+      STREAM_CHECK(GetDataSize(*constant.operator->()) == nbytes, "constant");
+      std::memcpy(constant->data, payload, nbytes);
+      if (!DMLC_IO_NO_ENDIAN_SWAP) {
+        int elem_bytes = (dtype.bits + 7) / 8;
+        dmlc::ByteSwap(constant->data, elem_bytes, nbytes / elem_bytes);
+      }
+      this->constants.push_back(constant);
+      continue;
+    }
+    // Bind the constant to the buffer.
+    MappedTensor* mt = new MappedTensor();
+    mt->shape = std::move(shape);
+    mt->buffer = buffer_;
+    mt->tensor.manager_ctx = mt;
+    mt->tensor.deleter = MappedTensor::Deleter;
+    DLTensor& t = mt->tensor.dl_tensor;
+    t.data = const_cast<char*>(payload);
+    t.ctx = {kDLCPU, 0};
+    t.ndim = ndim;
+    t.dtype = dtype;
+    t.shape = mt->shape.data();
+    t.strides = nullptr;
+    t.byte_offset = 0;
+    runtime::NDArray constant = runtime::NDArray::FromDLPack(&mt->tensor);
+    STREAM_CHECK(GetDataSize(t) == nbytes, "constant");
     this->constants.push_back(constant);
   }
 }
@@ -552,7 +751,9 @@ Instruction DeserializeInstruction(const VMInstructionSerializer& instr) {
       DCHECK(instr.fields.empty());
       return Instruction::Fatal();
     }
-    case Opcode::InvokePacked: {
+    case Opcode::InvokePacked:
+    case Opcode::InvokeShapeFunc:
+    case Opcode::InvokePackedConst: {
       // Number of fields = 3 + instr.arity
       DCHECK_GE(instr.fields.size(), 3U);
       DCHECK_EQ(instr.fields.size(), 3U + static_cast<size_t>(instr.fields[1]));
@@ -561,26 +762,33 @@ Instruction DeserializeInstruction(const VMInstructionSerializer& instr) {
       Index arity = instr.fields[1];
       Index output_size = instr.fields[2];
       std::vector<RegName> args = ExtractFields(instr.fields, 3, arity);
+      if (opcode == Opcode::InvokeShapeFunc) {
+        return Instruction::InvokeShapeFunc(packed_index, arity, output_size, args);
+      }
+      if (opcode == Opcode::InvokePackedConst) {
+        return Instruction::InvokePackedConst(packed_index, arity, output_size, args);
+      }
       return Instruction::InvokePacked(packed_index, arity, output_size, args);
     }
     case Opcode::AllocTensor: {
-      // Number of fields = 6 + instr.alloc_tensor.ndim
-      DCHECK_GE(instr.fields.size(), 6U);
-      DCHECK_EQ(instr.fields.size(), 6U + static_cast<size_t>(instr.fields[4]));
+      // Number of fields = 7 + instr.alloc_tensor.ndim
+      DCHECK_GE(instr.fields.size(), 7U);
+      DCHECK_EQ(instr.fields.size(), 7U + static_cast<size_t>(instr.fields[5]));
 
       RegName storage_reg = instr.fields[0];
+      Index offset = instr.fields[1];
 
       DLDataType dtype;
-      dtype.code = instr.fields[1];
-      dtype.bits = instr.fields[2];
-      dtype.lanes = instr.fields[3];
+      dtype.code = instr.fields[2];
+      dtype.bits = instr.fields[3];
+      dtype.lanes = instr.fields[4];
 
-      Index ndim = instr.fields[4];
-      RegName dst = instr.fields[5];
+      Index ndim = instr.fields[5];
+      RegName dst = instr.fields[6];
 
-      std::vector<Index> shape = ExtractFields(instr.fields, 6, ndim);
+      std::vector<Index> shape = ExtractFields(instr.fields, 7, ndim);
 
-      return Instruction::AllocTensor(storage_reg, shape, dtype, dst);
+      return Instruction::AllocTensor(storage_reg, offset, shape, dtype, dst);
     }
     case Opcode::AllocTensorReg: {
       // Number of fields = 5
@@ -640,6 +848,31 @@ Instruction DeserializeInstruction(const VMInstructionSerializer& instr) {
         dtype,
         dst);
     }
+    case Opcode::AllocStorageTensor: {
+      // Number of fields = 10 + instr.alloc_storage_tensor.ndim
+      DCHECK_GE(instr.fields.size(), 10U);
+      DCHECK_EQ(instr.fields.size(), 10U + static_cast<size_t>(instr.fields[8]));
+      Index allocation_size = instr.fields[0];
+      Index alignment = instr.fields[1];
+
+      DLDataType dtype_hint;
+      dtype_hint.code = instr.fields[2];
+      dtype_hint.bits = instr.fields[3];
+      dtype_hint.lanes = instr.fields[4];
+
+      DLDataType dtype;
+      dtype.code = instr.fields[5];
+      dtype.bits = instr.fields[6];
+      dtype.lanes = instr.fields[7];
+
+      Index ndim = instr.fields[8];
+      RegName dst = instr.fields[9];
+
+      std::vector<Index> shape = ExtractFields(instr.fields, 10, ndim);
+
+      return Instruction::AllocStorageTensor(allocation_size, alignment, dtype_hint, shape,
+                                             dtype, dst);
+    }
     case Opcode::If: {
       // Number of fields = 4
       DCHECK_EQ(instr.fields.size(), 4U);
@@ -712,29 +945,36 @@ void Executable::LoadCodeSection(dmlc::Stream* strm) {
 
   size_t num_funcs = static_cast<size_t>(sz);
   this->functions.resize(num_funcs);
+  this->lazy_bytecode_.resize(num_funcs);
   for (size_t i = 0; i < num_funcs; i++) {
     // Load the function info.
     VMFunctionSerializer loaded_func;
     STREAM_CHECK(loaded_func.Load(strm), "code/function");
 
-    // Load the instructions.
-    std::vector<Instruction> instructions;
-    for (size_t j = 0; j < loaded_func.num_instructions; j++) {
-      VMInstructionSerializer instr;
-      std::vector<Index> instr_fields;
-      STREAM_CHECK(instr.Load(strm), "code/instruction");
-      instructions.push_back(DeserializeInstruction(instr));
-    }
+    // Locate the instructions, which are deserialized on first use.
+    uint64_t offset, nbytes;
+    STREAM_CHECK(strm->Read(&offset), "code/function");
+    STREAM_CHECK(strm->Read(&nbytes), "code/function");
+    STREAM_CHECK(offset <= data_section_size_ && nbytes <= data_section_size_ - offset,
+                 "code/function");
 
     // Create the VM function.
     VMFunction vm_func = VMFunction(loaded_func.name,
                                     loaded_func.params,
-                                    instructions,
+                                    {},
                                     loaded_func.register_file_size);
     auto it = this->global_map.find(loaded_func.name);
     CHECK(it != this->global_map.end());
-    CHECK_LE(it->second, this->global_map.size());
+    CHECK_LT(static_cast<size_t>(it->second), num_funcs);
     this->functions[it->second] = vm_func;
+    auto* lazy = new LazyBytecode();
+    lazy->data = data_section_ + offset;
+    lazy->size = static_cast<size_t>(nbytes);
+    lazy->num_instructions = loaded_func.num_instructions;
+    this->lazy_bytecode_[it->second].reset(lazy);
+  }
+  for (const auto& lazy : this->lazy_bytecode_) {
+    CHECK(lazy != nullptr) << "Missing the bytecode of a VM function";
   }
 }
 
@@ -796,6 +1036,13 @@ TVM_REGISTER_GLOBAL("runtime.Load_Executable")
   return Executable::Load(code, lib);
 });
 
+TVM_REGISTER_GLOBAL("runtime.Load_ExecutableFile")
+.set_body_typed([](
+    std::string path,
+    runtime::Module lib) {
+  return Executable::LoadFile(path, lib);
+});
+
 }  // namespace vm
 }  // namespace runtime
 }  // namespace tvm
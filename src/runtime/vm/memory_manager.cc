@@ -24,6 +24,7 @@
 #include <utility>
 #include <memory>
 #include "memory_manager.h"
+#include "bucketed_allocator.h"
 #include "naive_allocator.h"
 #include "pooled_allocator.h"
 
@@ -31,13 +32,18 @@ namespace tvm {
 namespace runtime {
 namespace vm {
 
+/*! \brief A buffer of Allocator::Empty and the allocator it is freed to. */
+struct EmptyBuffer {
+  Allocator* allocator;
+  Buffer buffer;
+};
+
 static void BufferDeleter(Object* obj) {
   auto* ptr = static_cast<NDArray::Container*>(obj);
   CHECK(ptr->manager_ctx != nullptr);
-  Buffer* buffer = reinterpret_cast<Buffer*>(ptr->manager_ctx);
-  MemoryManager::Global()->GetAllocator(buffer->ctx)->
-      Free(*(buffer));
-  delete buffer;
+  EmptyBuffer* empty = reinterpret_cast<EmptyBuffer*>(ptr->manager_ctx);
+  empty->allocator->Free(empty->buffer);
+  delete empty;
   delete ptr;
 }
 
@@ -76,9 +82,13 @@ inline size_t GetDataAlignment(const DLTensor& arr) {
 }
 
 NDArray StorageObj::AllocNDArray(size_t offset, std::vector<int64_t> shape, DLDataType dtype) {
-  // TODO(@jroesch): generalize later to non-overlapping allocations.
-  CHECK_EQ(offset, 0u);
   VerifyDataType(dtype);
+  // The kernels require a zero byte_offset, so a non-zero offset moves the
+  // data pointer, which only addresses memory on these devices.
+  DLDeviceType device_type = this->buffer.ctx.device_type;
+  CHECK(offset == 0 || device_type == kDLCPU || device_type == kDLCPUPinned ||
+        device_type == kDLGPU || device_type == kDLROCM)
+      << "tensor offsets are not supported on device type " << device_type;
 
   // crtical zone: allocate header, cannot throw
   NDArray::Container* container = new NDArray::Container(nullptr, shape, dtype, this->buffer.ctx);
@@ -87,13 +97,13 @@ NDArray StorageObj::AllocNDArray(size_t offset, std::vector<int64_t> shape, DLDa
   size_t needed_size = GetDataSize(container->dl_tensor);
   this->IncRef();
   container->manager_ctx = reinterpret_cast<void*>(this);
-  container->dl_tensor.data = this->buffer.data;
+  container->dl_tensor.data = static_cast<char*>(this->buffer.data) + offset;
   NDArray ret(GetObjectPtr<Object>(container));
 
   // RAII in effect, now run the check.
-  // TODO(@jroesch): generalize later to non-overlapping allocations.
-  CHECK(needed_size == this->buffer.size)
-    << "size mistmatch required " << needed_size << " found " << this->buffer.size;
+  CHECK_LE(offset + needed_size, this->buffer.size)
+    << "size mistmatch required " << needed_size << " at offset " << offset
+    << " found " << this->buffer.size;
 
   return ret;
 }
@@ -104,14 +114,27 @@ MemoryManager* MemoryManager::Global() {
 }
 
 Allocator* MemoryManager::GetAllocator(TVMContext ctx) {
+  return GetAllocator(ctx, kNaive);
+}
+
+Allocator* MemoryManager::GetAllocator(TVMContext ctx, AllocatorType type) {
+  CHECK(type >= kNaive && type <= kBucketed) << "Unknown allocator type " << static_cast<int>(type);
   std::lock_guard<std::mutex> lock(mu_);
-  if (allocators_.find(ctx) == allocators_.end()) {
+  auto& allocators = allocators_[type];
+  auto it = allocators.find(ctx);
+  if (it == allocators.end()) {
     DLOG(INFO) << "New allocator for " << DeviceName(ctx.device_type) << "("
                << ctx.device_id << ")";
-    std::unique_ptr<Allocator> alloc(new NaiveAllocator(ctx));
-    allocators_.emplace(ctx, std::move(alloc));
+    std::unique_ptr<Allocator> alloc;
+    switch (type) {
+      case kNaive: alloc.reset(new NaiveAllocator(ctx)); break;
+      case kPooled: alloc.reset(new PooledAllocator(ctx)); break;
+      case kBucketed: alloc.reset(new BucketedAllocator(ctx)); break;
+      default: LOG(FATAL) << "Unknown allocator type " << static_cast<int>(type);
+    }
+    it = allocators.emplace(ctx, std::move(alloc)).first;
   }
-  return allocators_.at(ctx).get();
+  return it->second.get();
 }
 
 NDArray Allocator::Empty(std::vector<int64_t> shape, DLDataType dtype, DLContext ctx) {
@@ -120,10 +143,11 @@ NDArray Allocator::Empty(std::vector<int64_t> shape, DLDataType dtype, DLContext
   container->SetDeleter(BufferDeleter);
   size_t size = GetDataSize(container->dl_tensor);
   size_t alignment = GetDataAlignment(container->dl_tensor);
-  Buffer *buffer = new Buffer;
-  *buffer = this->Alloc(size, alignment, dtype);
-  container->manager_ctx = reinterpret_cast<void*>(buffer);
-  container->dl_tensor.data = buffer->data;
+  EmptyBuffer* empty = new EmptyBuffer;
+  empty->allocator = this;
+  empty->buffer = this->Alloc(size, alignment, dtype);
+  container->manager_ctx = reinterpret_cast<void*>(empty);
+  container->dl_tensor.data = empty->buffer.data;
   return NDArray(GetObjectPtr<Object>(container));
 }
 
@@ -54,6 +54,19 @@ namespace tvm {
 namespace runtime {
 namespace vm {
 
+/*! \brief The kinds of allocators managed by the MemoryManager. */
+enum AllocatorType {
+  /*! \brief Every buffer goes straight to the device. */
+  kNaive = 1,
+  /*! \brief Buffers are cached by their exact page-rounded size. */
+  kPooled,
+  /*!
+   * \brief Buffers are cached by size class in per-thread caches backed by a
+   *  lock-free shared cache with a bounded size.
+   */
+  kBucketed,
+};
+
 struct Buffer {
   /*! \brief The pointer to the allocated block of memory. */
   void* data{nullptr};
@@ -65,7 +78,7 @@ struct Buffer {
 
 class Allocator {
  public:
-  Allocator() {}
+  explicit Allocator(AllocatorType type) : type_(type) {}
 
   /*! \brief Allocate an empty NDArray using from the allocator.
    *  \param shape The shape of the NDArray.
@@ -91,21 +104,48 @@ class Allocator {
    *  \return The amount of memory currently allocated.
    */
   virtual size_t UsedMemory() const = 0;
+  /*! \brief The amount of freed memory held by the allocator for reuse.
+   *  \return The amount of memory held for reuse.
+   */
+  virtual size_t CachedMemory() const { return 0; }
+  /*! \brief The number of allocations served from freed buffers.
+   *  \return The number of reused buffers.
+   */
+  virtual size_t NumReused() const { return 0; }
+  /*! \brief The type of the allocator. */
+  AllocatorType type() const { return type_; }
   virtual ~Allocator() = default;
+
+ private:
+  AllocatorType type_;
 };
 
 class MemoryManager {
  public:
   static MemoryManager* Global();
 
+  /*!
+   * \brief Get the allocator of a context, creating a naive one if none exists.
+   * \param ctx The context.
+   * \return The allocator.
+   */
   Allocator* GetAllocator(TVMContext ctx);
+  /*!
+   * \brief Get the allocator of the given type of a context, creating it if none exists.
+   *  The allocators are never destroyed, so buffers can hold on to them.
+   * \param ctx The context.
+   * \param type The allocator type.
+   * \return The allocator.
+   */
+  Allocator* GetAllocator(TVMContext ctx, AllocatorType type);
 
  private:
   MemoryManager() {}
 
  private:
   std::mutex mu_;
-  std::unordered_map<TVMContext, std::unique_ptr<Allocator> > allocators_;
+  /*! \brief The allocators of each context, indexed by the allocator type. */
+  std::unordered_map<TVMContext, std::unique_ptr<Allocator> > allocators_[kBucketed + 1];
 };
 
 /*! \brief An object representing a storage allocation. */
@@ -113,8 +153,16 @@ class StorageObj : public Object {
  public:
   /*! \brief The index into the VM function table. */
   Buffer buffer;
-
-  /*! \brief Allocate an NDArray from a given piece of storage. */
+  /*! \brief The allocator the buffer is freed to. */
+  Allocator* allocator{nullptr};
+
+  /*!
+   * \brief Allocate an NDArray from a given piece of storage.
+   * \param offset The byte offset of the array in the storage, tensors of a
+   *  storage planned at compile time may share it at different offsets.
+   * \param shape The shape of the array.
+   * \param dtype The data type of the array.
+   */
   NDArray AllocNDArray(size_t offset,
                        std::vector<int64_t> shape,
                        DLDataType dtype);
@@ -123,8 +171,7 @@ class StorageObj : public Object {
   static void Deleter(Object* ptr);
 
   ~StorageObj() {
-    auto alloc = MemoryManager::Global()->GetAllocator(buffer.ctx);
-    alloc->Free(buffer);
+    allocator->Free(buffer);
   }
 
   static constexpr const uint32_t _type_index = TypeIndex::kDynamic;
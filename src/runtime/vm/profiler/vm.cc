@@ -30,71 +30,204 @@
 #include <iomanip>
 #include <memory>
 #include <numeric>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "../memory_manager.h"
 #include "vm.h"
 
 namespace tvm {
 namespace runtime {
 namespace vm {
 
+/*! \brief The name of an opcode, as printed in the bytecode. */
+static const char* OpcodeName(Opcode op) {
+  switch (op) {
+    case Opcode::Move: return "move";
+    case Opcode::Ret: return "ret";
+    case Opcode::Invoke: return "invoke";
+    case Opcode::InvokeClosure: return "invoke_closure";
+    case Opcode::InvokePacked: return "invoke_packed";
+    case Opcode::AllocTensor: return "alloc_tensor";
+    case Opcode::AllocTensorReg: return "alloc_tensor_reg";
+    case Opcode::AllocADT: return "alloc_data";
+    case Opcode::AllocClosure: return "alloc_closure";
+    case Opcode::GetField: return "get_field";
+    case Opcode::If: return "if";
+    case Opcode::LoadConst: return "load_const";
+    case Opcode::Goto: return "goto";
+    case Opcode::GetTag: return "get_tag";
+    case Opcode::LoadConsti: return "load_consti";
+    case Opcode::Fatal: return "fatal";
+    case Opcode::AllocStorage: return "alloc_storage";
+    case Opcode::InvokeShapeFunc: return "invoke_shape_func";
+    case Opcode::AllocStorageTensor: return "alloc_storage_tensor";
+    case Opcode::InvokePackedConst: return "invoke_packed_const";
+  }
+  return "unknown";
+}
+
+/*! \brief Write a string as a JSON string literal. */
+static void WriteJSONString(std::ostream& os, const std::string& str) {
+  os << '"';
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+         << std::dec << std::setfill(' ');
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
 PackedFunc VirtualMachineDebug::GetFunction(
     const std::string& name, const ObjectPtr<Object>& sptr_to_self) {
   if (name == "get_stat") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
       CHECK_EQ(args.size(), 1U);
-      std::vector<std::pair<Index, double>> op_acc_time;
-      for (auto kv : op_durations_) {
-        auto val = std::make_pair(
-            kv.first, std::accumulate(kv.second.begin(), kv.second.end(), 0.0));
-        op_acc_time.push_back(val);
-      }
-      bool sort_by_time = args[0];
-      if (sort_by_time) {
-        auto comp = [](const std::pair<Index, double>& lhs,
-                       const std::pair<Index, double>& rhs) {
-          return lhs.second > rhs.second;
-        };
-        std::sort(op_acc_time.begin(), op_acc_time.end(), comp);
-      }
-      double total_duration = 0.0;
-      int64_t total_packed_funcs = 0;
-      std::ostringstream os;
-      os << std::setw(30) << std::left << "#OpName"
-         << "\t" << std::setw(10) << std::left << "#InvokeCount"
-         << "\t"
-         << "#Duration(us): Sum/Mean/Min/Max" << std::endl;
-
-      for (auto kv : op_acc_time) {
-        auto vals = op_durations_[kv.first];
-        auto sum = kv.second;
-        auto mean = sum / static_cast<double>(vals.size());
-        auto min_value = *std::min_element(vals.begin(), vals.end());
-        auto max_value = *std::max_element(vals.begin(), vals.end());
-
-        os << std::setw(30) << std::left << packed_index_map_[kv.first] << "\t"
-           << std::setw(10) << std::left << op_invokes_[kv.first] << "\t"
-           <<  sum << "/" << mean << "/" << min_value << "/" << max_value << std::endl;
-
-        total_duration += sum;
-        total_packed_funcs += op_invokes_[kv.first];
-      }
-      os << "\nTotal Duration: " << total_duration << " us.\t"
-         << "Total Packed Functions: " << total_packed_funcs << std::endl;
-      *rv = os.str();
+      *rv = GetStat(args[0]);
+    });
+  } else if (name == "get_chrome_trace") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      *rv = GetChromeTrace();
     });
   } else if (name == "reset") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
-      op_durations_.clear();
-      op_invokes_.clear();
+      Reset();
     });
   } else {
     return VirtualMachine::GetFunction(name, sptr_to_self);
   }
 }
 
+std::string VirtualMachineDebug::GetStat(bool sort_by_time) {
+  std::vector<std::pair<Index, double>> op_acc_time;
+  for (auto kv : op_durations_) {
+    auto val = std::make_pair(
+        kv.first, std::accumulate(kv.second.begin(), kv.second.end(), 0.0));
+    op_acc_time.push_back(val);
+  }
+  auto comp = [](const auto& lhs, const auto& rhs) {
+    return lhs.second > rhs.second;
+  };
+  if (sort_by_time) {
+    std::sort(op_acc_time.begin(), op_acc_time.end(), comp);
+  }
+  double total_duration = 0.0;
+  int64_t total_packed_funcs = 0;
+  std::ostringstream os;
+  os << std::setw(30) << std::left << "#OpName"
+     << "\t" << std::setw(10) << std::left << "#InvokeCount"
+     << "\t"
+     << "#Duration(us): Sum/Mean/Min/Max" << std::endl;
+
+  for (auto kv : op_acc_time) {
+    auto vals = op_durations_[kv.first];
+    auto sum = kv.second;
+    auto mean = sum / static_cast<double>(vals.size());
+    auto min_value = *std::min_element(vals.begin(), vals.end());
+    auto max_value = *std::max_element(vals.begin(), vals.end());
+
+    os << std::setw(30) << std::left << packed_index_map_[kv.first] << "\t"
+       << std::setw(10) << std::left << op_invokes_[kv.first] << "\t"
+       <<  sum << "/" << mean << "/" << min_value << "/" << max_value << std::endl;
+
+    total_duration += sum;
+    total_packed_funcs += op_invokes_[kv.first];
+  }
+  os << "\nTotal Duration: " << total_duration << " us.\t"
+     << "Total Packed Functions: " << total_packed_funcs << std::endl;
+
+  std::vector<std::pair<int, double>> opcode_time;
+  for (const auto& kv : opcode_stats_) {
+    opcode_time.emplace_back(kv.first, kv.second.duration);
+  }
+  if (sort_by_time) {
+    std::sort(opcode_time.begin(), opcode_time.end(), comp);
+  } else {
+    std::sort(opcode_time.begin(), opcode_time.end());
+  }
+  os << "\n" << std::setw(30) << std::left << "#Opcode"
+     << "\t" << std::setw(10) << std::left << "#Count"
+     << "\t"
+     << "#Duration(us): Sum/Mean" << std::endl;
+  for (const auto& kv : opcode_time) {
+    const OpcodeStat& stat = opcode_stats_[kv.first];
+    os << std::setw(30) << std::left << OpcodeName(static_cast<Opcode>(kv.first)) << "\t"
+       << std::setw(10) << std::left << stat.count << "\t"
+       << stat.duration << "/" << stat.duration / stat.count << std::endl;
+  }
+
+  double interpreter_duration = total_duration_ - total_kernel_duration_;
+  auto percent = [this](double duration) {
+    return total_duration_ > 0 ? duration / total_duration_ * 100 : 0.0;
+  };
+  os << "\nStorage Allocations: " << num_allocs_ << "\t"
+     << "Bytes: " << alloc_bytes_ << "\t"
+     << "Latency(us): " << alloc_duration_ << std::endl;
+  os << "Frames Pushed: " << num_frames_pushed_ << "\t"
+     << "Frames Popped: " << num_frames_popped_ << std::endl;
+  os << "Instruction Duration: " << total_duration_ << " us.\t"
+     << "Kernel: " << total_kernel_duration_ << " us (" << percent(total_kernel_duration_)
+     << "%).\t"
+     << "Interpreter: " << interpreter_duration << " us (" << percent(interpreter_duration)
+     << "%)." << std::endl;
+  return os.str();
+}
+
+std::string VirtualMachineDebug::GetChromeTrace() {
+  // Each instruction is a complete event on a single thread, so that the
+  // kernel it runs nests under it. The timestamps count the time accounted
+  // to the instructions, without the overhead of profiling.
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(3);
+  os << "{\"traceEvents\": [";
+  for (size_t i = 0; i < trace_events_.size(); ++i) {
+    const TraceEvent& event = trace_events_[i];
+    const char* category = "interpreter";
+    std::string name = OpcodeName(event.op);
+    if (event.packed_index >= 0) {
+      category = "kernel";
+      name = packed_index_map_[event.packed_index];
+    } else if (event.op == Opcode::AllocStorage || event.op == Opcode::AllocStorageTensor) {
+      category = "alloc";
+    }
+    os << (i == 0 ? "\n" : ",\n") << "  {\"name\": ";
+    WriteJSONString(os, name);
+    os << ", \"cat\": \"" << category << "\", \"ph\": \"X\", \"ts\": " << event.ts
+       << ", \"dur\": " << event.dur << ", \"pid\": 0, \"tid\": 0";
+    if (event.bytes > 0) {
+      os << ", \"args\": {\"bytes\": " << event.bytes << "}";
+    }
+    os << "}";
+  }
+  os << "\n], \"displayTimeUnit\": \"ns\", \"otherData\": {\"dropped_events\": "
+     << num_dropped_events_ << "}}";
+  return os.str();
+}
+
+void VirtualMachineDebug::Reset() {
+  op_durations_.clear();
+  for (auto& kv : op_invokes_) {
+    kv.second = 0;
+  }
+  opcode_stats_.clear();
+  num_allocs_ = 0;
+  alloc_bytes_ = 0;
+  alloc_duration_ = 0;
+  total_duration_ = 0;
+  total_kernel_duration_ = 0;
+  num_frames_pushed_ = 0;
+  num_frames_popped_ = 0;
+  trace_events_.clear();
+  num_dropped_events_ = 0;
+}
+
 void VirtualMachineDebug::LoadExecutable(const Executable* exec) {
   VirtualMachine::LoadExecutable(exec);
   CHECK(exec_);
@@ -111,6 +244,7 @@ void VirtualMachineDebug::InvokePacked(Index packed_index,
   CHECK(exec_);
   auto ctx = this->GetParamsContext();
   // warmup
+  auto warmup_begin = std::chrono::high_resolution_clock::now();
   VirtualMachine::InvokePacked(packed_index, func, arg_count, output_size, args);
   TVMSynchronize(ctx.device_type, ctx.device_id, nullptr);
 
@@ -125,6 +259,49 @@ void VirtualMachineDebug::InvokePacked(Index packed_index,
 
   op_durations_[packed_index].push_back(op_duration * 1e6);
   op_invokes_[packed_index] += 1;
+  // The warmup run is not accounted to the instruction invoking the kernel.
+  warmup_duration_ +=
+      std::chrono::duration_cast<std::chrono::duration<double, std::micro> >(op_begin -
+                                                                             warmup_begin)
+          .count();
+  kernel_index_ = packed_index;
+  kernel_duration_ += op_duration * 1e6;
+}
+
+void VirtualMachineDebug::ProfileInstruction(const Instruction& instr, double duration) {
+  duration = std::max(duration - warmup_duration_, kernel_duration_);
+  OpcodeStat& stat = opcode_stats_[static_cast<int>(instr.op)];
+  stat.count += 1;
+  stat.duration += duration;
+
+  int64_t bytes = 0;
+  if (instr.op == Opcode::AllocStorage) {
+    bytes = Downcast<Storage>(registers_[instr.dst])->buffer.size;
+  } else if (instr.op == Opcode::AllocStorageTensor) {
+    bytes = instr.alloc_storage_tensor.allocation_size;
+  }
+  if (instr.op == Opcode::AllocStorage || instr.op == Opcode::AllocStorageTensor) {
+    num_allocs_ += 1;
+    alloc_bytes_ += bytes;
+    alloc_duration_ += duration;
+  }
+
+  if (trace_events_.size() + (kernel_index_ >= 0) < kMaxTraceEvents) {
+    trace_events_.push_back({instr.op, -1, total_duration_, duration, bytes});
+    if (kernel_index_ >= 0) {
+      // The kernel runs at the end of the instruction.
+      trace_events_.push_back({instr.op, kernel_index_,
+                               total_duration_ + duration - kernel_duration_, kernel_duration_,
+                               0});
+    }
+  } else {
+    num_dropped_events_ += 1;
+  }
+  total_duration_ += duration;
+  total_kernel_duration_ += kernel_duration_;
+  kernel_index_ = -1;
+  kernel_duration_ = 0;
+  warmup_duration_ = 0;
 }
 
 runtime::Module CreateVirtualMachineDebug(const Executable* exec) {
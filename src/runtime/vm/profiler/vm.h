@@ -38,7 +38,7 @@ namespace vm {
 
 class VirtualMachineDebug : public VirtualMachine {
  public:
-  VirtualMachineDebug() : VirtualMachine() {}
+  VirtualMachineDebug() : VirtualMachine() { profile_instructions_ = true; }
 
   PackedFunc GetFunction(const std::string& name,
                          const ObjectPtr<Object>& sptr_to_self) final;
@@ -51,9 +51,56 @@ class VirtualMachineDebug : public VirtualMachine {
   void InvokePacked(Index packed_index, const PackedFunc& func, Index arg_count,
                     Index output_size, const std::vector<ObjectRef>& args) final;
 
+  void ProfileInstruction(const Instruction& instr, double duration) final;
+
+  /*! \brief Format the collected statistics as text tables. */
+  std::string GetStat(bool sort_by_time);
+
+  /*! \brief Format the recorded events in the Chrome trace event JSON format. */
+  std::string GetChromeTrace();
+
+  /*! \brief Clear the collected statistics and events. */
+  void Reset();
+
+  /*! \brief The executions of an opcode. */
+  struct OpcodeStat {
+    int64_t count{0};
+    double duration{0};
+  };
+
+  /*! \brief An executed instruction, or the kernel run by one. */
+  struct TraceEvent {
+    Opcode op;
+    /*! \brief The packed function for a kernel event, -1 otherwise. */
+    Index packed_index;
+    /*! \brief The start and the duration of the event in microseconds. */
+    double ts;
+    double dur;
+    /*! \brief The bytes allocated by the instruction. */
+    int64_t bytes;
+  };
+
+  /*! \brief The maximum number of trace events kept, later ones are dropped. */
+  static constexpr size_t kMaxTraceEvents = 1 << 20;
+
   std::unordered_map<Index, std::string> packed_index_map_;
   std::unordered_map<Index, std::vector<double>> op_durations_;
   std::unordered_map<Index, int> op_invokes_;
+  std::unordered_map<int, OpcodeStat> opcode_stats_;
+  /*! \brief The number, total bytes and total latency of the storage allocations. */
+  int64_t num_allocs_{0};
+  int64_t alloc_bytes_{0};
+  double alloc_duration_{0};
+  /*! \brief The timed kernel runs of the instruction being executed. */
+  Index kernel_index_{-1};
+  double kernel_duration_{0};
+  /*! \brief The warmup kernel runs of the instruction being executed, not accounted to it. */
+  double warmup_duration_{0};
+  /*! \brief The time accounted to all instructions, and to their kernels. */
+  double total_duration_{0};
+  double total_kernel_duration_{0};
+  std::vector<TraceEvent> trace_events_;
+  size_t num_dropped_events_{0};
 };
 
 }  // namespace vm
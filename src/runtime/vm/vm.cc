@@ -52,13 +52,13 @@ VMClosure::VMClosure(size_t func_index, std::vector<ObjectRef> free_vars) {
   data_ = std::move(ptr);
 }
 
-inline Storage make_storage(size_t size, size_t alignment, DLDataType dtype_hint, TVMContext ctx) {
-  // We could put cache in here, from ctx to storage allocator.
+inline Storage make_storage(size_t size, size_t alignment, DLDataType dtype_hint,
+                            Allocator* alloc) {
   auto storage_obj = SimpleObjAllocator().make_object<StorageObj>();
-  auto alloc = MemoryManager::Global()->GetAllocator(ctx);
   DCHECK(alloc != nullptr)
     << "allocator must not null";
   storage_obj->buffer = alloc->Alloc(size, alignment, dtype_hint);
+  storage_obj->allocator = alloc;
   return Storage(storage_obj);
 }
 
@@ -86,6 +86,7 @@ Instruction::Instruction(const Instruction& instr) {
       return;
     case Opcode::AllocTensor:
       this->alloc_tensor.storage = instr.alloc_tensor.storage;
+      this->alloc_tensor.offset = instr.alloc_tensor.offset;
       this->alloc_tensor.ndim = instr.alloc_tensor.ndim;
       this->alloc_tensor.shape = Duplicate<int64_t>(instr.alloc_tensor.shape,
                                                     instr.alloc_tensor.ndim);
@@ -107,6 +108,8 @@ Instruction::Instruction(const Instruction& instr) {
       this->free_vars = Duplicate<RegName>(instr.free_vars, instr.num_freevar);
       return;
     case Opcode::InvokePacked:
+    case Opcode::InvokeShapeFunc:
+    case Opcode::InvokePackedConst:
       this->packed_index = instr.packed_index;
       this->arity = instr.arity;
       this->output_size = instr.output_size;
@@ -144,6 +147,11 @@ Instruction::Instruction(const Instruction& instr) {
     case Opcode::AllocStorage:
       this->alloc_storage = instr.alloc_storage;
       return;
+    case Opcode::AllocStorageTensor:
+      this->alloc_storage_tensor = instr.alloc_storage_tensor;
+      this->alloc_storage_tensor.shape = Duplicate<int64_t>(instr.alloc_storage_tensor.shape,
+                                                            instr.alloc_storage_tensor.ndim);
+      return;
     default:
       std::ostringstream out;
       out << "Invalid instruction " << static_cast<int>(instr.op);
@@ -175,7 +183,8 @@ Instruction& Instruction::operator=(const Instruction& instr) {
       this->result = instr.result;
       return *this;
     case Opcode::AllocTensor:
-      this->alloc_tensor.storage = this->alloc_tensor.storage;
+      this->alloc_tensor.storage = instr.alloc_tensor.storage;
+      this->alloc_tensor.offset = instr.alloc_tensor.offset;
       this->alloc_tensor.ndim = instr.alloc_tensor.ndim;
       this->alloc_tensor.shape = Duplicate<int64_t>(instr.alloc_tensor.shape,
                                                     instr.alloc_tensor.ndim);
@@ -199,6 +208,8 @@ Instruction& Instruction::operator=(const Instruction& instr) {
       this->free_vars = Duplicate<RegName>(instr.free_vars, instr.num_freevar);
       return *this;
     case Opcode::InvokePacked:
+    case Opcode::InvokeShapeFunc:
+    case Opcode::InvokePackedConst:
       this->packed_index = instr.packed_index;
       this->arity = instr.arity;
       this->output_size = instr.output_size;
@@ -236,6 +247,11 @@ Instruction& Instruction::operator=(const Instruction& instr) {
     case Opcode::AllocStorage:
       this->alloc_storage = instr.alloc_storage;
       return *this;
+    case Opcode::AllocStorageTensor:
+      this->alloc_storage_tensor = instr.alloc_storage_tensor;
+      this->alloc_storage_tensor.shape = Duplicate<int64_t>(instr.alloc_storage_tensor.shape,
+                                                            instr.alloc_storage_tensor.ndim);
+      return *this;
     default:
       std::ostringstream out;
       out << "Invalid instruction " << static_cast<int>(instr.op);
@@ -260,6 +276,9 @@ Instruction::~Instruction() {
     case Opcode::AllocTensor:
       delete this->alloc_tensor.shape;
       return;
+    case Opcode::AllocStorageTensor:
+      delete this->alloc_storage_tensor.shape;
+      return;
     case Opcode::AllocADT:
       delete this->datatype_fields;
       return;
@@ -267,6 +286,8 @@ Instruction::~Instruction() {
       delete this->free_vars;
       return;
     case Opcode::InvokePacked:
+    case Opcode::InvokeShapeFunc:
+    case Opcode::InvokePackedConst:
       delete this->packed_args;
       return;
     case Opcode::InvokeClosure:
@@ -310,14 +331,34 @@ Instruction Instruction::InvokePacked(Index packed_index,
   return instr;
 }
 
+Instruction Instruction::InvokeShapeFunc(Index packed_index,
+                                         Index arity,
+                                         Index output_size,
+                                         const std::vector<RegName>& args) {
+  Instruction instr = InvokePacked(packed_index, arity, output_size, args);
+  instr.op = Opcode::InvokeShapeFunc;
+  return instr;
+}
+
+Instruction Instruction::InvokePackedConst(Index packed_index,
+                                           Index arity,
+                                           Index output_size,
+                                           const std::vector<RegName>& args) {
+  Instruction instr = InvokePacked(packed_index, arity, output_size, args);
+  instr.op = Opcode::InvokePackedConst;
+  return instr;
+}
+
 Instruction Instruction::AllocTensor(
   RegName storage,
+  Index offset,
   const std::vector<int64_t>& shape,
   DLDataType dtype, Index dst) {
   Instruction instr;
   instr.op = Opcode::AllocTensor;
   instr.dst = dst;
   instr.alloc_tensor.storage = storage;
+  instr.alloc_tensor.offset = offset;
   instr.alloc_tensor.ndim = shape.size();
   instr.alloc_tensor.shape = new int64_t[shape.size()];
   for (size_t i = 0; i < shape.size(); ++i) {
@@ -353,6 +394,27 @@ Instruction Instruction::AllocStorage(RegName size,
   return instr;
 }
 
+Instruction Instruction::AllocStorageTensor(Index size,
+                                            Index alignment,
+                                            DLDataType dtype_hint,
+                                            const std::vector<int64_t>& shape,
+                                            DLDataType dtype,
+                                            Index dst) {
+  Instruction instr;
+  instr.op = Opcode::AllocStorageTensor;
+  instr.dst = dst;
+  instr.alloc_storage_tensor.allocation_size = size;
+  instr.alloc_storage_tensor.alignment = alignment;
+  instr.alloc_storage_tensor.dtype_hint = dtype_hint;
+  instr.alloc_storage_tensor.ndim = shape.size();
+  instr.alloc_storage_tensor.shape = new int64_t[shape.size()];
+  for (size_t i = 0; i < shape.size(); ++i) {
+    instr.alloc_storage_tensor.shape[i] = shape[i];
+  }
+  instr.alloc_storage_tensor.dtype = dtype;
+  return instr;
+}
+
 Instruction Instruction::AllocADT(Index tag, Index num_fields,
                                        const std::vector<RegName>& datatype_fields, Index dst) {
   Instruction instr;
@@ -513,8 +575,10 @@ void InstructionPrint(std::ostream& os, const Instruction& instr) {
       os << "fatal";
       break;
     }
-    case Opcode::InvokePacked: {
-      os << "invoke_packed PackedFunc[" << instr.packed_index << "] (in: $"
+    case Opcode::InvokePacked:
+    case Opcode::InvokeShapeFunc: {
+      os << (instr.op == Opcode::InvokePacked ? "invoke_packed" : "invoke_shape_func")
+         << " PackedFunc[" << instr.packed_index << "] (in: $"
          << StrJoin<RegName>(instr.packed_args, 0,
                              instr.arity - instr.output_size, ", $")
          << ", out: $"
@@ -523,9 +587,27 @@ void InstructionPrint(std::ostream& os, const Instruction& instr) {
          << ")";
       break;
     }
+    case Opcode::InvokePackedConst: {
+      os << "invoke_packed_const PackedFunc[" << instr.packed_index << "] (in: ";
+      for (Index i = 0; i < instr.arity - instr.output_size; ++i) {
+        RegName arg = instr.packed_args[i];
+        os << (i == 0 ? "" : ", ");
+        if (arg >= 0) {
+          os << "$" << arg;
+        } else {
+          os << "Const[" << -1 - arg << "]";
+        }
+      }
+      os << ", out: $"
+         << StrJoin<RegName>(instr.packed_args, instr.arity - instr.output_size,
+                             instr.output_size, ", $")
+         << ")";
+      break;
+    }
     case Opcode::AllocTensor: {
       os << "alloc_tensor $" << instr.dst << " $"
-         << instr.alloc_tensor.storage << " ["
+         << instr.alloc_tensor.storage << " "
+         << instr.alloc_tensor.offset << " ["
          << StrJoin<int64_t>(instr.alloc_tensor.shape, 0,
                              instr.alloc_tensor.ndim)
          << "] ";
@@ -596,6 +678,17 @@ void InstructionPrint(std::ostream& os, const Instruction& instr) {
         DLDataType2String(instr.alloc_storage.dtype_hint);
       break;
     }
+    case Opcode::AllocStorageTensor: {
+      os << "alloc_storage_tensor $" << instr.dst << " "
+         << instr.alloc_storage_tensor.allocation_size << " "
+         << instr.alloc_storage_tensor.alignment << " "
+         << DLDataType2String(instr.alloc_storage_tensor.dtype_hint) << " ["
+         << StrJoin<int64_t>(instr.alloc_storage_tensor.shape, 0,
+                             instr.alloc_storage_tensor.ndim)
+         << "] ";
+      DLDatatypePrint(os, instr.alloc_storage_tensor.dtype);
+      break;
+    }
     default:
       LOG(FATAL) << "should never hit this case" << static_cast<int>(instr.op);
       break;
@@ -638,7 +731,7 @@ PackedFunc VirtualMachine::GetFunction(const std::string& name,
       auto git = exec_->global_map.find(func_name);
       CHECK(git != exec_->global_map.end())
         << "Cannot find function " << func_name << " in the executable";
-      auto func = exec_->functions[git->second];
+      const auto& func = exec_->GetVMFunction(git->second);
       if (func.params.empty()) {
         *rv = Invoke(func, {});
       } else {
@@ -650,16 +743,53 @@ PackedFunc VirtualMachine::GetFunction(const std::string& name,
     });
   } else if (name == "init") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
-      CHECK_EQ(args.size() % 2, 0);
+      // (device_type, device_id) pairs, optionally followed by the allocator type.
+      AllocatorType type = kNaive;
+      if (args.size() % 2 == 1) {
+        type = static_cast<AllocatorType>(static_cast<int>(args[args.size() - 1]));
+      }
       std::vector<TVMContext> contexts;
+      std::vector<Allocator*> allocators;
       for (int i = 0; i < args.size() / 2; ++i) {
         TVMContext ctx;
         int device_type = args[i * 2];
         ctx.device_type = DLDeviceType(device_type);
         ctx.device_id = args[i * 2 + 1];
         contexts.push_back(ctx);
+        allocators.push_back(MemoryManager::Global()->GetAllocator(ctx, type));
       }
-      this->Init(contexts);
+      this->Init(contexts, allocators);
+    });
+  } else if (name == "share") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      *rv = this->Share();
+    });
+  } else if (name == "get_num_executed") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      *rv = static_cast<int64_t>(num_executed_);
+    });
+  } else if (name == "get_used_memory") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      CHECK(!allocators_.empty()) << "The virtual machine has not been initialized yet.";
+      *rv = static_cast<int64_t>(allocators_[0]->UsedMemory());
+    });
+  } else if (name == "get_cached_memory") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      CHECK(!allocators_.empty()) << "The virtual machine has not been initialized yet.";
+      *rv = static_cast<int64_t>(allocators_[0]->CachedMemory());
+    });
+  } else if (name == "get_num_reused") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      CHECK(!allocators_.empty()) << "The virtual machine has not been initialized yet.";
+      *rv = static_cast<int64_t>(allocators_[0]->NumReused());
+    });
+  } else if (name == "get_shape_func_cache_hits") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      *rv = static_cast<int64_t>(shape_func_cache_hits_);
+    });
+  } else if (name == "get_shape_func_cache_misses") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      *rv = static_cast<int64_t>(shape_func_cache_misses_);
     });
   } else if (name == "set_input") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
@@ -668,7 +798,7 @@ PackedFunc VirtualMachine::GetFunction(const std::string& name,
       auto gvit = exec_->global_map.find(func_name);
       CHECK(gvit != exec_->global_map.end()) << "Cannot find function " << func_name;
       auto func_index = gvit->second;
-      const auto& vm_func = exec_->functions[func_index];
+      const auto& vm_func = exec_->GetVMFunction(func_index);
       const auto& param_names = vm_func.params;
       // TODO(icemelon9): For heterogeneous execution, get input device information
       TVMContext ctx = ctxs_[0];
@@ -703,8 +833,17 @@ TVMContext VirtualMachine::GetParamsContext() const {
 }
 
 void VirtualMachine::PushFrame(Index arg_count, Index ret_pc, const VMFunction& vm_func) {
-  auto frame = VMFrame(ret_pc, func_index_, arg_count, code_, vm_func.register_file_size);
-  frames_.push_back(frame);
+  Index base = 0;
+  if (!frames_.empty()) {
+    base = frames_.back().register_base + frames_.back().register_file_size;
+  }
+  size_t top = static_cast<size_t>(base + vm_func.register_file_size);
+  if (register_stack_.size() < top) {
+    register_stack_.resize(std::max(top, register_stack_.size() * 2));
+  }
+  frames_.emplace_back(ret_pc, func_index_, arg_count, code_, base, vm_func.register_file_size);
+  registers_ = register_stack_.data() + base;
+  ++num_frames_pushed_;
 }
 
 Index VirtualMachine::PopFrame() {
@@ -713,8 +852,13 @@ Index VirtualMachine::PopFrame() {
   func_index_ = fr.func_index;
   code_ = fr.code;
   pc_ = fr.pc;
+  std::fill(registers_, registers_ + fr.register_file_size, ObjectRef());
   auto call_stack_size = frames_.size();
   frames_.pop_back();
+  ++num_frames_popped_;
+  if (!frames_.empty()) {
+    registers_ = register_stack_.data() + frames_.back().register_base;
+  }
   return call_stack_size;
 }
 
@@ -736,9 +880,7 @@ ObjectRef VirtualMachine::Invoke(const VMFunction& func, const std::vector<Objec
 
   InvokeGlobal(func, args);
   RunLoop();
-  // TODO(wweic) ctx could be obtained from the ctxs list.
-  auto alloc = MemoryManager::Global()->GetAllocator(ctxs_[0]);
-  DLOG(INFO) << "Memory used: " << alloc->UsedMemory() << " B";
+  DLOG(INFO) << "Memory used: " << allocators_[0]->UsedMemory() << " B";
   return return_register_;
 }
 
@@ -749,7 +891,7 @@ ObjectRef VirtualMachine::Invoke(const std::string& name, const std::vector<Obje
     << "Cannot find function " << name << " in the executable";
   auto func_index_ = it->second;
   DLOG(INFO) << "Invoke Global " << name << " at index " << func_index_;
-  return Invoke(exec_->functions[func_index_], args);
+  return Invoke(exec_->GetVMFunction(func_index_), args);
 }
 
 void VirtualMachine::InvokePacked(Index packed_index, const PackedFunc& func,
@@ -764,9 +906,14 @@ void VirtualMachine::InvokePacked(Index packed_index, const PackedFunc& func,
     }
   }
 
-  std::vector<TVMValue> values(arity);
-  std::vector<int> codes(arity);
-  runtime::TVMArgsSetter setter(values.data(), codes.data());
+  // The scratch space only grows, so the steady state does not allocate.
+  if (packed_values_.size() < arity) {
+    packed_values_.resize(arity);
+    packed_codes_.resize(arity);
+  }
+  TVMValue* values = packed_values_.data();
+  int* codes = packed_codes_.data();
+  runtime::TVMArgsSetter setter(values, codes);
   int idx = 0;
   for (Index i = 0; i < arg_count; i++) {
     if (const auto* dt_cell = args[i].as<ADTObj>()) {
@@ -782,48 +929,154 @@ void VirtualMachine::InvokePacked(Index packed_index, const PackedFunc& func,
   }
 
   TVMRetValue rv;
-  func.CallPacked(TVMArgs(values.data(), codes.data(), arity), &rv);
+  func.CallPacked(TVMArgs(values, codes, static_cast<int>(arity)), &rv);
+}
+
+/*! \brief The largest inputs of a shape function kept as a cache key. */
+constexpr size_t kMaxShapeFuncKeyBytes = 1024;
+/*! \brief The number of cached calls kept for each shape function. */
+constexpr size_t kMaxShapeFuncCacheEntries = 256;
+
+void VirtualMachine::InvokeShapeFunc(Index packed_index, const PackedFunc& func,
+                                     Index arg_count, Index output_size,
+                                     const std::vector<ObjectRef>& args) {
+  // Shape functions are pure, so the outputs only depend on the content of
+  // the inputs, which are shapes or small data-dependent tensors on the CPU.
+  std::string key;
+  bool cacheable = true;
+  for (Index i = 0; i < arg_count && cacheable; ++i) {
+    const auto* array = args[i].as<NDArray::Container>();
+    if (array == nullptr || array->dl_tensor.ctx.device_type != kDLCPU) {
+      cacheable = false;
+      break;
+    }
+    if (i >= arg_count - output_size) continue;
+    const DLTensor& tensor = array->dl_tensor;
+    size_t nbytes = GetDataSize(tensor);
+    if (key.size() + nbytes > kMaxShapeFuncKeyBytes) {
+      cacheable = false;
+      break;
+    }
+    key.append(reinterpret_cast<const char*>(&tensor.dtype), sizeof(tensor.dtype));
+    key.append(reinterpret_cast<const char*>(&tensor.ndim), sizeof(tensor.ndim));
+    key.append(reinterpret_cast<const char*>(tensor.shape), tensor.ndim * sizeof(int64_t));
+    key.append(static_cast<const char*>(tensor.data) + tensor.byte_offset, nbytes);
+  }
+  if (cacheable) {
+    auto& cache = shape_func_cache_[packed_index];
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+      ++shape_func_cache_hits_;
+      for (Index i = 0; i < output_size; ++i) {
+        Downcast<NDArray>(args[arg_count - output_size + i]).CopyFrom(it->second[i]);
+      }
+      return;
+    }
+  }
+  ++shape_func_cache_misses_;
+  InvokePacked(packed_index, func, arg_count, output_size, args);
+  if (cacheable) {
+    auto& cache = shape_func_cache_[packed_index];
+    if (cache.size() >= kMaxShapeFuncCacheEntries) {
+      cache.clear();
+    }
+    std::vector<NDArray> outputs;
+    for (Index i = 0; i < output_size; ++i) {
+      outputs.push_back(Downcast<NDArray>(args[arg_count - output_size + i]).CopyTo({kDLCPU, 0}));
+    }
+    cache.emplace(std::move(key), std::move(outputs));
+  }
 }
 
 void VirtualMachine::LoadExecutable(const Executable* exec) {
   CHECK(exec) << "The executable is not created yet.";
   exec_ = exec;
+  // A new state, the virtual machines sharing the previous one keep it.
+  loaded_ = std::make_shared<LoadedExecutable>();
 
   runtime::Module lib = exec_->lib;
   // Get the list of packed functions.
   CHECK(exec->primitive_map.empty() || lib.operator->())
       << "runtime module should have been built for primitive functions"
       << "\n";
+  auto& packed_funcs = loaded_->packed_funcs;
   for (const auto& it : exec_->primitive_map) {
     const auto& packed_name = it.first;
     auto packed_index = static_cast<size_t>(it.second);
-    if (packed_funcs_.size() <= packed_index) {
-      packed_funcs_.resize(packed_index + 1);
+    if (packed_funcs.size() <= packed_index) {
+      packed_funcs.resize(packed_index + 1);
     }
     tvm::runtime::PackedFunc pf = lib.GetFunction(packed_name, true);
     CHECK(pf != nullptr) << "Cannot find function in module: " << packed_name;
-    packed_funcs_[packed_index] = pf;
+    packed_funcs[packed_index] = pf;
   }
+  loaded_->const_pool.resize(exec_->constants.size());
 }
 
 
-void VirtualMachine::Init(const std::vector<TVMContext>& ctxs) {
+void VirtualMachine::Init(const std::vector<TVMContext>& ctxs,
+                          const std::vector<Allocator*>& allocators) {
+  CHECK(exec_) << "The executable is not created yet.";
+  bool same_ctxs = ctxs.size() == ctxs_.size();
+  for (size_t i = 0; same_ctxs && i < ctxs.size(); ++i) {
+    same_ctxs = ctxs[i].device_type == ctxs_[i].device_type &&
+                ctxs[i].device_id == ctxs_[i].device_id;
+  }
+  if (!same_ctxs) {
+    CHECK_EQ(loaded_.use_count(), 1)
+        << "The contexts of a virtual machine sharing its executable cannot change";
+    // The constants are loaded again on the new contexts.
+    std::fill(loaded_->const_pool.begin(), loaded_->const_pool.end(), ObjectRef());
+  }
   ctxs_ = ctxs;
+  allocators_ = allocators;
+}
+
+runtime::Module VirtualMachine::Share() {
+  CHECK(exec_) << "The executable is not created yet.";
+  CHECK(!ctxs_.empty()) << "The virtual machine must be initialized before being shared.";
+  // Load all the constants, the virtual machines sharing them only read them.
+  auto& const_pool = loaded_->const_pool;
+  for (size_t i = 0; i < const_pool.size(); ++i) {
+    if (!const_pool[i].defined()) {
+      const_pool[i] = CopyTo(exec_->constants[i], ctxs_[0]);
+    }
+  }
+  auto vm = make_object<VirtualMachine>();
+  vm->exec_ = exec_;
+  vm->loaded_ = loaded_;
+  vm->ctxs_ = ctxs_;
+  vm->allocators_ = allocators_;
+  return runtime::Module(vm);
 }
 
 inline void VirtualMachine::WriteRegister(Index r, const ObjectRef& val) {
-  frames_.back().register_file[r] = val;
+  registers_[r] = val;
+}
+
+inline const ObjectRef& VirtualMachine::ReadRegister(Index r) const {
+  return registers_[r];
 }
 
-inline ObjectRef VirtualMachine::ReadRegister(Index r) const {
-  return frames_.back().register_file[r];
+inline const ObjectRef& VirtualMachine::LoadConstant(Index const_index) {
+  // We cache the allocated object in the constant pool. To measure, the
+  // first iteration will set the pool up. The other iterations will
+  // directly reuse the allocated objects.
+  auto& const_pool = loaded_->const_pool;
+  if (!const_pool[const_index].defined()) {
+    // TODO(wweic) ctx could be obtained from the ctxs list.
+    const_pool[const_index] = CopyTo(exec_->constants[const_index], ctxs_[0]);
+  }
+  return const_pool[const_index];
 }
 
 inline int32_t VirtualMachine::LoadScalarInt(Index r) const {
   int32_t result;
   const auto& obj = ReadRegister(r);
-  auto nd_array = Downcast<NDArray>(obj);
-  NDArray array = nd_array.CopyTo({kDLCPU, 0});
+  NDArray array = Downcast<NDArray>(obj);
+  if (array->ctx.device_type != kDLCPU) {
+    array = array.CopyTo({kDLCPU, 0});
+  }
 
   if (array->dtype.bits <= 8) {
     result = reinterpret_cast<int8_t*>(array->data)[0];
@@ -835,119 +1088,209 @@ inline int32_t VirtualMachine::LoadScalarInt(Index r) const {
   return result;
 }
 
+// Jump from the end of each instruction directly to the code of the next one
+// through a table of label addresses where the compiler supports it, which
+// predicts better than the single jump of a switch. Otherwise go back to the
+// switch at the top of the loop.
+#if defined(__GNUC__) || defined(__clang__)
+#define TVM_VM_THREADED_DISPATCH 1
+#else
+#define TVM_VM_THREADED_DISPATCH 0
+#endif
+
 void VirtualMachine::RunLoop() {
+  if (profile_instructions_) {
+    RunLoopImpl<true>();
+  } else {
+    RunLoopImpl<false>();
+  }
+}
+
+template <bool kProfile>
+void VirtualMachine::RunLoopImpl() {
   CHECK(this->exec_);
   CHECK(this->code_);
   pc_ = 0;
   Index frame_start = frames_.size();
-  while (true) {
-  main_loop:
-    auto const& instr = code_[this->pc_];
-    DLOG(INFO) << "Executing(" << pc_ << "): " << instr;
+  auto trace = [this]() {
+    DLOG(INFO) << "Executing(" << pc_ << "): " << code_[pc_];
 #if USE_RELAY_DEBUG
-    InstructionPrint(std::cout, instr);
+    InstructionPrint(std::cout, code_[pc_]);
 #endif  // USE_RELAY_DEBUG
+  };
+  // When profiling, each instruction is timed from its dispatch to the next
+  // one, excluding the time spent reporting it.
+  using Clock = std::chrono::high_resolution_clock;
+  const Instruction* profiled = nullptr;
+  Clock::time_point profiled_begin;
+  auto profile_done = [this, &profiled, &profiled_begin]() {
+    if (!kProfile || profiled == nullptr) return;
+    double duration = std::chrono::duration_cast<std::chrono::duration<double, std::micro> >(
+        Clock::now() - profiled_begin).count();
+    ProfileInstruction(*profiled, duration);
+    profiled = nullptr;
+  };
+  auto profile = [this, &profiled, &profiled_begin, &profile_done]() {
+    if (!kProfile) return;
+    profile_done();
+    profiled = &code_[pc_];
+    profiled_begin = Clock::now();
+  };
+#if TVM_VM_THREADED_DISPATCH
+  // Indexed by opcode, in the order of the Opcode enum.
+  static const void* const kDispatchTable[] = {
+    &&op_Move, &&op_Ret, &&op_Invoke, &&op_InvokeClosure, &&op_InvokePacked,
+    &&op_AllocTensor, &&op_AllocTensorReg, &&op_AllocADT, &&op_AllocClosure,
+    &&op_GetField, &&op_If, &&op_LoadConst, &&op_Goto, &&op_GetTag,
+    &&op_LoadConsti, &&op_Fatal, &&op_AllocStorage, &&op_InvokeShapeFunc,
+    &&op_AllocStorageTensor, &&op_InvokePackedConst,
+  };
+// The handlers only dispatch once their locals are out of scope, as leaving a
+// scope through a computed goto skips the destructors.
+#define VM_OP(name) case Opcode::name: op_##name
+#define VM_DISPATCH()                                                \
+  do {                                                               \
+    ++num_executed_;                                                 \
+    trace();                                                         \
+    profile();                                                       \
+    goto *kDispatchTable[static_cast<int>(code_[pc_].op)];           \
+  } while (0)
+#else
+#define VM_OP(name) case Opcode::name
+#define VM_DISPATCH() continue
+#endif
 
-    switch (instr.op) {
-      case Opcode::Move: {
-        ObjectRef from_obj;
-        from_obj = ReadRegister(instr.from);
-        WriteRegister(instr.dst, from_obj);
+  while (true) {
+    ++num_executed_;
+    trace();
+    profile();
+    switch (code_[pc_].op) {
+      VM_OP(Move): {
+        const Instruction& instr = code_[pc_];
+        WriteRegister(instr.dst, ReadRegister(instr.from));
         pc_++;
-        goto main_loop;
       }
-      case Opcode::Fatal: {
+      VM_DISPATCH();
+      VM_OP(Fatal): {
         throw std::runtime_error("VM encountered fatal error");
       }
-      case Opcode::LoadConst: {
-        auto constant_obj = exec_->constants[instr.const_index];
-        // We cache the allocated object in the constant pool. To measure, the
-        // first iteration will set the pool up. The other iterations will
-        // directly reuse the allocated objects.
-        if (const_pool_.size() <= static_cast<size_t>(instr.const_index)) {
-          const_pool_.resize(instr.const_index + 1);
-        }
-
-        if (!const_pool_[instr.const_index].defined()) {
-          // TODO(wweic) ctx could be obtained from the ctxs list.
-          const_pool_[instr.const_index] = CopyTo(constant_obj, ctxs_[0]);
-        }
-        WriteRegister(instr.dst, const_pool_[instr.const_index]);
+      VM_OP(LoadConst): {
+        const Instruction& instr = code_[pc_];
+        WriteRegister(instr.dst, LoadConstant(instr.const_index));
         pc_++;
-        goto main_loop;
       }
-      case Opcode::LoadConsti: {
+      VM_DISPATCH();
+      VM_OP(LoadConsti): {
+        const Instruction& instr = code_[pc_];
         auto tensor = NDArray::Empty({1}, {kDLInt, 64, 1}, {kDLCPU, 0});
         reinterpret_cast<int64_t*>(tensor->data)[0] = instr.load_consti.val;
         WriteRegister(instr.dst, tensor);
         pc_++;
-        goto main_loop;
       }
-      case Opcode::Invoke: {
-        std::vector<ObjectRef> args;
+      VM_DISPATCH();
+      VM_OP(Invoke): {
+        const Instruction& instr = code_[pc_];
+        const VMFunction& func = exec_->GetVMFunction(instr.func_index);
+        // Copy the arguments straight into the callee's registers, which may
+        // move the register stack.
+        Index caller_base = frames_.back().register_base;
+        PushFrame(func.params.size(), pc_ + 1, func);
+        const ObjectRef* caller = register_stack_.data() + caller_base;
         for (Index i = 0; i < instr.num_args; ++i) {
-          args.push_back(ReadRegister(instr.invoke_args_registers[i]));
+          registers_[i] = caller[instr.invoke_args_registers[i]];
         }
-        InvokeGlobal(exec_->functions[instr.func_index], args);
         frames_.back().caller_return_register = instr.dst;
-        goto main_loop;
+        code_ = func.instructions.data();
+        pc_ = 0;
       }
-      case Opcode::InvokePacked: {
+      VM_DISPATCH();
+      VM_OP(InvokePacked): {
+        const Instruction& instr = code_[pc_];
         DLOG(INFO) << "InvokedPacked " << "arity=" << instr.arity;
-        const auto& func = packed_funcs_[instr.packed_index];
+        const auto& func = loaded_->packed_funcs[instr.packed_index];
         const auto& arity = instr.arity;
-        std::vector<ObjectRef> args;
+        arg_scratch_.clear();
         for (Index i = 0; i < arity; ++i) {
           DLOG(INFO) <<
             "arg" << i << " $" << instr.packed_args[i];
-          auto arg = ReadRegister(instr.packed_args[i]);
-          args.push_back(arg);
+          arg_scratch_.push_back(ReadRegister(instr.packed_args[i]));
         }
 
         // We no longer need to write the registers back, we write directly
         // through the registers mutably.
-        InvokePacked(instr.packed_index, func, arity, instr.output_size, args);
+        InvokePacked(instr.packed_index, func, arity, instr.output_size, arg_scratch_);
+        arg_scratch_.clear();
         pc_++;
-        goto main_loop;
       }
-      case Opcode::InvokeClosure: {
-        auto object = ReadRegister(instr.closure);
+      VM_DISPATCH();
+      VM_OP(InvokeShapeFunc): {
+        const Instruction& instr = code_[pc_];
+        arg_scratch_.clear();
+        for (Index i = 0; i < instr.arity; ++i) {
+          arg_scratch_.push_back(ReadRegister(instr.packed_args[i]));
+        }
+        InvokeShapeFunc(instr.packed_index, loaded_->packed_funcs[instr.packed_index], instr.arity,
+                        instr.output_size, arg_scratch_);
+        arg_scratch_.clear();
+        pc_++;
+      }
+      VM_DISPATCH();
+      VM_OP(InvokePackedConst): {
+        const Instruction& instr = code_[pc_];
+        arg_scratch_.clear();
+        for (Index i = 0; i < instr.arity; ++i) {
+          RegName arg = instr.packed_args[i];
+          arg_scratch_.push_back(arg >= 0 ? ReadRegister(arg) : LoadConstant(-1 - arg));
+        }
+        InvokePacked(instr.packed_index, loaded_->packed_funcs[instr.packed_index], instr.arity,
+                     instr.output_size, arg_scratch_);
+        arg_scratch_.clear();
+        pc_++;
+      }
+      VM_DISPATCH();
+      VM_OP(InvokeClosure): {
+        const Instruction& instr = code_[pc_];
+        ObjectRef object = ReadRegister(instr.closure);
         const auto* closure = object.as<VMClosureObj>();
-
-        std::vector<ObjectRef> args;
-        for (auto free_var : closure->free_vars) {
-          args.push_back(free_var);
+        const VMFunction& func = exec_->GetVMFunction(closure->func_index);
+        Index caller_base = frames_.back().register_base;
+        PushFrame(func.params.size(), pc_ + 1, func);
+        const ObjectRef* caller = register_stack_.data() + caller_base;
+        Index num_free_vars = static_cast<Index>(closure->free_vars.size());
+        for (Index i = 0; i < num_free_vars; ++i) {
+          registers_[i] = closure->free_vars[i];
         }
         for (Index i = 0; i < instr.num_closure_args; ++i) {
-          args.push_back(ReadRegister(instr.closure_args[i]));
+          registers_[num_free_vars + i] = caller[instr.closure_args[i]];
         }
-        InvokeGlobal(exec_->functions[closure->func_index], args);
         frames_.back().caller_return_register = instr.dst;
-        goto main_loop;
+        code_ = func.instructions.data();
+        pc_ = 0;
       }
-      case Opcode::GetField: {
-        auto object = ReadRegister(instr.object);
-        const auto& tuple = Downcast<ADT>(object);
-        auto field = tuple[instr.field_index];
-        WriteRegister(instr.dst, field);
+      VM_DISPATCH();
+      VM_OP(GetField): {
+        const Instruction& instr = code_[pc_];
+        const auto& tuple = Downcast<ADT>(ReadRegister(instr.object));
+        WriteRegister(instr.dst, tuple[instr.field_index]);
         pc_++;
-        goto main_loop;
       }
-      case Opcode::GetTag: {
-        auto object = ReadRegister(instr.get_tag.object);
-        const auto& adt = Downcast<ADT>(object);
+      VM_DISPATCH();
+      VM_OP(GetTag): {
+        const Instruction& instr = code_[pc_];
+        const auto& adt = Downcast<ADT>(ReadRegister(instr.get_tag.object));
         auto tag = adt.tag();
         auto tag_tensor = NDArray::Empty({1}, {kDLInt, 32, 1}, {kDLCPU, 0});
         reinterpret_cast<int32_t*>(tag_tensor->data)[0] = tag;
         WriteRegister(instr.dst, tag_tensor);
         pc_++;
-        goto main_loop;
       }
-      case Opcode::Goto: {
-        pc_ += instr.pc_offset;
-        goto main_loop;
+      VM_DISPATCH();
+      VM_OP(Goto): {
+        pc_ += code_[pc_].pc_offset;
       }
-      case Opcode::If: {
+      VM_DISPATCH();
+      VM_OP(If): {
+        const Instruction& instr = code_[pc_];
         int32_t test_val = LoadScalarInt(instr.if_op.test);
         int32_t target_val = LoadScalarInt(instr.if_op.target);
 
@@ -958,31 +1301,34 @@ void VirtualMachine::RunLoop() {
           CHECK_NE(instr.if_op.false_offset, 0);
           pc_ += instr.if_op.false_offset;
         }
-
-        goto main_loop;
       }
-      case Opcode::AllocTensor: {
+      VM_DISPATCH();
+      VM_OP(AllocTensor): {
+        const Instruction& instr = code_[pc_];
         auto shape = std::vector<int64_t>(instr.alloc_tensor.ndim);
 
         for (uint32_t i = 0; i < instr.alloc_tensor.ndim; ++i) {
           shape[i] = instr.alloc_tensor.shape[i];
         }
 
-        auto storage_obj = ReadRegister(instr.alloc_tensor.storage);
-        auto storage = Downcast<Storage>(storage_obj);
-        auto obj = storage->AllocNDArray(0, shape, instr.alloc_tensor.dtype);
+        auto storage = Downcast<Storage>(ReadRegister(instr.alloc_tensor.storage));
+        auto obj = storage->AllocNDArray(instr.alloc_tensor.offset, shape,
+                                         instr.alloc_tensor.dtype);
 
         WriteRegister(instr.dst, obj);
         pc_++;
-        goto main_loop;
       }
-      case Opcode::AllocTensorReg: {
+      VM_DISPATCH();
+      VM_OP(AllocTensorReg): {
+        const Instruction& instr = code_[pc_];
         DLContext cpu_ctx;
         cpu_ctx.device_type = kDLCPU;
         cpu_ctx.device_id = 0;
         auto shape_tensor_obj = ReadRegister(instr.alloc_tensor_reg.shape_register);
-        const auto shape_arr = Downcast<NDArray>(shape_tensor_obj);
-        NDArray shape_tensor = shape_arr.CopyTo(cpu_ctx);
+        NDArray shape_tensor = Downcast<NDArray>(shape_tensor_obj);
+        if (shape_tensor->ctx.device_type != kDLCPU) {
+          shape_tensor = shape_tensor.CopyTo(cpu_ctx);
+        }
         const DLTensor* dl_tensor = shape_tensor.operator->();
         CHECK_EQ(dl_tensor->dtype.code, 0u);
         CHECK_LE(dl_tensor->dtype.bits, 64);
@@ -991,34 +1337,37 @@ void VirtualMachine::RunLoop() {
         auto shape = std::vector<int64_t>(num_dims);
         shape.assign(dims, dims + num_dims);
 
-        auto storage_obj = ReadRegister(instr.alloc_tensor_reg.storage);
-        auto storage = Downcast<Storage>(storage_obj);
+        auto storage = Downcast<Storage>(ReadRegister(instr.alloc_tensor_reg.storage));
         auto obj = storage->AllocNDArray(0, shape, instr.alloc_tensor_reg.dtype);
 
         WriteRegister(instr.dst, obj);
         pc_++;
-        goto main_loop;
       }
-      case Opcode::AllocADT: {
-        std::vector<ObjectRef> fields;
+      VM_DISPATCH();
+      VM_OP(AllocADT): {
+        const Instruction& instr = code_[pc_];
+        arg_scratch_.clear();
         for (Index i = 0; i < instr.num_fields; ++i) {
-          fields.push_back(ReadRegister(instr.datatype_fields[i]));
+          arg_scratch_.push_back(ReadRegister(instr.datatype_fields[i]));
         }
-        ObjectRef obj = ADT(instr.constructor_tag, fields);
+        ObjectRef obj = ADT(instr.constructor_tag, arg_scratch_.begin(), arg_scratch_.end());
+        arg_scratch_.clear();
         WriteRegister(instr.dst, obj);
         pc_++;
-        goto main_loop;
       }
-      case Opcode::AllocClosure: {
+      VM_DISPATCH();
+      VM_OP(AllocClosure): {
+        const Instruction& instr = code_[pc_];
         std::vector<ObjectRef> free_vars;
         for (Index i = 0; i < instr.num_freevar; i++) {
           free_vars.push_back(ReadRegister(instr.free_vars[i]));
         }
         WriteRegister(instr.dst, VMClosure(instr.func_index, free_vars));
         pc_++;
-        goto main_loop;
       }
-      case Opcode::AllocStorage: {
+      VM_DISPATCH();
+      VM_OP(AllocStorage): {
+        const Instruction& instr = code_[pc_];
         auto size = LoadScalarInt(instr.alloc_storage.allocation_size);
         auto alignment = LoadScalarInt(instr.alloc_storage.alignment);
 
@@ -1027,12 +1376,24 @@ void VirtualMachine::RunLoop() {
           "alignment=" << alignment <<
           "dtype_hint=" << DLDataType2String(instr.alloc_storage.dtype_hint);
 
-        auto storage = make_storage(size, alignment, instr.alloc_storage.dtype_hint, ctxs_[0]);
+        auto storage = make_storage(size, alignment, instr.alloc_storage.dtype_hint,
+                                    allocators_[0]);
         WriteRegister(instr.dst, storage);
         pc_++;
-        goto main_loop;
       }
-      case Opcode::Ret: {
+      VM_DISPATCH();
+      VM_OP(AllocStorageTensor): {
+        const Instruction& instr = code_[pc_];
+        const auto& alloc = instr.alloc_storage_tensor;
+        auto storage = make_storage(alloc.allocation_size, alloc.alignment, alloc.dtype_hint,
+                                    allocators_[0]);
+        std::vector<int64_t> shape(alloc.shape, alloc.shape + alloc.ndim);
+        WriteRegister(instr.dst, storage->AllocNDArray(0, shape, alloc.dtype));
+        pc_++;
+      }
+      VM_DISPATCH();
+      VM_OP(Ret): {
+        const Instruction& instr = code_[pc_];
         // If we have hit the point from which we started
         // running, we should return to the caller breaking
         // the dispatch loop.
@@ -1040,15 +1401,19 @@ void VirtualMachine::RunLoop() {
         auto caller_return_register = frames_.back().caller_return_register;
 
         if (PopFrame() == frame_start) {
+          profile_done();
           return;
-          // Otherwise we are just returning from a local call.
-        } else {
-          WriteRegister(caller_return_register, return_register_);
-          goto main_loop;
         }
+        // Otherwise we are just returning from a local call.
+        WriteRegister(caller_return_register, return_register_);
       }
+      VM_DISPATCH();
+      default:
+        LOG(FATAL) << "Unknown instruction opcode " << static_cast<int>(code_[pc_].op);
     }
   }
+#undef VM_OP
+#undef VM_DISPATCH
 }
 
 runtime::Module CreateVirtualMachine(const Executable* exec) {
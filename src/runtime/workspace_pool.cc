@@ -21,7 +21,9 @@
  * \file workspace_pool.h
  * \brief Workspace pool utility.
  */
+#include <algorithm>
 #include <memory>
+#include <unordered_map>
 #include "workspace_pool.h"
 
 namespace tvm {
@@ -31,9 +33,66 @@ namespace runtime {
 constexpr size_t kWorkspacePageSize = 4 << 10;
 
 class WorkspacePool::Pool {
+ public:
+  virtual ~Pool() {}
+  // allocate from pool
+  virtual void* Alloc(TVMContext ctx, DeviceAPI* device, size_t nbytes) = 0;
+  // free resource back to pool
+  virtual void Free(void* data) = 0;
+  // Release all resources
+  virtual void Release(TVMContext ctx, DeviceAPI* device) = 0;
+  // Release cached pages until at most limit bytes are reserved
+  virtual void ReleaseCached(TVMContext ctx, DeviceAPI* device, size_t limit) = 0;
+  // Release the cached pages above the high-water mark since the last trim
+  void Trim(TVMContext ctx, DeviceAPI* device) {
+    ReleaseCached(ctx, device, window_peak_);
+    window_peak_ = stats_.bytes_in_use;
+  }
+  // statistics of the pool
+  const Stats& stats() const {
+    return stats_;
+  }
+
+ protected:
+  // Allocate a page from the device
+  void* DeviceAlloc(TVMContext ctx, DeviceAPI* device, size_t nbytes) {
+    DLDataType type;
+    type.code = kDLUInt;
+    type.bits = 8;
+    type.lanes = 1;
+    void* data = device->AllocDataSpace(ctx, nbytes, kTempAllocaAlignment, type);
+    stats_.num_device_alloc += 1;
+    stats_.bytes_reserved += nbytes;
+    return data;
+  }
+  // Free a page to the device
+  void DeviceFree(TVMContext ctx, DeviceAPI* device, void* data, size_t nbytes) {
+    device->FreeDataSpace(ctx, data);
+    stats_.bytes_reserved -= nbytes;
+  }
+  // Record a page handed out
+  void RecordAlloc(size_t nbytes) {
+    stats_.num_alloc += 1;
+    stats_.bytes_in_use += nbytes;
+    stats_.peak_bytes_in_use = std::max(stats_.peak_bytes_in_use, stats_.bytes_in_use);
+    window_peak_ = std::max(window_peak_, stats_.bytes_in_use);
+  }
+  // Record a page given back
+  void RecordFree(size_t nbytes) {
+    stats_.bytes_in_use -= nbytes;
+  }
+
+ private:
+  /*! \brief The statistics */
+  Stats stats_;
+  /*! \brief The highest bytes in use since the last trim */
+  size_t window_peak_{0};
+};
+
+class WorkspacePool::BestFitPool final : public WorkspacePool::Pool {
  public:
   // constructor
-  Pool() {
+  BestFitPool() {
     // safe guard header on each list.
     Entry e;
     e.data = nullptr;
@@ -42,26 +101,22 @@ class WorkspacePool::Pool {
     allocated_.push_back(e);
   }
   // allocate from pool
-  void* Alloc(TVMContext ctx, DeviceAPI* device, size_t nbytes) {
+  void* Alloc(TVMContext ctx, DeviceAPI* device, size_t nbytes) final {
     // Allocate align to page.
     nbytes = (nbytes + (kWorkspacePageSize - 1)) / kWorkspacePageSize * kWorkspacePageSize;
     if (nbytes == 0) nbytes = kWorkspacePageSize;
     Entry e;
-    DLDataType type;
-    type.code = kDLUInt;
-    type.bits = 8;
-    type.lanes = 1;
     if (free_list_.size() == 2) {
       e = free_list_.back();
       free_list_.pop_back();
       if (e.size < nbytes) {
         // resize the page
-        device->FreeDataSpace(ctx, e.data);
-        e.data = device->AllocDataSpace(ctx, nbytes, kTempAllocaAlignment, type);
+        DeviceFree(ctx, device, e.data, e.size);
+        e.data = DeviceAlloc(ctx, device, nbytes);
         e.size = nbytes;
       }
     } else if (free_list_.size() == 1) {
-      e.data = device->AllocDataSpace(ctx, nbytes, kTempAllocaAlignment, type);
+      e.data = DeviceAlloc(ctx, device, nbytes);
       e.size = nbytes;
     } else {
       if (free_list_.back().size >= nbytes) {
@@ -74,16 +129,17 @@ class WorkspacePool::Pool {
         // resize the page
         e = free_list_.back();
         free_list_.pop_back();
-        device->FreeDataSpace(ctx, e.data);
-        e.data = device->AllocDataSpace(ctx, nbytes, kTempAllocaAlignment, type);
+        DeviceFree(ctx, device, e.data, e.size);
+        e.data = DeviceAlloc(ctx, device, nbytes);
         e.size = nbytes;
       }
     }
     allocated_.push_back(e);
+    RecordAlloc(e.size);
     return e.data;
   }
   // free resource back to pool
-  void Free(void* data) {
+  void Free(void* data) final {
     Entry e;
     if (allocated_.back().data == data) {
       // quick path, last allocated.
@@ -96,6 +152,7 @@ class WorkspacePool::Pool {
       e = allocated_[index];
       allocated_.erase(allocated_.begin() + index);
     }
+    RecordFree(e.size);
     if (free_list_.back().size < e.size) {
       free_list_.push_back(e);
     } else if (free_list_.size() == 2) {
@@ -111,13 +168,20 @@ class WorkspacePool::Pool {
     }
   }
   // Release all resources
-  void Release(TVMContext ctx, DeviceAPI* device) {
+  void Release(TVMContext ctx, DeviceAPI* device) final {
     CHECK_EQ(allocated_.size(), 1);
     for (size_t i = 1; i < free_list_.size(); ++i) {
-      device->FreeDataSpace(ctx, free_list_[i].data);
+      DeviceFree(ctx, device, free_list_[i].data, free_list_[i].size);
     }
     free_list_.clear();
   }
+  // Release cached pages, the largest first
+  void ReleaseCached(TVMContext ctx, DeviceAPI* device, size_t limit) final {
+    while (free_list_.size() > 1 && stats().bytes_reserved > limit) {
+      DeviceFree(ctx, device, free_list_.back().data, free_list_.back().size);
+      free_list_.pop_back();
+    }
+  }
 
  private:
   /*! \brief a single entry in the pool */
@@ -131,8 +195,110 @@ class WorkspacePool::Pool {
   std::vector<Entry> allocated_;
 };
 
+/*!
+ * \brief Pool with segregated free lists of size classes.
+ *
+ *  Requests are rounded up in pages to a class of the form (4 + j) * 2^e pages,
+ *  j in [0, 4), which bounds the rounding waste by 25%. Allocation pops the free
+ *  list of the class, or of one of the next few classes, and free pushes to the
+ *  class found through a hash map, so both are O(1).
+ */
+class WorkspacePool::SizeClassPool final : public WorkspacePool::Pool {
+ public:
+  // allocate from pool
+  void* Alloc(TVMContext ctx, DeviceAPI* device, size_t nbytes) final {
+    size_t npages = std::max((nbytes + (kWorkspacePageSize - 1)) / kWorkspacePageSize,
+                             static_cast<size_t>(1));
+    size_t cls = SizeClass(npages);
+    if (cls >= free_lists_.size()) {
+      free_lists_.resize(cls + 1);
+    }
+    void* data = nullptr;
+    // a cached page of a slightly larger class beats a new device allocation
+    size_t end = std::min(cls + kMaxClassLookAhead + 1, free_lists_.size());
+    for (size_t c = cls; c < end && data == nullptr; ++c) {
+      if (!free_lists_[c].empty()) {
+        data = free_lists_[c].back();
+        free_lists_[c].pop_back();
+        cls = c;
+      }
+    }
+    if (data == nullptr) {
+      data = DeviceAlloc(ctx, device, ClassBytes(cls));
+    }
+    allocated_[data] = cls;
+    RecordAlloc(ClassBytes(cls));
+    return data;
+  }
+  // free resource back to pool
+  void Free(void* data) final {
+    auto it = allocated_.find(data);
+    CHECK(it != allocated_.end()) << "trying to free things that has not been allocated";
+    size_t cls = it->second;
+    allocated_.erase(it);
+    RecordFree(ClassBytes(cls));
+    free_lists_[cls].push_back(data);
+  }
+  // Release all resources
+  void Release(TVMContext ctx, DeviceAPI* device) final {
+    CHECK_EQ(allocated_.size(), 0U);
+    ReleaseCached(ctx, device, 0);
+    free_lists_.clear();
+  }
+  // Release cached pages, the largest classes first
+  void ReleaseCached(TVMContext ctx, DeviceAPI* device, size_t limit) final {
+    for (size_t cls = free_lists_.size(); cls != 0 && stats().bytes_reserved > limit; --cls) {
+      std::vector<void*>& free_list = free_lists_[cls - 1];
+      while (!free_list.empty() && stats().bytes_reserved > limit) {
+        DeviceFree(ctx, device, free_list.back(), ClassBytes(cls - 1));
+        free_list.pop_back();
+      }
+    }
+  }
+
+ private:
+  // number of larger classes checked for a cached page, up to twice the size
+  static constexpr size_t kMaxClassLookAhead = 4;
+  // index of the highest set bit of x > 0
+  static size_t Log2Floor(size_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return sizeof(unsigned long long) * 8 - 1 -  // NOLINT(*)
+        __builtin_clzll(static_cast<unsigned long long>(x));  // NOLINT(*)
+#else
+    size_t e = 0;
+    while (x >>= 1) ++e;
+    return e;
+#endif
+  }
+  // The class of a request of npages pages, classes 0, 1, 2 are 1, 2, 3 pages.
+  static size_t SizeClass(size_t npages) {
+    if (npages < 4) return npages - 1;
+    size_t e = Log2Floor(npages);
+    size_t step = static_cast<size_t>(1) << (e - 2);
+    size_t j = (npages - (static_cast<size_t>(1) << e) + step - 1) / step;
+    return 3 + 4 * (e - 2) + j;
+  }
+  // The bytes of a class.
+  static size_t ClassBytes(size_t cls) {
+    if (cls < 3) return (cls + 1) * kWorkspacePageSize;
+    size_t e = (cls - 3) / 4 + 2;
+    size_t j = (cls - 3) % 4;
+    return ((4 + j) << (e - 2)) * kWorkspacePageSize;
+  }
+  /*! \brief Free pages of each class */
+  std::vector<std::vector<void*> > free_lists_;
+  /*! \brief The class of each page handed out */
+  std::unordered_map<void*, size_t> allocated_;
+};
+
 WorkspacePool::WorkspacePool(DLDeviceType device_type, std::shared_ptr<DeviceAPI> device)
-    : device_type_(device_type), device_(device) {
+    : WorkspacePool(device_type, device, DefaultPoolKind(device_type)) {
+}
+
+WorkspacePool::WorkspacePool(DLDeviceType device_type,
+                             std::shared_ptr<DeviceAPI> device,
+                             PoolKind kind)
+    : device_type_(device_type), kind_(kind), device_(device) {
 }
 
 WorkspacePool::~WorkspacePool() {
@@ -152,7 +318,11 @@ void* WorkspacePool::AllocWorkspace(TVMContext ctx, size_t size) {
     array_.resize(ctx.device_id + 1, nullptr);
   }
   if (array_[ctx.device_id] == nullptr) {
-    array_[ctx.device_id] = new Pool();
+    if (kind_ == kSizeClass) {
+      array_[ctx.device_id] = new SizeClassPool();
+    } else {
+      array_[ctx.device_id] = new BestFitPool();
+    }
   }
   return array_[ctx.device_id]->Alloc(ctx, device_.get(), size);
 }
@@ -163,5 +333,28 @@ void WorkspacePool::FreeWorkspace(TVMContext ctx, void* ptr) {
   array_[ctx.device_id]->Free(ptr);
 }
 
+WorkspacePool::Stats WorkspacePool::GetStats(TVMContext ctx) const {
+  if (static_cast<size_t>(ctx.device_id) >= array_.size() ||
+      array_[ctx.device_id] == nullptr) {
+    return Stats();
+  }
+  return array_[ctx.device_id]->stats();
+}
+
+void WorkspacePool::Trim(TVMContext ctx) {
+  if (static_cast<size_t>(ctx.device_id) < array_.size() &&
+      array_[ctx.device_id] != nullptr) {
+    array_[ctx.device_id]->Trim(ctx, device_.get());
+  }
+}
+
+WorkspacePool::PoolKind WorkspacePool::DefaultPoolKind(DLDeviceType device_type) {
+  switch (static_cast<int>(device_type)) {
+    case kDLCPU:
+    case kDLCPUPinned: return kSizeClass;
+    default: return kBestFit;
+  }
+}
+
 }  // namespace runtime
 }  // namespace tvm
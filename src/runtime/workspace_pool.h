@@ -43,12 +43,43 @@ namespace runtime {
  */
 class TVM_DLL WorkspacePool {
  public:
+  /*! \brief The allocation strategy of the per-device pools. */
+  enum PoolKind : int {
+    /*! \brief Best fit over a sorted free list, suits a few large allocations. */
+    kBestFit = 0,
+    /*!
+     * \brief Segregated size classes with O(1) allocation and free,
+     *  suits kernels issuing many workspace allocations.
+     */
+    kSizeClass = 1,
+  };
+  /*! \brief Allocation statistics of the pool of one device. */
+  struct Stats {
+    /*! \brief The number of workspace allocations served. */
+    size_t num_alloc{0};
+    /*! \brief The number of allocations requested from the device. */
+    size_t num_device_alloc{0};
+    /*! \brief The bytes currently handed out. */
+    size_t bytes_in_use{0};
+    /*! \brief The bytes currently held from the device, in use or cached. */
+    size_t bytes_reserved{0};
+    /*! \brief The highest bytes_in_use since the pool was created. */
+    size_t peak_bytes_in_use{0};
+  };
   /*!
    * \brief Create pool with specific device type and device.
+   *  The pool kind is chosen by the device type, see DefaultPoolKind.
    * \param device_type The device type.
    * \param device The device API.
    */
   WorkspacePool(DLDeviceType device_type, std::shared_ptr<DeviceAPI> device);
+  /*!
+   * \brief Create pool with specific device type, device and pool kind.
+   * \param device_type The device type.
+   * \param device The device API.
+   * \param kind The allocation strategy.
+   */
+  WorkspacePool(DLDeviceType device_type, std::shared_ptr<DeviceAPI> device, PoolKind kind);
   /*! \brief destructor */
   ~WorkspacePool();
   /*!
@@ -64,13 +95,36 @@ class TVM_DLL WorkspacePool {
    * \param ptr The pointer to be freed.
    */
   void FreeWorkspace(TVMContext ctx, void* ptr);
+  /*!
+   * \brief Get the allocation statistics of one device.
+   * \param ctx The context of allocation.
+   * \return The statistics, all zero if the device has not been used.
+   */
+  Stats GetStats(TVMContext ctx) const;
+  /*!
+   * \brief Return cached memory of one device back to the device, keeping at
+   *  most the high-water mark of the bytes in use since the previous trim.
+   * \param ctx The context of allocation.
+   */
+  void Trim(TVMContext ctx);
+  /*!
+   * \brief The pool kind used for a device type.
+   *  Host memory uses size classes, while device memory keeps the tighter best fit.
+   * \param device_type The device type.
+   * \return The pool kind.
+   */
+  static PoolKind DefaultPoolKind(DLDeviceType device_type);
 
  private:
   class Pool;
+  class BestFitPool;
+  class SizeClassPool;
   /*! \brief pool of device local array */
   std::vector<Pool*> array_;
   /*! \brief device type this pool support */
   DLDeviceType device_type_;
+  /*! \brief The allocation strategy of the device local pools */
+  PoolKind kind_;
   /*! \brief The device API */
   std::shared_ptr<DeviceAPI> device_;
 };
@@ -20,9 +20,12 @@
 #include <atomic>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include <tvm/runtime/c_backend_api.h>
+#include <tvm/runtime/registry.h>
+#include <tvm/runtime/threading_backend.h>
 
 constexpr size_t N = 128;
 
@@ -36,6 +39,50 @@ static FTVMParallelLambda atomic_add_task_id = [](int task_id, TVMParallelGroupE
   return 0;
 };
 
+struct NestedLaunchData {
+  std::atomic<int> num_task{0};
+  std::atomic<int> num_correct{0};
+};
+
+static FTVMParallelLambda nested_launch = [](int task_id, TVMParallelGroupEnv* penv,
+                                             void* cdata) -> int {
+  auto* data = reinterpret_cast<NestedLaunchData*>(cdata);
+  data->num_task.store(penv->num_task, std::memory_order_relaxed);
+  std::atomic<size_t> acc(0);
+  int ret = TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0);
+  if (acc.load(std::memory_order_relaxed) == N * (N - 1) / 2) {
+    data->num_correct.fetch_add(1, std::memory_order_relaxed);
+  }
+  return ret;
+};
+
+struct BarrierData {
+  std::atomic<int> arrived{0};
+  std::atomic<int> num_correct{0};
+};
+
+static FTVMParallelLambda barrier_task = [](int task_id, TVMParallelGroupEnv* penv,
+                                            void* cdata) -> int {
+  auto* data = reinterpret_cast<BarrierData*>(cdata);
+  data->arrived.fetch_add(1);
+  TVMBackendParallelBarrier(task_id, penv);
+  // every task of the launch has arrived once the barrier is passed
+  if (data->arrived.load() == penv->num_task) {
+    data->num_correct.fetch_add(1);
+  }
+  return 0;
+};
+
+static FTVMParallelLambda nested_barrier_launch = [](int task_id, TVMParallelGroupEnv* penv,
+                                                     void* cdata) -> int {
+  // more tasks than the workers left idle by the enclosing launch
+  int num_task = tvm::runtime::threading::MaxConcurrency();
+  BarrierData data;
+  int ret = TVMBackendParallelLaunch(barrier_task, &data, num_task);
+  if (data.num_correct.load() != num_task) return -1;
+  return ret;
+};
+
 TEST(ThreadingBackend, TVMBackendParallelLaunch) {
   std::atomic<size_t> acc(0);
   TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0);
@@ -64,6 +111,112 @@ TEST(ThreadingBackend, TVMBackendParallelLaunchMultipleThreads) {
   }
 }
 
+TEST(ThreadingBackend, TVMBackendParallelLaunchNested) {
+  NestedLaunchData data;
+  EXPECT_EQ(TVMBackendParallelLaunch(nested_launch, &data, 0), 0);
+  EXPECT_GT(data.num_task.load(), 0);
+  EXPECT_EQ(data.num_correct.load(), data.num_task.load());
+}
+
+TEST(ThreadingBackend, TVMBackendParallelLaunchNestedMultipleThreads) {
+  size_t num_threads = 4;
+  size_t num_jobs_per_thread = 3;
+  std::vector<std::unique_ptr<std::thread>> ts;
+  for (size_t i = 0; i < num_threads; ++i) {
+    ts.emplace_back(new std::thread([&]() {
+      for (size_t j = 0; j < num_jobs_per_thread; ++j) {
+        NestedLaunchData data;
+        EXPECT_EQ(TVMBackendParallelLaunch(nested_launch, &data, 0), 0);
+        EXPECT_EQ(data.num_correct.load(), data.num_task.load());
+      }
+    }));
+  }
+  for (auto& t : ts) {
+    t->join();
+  }
+}
+
+TEST(ThreadingBackend, TVMBackendParallelBarrierNestedAndConcurrent) {
+  std::vector<std::unique_ptr<std::thread>> ts;
+  for (size_t i = 0; i < 2; ++i) {
+    ts.emplace_back(new std::thread([&]() {
+      for (size_t j = 0; j < 3; ++j) {
+        EXPECT_EQ(TVMBackendParallelLaunch(nested_barrier_launch, nullptr, 0), 0);
+      }
+    }));
+  }
+  for (auto& t : ts) {
+    t->join();
+  }
+}
+
+TEST(ThreadingBackend, TVMBackendParallelLaunchWorkStealing) {
+  const tvm::runtime::PackedFunc* config =
+      tvm::runtime::Registry::Get("runtime.config_threadpool");
+  ASSERT_TRUE(config != nullptr);
+  // big cores, all threads, work-stealing with 8 tasks per worker
+  (*config)(1, 0, 1, 8);
+  for (int num_task : {0, 1, 3, 37}) {
+    std::atomic<size_t> acc(0);
+    EXPECT_EQ(TVMBackendParallelLaunch(atomic_add_task_id, &acc, num_task), 0);
+    EXPECT_EQ(acc.load(std::memory_order_relaxed), N * (N - 1) / 2);
+  }
+  // restore the static schedule
+  (*config)(1, 0, 0);
+}
+
+TEST(ThreadingBackend, TVMBackendParallelLaunchNumaNode) {
+  const std::vector<std::vector<unsigned int> >& nodes =
+      tvm::runtime::threading::NumaNodeCpus();
+  ASSERT_GE(nodes.size(), 1U);
+  int node = 0;
+  while (nodes[node].empty()) ++node;
+  const tvm::runtime::PackedFunc* config =
+      tvm::runtime::Registry::Get("runtime.config_threadpool");
+  ASSERT_TRUE(config != nullptr);
+  // NUMA node teams, all threads
+  (*config)(2, 0);
+  std::thread t([&]() {
+    tvm::runtime::threading::BindToNumaNode(node);
+    int current = tvm::runtime::threading::CurrentNumaNode();
+    EXPECT_TRUE(current == node || (current == -1 && nodes.size() == 1));
+    std::atomic<size_t> acc(0);
+    EXPECT_EQ(TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0), 0);
+    EXPECT_EQ(acc.load(std::memory_order_relaxed), N * (N - 1) / 2);
+  });
+  t.join();
+  // restore the big cores
+  (*config)(1, 0);
+}
+
+TEST(ThreadingBackend, TVMBackendParallelLaunchWhileReconfiguring) {
+  const tvm::runtime::PackedFunc* config =
+      tvm::runtime::Registry::Get("runtime.config_threadpool");
+  ASSERT_TRUE(config != nullptr);
+  std::atomic<bool> stop{false};
+  std::vector<std::unique_ptr<std::thread>> ts;
+  for (size_t i = 0; i < 2; ++i) {
+    ts.emplace_back(new std::thread([&]() {
+      while (!stop.load()) {
+        std::atomic<size_t> acc(0);
+        EXPECT_EQ(TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0), 0);
+        EXPECT_EQ(acc.load(std::memory_order_relaxed), N * (N - 1) / 2);
+      }
+    }));
+  }
+  int max_threads = tvm::runtime::threading::MaxConcurrency();
+  for (int i = 0; i < 200; ++i) {
+    // alternate the number of workers and the schedule under the running launches
+    (*config)(1, 1 + i % max_threads, i % 2, 1 + i % 4);
+  }
+  stop.store(true);
+  for (auto& t : ts) {
+    t->join();
+  }
+  // restore the big cores and the static schedule
+  (*config)(1, 0, 0);
+}
+
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   testing::FLAGS_gtest_death_test_style = "threadsafe";
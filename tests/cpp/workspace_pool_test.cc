@@ -0,0 +1,95 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <tvm/runtime/device_api.h>
+#include <memory>
+#include "../src/runtime/workspace_pool.h"
+
+using tvm::runtime::DeviceAPI;
+using tvm::runtime::WorkspacePool;
+
+namespace {
+
+TVMContext CPUContext() {
+  TVMContext ctx;
+  ctx.device_type = kDLCPU;
+  ctx.device_id = 0;
+  return ctx;
+}
+
+std::shared_ptr<DeviceAPI> CPUDevice() {
+  // the device api is a global singleton, never delete it.
+  return std::shared_ptr<DeviceAPI>(DeviceAPI::Get(CPUContext()), [](DeviceAPI*) {});
+}
+
+}  // namespace
+
+TEST(WorkspacePool, DefaultPoolKind) {
+  EXPECT_EQ(WorkspacePool::DefaultPoolKind(kDLCPU), WorkspacePool::kSizeClass);
+  EXPECT_EQ(WorkspacePool::DefaultPoolKind(kDLGPU), WorkspacePool::kBestFit);
+}
+
+TEST(WorkspacePool, SizeClassReuse) {
+  TVMContext ctx = CPUContext();
+  WorkspacePool pool(kDLCPU, CPUDevice(), WorkspacePool::kSizeClass);
+  void* a = pool.AllocWorkspace(ctx, 10000);
+  pool.FreeWorkspace(ctx, a);
+  // 9000 bytes fall into the same class as 10000 bytes
+  void* b = pool.AllocWorkspace(ctx, 9000);
+  EXPECT_EQ(a, b);
+  void* c = pool.AllocWorkspace(ctx, 1 << 20);
+  void* d = pool.AllocWorkspace(ctx, 1);
+  pool.FreeWorkspace(ctx, b);
+  pool.FreeWorkspace(ctx, d);
+  pool.FreeWorkspace(ctx, c);
+  WorkspacePool::Stats stats = pool.GetStats(ctx);
+  EXPECT_EQ(stats.num_alloc, 4U);
+  EXPECT_EQ(stats.num_device_alloc, 3U);
+  EXPECT_EQ(stats.bytes_in_use, 0U);
+  EXPECT_GE(stats.peak_bytes_in_use, static_cast<size_t>((1 << 20) + 9000 + 1));
+  EXPECT_EQ(stats.bytes_reserved, stats.peak_bytes_in_use);
+}
+
+TEST(WorkspacePool, Trim) {
+  TVMContext ctx = CPUContext();
+  for (auto kind : {WorkspacePool::kSizeClass, WorkspacePool::kBestFit}) {
+    WorkspacePool pool(kDLCPU, CPUDevice(), kind);
+    void* a = pool.AllocWorkspace(ctx, 1 << 16);
+    void* b = pool.AllocWorkspace(ctx, 1 << 18);
+    pool.FreeWorkspace(ctx, b);
+    pool.FreeWorkspace(ctx, a);
+    // everything cached was in use since the pool was created
+    pool.Trim(ctx);
+    EXPECT_EQ(pool.GetStats(ctx).bytes_reserved, (1U << 16) + (1U << 18));
+    a = pool.AllocWorkspace(ctx, 1 << 16);
+    pool.FreeWorkspace(ctx, a);
+    // only the smaller page was needed since the previous trim
+    pool.Trim(ctx);
+    EXPECT_EQ(pool.GetStats(ctx).bytes_reserved, 1U << 16);
+    pool.Trim(ctx);
+    EXPECT_EQ(pool.GetStats(ctx).bytes_reserved, 0U);
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
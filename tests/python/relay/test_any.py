@@ -78,6 +78,27 @@ def test_any_elemwise():
     verify_any_elemwise((relay.Any(), 2), (5, 2), relay.negative, np.negative)
     verify_any_elemwise((relay.Any(), relay.Any()), (5, 4), relay.exp, np.exp)
 
+def test_shape_func_cache():
+    x = relay.var('x', shape=(relay.Any(), 2), dtype='float32')
+    y = relay.var('y', shape=(relay.Any(), 2), dtype='float32')
+    mod = tvm.IRModule()
+    mod["main"] = relay.Function([x, y], relay.add(x, y))
+    exe = relay.vm.compile(mod, "llvm")
+    vm = tvm.runtime.vm.VirtualMachine(exe)
+    vm.init(tvm.cpu())
+    hits = []
+    for rows in [3, 3, 5, 3]:
+        x_np = np.random.uniform(size=(rows, 2)).astype('float32')
+        y_np = np.random.uniform(size=(rows, 2)).astype('float32')
+        result = vm.invoke("main", x_np, y_np)
+        tvm.testing.assert_allclose(result.asnumpy(), x_np + y_np)
+        hits.append(vm.get_shape_func_cache_stats()[0])
+    # Only the calls repeating the shapes of an earlier call hit the cache.
+    assert hits[0] == 0
+    assert hits[1] > hits[0]
+    assert hits[2] == hits[1]
+    assert hits[3] > hits[2]
+
 def test_any_broadcast_fail():
     # Test broadcast with incompatible values at runtime
     def check_fail(x_shape, y_shape, x_np_shape, y_np_shape, op, np_op):
@@ -667,3 +688,4 @@ if __name__ == "__main__":
     test_arange_with_dynamic_shape()
     test_recursive_concat()
     test_recursive_concat_with_wrong_annotation()
+    test_shape_func_cache()
@@ -14,12 +14,15 @@
 # KIND, either express or implied.  See the License for the
 # specific language governing permissions and limitations
 # under the License.
+import os
+
 import numpy as np
 import tvm
 from tvm import te
 import tvm.testing
 from tvm import relay
 from tvm import autotvm
+from tvm.contrib import graph_runtime, util
 import topi
 from tvm.relay.testing import run_infer_type
 from tvm.relay.testing.temp_op_attr import TempOpAttr
@@ -234,6 +237,100 @@ def test_compile_nhwc_pack():
     relay.build(mod, target="llvm")
 
 
+def test_compile_disk_cache():
+    x = relay.var("x", shape=(1, 3, 8, 8))
+    w = relay.var("w", shape=(4, 3, 3, 3))
+    b = relay.var("b", shape=(4,))
+    y = relay.nn.relu(relay.nn.bias_add(relay.nn.conv2d(x, w, padding=(1, 1)), b))
+    y = relay.add(y, relay.const(1.0))
+    mod = tvm.IRModule.from_expr(relay.Function([x, w, b], y))
+    inputs = {"x": np.random.uniform(size=(1, 3, 8, 8)).astype("float32"),
+              "w": np.random.uniform(size=(4, 3, 3, 3)).astype("float32"),
+              "b": np.random.uniform(size=(4,)).astype("float32")}
+
+    def run():
+        graph, lib, params = relay.build(mod, "llvm")
+        m = graph_runtime.create(graph, lib, tvm.cpu())
+        m.set_input(**params)
+        m.run(**inputs)
+        return m.get_output(0).asnumpy()
+
+    engine = relay.backend.compile_engine.get()
+    ref = run()
+    path = util.tempdir().relpath("cache")
+    engine.set_disk_cache(path)
+    try:
+        engine.clear()
+        tvm.testing.assert_allclose(run(), ref, rtol=1e-5)
+        entries = sorted(os.listdir(path))
+        assert any(e.endswith(".bc") for e in entries)
+        assert any(e.endswith(".key") for e in entries)
+        hits, misses = engine.disk_cache_stats()
+        assert hits == 0 and misses > 0
+        # The functions are now loaded from the disk, which adds no entry.
+        engine.clear()
+        tvm.testing.assert_allclose(run(), ref, rtol=1e-5)
+        assert sorted(os.listdir(path)) == entries
+        assert engine.disk_cache_stats() == (misses, misses)
+    finally:
+        engine.set_disk_cache(None)
+        engine.clear()
+
+
+def test_compile_parallel():
+    # Enough different functions for the module to be built in chunks.
+    x = relay.var("x", shape=(8,))
+    y = x
+    for _ in range(40):
+        y = relay.nn.relu(relay.nn.pad(y, ((0, 1),)) - relay.const(0.5))
+    mod = tvm.IRModule.from_expr(relay.Function([x], y))
+    data = np.random.uniform(size=(8,)).astype("float32")
+
+    engine = relay.backend.compile_engine.get()
+
+    def run(num_threads, export, lower_passes=()):
+        os.environ["TVM_BUILD_NUM_THREADS"] = str(num_threads)
+        try:
+            engine.clear()
+            # Without fusion, every operator is a function of its own.
+            with relay.build_config(opt_level=0), \
+                 tvm.target.build_config(add_lower_pass=list(lower_passes)):
+                graph, lib, params = relay.build(mod, "llvm")
+        finally:
+            del os.environ["TVM_BUILD_NUM_THREADS"]
+        if export:
+            path = util.tempdir().relpath("lib.so")
+            lib.export_library(path)
+            lib = tvm.runtime.load_module(path)
+        m = graph_runtime.create(graph, lib, tvm.cpu())
+        m.set_input(**params)
+        m.run(x=data)
+        return graph, m.get_output(0).asnumpy()
+
+    graph, ref = run(1, False)
+    num_funcs = len(engine.items())
+    assert num_funcs > 40
+    for export in [False, True]:
+        parallel_graph, res = run(4, export)
+        # The functions are lowered natively on the build threads.
+        assert engine.num_lowered_in_parallel() == num_funcs
+        # The functions are named in the same order.
+        assert parallel_graph == graph
+        tvm.testing.assert_allclose(res, ref)
+
+    # A Python lowering pass runs on the calling thread.
+    num_passed = [0]
+
+    def count(stmt):
+        num_passed[0] += 1
+        return stmt
+    serial_graph, res = run(4, False, [(1, count)])
+    assert num_passed[0] == num_funcs
+    assert engine.num_lowered_in_parallel() == 0
+    assert serial_graph == graph
+    tvm.testing.assert_allclose(res, ref)
+
+
 if __name__ == "__main__":
     test_get_valid_implementations()
     test_select_implementation()
@@ -243,3 +340,5 @@ if __name__ == "__main__":
     test_compile_tuple_dup()
     test_compile_full()
     test_compile_nhwc_pack()
+    test_compile_disk_cache()
+    test_compile_parallel()
@@ -14,6 +14,8 @@
 # KIND, either express or implied.  See the License for the
 # specific language governing permissions and limitations
 # under the License.
+import json
+
 import numpy as np
 
 import tvm
@@ -141,6 +143,43 @@ def test_plan_memory():
     assert len(device_types) == 1
 
 
+def test_plan_memory_offset():
+    x = relay.var("x", shape=(8, 16))
+    a = relay.nn.relu(x)
+    b = relay.concatenate([a, relay.exp(a)], axis=1)
+    c = relay.sum(b, axis=1, keepdims=True)
+    d = relay.log(relay.add(relay.abs(b), c))
+    func = relay.Function([x], relay.sigmoid(d))
+    mod = tvm.IRModule.from_expr(func)
+    mod = relay.transform.InferType()(mod)
+    mod = relay.transform.FuseOps(0)(mod)
+    planned, _, peak = [v.value for v in
+                        relay.backend._backend.GraphPlanMemoryStats(mod["main"])]
+    # the peak is a lower bound of any placement
+    assert peak <= planned
+
+    # a chain of equal tensors alternates between two slots, the peak is reached
+    chain = relay.Function([x], relay.sigmoid(relay.log(relay.exp(relay.nn.relu(x)))))
+    chain = relay.transform.FuseOps(0)(
+        relay.transform.InferType()(tvm.IRModule.from_expr(chain)))
+    planned, _, peak = [v.value for v in
+                        relay.backend._backend.GraphPlanMemoryStats(chain["main"])]
+    assert planned == peak == 2 * 8 * 16 * 4
+
+    x_data = np.random.uniform(size=(8, 16)).astype("float32")
+    outs = []
+    for plan_memory_offset in [False, True]:
+        with relay.build_config(opt_level=0, plan_memory_offset=plan_memory_offset):
+            graph, lib, params = relay.build(tvm.IRModule.from_expr(func), "llvm")
+        attrs = json.loads(graph)["attrs"]
+        assert ("storage_offset" in attrs) == plan_memory_offset
+        m = graph_runtime.create(graph, lib, tvm.cpu())
+        m.set_input("x", x_data)
+        m.run()
+        outs.append(m.get_output(0).asnumpy())
+    tvm.testing.assert_allclose(outs[0], outs[1], rtol=1e-5)
+
+
 def test_gru_like():
     def unit(rnn_dim):
         X = relay.var("X", shape=(1, rnn_dim))
@@ -180,6 +219,7 @@ def test_gru_like():
 
 if __name__ == "__main__":
     test_plan_memory()
+    test_plan_memory_offset()
     test_with_params()
     test_add_op_scalar()
     test_add_op_tensor()
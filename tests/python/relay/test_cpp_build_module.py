@@ -59,6 +59,58 @@ def test_basic_build():
                                atol=1e-5, rtol=1e-5)
 
 
+def test_incremental_build():
+    ctx = tvm.cpu()
+    a = relay.var("a", dtype="float32", shape=(16, 8))
+    b = relay.var("b", dtype="float32", shape=(8, 8))
+    c = relay.var("c", dtype="float32", shape=(8,))
+    y = relay.nn.relu(relay.nn.bias_add(relay.nn.dense(a, b), c))
+    mod = tvm.IRModule.from_expr(relay.Function([a, b, c], y))
+    A = np.random.uniform(-1, 1, (16, 8)).astype("float32")
+
+    def build(mod, lower_passes=()):
+        params = {"b": np.random.uniform(-1, 1, (8, 8)).astype("float32"),
+                  "c": np.random.uniform(-1, 1, (8,)).astype("float32")}
+        with tvm.target.build_config(add_lower_pass=list(lower_passes)):
+            g_json, mmod, params = relay.build(mod, "llvm", params=params, incremental=True)
+        # The weights stay inputs of the graph.
+        assert "b" in params and "c" in params
+        rt = tvm.contrib.graph_runtime.create(g_json, mmod, ctx)
+        rt.set_input("a", A)
+        rt.load_params(relay.save_param_dict(params))
+        rt.run()
+        out = rt.get_output(0).asnumpy()
+        ref = np.maximum(np.dot(A, params["b"].asnumpy().T) + params["c"].asnumpy(), 0)
+        np.testing.assert_allclose(out, ref, atol=1e-5, rtol=1e-5)
+        return g_json, mmod
+
+    relay.build_module.clear_incremental_builds()
+    g_json, mmod = build(mod)
+    # New weights reuse the graph and the module.
+    new_json, new_mod = build(mod)
+    assert new_json == g_json
+    assert hash(new_mod) == hash(mmod)
+
+    # A dropout, removed by the optimization, reuses the build of the
+    # optimized function.
+    dropout_mod = tvm.IRModule.from_expr(relay.Function([a, b, c], relay.nn.dropout(y)))
+    new_json, new_mod = build(dropout_mod)
+    assert new_json == g_json
+    assert hash(new_mod) == hash(mmod)
+
+    # Another order of the params changes the graph, but reuses the module
+    # of the same lowered functions.
+    swapped_mod = tvm.IRModule.from_expr(relay.Function([b, a, c], y))
+    new_json, new_mod = build(swapped_mod)
+    assert new_json != g_json
+    assert hash(new_mod) == hash(mmod)
+
+    # The lowering passes are not part of the context, their builds are new.
+    new_json, new_mod = build(mod, [(1, lambda stmt: stmt)])
+    assert hash(new_mod) != hash(mmod)
+    relay.build_module.clear_incremental_builds()
+
+
 def test_fp16_build():
     dtype = "float16"
 
@@ -133,5 +185,6 @@ def test_fp16_conversion():
 
 if __name__ == "__main__":
     test_basic_build()
+    test_incremental_build()
     test_fp16_build()
     test_fp16_conversion()
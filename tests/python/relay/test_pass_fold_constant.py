@@ -205,6 +205,25 @@ def test_fold_batch_norm():
     assert relay.analysis.graph_equal(mod["main"], expect)
 
 
+def test_fold_deep_chain():
+    """Fold the same constant into each add of a 50000 deep chain."""
+    n = 50000
+    x = relay.var("x", shape=(10, 20))
+    c = relay.add(relay.const(1.0), relay.const(2.0))
+    y = x
+    for _ in range(n):
+        y = relay.add(y, c)
+    zz = run_opt_pass(relay.Function([x], y), transform.FoldConstant())
+    num_adds = 0
+    call = zz.body
+    while isinstance(call, relay.Call):
+        assert isinstance(call.args[1], relay.Constant)
+        assert call.args[1].data.asnumpy() == 3.0
+        num_adds += 1
+        call = call.args[0]
+    assert num_adds == n
+
+
 if __name__ == "__main__":
     test_fold_const()
     test_fold_let()
@@ -213,3 +232,4 @@ if __name__ == "__main__":
     test_fold_shape_of()
     test_fold_full()
     test_fold_batch_norm()
+    test_fold_deep_chain()
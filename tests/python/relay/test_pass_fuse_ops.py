@@ -621,6 +621,25 @@ def test_fuse_max():
     after = run_opt_pass(expected(), transform.InferType())
     assert relay.analysis.alpha_equal(zz, after)
 
+
+def test_fuse_deep_chain():
+    """Fuse a 50000 deep chain of exp into groups of at most 256 ops."""
+    n = 50000
+    max_fused_ops = 256
+    x = relay.var("x", shape=(10, 20))
+    y = x
+    for _ in range(n):
+        y = relay.exp(y)
+    zz = run_opt_pass(relay.Function([x], y), transform.FuseOps())
+    num_fused = 0
+    call = zz.body
+    while isinstance(call, relay.Call):
+        assert isinstance(call.op, relay.Function)
+        num_fused += 1
+        call = call.args[0]
+    assert call.same_as(zz.params[0])
+    assert num_fused == (n + max_fused_ops - 1) // max_fused_ops
+
 if __name__ == "__main__":
     test_fuse_simple()
     test_conv2d_fuse()
@@ -637,3 +656,4 @@ if __name__ == "__main__":
     test_immutable()
     test_split()
     test_fuse_max()
+    test_fuse_deep_chain()
@@ -554,5 +554,38 @@ def test_print_debug_callback():
     assert __TRACE_COUNTER__ == 4
 
 
+def test_pass_profile():
+    shape = (1, 2, 3)
+    x = relay.var("x", relay.TensorType(shape, "float32"))
+    c = relay.add(relay.const(1.0), relay.multiply(relay.const(2.0), relay.const(3.0)))
+    func = relay.Function([x], relay.multiply(relay.add(x, x), c))
+    mod = tvm.IRModule({"main": func})
+
+    inner = _transform.Sequential([
+        relay.transform.FoldConstant(),
+        relay.transform.DeadCodeElimination()
+    ], name="inner")
+    seq = _transform.Sequential([relay.transform.InferType(), inner], name="outer")
+
+    with relay.build_config(opt_level=3, profile=True) as ctx:
+        seq(mod)
+    profiles = ctx.profiles()
+    assert [p.name for p in profiles] == ["outer"]
+    outer = profiles[0]
+    names = [p.name for p in outer.children]
+    assert names[0] == "InferType" and names[-1] == "inner"
+    fold = [p for p in outer.children[-1].children if p.name == "FoldConstant"]
+    assert len(fold) == 1
+    # The constants are folded into one.
+    assert fold[0].num_nodes_after < fold[0].num_nodes_before
+    # The folded constant is new.
+    assert 0 < fold[0].num_new_nodes <= fold[0].num_nodes_after
+    assert outer.num_nodes_before > 0 and outer.duration_us >= 0
+    report = ctx.render_profiles()
+    assert "outer" in report and "  inner" in report and "    FoldConstant" in report
+    ctx.clear_profiles()
+    assert not ctx.profiles()
+
+
 if __name__ == "__main__":
     pytest.main()
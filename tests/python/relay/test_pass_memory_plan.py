@@ -0,0 +1,86 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+import numpy as np
+import tvm
+from tvm import relay
+from tvm.runtime import vm as vm_rt
+from tvm.relay.transform import memory_plan
+
+
+def compile_vm(func, disabled_pass=None):
+    mod = tvm.IRModule()
+    mod['main'] = func
+    # Keep each operator in its own function to have several allocations.
+    with relay.build_config(opt_level=0, disabled_pass=disabled_pass):
+        return relay.vm.compile(mod, "llvm")
+
+
+def run_vm(exe, *args):
+    vm = vm_rt.VirtualMachine(exe)
+    vm.init(tvm.cpu())
+    return vm.invoke("main", *args).asnumpy()
+
+
+def test_plan_offsets():
+    # The first two tensors are alive together, the third one reuses the first.
+    offsets, total = memory_plan.plan_offsets(
+        [256, 128, 256], [64, 64, 64], [(0, 2), (1, 3), (3, 4)])
+    assert offsets[1] >= offsets[0] + 256 or offsets[0] >= offsets[1] + 128
+    assert offsets[2] == offsets[0]
+    assert total == 384
+
+
+def test_plan_chain():
+    x = relay.var('x', shape=(10,))
+    y = relay.var('y', shape=(10,))
+    z = relay.exp(x)
+    z = relay.add(z, y)
+    z = relay.nn.relu(z)
+    z = relay.multiply(z, y)
+    func = relay.Function([x, y], z)
+    planned = compile_vm(func)
+    unplanned = compile_vm(func, disabled_pass=["MemoryPlan"])
+    assert planned.bytecode.count("alloc_storage") < unplanned.bytecode.count("alloc_storage")
+
+    x_np = np.random.rand(10).astype('float32')
+    y_np = np.random.rand(10).astype('float32')
+    ref = np.maximum(np.exp(x_np) + y_np, 0) * y_np
+    np.testing.assert_allclose(run_vm(planned, x_np, y_np), ref, rtol=1e-5)
+    np.testing.assert_allclose(run_vm(unplanned, x_np, y_np), ref, rtol=1e-5)
+
+
+def test_plan_tuple_output():
+    # The tensors returned by the function keep their own storage.
+    x = relay.var('x', shape=(4, 4))
+    a = relay.exp(x)
+    b = relay.negative(a)
+    c = relay.sqrt(a)
+    func = relay.Function([x], relay.Tuple([b, relay.add(b, c)]))
+    exe = compile_vm(func)
+    x_np = np.random.rand(4, 4).astype('float32')
+    vm = vm_rt.VirtualMachine(exe)
+    vm.init(tvm.cpu())
+    res = vm.invoke("main", x_np)
+    np.testing.assert_allclose(res[0].asnumpy(), -np.exp(x_np), rtol=1e-5)
+    np.testing.assert_allclose(res[1].asnumpy(), -np.exp(x_np) + np.sqrt(np.exp(x_np)),
+                               rtol=1e-5)
+
+
+if __name__ == "__main__":
+    test_plan_offsets()
+    test_plan_chain()
+    test_plan_tuple_output()
@@ -0,0 +1,90 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+import json
+
+import numpy as np
+
+import tvm
+from tvm import relay
+from tvm.contrib import graph_runtime
+from tvm.relay.transform import ScheduleForMemory
+
+
+def branchy_func():
+    # relu(y) is visited first but only needed by the last call, while the
+    # other branch goes through two large tensors.
+    x = relay.var("x", shape=(1, 256))
+    y = relay.var("y", shape=(256, 256))
+    p = relay.nn.relu(y)
+    e = relay.multiply(relay.broadcast_to(x, (256, 256)), relay.const(2.0))
+    q = relay.sum(e, axis=0, keepdims=True)
+    return relay.Function([x, y], relay.add(p, q))
+
+
+def peak_bytes(mod):
+    return relay.backend._backend.GraphPlanMemoryStats(mod["main"])[2].value
+
+
+def test_reduce_peak():
+    mod = tvm.IRModule.from_expr(branchy_func())
+    mod = relay.transform.InferType()(mod)
+    mod = relay.transform.FuseOps(0)(mod)
+    scheduled = ScheduleForMemory()(mod)
+    scheduled = relay.transform.InferType()(scheduled)
+    assert isinstance(scheduled["main"].body, relay.Let)
+    # The best orders run the branch down to its small sum before relu(y), so
+    # at most two large tensors and the sum are alive, against three large
+    # tensors when relu(y) runs first.
+    large, small = 256 * 256 * 4, 256 * 4
+    assert peak_bytes(mod) == 3 * large
+    assert peak_bytes(scheduled) == 2 * large + small
+
+
+def test_keep_order():
+    x = relay.var("x", shape=(16, 16))
+    func = relay.Function([x], relay.exp(relay.nn.relu(x)))
+    mod = tvm.IRModule.from_expr(func)
+    mod = relay.transform.InferType()(mod)
+    mod = relay.transform.FuseOps(0)(mod)
+    scheduled = ScheduleForMemory()(mod)
+    assert not isinstance(scheduled["main"].body, relay.Let)
+
+
+def test_build():
+    x_data = np.random.uniform(size=(1, 256)).astype("float32")
+    y_data = np.random.uniform(-1, 1, size=(256, 256)).astype("float32")
+    outs = []
+    for required_pass in [[], ["ScheduleForMemory"]]:
+        with relay.build_config(opt_level=0, required_pass=required_pass):
+            graph, lib, _ = relay.build(tvm.IRModule.from_expr(branchy_func()), "llvm")
+        names = [node["name"] for node in json.loads(graph)["nodes"]]
+        relu = [i for i, name in enumerate(names) if "relu" in name][0]
+        broadcast = [i for i, name in enumerate(names) if "broadcast_to" in name][0]
+        assert (broadcast < relu) == bool(required_pass)
+        m = graph_runtime.create(graph, lib, tvm.cpu())
+        m.set_input("x", x_data)
+        m.set_input("y", y_data)
+        m.run()
+        outs.append(m.get_output(0).asnumpy())
+    tvm.testing.assert_allclose(outs[0], outs[1], rtol=1e-5)
+    tvm.testing.assert_allclose(outs[0], np.maximum(y_data, 0) + 512 * x_data, rtol=1e-5)
+
+
+if __name__ == "__main__":
+    test_reduce_peak()
+    test_keep_order()
+    test_build()
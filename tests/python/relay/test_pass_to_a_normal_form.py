@@ -199,6 +199,26 @@ def test_gradient_if():
     mod = relay.transform.ToANormalForm()(mod)
 
 
+def test_deep_chain():
+    """Bind each relu of a 50000 deep chain to a let, then type the lets."""
+    n = 50000
+    x = relay.var("x", shape=(10, 20))
+    y = x
+    for _ in range(n):
+        y = relay.nn.relu(y)
+    anf = run_opt_pass(relay.Function([x], y),
+                       [transform.ToANormalForm(), transform.InferType()])
+    assert alpha_equal(anf.body.checked_type, relay.TensorType((10, 20), "float32"))
+    num_lets = 0
+    body = anf.body
+    while isinstance(body, relay.Let):
+        assert isinstance(body.value, relay.Call)
+        num_lets += 1
+        body = body.body
+    assert isinstance(body, relay.Var)
+    assert num_lets == n
+
+
 if __name__ == '__main__':
     test_explicit_bound()
     test_order()
@@ -209,3 +229,4 @@ if __name__ == '__main__':
     test_nat_add()
     test_function()
     test_gradient_if()
+    test_deep_chain()
@@ -363,6 +363,17 @@ def test_let_polymorphism():
     assert_alpha_equal(body.checked_type, relay.TupleType([int32, relay.TupleType([])]))
 
 
+def test_deep_dataflow():
+    """Type 50000 relu and add calls chained through a tuple at the end."""
+    x = relay.var("x", shape=(10, 20))
+    y = x
+    for _ in range(50000):
+        y = relay.add(relay.nn.relu(y), relay.const(1.0))
+    y = relay.TupleGetItem(relay.Tuple([y, x]), 0)
+    yy = run_infer_type(y)
+    assert_alpha_equal(yy.checked_type, relay.TensorType((10, 20), "float32"))
+
+
 if __name__ == "__main__":
     test_free_expr()
     test_dual_op()
@@ -381,3 +392,4 @@ if __name__ == "__main__":
     test_constructor_call()
     test_adt_match()
     test_let_polymorphism()
+    test_deep_dataflow()
@@ -14,6 +14,8 @@
 # KIND, either express or implied.  See the License for the
 # specific language governing permissions and limitations
 # under the License.
+import threading
+
 import numpy as np
 import pytest
 
@@ -215,6 +217,64 @@ def test_sum_loop():
     mod["main"] = relay.Function([iarg, aarg], sum_up(iarg, aarg))
     check_result([i_data, accum_data], sum(range(1, loop_bound + 1)), mod=mod)
 
+def test_share_executable():
+    x = relay.var('x', shape=(8, 16))
+    w = relay.const(np.random.rand(16, 16).astype('float32'))
+    mod = tvm.IRModule()
+    mod["main"] = relay.Function([x], relay.nn.relu(relay.nn.dense(x, w)))
+    exe = relay.vm.compile(mod, "llvm")
+    vm = runtime.vm.VirtualMachine(exe)
+    vm.init(tvm.cpu())
+    vms = [vm] + [vm.share() for _ in range(3)]
+    w_np = w.data.asnumpy()
+    errors = []
+
+    def worker(shared_vm, seed):
+        try:
+            rng = np.random.RandomState(seed)
+            for _ in range(10):
+                x_np = rng.rand(8, 16).astype('float32')
+                res = shared_vm.invoke("main", x_np).asnumpy()
+                tvm.testing.assert_allclose(res, np.maximum(x_np.dot(w_np.T), 0), rtol=1e-5)
+        except Exception as e:  # pylint: disable=broad-except
+            errors.append(e)
+
+    threads = [threading.Thread(target=worker, args=(shared_vm, i))
+               for i, shared_vm in enumerate(vms)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    assert not errors, errors
+
+def test_deep_recursion():
+    # Each call takes a frame, enough to grow the register stack while the
+    # frames of the callers hold their arguments.
+    mod = tvm.IRModule({})
+    sum_up = relay.GlobalVar('sum_up')
+    i = relay.var('i', shape=[], dtype='int32')
+    accum = relay.var('accum', shape=[], dtype='int32')
+    sb = ScopeBuilder()
+    with sb.if_scope(relay.equal(i, relay.const(0, 'int32'))):
+        sb.ret(accum)
+    with sb.else_scope():
+        one_less = relay.subtract(i, relay.const(1, 'int32'))
+        new_accum = relay.add(accum, i)
+        sb.ret(relay.Tuple([relay.Call(sum_up, [one_less, new_accum])])[0])
+    mod[sum_up] = relay.Function([i, accum], sb.get())
+    iarg = relay.var('i', shape=[], dtype='int32')
+    aarg = relay.var('accum', shape=[], dtype='int32')
+    mod["main"] = relay.Function([iarg, aarg], sum_up(iarg, aarg))
+    exe = relay.vm.compile(mod, "llvm")
+    vm = runtime.vm.VirtualMachine(exe)
+    vm.init(tvm.cpu())
+    loop_bound = 1000
+    for _ in range(2):
+        executed = vm.get_num_executed()
+        res = vm.invoke("main", np.array(loop_bound, dtype='int32'), np.array(0, dtype='int32'))
+        assert res.asnumpy() == sum(range(1, loop_bound + 1))
+        assert vm.get_num_executed() - executed > loop_bound
+
 def test_tuple_fst():
     ttype = relay.TupleType([relay.TensorType((1,)), relay.TensorType((10,))])
     tup = relay.var('tup', type_annotation=ttype)
@@ -622,5 +682,75 @@ def test_loop_free_var():
         mod["main"] = relay.Function(relay.analysis.free_vars(ret), ret)
         check_result(args, expected, mod=mod)
 
+def test_bucketed_allocator():
+    x = relay.var('x', shape=(10, 10), dtype='float32')
+    i = relay.var('i', shape=(), dtype='int32')
+    acc = relay.var('acc', shape=(10, 10), dtype='float32')
+
+    def cond(i, _):
+        return i < relay.const(20, dtype='int32')
+
+    def body(i, acc):
+        return i + relay.const(1, "int32"), relay.nn.relu(acc + x)
+
+    loop = while_loop(cond, [i, acc], body)
+    tup = loop(relay.const(0, dtype='int32'), relay.zeros(shape=(10, 10), dtype='float32'))
+    mod = tvm.IRModule()
+    mod["main"] = relay.Function([x], relay.TupleGetItem(tup, 1))
+    exe = relay.vm.compile(mod, "llvm")
+    x_data = np.random.rand(10, 10).astype('float32')
+    ctx = tvm.cpu(0)
+    vm = runtime.vm.VirtualMachine(exe)
+    vm.init(ctx, "bucketed")
+
+    def run():
+        res = vm.invoke("main", x_data)
+        tvm.testing.assert_allclose(res.asnumpy(), x_data * 20, rtol=1e-5)
+        return vm.get_allocator_stats()
+
+    used, cached, reused = run()
+    # the buffers of the loop iterations are freed to the caches and reused,
+    # the VM holds on to the output until the next run
+    assert reused > 0
+    assert 0 < cached < used
+    used, cached, reused = run()
+    for _ in range(2):
+        # a run is served from the caches without growing the device memory
+        used_next, cached_next, reused_next = run()
+        assert (used_next, cached_next) == (used, cached)
+        assert reused_next > reused
+        reused = reused_next
+    # the naive allocator of the same context keeps nothing for reuse
+    naive = runtime.vm.VirtualMachine(exe)
+    naive.init(ctx)
+    naive.invoke("main", x_data)
+    assert naive.get_allocator_stats()[1:] == (0, 0)
+    with pytest.raises(ValueError):
+        vm.init(ctx, "unknown")
+
+def test_fuse_bytecode():
+    x = relay.var('x', shape=(4, 8), dtype='float32')
+    w = relay.const(np.random.rand(16, 8).astype('float32'))
+    b = relay.const(np.random.rand(16).astype('float32'))
+    func = relay.Function([x], relay.nn.relu(relay.nn.dense(x, w) + b))
+    mod = tvm.IRModule()
+    mod["main"] = func
+    exe = relay.vm.compile(mod, "llvm")
+    with relay.build_config(fuse_bytecode=False):
+        unfused = relay.vm.compile(mod, "llvm")
+    assert "invoke_packed_const" in exe.bytecode
+    assert "alloc_storage_tensor" in exe.bytecode
+    assert "invoke_packed_const" not in unfused.bytecode
+    assert exe.bytecode.count("\n") < unfused.bytecode.count("\n")
+
+    x_data = np.random.rand(4, 8).astype('float32')
+    ref = np.maximum(np.dot(x_data, w.data.asnumpy().T) + b.data.asnumpy(), 0)
+    code, lib = exe.save()
+    for e in [exe, unfused, runtime.vm.Executable.load_exec(code, lib)]:
+        vm = runtime.vm.VirtualMachine(e)
+        vm.init(tvm.cpu())
+        res = vm.invoke("main", x_data)
+        tvm.testing.assert_allclose(res.asnumpy(), ref, rtol=1e-5)
+
 if __name__ == "__main__":
     pytest.main([__file__])
@@ -162,6 +162,39 @@ def test_const():
     tvm.testing.assert_allclose(res.asnumpy(), x_data + 1)
 
 
+def test_load_file():
+    x = relay.var('x', shape=(10, 10), dtype='float32')
+    w = relay.const(np.random.rand(10, 10).astype('float32'))
+    b = relay.const(np.random.rand(10).astype('float32'))
+    f = relay.Function([x], relay.nn.relu(relay.nn.dense(x, w) + b))
+    exe = create_exec(f)
+    code, lib = exe.save()
+    tmp = util.tempdir()
+    path_code = tmp.relpath("code.ro")
+    with open(path_code, "wb") as fo:
+        fo.write(code)
+
+    x_data = np.random.rand(10, 10).astype('float32')
+    ref = np.maximum(np.dot(x_data, w.data.asnumpy().T) + b.data.asnumpy(), 0)
+    des_exec = _vm.Executable.load_exec_file(path_code, lib)
+    # The functions are deserialized on first use, and saved again in full.
+    assert "main" in des_exec.bytecode
+    code2, _ = des_exec.save()
+    assert code2 == code
+    des_vm = _vm.VirtualMachine(des_exec)
+    des_vm.init(tvm.cpu())
+    res = veval(des_vm, x_data)
+    tvm.testing.assert_allclose(res.asnumpy(), ref, rtol=1e-5)
+
+    # The constants stay bound to the file mapped by the executable.
+    des_exec = _vm.Executable.load_exec_file(path_code, lib)
+    des_vm = _vm.VirtualMachine(des_exec)
+    des_vm.init(tvm.cpu())
+    del des_exec
+    res = veval(des_vm, x_data)
+    tvm.testing.assert_allclose(res.asnumpy(), ref, rtol=1e-5)
+
+
 def test_if():
     x = relay.var('x', shape=(10, 10))
     y = relay.var('y', shape=(10, 10))
@@ -336,6 +369,7 @@ if __name__ == "__main__":
     test_serializer()
     test_save_load()
     test_const()
+    test_load_file()
     test_if()
     test_loop()
     test_tuple()
@@ -18,6 +18,8 @@ import tvm
 from tvm import te
 import numpy as np
 import json
+import os
+import threading
 from tvm import rpc
 from tvm.contrib import util, graph_runtime
 
@@ -119,9 +121,279 @@ def test_graph_simple():
             np.testing.assert_equal(out.asnumpy(), x_in + a)
             del mod
 
+    def check_mmap():
+        from tvm import relay
+        x = relay.var('x', shape=(1, 10))
+        w = relay.var('w', shape=(1, 10))
+        z = relay.add(x, w)
+        func = relay.Function([x, w], z)
+
+        w_in = np.random.uniform(size=(1, 10)).astype("float32")
+        graph, lib, params = relay.build(func, target="llvm", params={'w': w_in})
+
+        if not tvm.runtime.enabled("llvm"):
+            print("Skip because llvm is not enabled")
+            return
+        temp = util.tempdir()
+        path_aligned = temp.relpath("aligned.params")
+        with open(path_aligned, "wb") as fo:
+            fo.write(relay.save_param_dict(params, alignment=4096))
+        path_plain = temp.relpath("plain.params")
+        with open(path_plain, "wb") as fo:
+            fo.write(relay.save_param_dict(params))
+
+        loaded = relay.load_param_dict(bytearray(open(path_aligned, "rb").read()))
+        for k, v in params.items():
+            np.testing.assert_equal(loaded[k].asnumpy(), v.asnumpy())
+
+        def mapped_ranges(path):
+            ranges = []
+            with open("/proc/self/maps") as maps:
+                for line in maps:
+                    fields = line.split()
+                    if len(fields) >= 6 and fields[5] == os.path.realpath(path):
+                        begin, end = fields[0].split("-")
+                        ranges.append((int(begin, 16), int(end, 16)))
+            return ranges
+
+        a = np.random.uniform(size=(1, 10)).astype("float32")
+        for path in [path_aligned, path_plain]:
+            mod = graph_runtime.create(graph, lib, tvm.cpu(0))
+            mod.load_params_mmap(path)
+            if os.path.exists("/proc/self/maps"):
+                # The aligned weights point into the mapped file, the others are copies.
+                for name in params:
+                    data = mod.get_input(name).handle.contents.data
+                    in_file = any(begin <= data < end for begin, end in mapped_ranges(path))
+                    assert in_file == (path == path_aligned)
+            mod.run(x=a)
+            out = mod.get_output(0, tvm.nd.empty((1, 10)))
+            np.testing.assert_allclose(out.asnumpy(), a + w_in)
+            # The mapped weights stay valid after the file is removed.
+            os.remove(path)
+            mod.run(x=a)
+            out = mod.get_output(0, tvm.nd.empty((1, 10)))
+            np.testing.assert_allclose(out.asnumpy(), a + w_in)
+
+        mod = graph_runtime.create(graph, lib, tvm.cpu(0))
+        mod.load_params(relay.save_param_dict(params, alignment=64))
+        mod.run(x=a)
+        out = mod.get_output(0, tvm.nd.empty((1, 10)))
+        np.testing.assert_allclose(out.asnumpy(), a + w_in)
+
+    def chain_graph(num_ops):
+        nodes = [node0]
+        for i in range(num_ops):
+            nodes.append({"op": "tvm_op", "name": "add%d" % i,
+                          "inputs": [[i, 0, 0]],
+                          "attrs": {"func_name": "myadd",
+                                    "flatten_data": "1",
+                                    "num_inputs" : "1",
+                                    "num_outputs" : "1"}})
+        return json.dumps({
+            "nodes": nodes,
+            "arg_nodes": [0],
+            "node_row_ptr": list(range(num_ops + 2)),
+            "heads": [[num_ops, 0, 0]],
+            "attrs": {
+                "shape" : ["list_shape", [shape] * (num_ops + 1)],
+                "dltype" : ["list_str", ["float32"] * (num_ops + 1)],
+                "storage_id" : ["list_int", [0] + [1 + i % 2 for i in range(num_ops)]],
+            }})
+
+    def check_call_table():
+        if not tvm.runtime.enabled("llvm"):
+            print("Skip because llvm is not enabled")
+            return
+        num_ops = 8
+        chain = chain_graph(num_ops)
+        mlib = tvm.build(s, [A, B], "llvm", name="myadd")
+        mod = graph_runtime.create(chain, mlib, tvm.cpu(0))
+        a = np.random.uniform(size=(n,)).astype(A.dtype)
+        for enable in [True, False, True]:
+            mod.use_call_table(enable)
+            mod.run(x=a)
+            out = mod.get_output(0, tvm.nd.empty((n,)))
+            np.testing.assert_allclose(out.asnumpy(), a + num_ops, rtol=1e-6)
+        # The prepacked arguments follow zero-copy inputs.
+        b = tvm.nd.array(np.random.uniform(size=(n,)).astype(A.dtype))
+        mod.module["set_input_zero_copy"]("x", b)
+        mod.run()
+        out = mod.get_output(0, tvm.nd.empty((n,)))
+        np.testing.assert_allclose(out.asnumpy(), b.asnumpy() + num_ops, rtol=1e-6)
+
+    def check_session():
+        from tvm import relay
+        x = relay.var('x', shape=(1, 10))
+        w = relay.var('w', shape=(1, 10))
+        func = relay.Function([x, w], relay.add(x, w))
+
+        w_in = np.random.uniform(size=(1, 10)).astype("float32")
+        graph, lib, params = relay.build(func, target="llvm", params={'w': w_in})
+
+        if not tvm.runtime.enabled("llvm"):
+            print("Skip because llvm is not enabled")
+            return
+        max_arenas = 2
+        sess = graph_runtime.create_session(graph, lib, tvm.cpu(0), max_arenas=max_arenas)
+        sess.load_params(relay.save_param_dict(params))
+        name = list(params.keys())[0]
+
+        # The concurrent requests share one copy of the weights.
+        m0 = sess.acquire()
+        m1 = sess.acquire()
+        assert m0.get_input(name).handle.contents.data == \
+            m1.get_input(name).handle.contents.data
+        sess.release(m0)
+        sess.release(m1)
+
+        errors = []
+        def serve(tid):
+            try:
+                for i in range(20):
+                    a = np.full((1, 10), tid * 100 + i, dtype="float32")
+                    with sess.request() as mod:
+                        mod.run(x=a)
+                        out = mod.get_output(0).asnumpy()
+                    np.testing.assert_allclose(out, a + w_in)
+            except Exception as err:  # pylint: disable=broad-except
+                errors.append(err)
+
+        threads = [threading.Thread(target=serve, args=(t,)) for t in range(4)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        assert not errors, errors
+        assert sess.get_num_arenas() <= max_arenas
+
+        # The arenas cannot write the shared weights.
+        with sess.request() as mod:
+            try:
+                mod.load_params(relay.save_param_dict(params))
+                assert False, "load_params into shared weights should fail"
+            except tvm.error.TVMError:
+                pass
+        # Reloading through the session replaces the weights of every arena.
+        w_new = w_in + 1
+        sess.load_params(relay.save_param_dict({name: tvm.nd.array(w_new)}))
+        a = np.ones((1, 10), dtype="float32")
+        with sess.request() as mod:
+            mod.run(x=a)
+            np.testing.assert_allclose(mod.get_output(0).asnumpy(), a + w_new)
+
+    def check_pipeline():
+        if not tvm.runtime.enabled("llvm"):
+            print("Skip because llvm is not enabled")
+            return
+        num_ops = 8
+        chain = chain_graph(num_ops)
+        mlib = tvm.build(s, [A, B], "llvm", name="myadd")
+        # Two stages on two CPU contexts, split in the middle of the chain.
+        pipe = graph_runtime.create_pipeline(chain, mlib, [tvm.cpu(0), tvm.cpu(1)],
+                                             max_in_flight=3, stage_begins=[5])
+        assert pipe.get_num_stages() == 2
+        inputs = [np.full((n,), i, dtype=A.dtype) for i in range(10)]
+        collected = []
+        for i, a in enumerate(inputs):
+            pipe.submit(x=a)
+            if i >= 2:
+                collected.append(pipe.collect(tvm.nd.empty((n,)))[0].asnumpy())
+        while len(collected) < len(inputs):
+            collected.append(pipe.collect(tvm.nd.empty((n,)))[0].asnumpy())
+        for a, out in zip(inputs, collected):
+            np.testing.assert_allclose(out, a + num_ops)
+
+    def check_pipeline_devices():
+        from tvm import relay
+        if not tvm.runtime.enabled("llvm"):
+            print("Skip because llvm is not enabled")
+            return
+        # By default the stages follow the devices, a single one gives a single stage.
+        mlib = tvm.build(s, [A, B], "llvm", name="myadd")
+        pipe = graph_runtime.create_pipeline(chain_graph(4), mlib, tvm.cpu(0))
+        assert pipe.get_num_stages() == 1
+
+        for dev in ["cuda", "opencl"]:
+            if not tvm.runtime.enabled(dev) or not tvm.context(dev, 0).exist:
+                print("Skip because %s is not enabled" % dev)
+                continue
+            dev_ctx = tvm.context(dev, 0)
+            x = relay.var('x', shape=(1, 10))
+            y = relay.var('y', shape=(1, 10))
+            add = relay.add(x, y)
+            sqrt = relay.annotation.on_device(relay.sqrt(add), dev_ctx)
+            sub = relay.subtract(sqrt, relay.log(add))
+            exp = relay.annotation.on_device(relay.exp(sub), dev_ctx)
+            func = relay.Function([x, y], exp)
+            with relay.build_config(opt_level=1, fallback_device=tvm.cpu(0)):
+                graph, lib, _ = relay.build(func, {"cpu": "llvm", dev: dev})
+
+            # one stage per run of consecutive operators on the same device
+            graph_json = json.loads(graph)
+            device_index = graph_json["attrs"]["device_index"][1]
+            row_ptr = graph_json["node_row_ptr"]
+            op_devices = [device_index[row_ptr[nid]]
+                          for nid, node in enumerate(graph_json["nodes"])
+                          if node["op"] != "null"]
+            num_stages = 1 + sum(1 for i in range(1, len(op_devices))
+                                 if op_devices[i] != op_devices[i - 1])
+            assert num_stages > 1
+            pipe = graph_runtime.create_pipeline(graph, lib, [tvm.cpu(0), dev_ctx])
+            assert pipe.get_num_stages() == num_stages
+
+            inputs = [np.random.uniform(1, 2, size=(1, 10)).astype("float32")
+                      for _ in range(6)]
+            collected = []
+            for i, a in enumerate(inputs):
+                pipe.submit(x=a, y=a)
+                if i >= 1:
+                    collected.append(pipe.collect(tvm.nd.empty((1, 10)))[0].asnumpy())
+            collected.append(pipe.collect(tvm.nd.empty((1, 10)))[0].asnumpy())
+            for a, out in zip(inputs, collected):
+                np.testing.assert_allclose(out, np.exp(np.sqrt(a + a) - np.log(a + a)),
+                                           rtol=1e-5)
+
+    def check_inter_op():
+        from tvm import relay
+        x = relay.var('x', shape=(4, 16))
+        branches = []
+        params = {}
+        for i in range(4):
+            w = relay.var('w%d' % i, shape=(16, 16))
+            params['w%d' % i] = np.random.uniform(-1, 1, size=(16, 16)).astype("float32")
+            branches.append(relay.nn.relu(relay.nn.dense(x, w)))
+        y = branches[0]
+        for b in branches[1:]:
+            y = relay.add(y, b)
+        func = relay.Function(relay.analysis.free_vars(y), y)
+
+        if not tvm.runtime.enabled("llvm"):
+            print("Skip because llvm is not enabled")
+            return
+        graph, lib, params = relay.build(func, target="llvm", params=params)
+        mod = graph_runtime.create(graph, lib, tvm.cpu(0))
+        mod.load_params(relay.save_param_dict(params))
+        a = np.random.uniform(size=(4, 16)).astype("float32")
+        mod.run(x=a)
+        expected = mod.get_output(0).asnumpy()
+        mod.set_inter_op_threads(4)
+        for _ in range(10):
+            mod.run(x=a)
+            np.testing.assert_allclose(mod.get_output(0).asnumpy(), expected, rtol=1e-5)
+        mod.set_inter_op_threads(1)
+        mod.run(x=a)
+        np.testing.assert_allclose(mod.get_output(0).asnumpy(), expected, rtol=1e-5)
+
     check_verify()
     check_remote()
     check_sharing()
+    check_mmap()
+    check_call_table()
+    check_session()
+    check_pipeline()
+    check_pipeline_devices()
+    check_inter_op()
 
 if __name__ == "__main__":
     test_graph_simple()
@@ -101,6 +101,19 @@ def test_graph_simple():
         out = mod.get_output(0, tvm.nd.empty((n,)))
         np.testing.assert_equal(out.asnumpy(), a + 1)
 
+        #verify the timeline records every run of the op
+        path = mod.profile_timeline(repeat=3, hardware_counters=True)
+        assert path == os.path.join(directory, graph_runtime.TIMELINE_TRACE_FILE_NAME)
+        with open(path) as f:
+            trace = json.load(f)
+        ops = [event for event in trace["traceEvents"] if event["ph"] == 'X']
+        assert len(ops) == 3
+        assert all(event["name"] == 'add' for event in ops)
+        assert [event["args"]["repeat"] for event in ops] == [0, 1, 2]
+        assert all(event["args"]["bytes"] == 2 * n * 4 for event in ops)
+        assert all(0 <= event["args"]["utilization"] <= 1 for event in ops)
+        assert ops[0]["ts"] + ops[0]["dur"] <= ops[1]["ts"]
+
         mod.exit()
         #verify dump root delete after cleanup
         assert(not os.path.exists(directory))
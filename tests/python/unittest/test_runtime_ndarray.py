@@ -72,6 +72,36 @@ def test_fp16_conversion():
 
         tvm.testing.assert_allclose(expected, real)
 
+def test_workspace_pool_stats():
+    if not tvm.runtime.enabled("llvm"):
+        return
+    n = 4096
+    A = te.placeholder((n,), name="A")
+    # B is too large for the stack, so it lives in the CPU workspace pool
+    B = te.compute((n,), lambda i: A[i] + 1, name="B")
+    C = te.compute((n,), lambda i: B[i] * 2, name="C")
+    s = te.create_schedule(C.op)
+    func = tvm.build(s, [A, C], "llvm")
+
+    ctx = tvm.cpu(0)
+    stats = tvm.get_global_func("runtime.workspace_pool_stats")
+    trim = tvm.get_global_func("runtime.workspace_pool_trim")
+    num_alloc = stats(ctx, "num_alloc")
+    a = tvm.nd.array(np.random.uniform(size=n).astype(A.dtype), ctx)
+    c = tvm.nd.empty((n,), C.dtype, ctx)
+    func(a, c)
+    np.testing.assert_allclose(c.asnumpy(), (a.asnumpy() + 1) * 2, rtol=1e-5)
+    assert stats(ctx, "num_alloc") == num_alloc + 1
+    assert stats(ctx, "bytes_in_use") == 0
+    assert stats(ctx, "peak_bytes_in_use") >= n * 4
+    assert stats(ctx, "bytes_reserved") >= n * 4
+    # the first trim keeps the high-water mark of the run, the second releases it
+    trim(ctx)
+    trim(ctx)
+    assert stats(ctx, "bytes_reserved") == 0
+
+
 if __name__ == "__main__":
     test_nd_create()
     test_fp16_conversion()
+    test_workspace_pool_stats()
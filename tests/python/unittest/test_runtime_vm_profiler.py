@@ -14,6 +14,8 @@
 # KIND, either express or implied.  See the License for the
 # specific language governing permissions and limitations
 # under the License.
+import json
+
 import numpy as np
 
 import tvm
@@ -37,5 +39,18 @@ def test_basic():
     print("\n{}".format(vm.get_stat()))
     print("\n{}".format(vm.get_stat(False)))
 
+    stat = vm.get_stat()
+    assert "#Opcode" in stat
+    assert "invoke_packed" in stat
+    assert "Storage Allocations" in stat
+    assert "Interpreter" in stat
+    trace = json.loads(vm.get_chrome_trace())
+    events = trace["traceEvents"]
+    assert any(e["cat"] == "kernel" for e in events)
+    assert all(e["ph"] == "X" and e["dur"] >= 0 for e in events)
+
+    vm.reset()
+    assert not json.loads(vm.get_chrome_trace())["traceEvents"]
+
 if __name__ == "__main__":
     test_basic()